@@ -0,0 +1,10 @@
+#include "../common/simulator.hpp"
+
+// Activation of a protein by an activator held at a constant level (common/circuit_models.h)
+using activation = circuit_model_type<activation_species, activation_defaults, activation_rhs>;
+
+int main(int argc, char **argv) {
+    // Protein starts at zero, the activator at 1
+    Simulator<activation> simulator;
+    return simulator.run("activation_sundials", argc > 1 ? argv[1] : "activation_sundials.csv", {0.0, 1.0}, 50.0, 0.1);
+}
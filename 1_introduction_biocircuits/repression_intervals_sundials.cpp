@@ -0,0 +1,10 @@
+#include "../common/simulator.hpp"
+
+// Repression by a repressor switched on and off with a square wave (common/circuit_models.h)
+using repression_intervals = circuit_model_type<intervals_species, intervals_defaults, intervals_rhs, intervals_jac>;
+
+int main(int argc, char **argv) {
+    Simulator<repression_intervals> simulator;
+    return simulator.run("repression_intervals_sundials", argc > 1 ? argv[1] : "repression_intervals_sundials.csv",
+                         {0.0}, 50.0, 0.1);
+}
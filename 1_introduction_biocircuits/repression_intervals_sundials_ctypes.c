@@ -6,7 +6,6 @@
 #include <sundials/sundials_math.h>  // definition of SUNRabs
 #include <sunmatrix/sunmatrix_dense.h> // access to dense SUNMatrix
 #include <sunlinsol/sunlinsol_dense.h> // access to dense SUNLinearSolver
-#include <cvode/cvode_direct.h> // access to CVDls interface
 #include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
 
 // Parameters for the repression model
@@ -48,7 +47,7 @@ void solve_repression(double *results, int n_steps, double dt) {
     NV_Ith_S(y, 0) = p0;
 
     // Create the CVODE memory block
-    void *cvode_mem = CVodeCreate(CV_ADAMS, CV_NEWTON);
+    void *cvode_mem = CVodeCreate(CV_ADAMS);
     if (cvode_mem == NULL) {
         fprintf(stderr, "Error in CVodeCreate\n");
         return;
@@ -76,14 +75,14 @@ void solve_repression(double *results, int n_steps, double dt) {
     }
 
     // Create the dense SUNLinearSolver
-    SUNLinearSolver LS = SUNDenseLinearSolver(y, A);
+    SUNLinearSolver LS = SUNLinSol_Dense(y, A);
     if (LS == NULL) {
         fprintf(stderr, "Error in SUNLinSol_Dense\n");
         return;
     }
 
     // Attach the linear solver to CVODE
-    flag = CVDlsSetLinearSolver(cvode_mem, LS, A);
+    flag = CVodeSetLinearSolver(cvode_mem, LS, A);
     if (flag != CV_SUCCESS) {
         fprintf(stderr, "Error in CVodeSetLinearSolver\n");
         return;
@@ -0,0 +1,10 @@
+#include "../common/simulator.hpp"
+
+// Repression of a protein by a repressor held at a constant level (common/circuit_models.h)
+using repression = circuit_model_type<repression_species, repression_defaults, repression_rhs>;
+
+int main(int argc, char **argv) {
+    // Protein starts at zero, the repressor at 1
+    Simulator<repression> simulator;
+    return simulator.run("repression_sundials", argc > 1 ? argv[1] : "repression_sundials.csv", {0.0, 1.0}, 50.0, 0.1);
+}
@@ -0,0 +1,10 @@
+#include "../common/simulator.hpp"
+
+// Simple gene expression: constant production and first-order degradation (common/circuit_models.h)
+using simple_gene_expression = circuit_model_type<simple_species, simple_defaults, simple_rhs, simple_jac>;
+
+int main(int argc, char **argv) {
+    Simulator<simple_gene_expression> simulator;
+    return simulator.run("simple_gene_expression_sundials", argc > 1 ? argv[1] : "simple_gene_expression_sundials.csv",
+                         {0.0}, 50.0, 0.1);
+}
@@ -0,0 +1,10 @@
+#include "../common/simulator.hpp"
+
+// Transcription of an mRNA and its translation into protein (common/circuit_models.h)
+using transcription_translation = circuit_model_type<tt_species, tt_defaults, tt_rhs, tt_jac>;
+
+int main(int argc, char **argv) {
+    Simulator<transcription_translation> simulator;
+    return simulator.run("transcription_translation_sundials",
+                         argc > 1 ? argv[1] : "transcription_translation_sundials.csv", {0.0, 0.0}, 50.0, 0.1);
+}
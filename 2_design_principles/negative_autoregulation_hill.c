@@ -1,61 +0,0 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <cvode/cvode.h>             // prototypes for CVODE functions and constants
-#include <nvector/nvector_serial.h>  // serial N_Vector types, functions, and macros
-#include <sundials/sundials_math.h>  // definition of SUNRabs
-#include <sunmatrix/sunmatrix_dense.h> // access to dense SUNMatrix
-#include <sunlinsol/sunlinsol_dense.h> // access to dense SUNLinearSolver
-#include <cvode/cvode_direct.h> // access to CVDls interface
-#include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
-
-// Parameters for the autorepression model
-#define BETA 100.0
-#define GAMMA 1.0
-#define K 50.0
-#define N 2.0
-
-// Function to compute the derivative
-int autorepression(realtype t, N_Vector x, N_Vector xdot, void *user_data) {
-    realtype x_val = NV_Ith_S(x, 0);
-    NV_Ith_S(xdot, 0) = BETA * (1.0 / (1.0 + pow(x_val / K, N))) - GAMMA * x_val;
-    return 0;
-}
-
-int main() {
-    // Initial conditions
-    realtype t0 = 0.0;
-    realtype x0 = 0.0; // starting with zero protein concentration
-    realtype t;
-    realtype dt = 0.1;
-    realtype T = 50.0;
-
-    // Create a serial vector of length 1 for the solution
-    N_Vector x = N_VNew_Serial(1);
-    NV_Ith_S(x, 0) = x0;
-
-    // Create the CVODE memory block
-    void *cvode_mem = CVodeCreate(CV_ADAMS, CV_NEWTON);
-    if (cvode_mem == NULL) {
-        fprintf(stderr, "Error in CVodeCreate\n");
-        return 1;
-    }
-
-    // Initialize CVODE with the autorepression model
-    int flag = CVodeInit(cvode_mem, autorepression, t0, x);
-    if (flag != CV_SUCCESS) {
-        fprintf(stderr, "Error in CVodeInit\n");
-        return 1;
-    }
-
-    // Specify the relative and absolute tolerances
-    flag = CVodeSStolerances(cvode_mem, 1e-4, 1e-8);
-    if (flag != CV_SUCCESS) {
-        fprintf(stderr, "Error in CVodeSStolerances\n");
-        return 1;
-    }
-
-    // Other setup code like creating and attaching the linear solver would remain the same
-    // Time-stepping loop, file output, and memory cleanup would also be similar to your initial template
-
-    return 0;
-}
@@ -0,0 +1,11 @@
+#include "../common/simulator.hpp"
+
+// Negative autoregulation with Hill repression (common/circuit_models.h)
+using autorepression = circuit_model_type<nar_species, nar_defaults, nar_rhs, nar_jac>;
+
+int main(int argc, char **argv) {
+    // Starting with zero protein concentration
+    Simulator<autorepression> simulator;
+    return simulator.run("negative_autoregulation_hill", argc > 1 ? argv[1] : "negative_autoregulation_hill.csv",
+                         {0.0}, 50.0, 0.1);
+}
@@ -0,0 +1,11 @@
+#include "../common/simulator.hpp"
+
+// Autoregulatory gene expression with cooperative positive feedback (common/circuit_models.h)
+using autoregulatory_gene_expression = circuit_model_type<nar_species, par_defaults, par_rhs, par_jac>;
+
+int main(int argc, char **argv) {
+    // Initial concentration of the protein 0.1, below the unstable steady state
+    Simulator<autoregulatory_gene_expression> simulator;
+    return simulator.run("positive_autoregulation_bistability",
+                         argc > 1 ? argv[1] : "autoregulatory_gene_expression.csv", {0.1}, 50.0, 0.1);
+}
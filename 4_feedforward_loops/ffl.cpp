@@ -0,0 +1,10 @@
+#include "../common/simulator.hpp"
+
+// Gene expression in a simple coherent FFL, X is a constant external input (common/circuit_models.h)
+using ffl = circuit_model_type<ffl_species, ffl_defaults, ffl_rhs>;
+
+int main(int argc, char **argv) {
+    // Y and Z start at zero; rows go to stdout unless a path is given
+    Simulator<ffl> simulator;
+    return simulator.run("ffl", argc > 1 ? argv[1] : "-", {0.0, 0.0}, 10.0, 0.1);
+}
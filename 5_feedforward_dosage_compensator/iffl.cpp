@@ -0,0 +1,10 @@
+#include "../common/simulator.hpp"
+
+// Incoherent feedforward loop dosage compensator (common/circuit_models.h)
+using iffl = circuit_model_type<iffl_species, iffl_defaults, iffl_rhs, iffl_jac>;
+
+int main(int argc, char **argv) {
+    // X and Y start at zero; a path ending in .bctr selects binary output
+    Simulator<iffl> simulator;
+    return simulator.run("iffl", argc > 1 ? argv[1] : "iffl_simulation_results.csv", {0.0, 0.0}, 50.0, 0.1);
+}
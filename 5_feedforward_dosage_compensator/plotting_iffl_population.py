@@ -0,0 +1,49 @@
+import ctypes
+import numpy as np
+import matplotlib.pyplot as plt
+
+# Load the shared library
+lib = ctypes.CDLL('./iffl_population.so')
+
+# Define the function signature
+lib.simulate_iffl_population.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int, ctypes.c_int, ctypes.c_double,
+                                         ctypes.c_double, ctypes.c_long, ctypes.c_void_p, ctypes.c_int, ctypes.c_int,
+                                         ctypes.c_int, ctypes.c_ulong, ctypes.c_int, ctypes.c_void_p, ctypes.c_void_p,
+                                         ctypes.c_void_p]
+lib.simulate_iffl_population.restype = ctypes.c_int
+
+# Parameters: 10^5 cells with 1 to 4 gene copies, equally likely, exact SSA dynamics
+n_cells = 100000
+t_out = np.arange(10.0, 310.0, 10.0)
+n_bins = 40
+x_max, y_max = 20.0, 10.0
+copy_weights = np.array([0, 1, 1, 1, 1], dtype=np.float64)
+stochastic, plasmid = 1, 0
+hist = np.zeros((len(t_out), 2, n_bins), dtype=np.float64)
+x = np.zeros(n_cells, dtype=np.float64)
+y = np.zeros(n_cells, dtype=np.float64)
+copies = np.zeros(n_cells, dtype=np.int32)
+
+# Call the C function on all CPUs with seed 1
+lib.simulate_iffl_population(hist.ctypes.data, t_out.ctypes.data, len(t_out), n_bins, x_max, y_max, n_cells,
+                             copy_weights.ctypes.data, len(copy_weights) - 1, stochastic, plasmid, 1, 0,
+                             x.ctypes.data, y.ctypes.data, copies.ctypes.data)
+
+# Final histograms and the mean of X and Y per copy number
+fig, axes = plt.subplots(1, 2, figsize=(12, 5))
+for j, (label, upper) in enumerate([("X", x_max), ("Y", y_max)]):
+    edges = np.linspace(0, upper, n_bins + 1)
+    axes[0].stairs(hist[-1, j] / n_cells, edges, label=label)
+axes[0].set_xlabel('Copy number of the protein')
+axes[0].set_ylabel('Fraction of cells')
+axes[0].set_title('Population at t = %g' % t_out[-1])
+axes[0].legend()
+
+levels = np.arange(1, len(copy_weights))
+axes[1].plot(levels, [x[copies == k].mean() for k in levels], 'o-', label='X')
+axes[1].plot(levels, [y[copies == k].mean() for k in levels], 'o-', label='Y')
+axes[1].set_xlabel('Gene copy number')
+axes[1].set_ylabel('Mean expression')
+axes[1].set_title('Dosage compensation across the population')
+axes[1].legend()
+plt.show()
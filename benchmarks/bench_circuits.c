@@ -0,0 +1,347 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "../common/circuits.h"
+#include "../common/circuit_solver.h"
+#include "../common/ensemble_runner.h"
+#include "../common/output_spec.h"
+#include "../common/solver_stats.h"
+
+// Benchmark of every circuit in the registry and of the Gillespie backend
+//
+//   rhs_evals_per_s      raw right-hand side throughput
+//   solves_per_s_cold    create + solve + free, as the standalone drivers do
+//   solves_per_s_warm    one reused circuit_solver (CVodeReInit per run)
+//   ssa events_per_s     Gillespie dichotomous feedback
+//   thread_scaling       warm dichotomous feedback solves on 1..N threads
+//   accuracy             circuit_solver against the committed reference CSVs
+//
+// Results are written as JSON; the exit status is 1 when an accuracy check
+// fails, so a speedup cannot silently change the answers.
+//
+// usage: bench_circuits [results.json] [max_threads, 0 for all CPUs] [reference_dir]
+
+#define MIN_SECONDS 0.2      // each measurement repeats until it has run this long
+#define T_END 50.0
+#define DT 0.1
+#define N_OUT 501            // t = 0, 0.1, ..., 50 as in the drivers
+#define SCALING_RUNS 2000
+// |error| <= ACCURACY_TOL * max(1, |reference|). The check solves use the
+// method and tolerances of the drivers that wrote the references, so the two
+// agree to far better than the solver's rtol; any change of the answers
+// larger than rtol fails.
+#define ACCURACY_TOL 1e-4    // the drivers' rtol, also passed to the check solves
+
+// From other_circuits/gillespie_dichotomous_feedback.c
+int solve_dichotomous_feedback_stats(void *out, const output_spec *spec, int n_steps, double dt, double I,
+                                     solver_stats *stats);
+
+// Reference CSVs written by the drivers, and the circuit that reproduces them
+static const struct {
+    const char *file;
+    const char *circuit;
+} references[] = {
+    {"simple_gene_expression_sundials.csv", "simple_gene_expression"},
+    {"repression_sundials.csv", "repression"},
+    {"repression_intervals_sundials.csv", "repression_intervals"},
+    {"activation_sundials.csv", "activation"},
+    {"transcription_translation_sundials.csv", "transcription_translation"},
+};
+
+static volatile double sink;  // keeps the RHS loop from being optimized away
+
+static void output_times(realtype *t_out) {
+    for (int k = 0; k < N_OUT; k++) {
+        t_out[k] = k * DT;
+    }
+}
+
+static double rhs_evals_per_second(const circuit_model *m) {
+    realtype y[64], ydot[64];
+    long evals = 0;
+    double sum = 0.0;
+    double start = solver_stats_clock(), elapsed;
+    do {
+        for (int i = 0; i < 10000; i++) {
+            // Vary the state so every call does real work
+            for (int j = 0; j < m->n_species; j++) {
+                y[j] = m->default_y0[j] + 0.01 * (i & 15) + 0.1;
+            }
+            m->rhs(0.5 * i, y, ydot, m->default_params, m->data);
+            sum += ydot[0];
+        }
+        evals += 10000;
+        elapsed = solver_stats_clock() - start;
+    } while (elapsed < MIN_SECONDS);
+    sink = sum;
+    return evals / elapsed;
+}
+
+// Solves per second; cold runs create and free the solver for every solve
+static double solves_per_second(const circuit_model *m, int cold, solver_stats *last) {
+    realtype t_out[N_OUT];
+    realtype *out = malloc(sizeof(realtype) * N_OUT * m->n_species);
+    output_times(t_out);
+    circuit_solver *warm = cold ? NULL : circuit_solver_create(m, NULL);
+    long solves = 0;
+    double start = solver_stats_clock(), elapsed;
+    do {
+        circuit_solver *s = cold ? circuit_solver_create(m, NULL) : warm;
+        if (s == NULL || circuit_solver_run(s, NULL, NULL, t_out, N_OUT, out) != 0) {
+            fprintf(stderr, "Error solving %s\n", m->name);
+            free(out);
+            return 0.0;
+        }
+        *last = *circuit_solver_stats(s);
+        if (cold) {
+            circuit_solver_free(s);
+        }
+        solves++;
+        elapsed = solver_stats_clock() - start;
+    } while (elapsed < MIN_SECONDS);
+    circuit_solver_free(warm);
+    free(out);
+    return solves / elapsed;
+}
+
+static void scaling_worker(ensemble_runner *r, int thread, void *arg) {
+    const circuit_model *m = arg;
+    (void)thread;
+    realtype t_out[N_OUT];
+    realtype *out = malloc(sizeof(realtype) * N_OUT * m->n_species);
+    realtype *params = malloc(sizeof(realtype) * m->n_params);
+    circuit_solver *s = circuit_solver_create(m, NULL);
+    if (out == NULL || params == NULL || s == NULL) {
+        // The other threads take over the runs
+        circuit_solver_free(s);
+        free(params);
+        free(out);
+        return;
+    }
+    output_times(t_out);
+    memcpy(params, m->default_params, sizeof(realtype) * m->n_params);
+    long first, last;
+    while (ensemble_runner_next(r, &first, &last)) {
+        for (long i = first; i < last; i++) {
+            if (m->input_param >= 0) {
+                params[m->input_param] = 0.01 + 0.001 * i;  // a sweep of the input
+            }
+            circuit_solver_run(s, params, NULL, t_out, N_OUT, out);
+        }
+    }
+    circuit_solver_free(s);
+    free(params);
+    free(out);
+}
+
+// Function to time SCALING_RUNS warm solves on n_threads threads; *n_threads becomes the
+// number of threads that actually ran
+static double scaling_solves_per_second(const circuit_model *m, int *n_threads) {
+    double start = solver_stats_clock();
+    *n_threads = ensemble_runner_run(SCALING_RUNS, 16, *n_threads, scaling_worker, (void *)m);
+    return SCALING_RUNS / (solver_stats_clock() - start);
+}
+
+// Function to read a driver CSV: header names and rows of values
+static int read_csv(const char *path, char names[][64], int max_columns, double **values, int *n_rows) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        return -1;
+    }
+    char line[4096];
+    int n_columns = 0;
+    if (fgets(line, sizeof(line), fp) != NULL) {
+        for (char *tok = strtok(line, ",\r\n"); tok != NULL && n_columns < max_columns; tok = strtok(NULL, ",\r\n")) {
+            snprintf(names[n_columns++], 64, "%s", tok);
+        }
+    }
+    int capacity = 1024, rows = 0;
+    double *v = n_columns > 0 ? malloc(sizeof(double) * capacity * n_columns) : NULL;
+    if (v == NULL) {
+        fclose(fp);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (rows == capacity) {
+            double *grown = realloc(v, sizeof(double) * capacity * 2 * n_columns);
+            if (grown == NULL) {
+                free(v);
+                fclose(fp);
+                return -1;
+            }
+            v = grown;
+            capacity *= 2;
+        }
+        char *p = line;
+        for (int j = 0; j < n_columns; j++) {
+            v[rows * n_columns + j] = strtod(p, &p);
+            if (*p == ',') {
+                p++;
+            }
+        }
+        rows++;
+    }
+    fclose(fp);
+    *values = v;
+    *n_rows = rows;
+    return n_columns;
+}
+
+// Function to compare circuit_solver with one reference CSV; returns 1 if it passes
+static int check_reference(FILE *json, const char *dir, const char *file, const char *circuit, int first) {
+    const circuit_model *m = circuit_lookup(circuit);
+    char path[1024], names[16][64];
+    double *ref = NULL;
+    int n_rows = 0;
+    snprintf(path, sizeof(path), "%s/%s", dir, file);
+    int n_columns = read_csv(path, names, 16, &ref, &n_rows);
+    if (m == NULL || n_columns < 2 || n_rows == 0) {
+        fprintf(stderr, "Error reading %s\n", path);
+        free(ref);
+        return 0;
+    }
+
+    // The drivers start at t = 0 and print from the first step on
+    realtype *t_out = malloc(sizeof(realtype) * (n_rows + 1));
+    realtype *out = malloc(sizeof(realtype) * (n_rows + 1) * m->n_species);
+    int flag = -1;
+    if (t_out != NULL && out != NULL) {
+        t_out[0] = 0.0;
+        for (int i = 0; i < n_rows; i++) {
+            t_out[i + 1] = ref[i * n_columns];
+        }
+        circuit_solver_options options = {0};
+        options.rtol = ACCURACY_TOL;
+        circuit_solver *s = circuit_solver_create(m, &options);
+        flag = s != NULL ? circuit_solver_run(s, NULL, NULL, t_out, n_rows + 1, out) : -1;
+        circuit_solver_free(s);
+    }
+
+    double max_abs = 0.0, max_scaled = 0.0;
+    for (int c = 1; c < n_columns && flag == 0; c++) {
+        int j = circuit_species_index(m, names[c]);
+        if (j < 0) {
+            fprintf(stderr, "Error: %s has no species %s\n", circuit, names[c]);
+            flag = -1;
+            break;
+        }
+        for (int i = 0; i < n_rows; i++) {
+            double r = ref[i * n_columns + c];
+            double e = fabs(out[(i + 1) * m->n_species + j] - r);
+            max_abs = fmax(max_abs, e);
+            max_scaled = fmax(max_scaled, e / fmax(1.0, fabs(r)));
+        }
+    }
+    int pass = flag == 0 && max_scaled <= ACCURACY_TOL;
+    fprintf(json, "%s\n    {\"reference\": \"%s\", \"circuit\": \"%s\", \"rows\": %d, \"max_abs_error\": %.3g, "
+            "\"max_scaled_error\": %.3g, \"tolerance\": %g, \"pass\": %s}",
+            first ? "" : ",", file, circuit, n_rows, max_abs, max_scaled, ACCURACY_TOL, pass ? "true" : "false");
+    if (!pass) {
+        fprintf(stderr, "Accuracy check failed: %s vs %s (scaled error %.3g)\n", circuit, file, max_scaled);
+    }
+    free(t_out);
+    free(out);
+    free(ref);
+    return pass;
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "bench_results.json";
+    int max_threads = argc > 2 ? atoi(argv[2]) : 0;  // 0: every CPU
+    const char *reference_dir = argc > 3 ? argv[3] : "../1_introduction_biocircuits";
+    if (max_threads < 1) {
+        max_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (max_threads > 256) {
+        max_threads = 256;
+    }
+
+    FILE *json = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (json == NULL) {
+        fprintf(stderr, "Error opening file!\n");
+        return 1;
+    }
+    fprintf(json, "{\n  \"benchmark\": \"bench_circuits\",\n  \"timestamp\": %ld,\n  \"cpus\": %ld,\n",
+            (long)time(NULL), sysconf(_SC_NPROCESSORS_ONLN));
+
+    // ODE circuits
+    fprintf(json, "  \"circuits\": [");
+    for (int i = 0; i < circuit_count(); i++) {
+        const circuit_model *m = circuit_at(i);
+        solver_stats cold_stats, warm_stats;
+        double rhs = rhs_evals_per_second(m);
+        double cold = solves_per_second(m, 1, &cold_stats);
+        double warm = solves_per_second(m, 0, &warm_stats);
+        fprintf(json, "%s\n    {\"name\": \"%s\", \"species\": %d, \"rhs_evals_per_s\": %.4g, "
+                "\"solves_per_s_cold\": %.4g, \"solves_per_s_warm\": %.4g, \"steps_per_solve\": %ld, "
+                "\"rhs_evals_per_solve\": %ld, \"setup_s_cold\": %.3g, \"setup_s_warm\": %.3g}",
+                i > 0 ? "," : "", m->name, m->n_species, rhs, cold, warm, warm_stats.n_steps,
+                warm_stats.n_rhs_evals, cold_stats.setup_time, warm_stats.setup_time);
+        fprintf(stderr, "%-28s %10.3g rhs/s %10.3g solves/s cold %10.3g solves/s warm\n", m->name, rhs, cold, warm);
+    }
+    fprintf(json, "\n  ],\n");
+
+    // Gillespie dichotomous feedback
+    {
+        int n_steps = (int)(T_END / DT) + 1;
+        double *out = malloc(sizeof(double) * n_steps * 8);
+        output_spec spec = {0};
+        solver_stats st;
+        long events = 0, solves = 0;
+        double integrate = 0.0, start = solver_stats_clock(), elapsed;
+        do {
+            solve_dichotomous_feedback_stats(out, &spec, n_steps, DT, 1.0, &st);
+            for (int r = 0; r < st.n_reactions; r++) {
+                events += st.reaction_events[r];
+            }
+            integrate += st.integrate_time;
+            solves++;
+            elapsed = solver_stats_clock() - start;
+        } while (elapsed < MIN_SECONDS);
+        free(out);
+        fprintf(json, "  \"ssa\": {\"name\": \"gillespie_dichotomous_feedback\", \"events_per_s\": %.4g, "
+                "\"solves_per_s\": %.4g, \"events_per_solve\": %.4g},\n",
+                events / integrate, solves / elapsed, (double)events / solves);
+        fprintf(stderr, "%-28s %10.3g events/s %8.3g solves/s\n", "gillespie_dichotomous_feedback",
+                events / integrate, solves / elapsed);
+    }
+
+    // Thread scaling on the largest model
+    const circuit_model *scaling_model = circuit_lookup("dichotomous_feedback");
+    fprintf(json, "  \"thread_scaling\": {\"circuit\": \"%s\", \"runs\": %d, \"results\": [",
+            scaling_model->name, SCALING_RUNS);
+    double base = 0.0;
+    for (int n = 1; ; n *= 2) {
+        if (n > max_threads) {
+            n = max_threads;  // powers of two, then the maximum
+        }
+        int ran = n;
+        double rate = scaling_solves_per_second(scaling_model, &ran);
+        if (n == 1) {
+            base = rate;
+        }
+        fprintf(json, "%s\n    {\"threads\": %d, \"solves_per_s\": %.4g, \"speedup\": %.3g}",
+                n == 1 ? "" : ",", ran, rate, rate / base);
+        fprintf(stderr, "%2d threads %10.3g solves/s (x%.2f)\n", ran, rate, rate / base);
+        if (n == max_threads) {
+            break;
+        }
+    }
+    fprintf(json, "\n  ]},\n");
+
+    // Accuracy against the committed driver output
+    int failures = 0;
+    fprintf(json, "  \"accuracy\": [");
+    for (size_t i = 0; i < sizeof(references) / sizeof(references[0]); i++) {
+        failures += !check_reference(json, reference_dir, references[i].file, references[i].circuit, i == 0);
+    }
+    fprintf(json, "\n  ],\n  \"accuracy_failures\": %d\n}\n", failures);
+
+    if (json != stdout) {
+        fclose(json);
+    }
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,117 @@
+import ctypes
+import json
+import os
+import sys
+import time
+import numpy as np
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'common'))
+from output_spec import OutputSpec, make_output_spec, declare_spec_function
+from solver_stats import SolverStats, declare_stats_function
+
+# Python-side overhead of the ctypes libraries and of the biocircuits module:
+# the wall time of each call minus the time the C side reports for itself.
+#
+# usage: python3 bench_ctypes.py [results.json]   (run from benchmarks/ after run_benchmarks.sh built the libraries)
+
+MIN_SECONDS = 0.2
+N_STEPS = 501
+DT = 0.1
+
+
+def repeat(call):
+    """Call until MIN_SECONDS have passed; returns (calls, seconds)."""
+    calls = 0
+    start = time.perf_counter()
+    while True:
+        call()
+        calls += 1
+        elapsed = time.perf_counter() - start
+        if elapsed >= MIN_SECONDS:
+            return calls, elapsed
+
+
+def bench_library(path):
+    lib = ctypes.CDLL(path)
+    out = np.zeros((N_STEPS, 8))
+    spec = make_output_spec(out, n_steps=N_STEPS)
+    stats = SolverStats()
+
+    # A call that does no work: output_spec_num_samples() is linked into every library
+    lib.output_spec_num_samples.argtypes = [ctypes.POINTER(OutputSpec), ctypes.c_int]
+    lib.output_spec_num_samples.restype = ctypes.c_int
+    calls, elapsed = repeat(lambda: lib.output_spec_num_samples(spec, N_STEPS))
+    empty_call = elapsed / calls
+
+    # The plain entry point the plotting scripts use, with the array conversion they do
+    lib.solve_dichotomous_feedback.argtypes = [ctypes.POINTER(ctypes.c_double), ctypes.c_int, ctypes.c_double, ctypes.c_double]
+    lib.solve_dichotomous_feedback.restype = None
+    calls, elapsed = repeat(lambda: lib.solve_dichotomous_feedback(
+        out.ctypes.data_as(ctypes.POINTER(ctypes.c_double)), N_STEPS, DT, 1.0))
+    plain_call = elapsed / calls
+
+    # The instrumented entry point, to split the time between Python and C
+    solve = declare_stats_function(lib.solve_dichotomous_feedback_stats)
+    c_time = 0.0
+
+    def instrumented():
+        nonlocal c_time
+        solve(out.ctypes.data, spec, N_STEPS, DT, 1.0, ctypes.byref(stats))
+        c_time += stats.setup_time + stats.integrate_time + stats.output_time
+    calls, elapsed = repeat(instrumented)
+    return {
+        'library': os.path.basename(path),
+        'empty_call_s': empty_call,
+        'solve_call_s': plain_call,
+        'solve_c_s': c_time / calls,
+        'solve_overhead_s': elapsed / calls - c_time / calls,
+        'calls_per_s': calls / elapsed,
+    }
+
+
+def bench_module():
+    import biocircuits
+    info = biocircuits.circuit_info('dichotomous_feedback')
+    t_out = np.arange(N_STEPS) * DT
+    result = {}
+    for n in (1, 1000):
+        params = np.tile(info['default_params'], (n, 1))
+        out = np.empty((n, N_STEPS, len(info['species'])))
+        c_time = 0.0
+
+        def call():
+            nonlocal c_time
+            _, stats = biocircuits.solve_batch('dichotomous_feedback', params, t_out, out=out, stats=True)
+            c_time += stats[:, -3:].sum()
+        calls, elapsed = repeat(call)
+        result['batch_%d' % n] = {
+            'call_s': elapsed / calls,
+            'c_s': c_time / calls,
+            'overhead_s': elapsed / calls - c_time / calls,
+            'solves_per_s': n * calls / elapsed,
+        }
+    return result
+
+
+def main():
+    path = sys.argv[1] if len(sys.argv) > 1 else 'bench_ctypes.json'
+    results = {'benchmark': 'bench_ctypes', 'timestamp': int(time.time()), 'ctypes': []}
+    for lib in ('./dichotomous_feedback_sundials.so', './gillespie_dichotomous_feedback.so'):
+        if os.path.exists(lib):
+            r = bench_library(lib)
+            results['ctypes'].append(r)
+            print('%-36s empty call %.3g s, solve %.3g s (C %.3g s, overhead %.3g s)' % (
+                r['library'], r['empty_call_s'], r['solve_call_s'], r['solve_c_s'], r['solve_overhead_s']))
+    try:
+        results['biocircuits'] = bench_module()
+        for name, r in results['biocircuits'].items():
+            print('biocircuits %-24s call %.3g s, overhead %.3g s, %.3g solves/s' % (
+                name, r['call_s'], r['overhead_s'], r['solves_per_s']))
+    except ImportError:
+        print('biocircuits module not built, skipped')
+    with open(path, 'w') as f:
+        json.dump(results, f, indent=2)
+
+
+if __name__ == '__main__':
+    main()
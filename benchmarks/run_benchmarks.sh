@@ -0,0 +1,30 @@
+#!/bin/sh
+# Build and run the benchmark suite; results go to bench_results.json and bench_ctypes.json
+#
+#   cd benchmarks && ./run_benchmarks.sh [max_threads]
+#
+# Set SUNDIALS_CFLAGS / SUNDIALS_LIBS when SUNDIALS is not in the default search paths.
+set -e
+cd "$(dirname "$0")"
+
+CC=${CC:-gcc}
+CFLAGS=${CFLAGS:-"-O2"}
+LIBS="${SUNDIALS_LIBS} -lsundials_cvode -lsundials_nvecserial -lm -lpthread"
+
+$CC $CFLAGS $SUNDIALS_CFLAGS bench_circuits.c ../common/circuits.c ../common/circuit_solver.c ../common/result_cache.c ../common/nvector_arena.c \
+    ../common/solver_stats.c ../common/solver_stats_cvode.c ../common/output_spec.c \
+    ../other_circuits/gillespie_dichotomous_feedback.c ../common/reaction_network.c ../common/extrande.c \
+    ../common/ensemble_runner.c ../common/input_schedule.c ../common/rng.c -o bench_circuits $LIBS
+$CC $CFLAGS $SUNDIALS_CFLAGS -shared -fPIC ../other_circuits/dichotomous_feedback_sundials.c ../common/output_spec.c ../common/result_cache.c \
+    ../common/solver_stats.c ../common/solver_stats_cvode.c -o dichotomous_feedback_sundials.so $LIBS
+$CC $CFLAGS -shared -fPIC ../other_circuits/gillespie_dichotomous_feedback.c ../common/reaction_network.c ../common/extrande.c \
+    ../common/ensemble_runner.c ../common/input_schedule.c ../common/rng.c ../common/output_spec.c ../common/solver_stats.c \
+    -o gillespie_dichotomous_feedback.so -lm -lpthread
+if command -v python3-config >/dev/null 2>&1; then
+    $CC $CFLAGS $SUNDIALS_CFLAGS -shared -fPIC $(python3-config --includes) ../common/biocircuits_module.c \
+        ../common/circuits.c ../common/circuit_solver.c ../common/result_cache.c ../common/nvector_arena.c ../common/solver_stats.c ../common/solver_stats_cvode.c ../common/ensemble_runner.c \
+        -o biocircuits$(python3-config --extension-suffix) $LIBS
+fi
+
+./bench_circuits bench_results.json ${1:-0} ../1_introduction_biocircuits
+PYTHONPATH=. python3 bench_ctypes.py bench_ctypes.json
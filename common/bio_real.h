@@ -0,0 +1,23 @@
+#ifndef BIO_REAL_H
+#define BIO_REAL_H
+
+#include <float.h>
+
+// Storage precision of large state arrays (the per-cell state of population.c)
+//
+// Building with -DBIO_SINGLE_PRECISION stores them as float, which halves the
+// memory traffic of the 10^5-10^6 cell passes. Arithmetic on a single cell
+// stays in realtype/double, and times and propensity sums are always double.
+// Copy numbers are exact in float up to 2^24. For the ODE path the matching
+// switch is a SUNDIALS build with single precision, which makes realtype
+// float; tools/precision_check.c compares the two builds.
+
+#ifdef BIO_SINGLE_PRECISION
+typedef float bio_real;
+#define BIO_REAL_EPSILON FLT_EPSILON
+#else
+typedef double bio_real;
+#define BIO_REAL_EPSILON DBL_EPSILON
+#endif
+
+#endif
@@ -0,0 +1,399 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <string.h>
+#include "circuits.h"
+#include "circuit_solver.h"
+#include "ensemble_runner.h"
+
+// Python extension module "biocircuits"
+//
+//   solve_batch(circuit, params, t_out, y0=None, threads=1, out=None, rtol=1e-4, atol=1e-8, cache=None)
+//       params  float64 array [N, P]
+//       t_out   float64 array [T], the solve starts at t_out[0]
+//       y0      None (model defaults), float64 [S] shared by all runs, or [N, S]
+//       out     optional float64 array [N, T, S] to fill instead of a new one
+//       stats   also return a float64 array [N, len(STATS_FIELDS)] of solver statistics
+//       cache   directory of a result cache (result_cache.h), False for none, or None for
+//               the BIOCIRCUITS_CACHE directory when that is set
+//   returns the float64 array [N, T, S], or (array, stats) when stats is true
+//
+// Arrays are read and written in place through the buffer protocol, and the
+// GIL is released while the runs are spread over the worker threads.
+
+// Columns of the stats array, in the order of solver_stats
+static const char *const stats_fields[] = {
+    "steps", "rhs_evals", "jac_evals", "lin_setups", "nonlin_iters", "nonlin_conv_fails",
+    "err_test_fails", "method_switches", "last_step", "setup_s", "integrate_s", "output_s"
+};
+#define N_STATS_FIELDS ((int)(sizeof(stats_fields) / sizeof(stats_fields[0])))
+
+static void store_stats(double *row, const solver_stats *st) {
+    row[0] = st->n_steps;
+    row[1] = st->n_rhs_evals;
+    row[2] = st->n_jac_evals;
+    row[3] = st->n_lin_setups;
+    row[4] = st->n_nonlin_iters;
+    row[5] = st->n_nonlin_conv_fails;
+    row[6] = st->n_err_test_fails;
+    row[7] = st->n_method_switches;
+    row[8] = st->last_step;
+    row[9] = st->setup_time;
+    row[10] = st->integrate_time;
+    row[11] = st->output_time;
+}
+
+typedef struct {
+    const circuit_model *model;
+    circuit_solver_options options;
+    const double *params;
+    const double *t_out;
+    const double *y0;
+    Py_ssize_t y0_stride;   // 0 when one y0 is shared by every run
+    result_cache *cache;    // NULL: no caching
+    double *out;
+    double *stats;          // [n_runs, N_STATS_FIELDS], NULL when not requested
+    Py_ssize_t n_runs;
+    Py_ssize_t n_times;
+    // Merged under the runner's lock
+    Py_ssize_t n_solved;    // runs attempted; fewer than n_runs when no solver could be created
+    Py_ssize_t failed_run;  // first failing run, -1 if none
+    int failed_flag;
+} batch_job;
+
+// Function to solve one run from the float64 NumPy buffers; when SUNDIALS is built in single
+// precision, realtype is float and the run goes through the scratch array
+static int run_circuit(circuit_solver *solver, const circuit_model *m, const double *params, const double *y0,
+                       const double *t_out, int n_times, double *out, realtype *scratch) {
+#if defined(SUNDIALS_DOUBLE_PRECISION)
+    (void)m;
+    (void)scratch;
+    return circuit_solver_run(solver, params, y0, t_out, n_times, out);
+#else
+    realtype *p = scratch, *y = p + m->n_params, *t = y + m->n_species, *o = t + n_times;
+    for (int k = 0; k < m->n_params; k++) {
+        p[k] = params[k];
+    }
+    for (int i = 0; y0 != NULL && i < m->n_species; i++) {
+        y[i] = y0[i];
+    }
+    for (int k = 0; k < n_times; k++) {
+        t[k] = t_out[k];
+    }
+    int flag = circuit_solver_run(solver, p, y0 != NULL ? y : NULL, t, n_times, o);
+    for (size_t k = 0; k < (size_t)n_times * m->n_species; k++) {
+        out[k] = o[k];
+    }
+    return flag;
+#endif
+}
+
+static void batch_worker(ensemble_runner *r, int thread, void *arg) {
+    batch_job *job = arg;
+    (void)thread;
+    const circuit_model *m = job->model;
+    circuit_solver *solver = circuit_solver_create(m, &job->options);
+    realtype *scratch = NULL;
+#if !defined(SUNDIALS_DOUBLE_PRECISION)
+    scratch = malloc(sizeof(realtype) * (m->n_params + m->n_species + job->n_times * (1 + m->n_species)));
+    if (scratch == NULL) {
+        circuit_solver_free(solver);
+        solver = NULL;
+    }
+#endif
+    if (solver != NULL) {
+        circuit_solver_set_cache(solver, job->cache);
+    }
+    if (solver == NULL) {
+        // The other workers take over the runs; runs left unsolved are reported by the caller
+        return;
+    }
+    long first, last;
+    while (ensemble_runner_next(r, &first, &last)) {
+        for (Py_ssize_t i = first; i < last; i++) {
+            int flag = run_circuit(solver, m, job->params + i * m->n_params,
+                                   job->y0 ? job->y0 + i * job->y0_stride : NULL,
+                                   job->t_out, (int)job->n_times,
+                                   job->out + i * job->n_times * m->n_species, scratch);
+            if (job->stats != NULL) {
+                store_stats(job->stats + i * N_STATS_FIELDS, circuit_solver_stats(solver));
+            }
+            if (flag != 0) {
+                pthread_mutex_lock(&r->lock);
+                if (job->failed_run < 0 || i < job->failed_run) {
+                    job->failed_run = i;
+                    job->failed_flag = flag;
+                }
+                pthread_mutex_unlock(&r->lock);
+            }
+        }
+        pthread_mutex_lock(&r->lock);
+        job->n_solved += last - first;
+        pthread_mutex_unlock(&r->lock);
+    }
+    circuit_solver_free(solver);
+    free(scratch);
+}
+
+// Function to get a C-contiguous float64 buffer with min_ndim..max_ndim dimensions
+static int get_double_buffer(PyObject *obj, Py_buffer *view, int writable, int min_ndim, int max_ndim, const char *name) {
+    int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | (writable ? PyBUF_WRITABLE : 0);
+    if (PyObject_GetBuffer(obj, view, flags) != 0) {
+        PyErr_Format(PyExc_TypeError, "%s must be a C-contiguous%s float64 array", name, writable ? " writable" : "");
+        return -1;
+    }
+    const char *fmt = view->format ? view->format : "B";
+    if (fmt[0] == '<' || fmt[0] == '=' || fmt[0] == '@') {
+        fmt++;
+    }
+    if (strcmp(fmt, "d") != 0 || view->ndim < min_ndim || view->ndim > max_ndim) {
+        PyErr_Format(PyExc_TypeError, "%s must be a %d-D float64 array", name, max_ndim);
+        PyBuffer_Release(view);
+        return -1;
+    }
+    return 0;
+}
+
+static PyObject *new_array(PyObject *shape) {
+    if (shape == NULL) {
+        return NULL;
+    }
+    PyObject *out = NULL;
+    PyObject *numpy = PyImport_ImportModule("numpy");
+    if (numpy != NULL) {
+        out = PyObject_CallMethod(numpy, "empty", "(Os)", shape, "float64");
+        Py_DECREF(numpy);
+    }
+    Py_DECREF(shape);
+    return out;
+}
+
+static PyObject *solve_batch(PyObject *self, PyObject *args, PyObject *kwargs) {
+    static char *keywords[] = {"circuit", "params", "t_out", "y0", "threads", "out", "rtol", "atol", "stats", "method",
+                               "cache", NULL};
+    const char *name, *method = "adams";
+    PyObject *params_obj, *t_obj, *y0_obj = Py_None, *out_obj = Py_None, *stats_obj = NULL, *cache_obj = Py_None;
+    int threads = 1, want_stats = 0;
+    double rtol = 1e-4, atol = 1e-8;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sOO|OiOddpsO", keywords, &name, &params_obj, &t_obj,
+                                     &y0_obj, &threads, &out_obj, &rtol, &atol, &want_stats, &method, &cache_obj)) {
+        return NULL;
+    }
+    const circuit_model *m = circuit_lookup(name);
+    if (m == NULL) {
+        PyErr_Format(PyExc_ValueError, "unknown circuit '%s'", name);
+        return NULL;
+    }
+    int method_id;
+    if (strcmp(method, "adams") == 0) {
+        method_id = CIRCUIT_ADAMS;
+    } else if (strcmp(method, "bdf") == 0) {
+        method_id = CIRCUIT_BDF;
+    } else if (strcmp(method, "auto") == 0) {
+        method_id = CIRCUIT_AUTO;
+    } else {
+        PyErr_Format(PyExc_ValueError, "method must be 'adams', 'bdf' or 'auto', got '%s'", method);
+        return NULL;
+    }
+
+    result_cache *cache = NULL, *own_cache = NULL;
+    if (cache_obj == Py_None) {
+        cache = result_cache_default();
+    } else if (PyUnicode_Check(cache_obj)) {
+        const char *cache_dir = PyUnicode_AsUTF8(cache_obj);
+        if (cache_dir == NULL) {
+            return NULL;   // not encodable as UTF-8, the exception is set
+        }
+        own_cache = cache = result_cache_open(cache_dir, 0);
+        if (cache == NULL) {
+            PyErr_Format(PyExc_OSError, "cannot open the cache directory '%U'", cache_obj);
+            return NULL;
+        }
+    } else {
+        int use_cache = PyObject_IsTrue(cache_obj);
+        if (use_cache != 0) {
+            if (use_cache > 0) {
+                PyErr_SetString(PyExc_TypeError, "cache must be a directory, False or None");
+            }
+            return NULL;
+        }
+    }
+
+    Py_buffer params = {0}, t_out = {0}, y0 = {0}, out = {0}, stats = {0};
+    PyObject *result = NULL;
+    if (get_double_buffer(params_obj, &params, 0, 2, 2, "params") != 0) {
+        return NULL;
+    }
+    if (get_double_buffer(t_obj, &t_out, 0, 1, 1, "t_out") != 0) {
+        goto done;
+    }
+    Py_ssize_t n_runs = params.shape[0], n_times = t_out.shape[0];
+    if (params.shape[1] != m->n_params) {
+        PyErr_Format(PyExc_ValueError, "%s takes %d parameters, got %zd", m->name, m->n_params, params.shape[1]);
+        goto done;
+    }
+    Py_ssize_t y0_stride = 0;
+    if (y0_obj != Py_None) {
+        if (get_double_buffer(y0_obj, &y0, 0, 1, 2, "y0") != 0) {
+            goto done;
+        }
+        Py_ssize_t n_species = y0.shape[y0.ndim - 1];
+        if (n_species != m->n_species || (y0.ndim == 2 && y0.shape[0] != n_runs)) {
+            PyErr_Format(PyExc_ValueError, "y0 must have shape (%d,) or (%zd, %d)", m->n_species, n_runs, m->n_species);
+            goto done;
+        }
+        y0_stride = y0.ndim == 2 ? m->n_species : 0;
+    }
+
+    if (out_obj == Py_None) {
+        out_obj = new_array(Py_BuildValue("(nnn)", n_runs, n_times, (Py_ssize_t)m->n_species));
+        if (out_obj == NULL) {
+            goto done;
+        }
+    } else {
+        Py_INCREF(out_obj);
+    }
+    if (get_double_buffer(out_obj, &out, 1, 3, 3, "out") != 0) {
+        Py_DECREF(out_obj);
+        goto done;
+    }
+    if (out.shape[0] != n_runs || out.shape[1] != n_times || out.shape[2] != m->n_species) {
+        PyErr_Format(PyExc_ValueError, "out must have shape (%zd, %zd, %d)", n_runs, n_times, m->n_species);
+        Py_DECREF(out_obj);
+        goto done;
+    }
+
+    if (want_stats) {
+        stats_obj = new_array(Py_BuildValue("(nn)", n_runs, (Py_ssize_t)N_STATS_FIELDS));
+        if (stats_obj == NULL || get_double_buffer(stats_obj, &stats, 1, 2, 2, "stats") != 0) {
+            Py_DECREF(out_obj);
+            Py_XDECREF(stats_obj);
+            goto done;
+        }
+    }
+
+    batch_job job = {0};
+    job.model = m;
+    job.options.rtol = rtol;
+    job.options.atol = atol;
+    job.options.method = method_id;
+    job.params = params.buf;
+    job.t_out = t_out.buf;
+    job.y0 = y0.obj != NULL ? y0.buf : NULL;
+    job.y0_stride = y0_stride;
+    job.cache = cache;
+    job.out = out.buf;
+    job.stats = stats_obj != NULL ? stats.buf : NULL;
+    job.n_runs = n_runs;
+    job.n_times = n_times;
+    job.failed_run = -1;
+
+    // Small runs are cheap, so they are handed out 16 at a time
+    Py_BEGIN_ALLOW_THREADS
+    ensemble_runner_run(n_runs, 16, threads, batch_worker, &job);
+    Py_END_ALLOW_THREADS
+
+    if (job.n_solved < n_runs) {
+        // Every worker failed before its first run: no run was attempted, so report the setup
+        PyErr_Format(PyExc_MemoryError, "%s: cannot create the CVODE solver", m->name);
+        Py_DECREF(out_obj);
+        Py_XDECREF(stats_obj);
+        goto done;
+    }
+    if (job.failed_run >= 0) {
+        PyErr_Format(PyExc_RuntimeError, "%s: run %zd failed with CVODE flag %d", m->name, job.failed_run, job.failed_flag);
+        Py_DECREF(out_obj);
+        Py_XDECREF(stats_obj);
+        goto done;
+    }
+    result = stats_obj != NULL ? Py_BuildValue("(NN)", out_obj, stats_obj) : out_obj;
+
+done:
+    if (params.obj != NULL) {
+        PyBuffer_Release(&params);
+    }
+    if (t_out.obj != NULL) {
+        PyBuffer_Release(&t_out);
+    }
+    if (y0.obj != NULL) {
+        PyBuffer_Release(&y0);
+    }
+    if (out.obj != NULL) {
+        PyBuffer_Release(&out);
+    }
+    if (stats.obj != NULL) {
+        PyBuffer_Release(&stats);
+    }
+    result_cache_close(own_cache);
+    return result;
+}
+
+static PyObject *string_list(const char *const *names, int n) {
+    PyObject *list = PyList_New(n);
+    for (int i = 0; list != NULL && i < n; i++) {
+        PyList_SET_ITEM(list, i, PyUnicode_FromString(names[i]));
+    }
+    return list;
+}
+
+static PyObject *circuits(PyObject *self, PyObject *noargs) {
+    PyObject *list = PyList_New(circuit_count());
+    for (int i = 0; list != NULL && i < circuit_count(); i++) {
+        PyList_SET_ITEM(list, i, PyUnicode_FromString(circuit_at(i)->name));
+    }
+    return list;
+}
+
+static PyObject *circuit_info(PyObject *self, PyObject *args) {
+    const char *name;
+    if (!PyArg_ParseTuple(args, "s", &name)) {
+        return NULL;
+    }
+    const circuit_model *m = circuit_lookup(name);
+    if (m == NULL) {
+        PyErr_Format(PyExc_ValueError, "unknown circuit '%s'", name);
+        return NULL;
+    }
+    PyObject *defaults = PyList_New(m->n_params);
+    for (int k = 0; k < m->n_params; k++) {
+        PyList_SET_ITEM(defaults, k, PyFloat_FromDouble(m->default_params[k]));
+    }
+    PyObject *y0 = PyList_New(m->n_species);
+    for (int j = 0; j < m->n_species; j++) {
+        PyList_SET_ITEM(y0, j, PyFloat_FromDouble(m->default_y0[j]));
+    }
+    return Py_BuildValue("{s:N,s:N,s:N,s:N}",
+                         "species", string_list(m->species_names, m->n_species),
+                         "params", string_list(m->param_names, m->n_params),
+                         "default_params", defaults,
+                         "default_y0", y0);
+}
+
+static PyMethodDef biocircuits_methods[] = {
+    {"solve_batch", (PyCFunction)(void (*)(void))solve_batch, METH_VARARGS | METH_KEYWORDS,
+     "solve_batch(circuit, params, t_out, y0=None, threads=1, out=None, rtol=1e-4, atol=1e-8, stats=False, method='adams',"
+     " cache=None)"
+     " -> ndarray[N, T, S], or (ndarray[N, T, S], ndarray[N, len(STATS_FIELDS)]) with stats=True"},
+    {"circuits", circuits, METH_NOARGS, "Names of the available circuits."},
+    {"circuit_info", circuit_info, METH_VARARGS, "Species, parameter names and defaults of a circuit."},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef biocircuits_module = {
+    PyModuleDef_HEAD_INIT, "biocircuits", "Batch solvers for the biocircuits models.", -1, biocircuits_methods
+};
+
+PyMODINIT_FUNC PyInit_biocircuits(void) {
+    PyObject *module = PyModule_Create(&biocircuits_module);
+    if (module != NULL) {
+        PyObject *fields = PyTuple_New(N_STATS_FIELDS);
+        for (int i = 0; fields != NULL && i < N_STATS_FIELDS; i++) {
+            PyTuple_SET_ITEM(fields, i, PyUnicode_FromString(stats_fields[i]));
+        }
+        if (fields == NULL || PyModule_AddObject(module, "STATS_FIELDS", fields) != 0) {
+            Py_XDECREF(fields);
+            Py_DECREF(module);
+            return NULL;
+        }
+    }
+    return module;
+}
@@ -0,0 +1,213 @@
+#ifndef CIRCUIT_MODELS_H
+#define CIRCUIT_MODELS_H
+
+#include <math.h>
+#include <string.h>
+#include "circuits.h"
+
+// The physics of every registry circuit: species and parameter names,
+// defaults, initial state, right-hand side and, where written, the analytic
+// Jacobian (column-major, every entry set). This is the one definition of
+// each model. circuits.c builds the registry from it, and the C++ drivers
+// use it through circuit_model_type in simulator.hpp, where the functions
+// are visible and inline like the drivers' own code.
+
+// simple_gene_expression (1_introduction_biocircuits)
+static const char *const simple_species[] = {"Protein_concentration"};
+static const char *const simple_params[] = {"BETA", "GAMMA"};
+static const realtype simple_defaults[] = {1.0, 0.5};
+static const realtype simple_y0[] = {0.0};
+
+static inline int simple_rhs(realtype t, const realtype *y, realtype *ydot, const realtype *p, const void *data) {
+    ydot[0] = p[0] - p[1] * y[0];
+    return 0;
+}
+
+static inline int simple_jac(realtype t, const realtype *y, realtype *jac, const realtype *p, const void *data) {
+    jac[0] = -p[1];
+    return 0;
+}
+
+// repression with a constant repressor (repression_sundials.cpp)
+static const char *const repression_species[] = {"Protein_concentration", "Repressor_concentration"};
+static const char *const repression_params[] = {"BETA0_REPRESSION", "ALPHA0_REPRESSION", "KD_REPRESSION", "GAMMA_REPRESSION"};
+static const realtype repression_defaults[] = {1.0, 0.1, 0.5, 0.5};
+static const realtype repression_y0[] = {0.0, 1.0};
+
+static inline int repression_rhs(realtype t, const realtype *y, realtype *ydot, const realtype *p, const void *data) {
+    ydot[0] = p[0] / (1 + y[1] / p[2]) + p[1] - p[3] * y[0];
+    ydot[1] = 0; // assuming r is constant for simplicity
+    return 0;
+}
+
+// repression by a square-wave repressor (repression_intervals_sundials.cpp)
+static const char *const intervals_species[] = {"Protein_concentration"};
+static const char *const intervals_params[] = {"BETA0_REPRESSION", "ALPHA0_REPRESSION", "KD_REPRESSION", "GAMMA_REPRESSION", "PERIOD"};
+static const realtype intervals_defaults[] = {1.0, 0.1, 0.5, 0.5, 10.0};
+static const realtype intervals_y0[] = {0.0};
+
+static inline int intervals_rhs(realtype t, const realtype *y, realtype *ydot, const realtype *p, const void *data) {
+    realtype r = fmod(t, p[4]) < p[4] / 2.0 ? 1.0 : 0.0;  // repressor present in the first half period
+    ydot[0] = p[0] / (1 + r / p[2]) + p[1] - p[3] * y[0];
+    return 0;
+}
+
+static inline int intervals_jac(realtype t, const realtype *y, realtype *jac, const realtype *p, const void *data) {
+    jac[0] = -p[3];
+    return 0;
+}
+
+// activation (activation_sundials.cpp)
+static const char *const activation_species[] = {"Protein_concentration", "Activator_concentration"};
+static const char *const activation_params[] = {"BETA0_ACTIVATION", "KD_ACTIVATION", "GAMMA_ACTIVATION"};
+static const realtype activation_defaults[] = {1.0, 0.5, 0.5};
+static const realtype activation_y0[] = {0.0, 1.0};
+
+static inline int activation_rhs(realtype t, const realtype *y, realtype *ydot, const realtype *p, const void *data) {
+    ydot[0] = p[0] * (y[1] / p[1]) / (1 + y[1] / p[1]) - p[2] * y[0];
+    ydot[1] = 0; // assuming a is constant for simplicity
+    return 0;
+}
+
+// transcription_translation (transcription_translation_sundials.cpp)
+static const char *const tt_species[] = {"mRNA_concentration", "Protein_concentration"};
+static const char *const tt_params[] = {"BETA_M", "GAMMA_M", "BETA_P", "GAMMA_P"};
+static const realtype tt_defaults[] = {1.0, 0.5, 1.0, 0.5};
+static const realtype tt_y0[] = {0.0, 0.0};
+
+static inline int tt_rhs(realtype t, const realtype *y, realtype *ydot, const realtype *p, const void *data) {
+    ydot[0] = p[0] - p[1] * y[0];
+    ydot[1] = p[2] * y[0] - p[3] * y[1];
+    return 0;
+}
+
+static inline int tt_jac(realtype t, const realtype *y, realtype *jac, const realtype *p, const void *data) {
+    jac[0] = -p[1];
+    jac[1] = p[2];
+    jac[2] = 0;
+    jac[3] = -p[3];
+    return 0;
+}
+
+// negative autoregulation (2_design_principles/negative_autoregulation_hill.cpp)
+static const char *const nar_species[] = {"Protein_concentration"};
+static const char *const hill_params[] = {"BETA", "GAMMA", "K", "N"};
+static const realtype nar_defaults[] = {100.0, 1.0, 50.0, 2.0};
+static const realtype nar_y0[] = {0.0};
+
+static inline int nar_rhs(realtype t, const realtype *y, realtype *ydot, const realtype *p, const void *data) {
+    ydot[0] = p[0] * (1.0 / (1.0 + pow(y[0] / p[2], p[3]))) - p[1] * y[0];
+    return 0;
+}
+
+static inline int nar_jac(realtype t, const realtype *y, realtype *jac, const realtype *p, const void *data) {
+    realtype u = y[0] / p[2];
+    realtype un = pow(u, p[3]);
+    jac[0] = (u > 0 ? -p[0] * p[3] * un / (y[0] * (1 + un) * (1 + un)) : 0) - p[1];
+    return 0;
+}
+
+// positive autoregulation (3_sticky_switches/positive_autoregulation_bistability.cpp)
+static const realtype par_defaults[] = {10.0, 1.0, 3.0, 5.0};
+static const realtype par_y0[] = {0.1};
+
+static inline int par_rhs(realtype t, const realtype *y, realtype *ydot, const realtype *p, const void *data) {
+    realtype xn = pow(y[0], p[3]);
+    ydot[0] = p[0] * xn / (pow(p[2], p[3]) + xn) - p[1] * y[0];
+    return 0;
+}
+
+static inline int par_jac(realtype t, const realtype *y, realtype *jac, const realtype *p, const void *data) {
+    realtype xn = pow(y[0], p[3]), kn = pow(p[2], p[3]);
+    jac[0] = (y[0] > 0 ? p[0] * p[3] * kn * xn / (y[0] * (kn + xn) * (kn + xn)) : 0) - p[1];
+    return 0;
+}
+
+// coherent feedforward loop (4_feedforward_loops/ffl.cpp), X is the external input
+static const char *const ffl_species[] = {"Y", "Z"};
+static const char *const ffl_params[] = {"KXY", "KXZ", "KYZ", "BETAY", "BETAZ", "GAMMAY", "GAMMAZ", "NXY", "NXZ", "NYZ", "X"};
+static const realtype ffl_defaults[] = {0.5, 0.5, 0.5, 1.0, 1.0, 0.1, 0.1, 2.0, 2.0, 2.0, 1.0};
+static const realtype ffl_y0[] = {0.0, 0.0};
+
+static inline int ffl_rhs(realtype t, const realtype *y, realtype *ydot, const realtype *p, const void *data) {
+    realtype X = p[10];
+    realtype activation_XY = pow(X / p[0], p[7]) / (1 + pow(X / p[0], p[7]));
+    realtype activation_XZ = pow(X / p[1], p[8]) / (1 + pow(X / p[1], p[8]));
+    realtype activation_YZ = pow(y[0] / p[2], p[9]) / (1 + pow(y[0] / p[2], p[9]));
+    ydot[0] = p[3] * activation_XY - p[5] * y[0];
+    ydot[1] = p[4] * (activation_XZ + activation_YZ) - p[6] * y[1];
+    return 0;
+}
+
+// incoherent feedforward loop dosage compensator (5_feedforward_dosage_compensator/iffl.cpp)
+static const char *const iffl_species[] = {"X_Concentration", "Y_Concentration"};
+static const char *const iffl_params[] = {"PRODUCTION_RATE_X", "DEGRADATION_RATE_X", "PRODUCTION_RATE_Y", "DEGRADATION_RATE_Y", "HILL_COEFFICIENT", "COPY_NUMBER"};
+static const realtype iffl_defaults[] = {0.1, 0.05, 0.1, 0.05, 2.0, 1.0};
+static const realtype iffl_y0[] = {0.0, 0.0};
+
+static inline int iffl_rhs(realtype t, const realtype *y, realtype *ydot, const realtype *p, const void *data) {
+    ydot[0] = p[0] * p[5] - p[1] * y[0];
+    ydot[1] = (p[2] * p[5] / (1 + pow(y[0], p[4]))) - p[3] * y[1];
+    return 0;
+}
+
+static inline int iffl_jac(realtype t, const realtype *y, realtype *jac, const realtype *p, const void *data) {
+    realtype xn = pow(y[0], p[4]);
+    realtype denominator = 1 + xn;
+    jac[0] = -p[1];
+    jac[1] = y[0] > 0 ? -p[2] * p[5] * p[4] * xn / (y[0] * denominator * denominator) : 0;
+    jac[2] = 0;
+    jac[3] = -p[3];
+    return 0;
+}
+
+// dichotomous feedback (other_circuits/dichotomous_feedback_sundials.c), I is the external input
+static const char *const df_species[] = {"HK", "HKp", "RR", "RRp", "SR", "SRp", "PH", "Output"};
+static const char *const df_params[] = {"BETA_HK", "BETA_RR", "BETA_SR", "BETA_PH", "DELTA", "KAP_MAX", "KDA",
+                                        "KT", "KTC", "KP", "KPC", "KOUT_MAX", "KDR", "N", "I"};
+static const realtype df_defaults[] = {1.0, 1.0, 1.0, 1.0, 0.1, 1.0, 1.0, 0.1, 0.1, 0.1, 0.1, 1.0, 1.0, 2.0, 1.0};
+static const realtype df_y0[] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+
+static inline int df_rhs(realtype t, const realtype *y, realtype *ydot, const realtype *p, const void *data) {
+    realtype HK = y[0], HKp = y[1], RR = y[2], RRp = y[3], SR = y[4], SRp = y[5], PH = y[6], Output = y[7];
+    realtype DELTA = p[4], KT = p[7], KTC = p[8], KP = p[9], KPC = p[10];
+    realtype kap = p[5] * p[14] / (p[14] + p[6]);
+    realtype r = pow(RRp / p[12], p[13]);
+    realtype kout = p[11] * r / (r + 1);
+
+    ydot[0] = p[0] - DELTA * HK - kap * HK + KT * HKp * RR + KTC * HKp * SR;
+    ydot[1] = -KT * HKp * RR + kap * HK - DELTA * HKp - KTC * HKp * SR;
+    ydot[2] = p[1] - DELTA * RR - KT * HKp * RR + KP * HK * RRp + KPC * PH * RRp;
+    ydot[3] = -DELTA * RRp + KT * HKp * RR - KP * HK * RRp - KPC * PH * RRp;
+    ydot[4] = p[2] - DELTA * SR - KTC * HKp * SR + KPC * HK * SRp;
+    ydot[5] = -DELTA * SRp + KTC * HKp * SR - KPC * HK * SRp;
+    ydot[6] = p[3] - DELTA * PH;
+    ydot[7] = kout - DELTA * Output;
+    return 0;
+}
+
+// Analytic Jacobian of df_rhs, the stiffest model in the registry
+static inline int df_jac(realtype t, const realtype *y, realtype *jac, const realtype *p, const void *data) {
+    realtype HK = y[0], HKp = y[1], RR = y[2], RRp = y[3], SR = y[4], SRp = y[5], PH = y[6];
+    realtype DELTA = p[4], KT = p[7], KTC = p[8], KP = p[9], KPC = p[10];
+    realtype kap = p[5] * p[14] / (p[14] + p[6]);
+    realtype r = pow(RRp / p[12], p[13]);
+    // d kout / d RRp, written without dividing by RRp so it is finite at RRp = 0
+    realtype dkout = RRp > 0 || p[13] == 1
+        ? p[11] * p[13] / p[12] * pow(RRp / p[12], p[13] - 1) / ((r + 1) * (r + 1)) : 0;
+
+    memset(jac, 0, 64 * sizeof(realtype));
+#define J(i, j) jac[(j) * 8 + (i)]
+    J(0, 0) = -DELTA - kap;  J(0, 1) = KT * RR + KTC * SR;   J(0, 2) = KT * HKp;  J(0, 4) = KTC * HKp;
+    J(1, 0) = kap;  J(1, 1) = -KT * RR - DELTA - KTC * SR;   J(1, 2) = -KT * HKp;  J(1, 4) = -KTC * HKp;
+    J(2, 0) = KP * RRp;  J(2, 1) = -KT * RR;  J(2, 2) = -DELTA - KT * HKp;  J(2, 3) = KP * HK + KPC * PH;  J(2, 6) = KPC * RRp;
+    J(3, 0) = -KP * RRp;  J(3, 1) = KT * RR;  J(3, 2) = KT * HKp;  J(3, 3) = -DELTA - KP * HK - KPC * PH;  J(3, 6) = -KPC * RRp;
+    J(4, 0) = KPC * SRp;  J(4, 1) = -KTC * SR;  J(4, 4) = -DELTA - KTC * HKp;  J(4, 5) = KPC * HK;
+    J(5, 0) = -KPC * SRp;  J(5, 1) = KTC * SR;  J(5, 4) = KTC * HKp;  J(5, 5) = -DELTA - KPC * HK;
+    J(6, 6) = -DELTA;
+    J(7, 3) = dkout;  J(7, 7) = -DELTA;
+#undef J
+    return 0;
+}
+
+#endif
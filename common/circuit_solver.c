@@ -0,0 +1,567 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <cvode/cvode.h>             // prototypes for CVODE functions and constants
+#include <nvector/nvector_serial.h>  // serial N_Vector types, functions, and macros
+#include <sunmatrix/sunmatrix_dense.h> // access to dense SUNMatrix
+#include <sunlinsol/sunlinsol_dense.h> // access to dense SUNLinearSolver
+#include <sunnonlinsol/sunnonlinsol_fixedpoint.h> // access to the fixed-point SUNNonlinearSolver
+#include "nvector_arena.h"
+#include "circuit_solver.h"
+
+// CIRCUIT_AUTO: every STIFFNESS_CHECK_STEPS steps, h * rho(J) is estimated by
+// power iteration. Adams with fixed-point iteration is limited to h * rho of
+// order one, so above STIFF_ENTER the step is set by stability rather than
+// accuracy and BDF takes over; below STIFF_LEAVE Adams could take the BDF
+// step as well and is switched back in. A switch needs STIFFNESS_VOTES
+// consecutive checks, so the methods do not flip back and forth.
+#define STIFFNESS_CHECK_STEPS 20
+#define STIFFNESS_VOTES 2
+#define STIFF_ENTER 1.0
+#define STIFF_LEAVE 0.2
+#define POWER_ITERATIONS 6
+#define AUTO_MAX_STEPS 500     // per output interval, as CVODE's default mxstep
+
+struct circuit_solver {
+    const circuit_model *model;
+    circuit_solver_options options;
+    void *cvode_mem;           // CIRCUIT_AUTO: Adams with fixed-point iteration
+    void *stiff_mem;           // CIRCUIT_AUTO: BDF with Newton iteration and the dense solver
+    void *active_mem;          // CIRCUIT_AUTO: the one of the two that is stepping
+    nvector_arena *arena;      // y and every vector CVODE clones from it
+    N_Vector y;
+    N_Vector y_out;            // CIRCUIT_AUTO: state interpolated at the output times
+    SUNMatrix A;
+    SUNLinearSolver LS;
+    SUNNonlinearSolver NLS;    // CIRCUIT_AUTO: fixed-point iteration of cvode_mem
+    realtype *work;            // CIRCUIT_AUTO: scratch for the stiffness estimate
+    long n_estimate_evals;     // RHS evaluations spent on stiffness estimates
+    solver_stats switched;     // CIRCUIT_AUTO: counters of this run cleared by a switch's CVodeReInit
+    int initialized;           // CVodeInit done, later runs use CVodeReInit
+    const realtype *params;    // parameters of the current run
+    double create_time;        // charged to the setup time of the first run
+    solver_stats stats;        // statistics of the last run
+    result_cache *cache;       // NULL: every run integrates
+    circuit_input_fn input_fn; // NULL: no external input
+    void *input_ctx;
+    int input_param;
+    realtype *input_params;    // the run's parameters with the input filled in
+    int exact_end;             // stop runs at their last output time
+    int stop_time_set;         // a stop time may still be pending in CVODE
+    realtype t_stop;           // stop_time_set: the run's stop time
+};
+
+// Function to give the parameters at time t: the run's, with the input if there is one
+static const realtype *params_at(circuit_solver *s, realtype t) {
+    if (s->input_fn == NULL) {
+        return s->params;
+    }
+    s->input_params[s->input_param] = s->input_fn(t, s->input_ctx);
+    return s->input_params;
+}
+
+// Function to give the time the model sees for CVODE's t: at the stop time,
+// just before it, so a run ending on a jump of the forcing takes its left
+// limit there and not the value after the jump
+static realtype model_time(const circuit_solver *s, realtype t) {
+    return s->stop_time_set && t >= s->t_stop ? s->t_stop - UNIT_ROUNDOFF * fabs(s->t_stop) : t;
+}
+
+// CVODE right-hand side: forward to the model with the current parameters
+static int solver_rhs(realtype t, N_Vector y, N_Vector ydot, void *user_data) {
+    circuit_solver *s = user_data;
+    t = model_time(s, t);
+    return s->model->rhs(t, N_VGetArrayPointer(y), N_VGetArrayPointer(ydot), params_at(s, t), s->model->data);
+}
+
+// CVODE dense Jacobian: forward to the model's column-major Jacobian
+static int solver_jac(realtype t, N_Vector y, N_Vector fy, SUNMatrix J, void *user_data,
+                      N_Vector tmp1, N_Vector tmp2, N_Vector tmp3) {
+    circuit_solver *s = user_data;
+    t = model_time(s, t);
+    return s->model->jac(t, N_VGetArrayPointer(y), SUNDenseMatrix_Data(J), params_at(s, t), s->model->data);
+}
+
+circuit_solver *circuit_solver_create(const circuit_model *model, const circuit_solver_options *options) {
+    double mark = solver_stats_clock();
+    circuit_solver *s = calloc(1, sizeof(*s));
+    if (s == NULL) {
+        return NULL;
+    }
+    s->model = model;
+    if (options != NULL) {
+        s->options = *options;
+    }
+    if (s->options.rtol <= 0) {
+        s->options.rtol = 1e-4;
+    }
+    if (s->options.atol <= 0) {
+        s->options.atol = 1e-8;
+    }
+
+    int n = model->n_species;
+    int automatic = s->options.method == CIRCUIT_AUTO;
+    s->arena = nvector_arena_create(n, automatic ? 2 * NVECTOR_ARENA_DEFAULT_CAPACITY : 0);
+    s->y = s->arena ? N_VNew_Arena(s->arena) : NULL;
+    if (s->y == NULL) {
+        fprintf(stderr, "Error in N_VNew_Arena\n");
+        circuit_solver_free(s);
+        return NULL;
+    }
+
+    // Create the CVODE memory block
+    s->cvode_mem = CVodeCreate(s->options.method == CIRCUIT_BDF ? CV_BDF : CV_ADAMS);
+    if (s->cvode_mem == NULL) {
+        fprintf(stderr, "Error in CVodeCreate\n");
+        circuit_solver_free(s);
+        return NULL;
+    }
+
+    // Automatic mode: a second, stiff integrator and the non-stiff fixed-point solver
+    if (automatic) {
+        s->stiff_mem = CVodeCreate(CV_BDF);
+        s->NLS = SUNNonlinSol_FixedPoint(s->y, 0);
+        s->y_out = N_VNew_Arena(s->arena);
+        s->work = malloc(sizeof(realtype) * (4 * n + (model->jac ? n * n : 0)));
+        if (s->stiff_mem == NULL || s->NLS == NULL || s->y_out == NULL || s->work == NULL) {
+            fprintf(stderr, "Error creating the automatic method selection\n");
+            circuit_solver_free(s);
+            return NULL;
+        }
+    }
+
+    // Create the dense SUNMatrix and SUNLinearSolver
+    s->A = SUNDenseMatrix(n, n);
+    s->LS = s->A ? SUNLinSol_Dense(s->y, s->A) : NULL;
+    if (s->LS == NULL) {
+        fprintf(stderr, "Error in SUNLinSol_Dense\n");
+        circuit_solver_free(s);
+        return NULL;
+    }
+    s->create_time = solver_stats_lap(&mark);
+    return s;
+}
+
+void circuit_solver_free(circuit_solver *s) {
+    if (s == NULL) {
+        return;
+    }
+    if (s->cvode_mem != NULL) {
+        CVodeFree(&s->cvode_mem);
+    }
+    if (s->stiff_mem != NULL) {
+        CVodeFree(&s->stiff_mem);
+    }
+    if (s->NLS != NULL) {
+        SUNNonlinSolFree(s->NLS);
+    }
+    if (s->LS != NULL) {
+        SUNLinSolFree(s->LS);
+    }
+    if (s->A != NULL) {
+        SUNMatDestroy(s->A);
+    }
+    if (s->y_out != NULL) {
+        N_VDestroy(s->y_out);
+    }
+    if (s->y != NULL) {
+        N_VDestroy(s->y);
+    }
+    free(s->work);
+    free(s->input_params);
+    nvector_arena_free(s->arena);
+    free(s);
+}
+
+const circuit_model *circuit_solver_model(const circuit_solver *s) {
+    return s->model;
+}
+
+const solver_stats *circuit_solver_stats(const circuit_solver *s) {
+    return &s->stats;
+}
+
+void circuit_solver_set_cache(circuit_solver *s, result_cache *cache) {
+    s->cache = cache;
+}
+
+void circuit_solver_set_input(circuit_solver *s, int param, circuit_input_fn fn, void *ctx) {
+    if (fn != NULL && s->input_params == NULL) {
+        s->input_params = malloc(sizeof(realtype) * s->model->n_params);
+        if (s->input_params == NULL) {
+            fprintf(stderr, "Error in circuit_solver_set_input: out of memory\n");
+            return;
+        }
+    }
+    s->input_fn = param >= 0 && param < s->model->n_params ? fn : NULL;
+    s->input_ctx = ctx;
+    s->input_param = param;
+}
+
+void circuit_solver_set_exact_end(circuit_solver *s, int exact) {
+    s->exact_end = exact;
+}
+
+// Function to initialize one CVODE memory block and attach the solver components;
+// blocks without a linear solver get the fixed-point nonlinear solver instead
+static int init_cvode(circuit_solver *s, void *cvode_mem, realtype t0, int with_linear_solver) {
+    int flag = CVodeInit(cvode_mem, solver_rhs, t0, s->y);
+    if (flag != CV_SUCCESS) {
+        fprintf(stderr, "Error in CVodeInit\n");
+        return flag;
+    }
+    flag = CVodeSStolerances(cvode_mem, s->options.rtol, s->options.atol);
+    if (flag != CV_SUCCESS) {
+        fprintf(stderr, "Error in CVodeSStolerances\n");
+        return flag;
+    }
+    if (with_linear_solver) {
+        flag = CVodeSetLinearSolver(cvode_mem, s->LS, s->A);
+        if (flag != CV_SUCCESS) {
+            fprintf(stderr, "Error in CVodeSetLinearSolver\n");
+            return flag;
+        }
+        if (s->model->jac != NULL) {
+            flag = CVodeSetJacFn(cvode_mem, solver_jac);
+            if (flag != CV_SUCCESS) {
+                fprintf(stderr, "Error in CVodeSetJacFn\n");
+                return flag;
+            }
+        }
+    } else {
+        flag = CVodeSetNonlinearSolver(cvode_mem, s->NLS);
+        if (flag != CV_SUCCESS) {
+            fprintf(stderr, "Error in CVodeSetNonlinearSolver\n");
+            return flag;
+        }
+    }
+    if (s->options.max_steps > 0) {
+        CVodeSetMaxNumSteps(cvode_mem, s->options.max_steps);
+    }
+    flag = CVodeSetUserData(cvode_mem, s);
+    if (flag != CV_SUCCESS) {
+        fprintf(stderr, "Error in CVodeSetUserData\n");
+        return flag;
+    }
+    return CV_SUCCESS;
+}
+
+// Function to initialize CVODE on the first run
+static int solver_init(circuit_solver *s, realtype t0) {
+    int flag;
+    if (s->stiff_mem != NULL) {
+        flag = init_cvode(s, s->cvode_mem, t0, 0);
+        if (flag == CV_SUCCESS) {
+            flag = init_cvode(s, s->stiff_mem, t0, 1);
+        }
+    } else {
+        flag = init_cvode(s, s->cvode_mem, t0, 1);
+    }
+    s->initialized = flag == CV_SUCCESS;
+    return flag;
+}
+
+// Function to estimate the spectral radius of the Jacobian at (t, y) by power
+// iteration, with the model Jacobian or with difference quotients J v
+static realtype spectral_radius(circuit_solver *s, realtype t) {
+    const circuit_model *m = s->model;
+    int n = m->n_species;
+    const realtype *y = N_VGetArrayPointer(s->y);
+    realtype *v = s->work, *jv = s->work + n, *f0 = s->work + 2 * n, *yp = s->work + 3 * n;
+    realtype *J = m->jac ? s->work + 4 * n : NULL;
+    t = model_time(s, t);
+    const realtype *p = params_at(s, t);
+
+    if (J != NULL) {
+        if (m->jac(t, y, J, p, m->data) != 0) {
+            return 0;
+        }
+    } else {
+        if (m->rhs(t, y, f0, p, m->data) != 0) {
+            return 0;
+        }
+        s->n_estimate_evals++;
+    }
+    realtype ynorm = 0;
+    for (int i = 0; i < n; i++) {
+        v[i] = (i % 2 ? -1 : 1) / sqrt((realtype)n);  // unit start vector
+        ynorm = fmax(ynorm, fabs(y[i]));
+    }
+    realtype eps = sqrt(UNIT_ROUNDOFF) * fmax(1.0, ynorm);
+
+    realtype rho = 0;
+    for (int it = 0; it < POWER_ITERATIONS; it++) {
+        if (J != NULL) {
+            for (int i = 0; i < n; i++) {
+                jv[i] = 0;
+            }
+            for (int j = 0; j < n; j++) {
+                for (int i = 0; i < n; i++) {
+                    jv[i] += J[j * n + i] * v[j];
+                }
+            }
+        } else {
+            for (int i = 0; i < n; i++) {
+                yp[i] = y[i] + eps * v[i];
+            }
+            if (m->rhs(t, yp, jv, p, m->data) != 0) {
+                return 0;
+            }
+            s->n_estimate_evals++;
+            for (int i = 0; i < n; i++) {
+                jv[i] = (jv[i] - f0[i]) / eps;
+            }
+        }
+        realtype norm = 0;
+        for (int i = 0; i < n; i++) {
+            norm += jv[i] * jv[i];
+        }
+        rho = sqrt(norm);  // |J v| with |v| = 1
+        if (rho == 0) {
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            v[i] = jv[i] / rho;
+        }
+    }
+    return rho;
+}
+
+// Function to add the solver counters of part to total
+static void add_counters(solver_stats *total, const solver_stats *part) {
+    total->n_steps += part->n_steps;
+    total->n_rhs_evals += part->n_rhs_evals;
+    total->n_jac_evals += part->n_jac_evals;
+    total->n_lin_setups += part->n_lin_setups;
+    total->n_nonlin_iters += part->n_nonlin_iters;
+    total->n_nonlin_conv_fails += part->n_nonlin_conv_fails;
+    total->n_err_test_fails += part->n_err_test_fails;
+}
+
+// Function to keep the counters of one integrator before a CVodeReInit clears them
+static void accumulate_cvode_stats(circuit_solver *s, void *cvode_mem) {
+    solver_stats part = {0};
+    solver_stats_collect_cvode(cvode_mem, &part);
+    add_counters(&s->switched, &part);
+}
+
+// Function to continue the run from (t, y) with the other integrator, starting
+// from the step size the current one was using. The outgoing integrator keeps
+// its counters until the run ends or it is switched back in.
+static int switch_method(circuit_solver *s, realtype t) {
+    realtype h = 0;
+    CVodeGetCurrentStep(s->active_mem, &h);
+    void *next = s->active_mem == s->cvode_mem ? s->stiff_mem : s->cvode_mem;
+    CVodeSetInitStep(next, h);
+    accumulate_cvode_stats(s, next);
+    int flag = CVodeReInit(next, t, s->y);
+    if (flag != CV_SUCCESS) {
+        fprintf(stderr, "Error in CVodeReInit\n");
+        return flag;
+    }
+    s->active_mem = next;
+    s->stats.n_method_switches++;
+    return CV_SUCCESS;
+}
+
+// Time-stepping for CIRCUIT_AUTO: single internal steps with a stiffness check
+// every few steps, and outputs interpolated with CVodeGetDky
+static int run_automatic(circuit_solver *s, const realtype *t_out, int n_out, realtype *out, double *mark) {
+    int n = s->model->n_species;
+    solver_stats *st = &s->stats;
+    long max_steps = s->options.max_steps > 0 ? s->options.max_steps : AUTO_MAX_STEPS;
+    s->active_mem = s->cvode_mem;  // every run starts non-stiff
+    realtype t = t_out[0];
+    int since_check = 0, votes = 0;
+
+    for (int k = 1; k < n_out; k++) {
+        long steps = 0;
+        while (t < t_out[k]) {
+            int flag = CVode(s->active_mem, t_out[k], s->y, &t, CV_ONE_STEP);
+            if (flag < 0) {
+                // A failing non-stiff step is itself a sign of stiffness: go on with BDF from the last good state
+                if (s->active_mem == s->cvode_mem &&
+                    (flag == CV_CONV_FAILURE || flag == CV_ERR_FAILURE || flag == CV_TOO_MUCH_WORK)) {
+                    flag = switch_method(s, t);
+                    votes = since_check = 0;
+                    if (flag == CV_SUCCESS) {
+                        continue;
+                    }
+                }
+                return flag;
+            }
+            if (++steps > max_steps) {
+                return CV_TOO_MUCH_WORK;
+            }
+            // Switch only before the output time, so the new integrator can interpolate it
+            if (++since_check >= STIFFNESS_CHECK_STEPS && t < t_out[k]) {
+                since_check = 0;
+                realtype h = 0;
+                CVodeGetCurrentStep(s->active_mem, &h);
+                realtype h_rho = h * spectral_radius(s, t);
+                int stiff = s->active_mem == s->stiff_mem;
+                votes = (stiff ? h_rho < STIFF_LEAVE : h_rho > STIFF_ENTER) ? votes + 1 : 0;
+                if (votes >= STIFFNESS_VOTES) {
+                    votes = 0;
+                    flag = switch_method(s, t);
+                    if (flag != CV_SUCCESS) {
+                        return flag;
+                    }
+                }
+            }
+        }
+        st->integrate_time += solver_stats_lap(mark);
+        int flag = CVodeGetDky(s->active_mem, t_out[k], 0, s->y_out);
+        if (flag < 0) {
+            return flag;
+        }
+        memcpy(out + (size_t)k * n, N_VGetArrayPointer(s->y_out), (size_t)n * sizeof(realtype));
+        st->output_time += solver_stats_lap(mark);
+    }
+    return 0;
+}
+
+// Function to read the counters of both integrators, and those cleared by
+// switches during the run, into the run statistics
+static void collect_stats(circuit_solver *s) {
+    solver_stats *st = &s->stats;
+    solver_stats_collect_cvode(s->cvode_mem, st);
+    if (s->stiff_mem != NULL) {
+        solver_stats stiff = *st;
+        solver_stats_collect_cvode(s->stiff_mem, &stiff);
+        add_counters(st, &stiff);
+        add_counters(st, &s->switched);
+        st->n_rhs_evals += s->n_estimate_evals;
+        if (s->active_mem == s->stiff_mem) {
+            st->last_step = stiff.last_step;
+        }
+    }
+}
+
+static int run_cvode(circuit_solver *s, const realtype *params, const realtype *y0,
+                     const realtype *t_out, int n_out, realtype *out, double mark) {
+    const circuit_model *m = s->model;
+    int n = m->n_species;
+    solver_stats *st = &s->stats;
+    s->params = params != NULL ? params : m->default_params;
+
+    // Initial conditions
+    realtype *y = N_VGetArrayPointer(s->y);
+    memcpy(y, y0 != NULL ? y0 : m->default_y0, (size_t)n * sizeof(realtype));
+    memcpy(out, y, (size_t)n * sizeof(realtype));
+
+    realtype t = t_out[0];
+    int flag;
+    if (s->stiff_mem != NULL) {
+        // The step size carried over by the last switch must not leak into this run
+        s->n_estimate_evals = 0;
+        memset(&s->switched, 0, sizeof(s->switched));
+        CVodeSetInitStep(s->cvode_mem, 0);
+        CVodeSetInitStep(s->stiff_mem, 0);
+    }
+    if (s->initialized) {
+        flag = CVodeReInit(s->cvode_mem, t, s->y);
+        if (flag == CV_SUCCESS && s->stiff_mem != NULL) {
+            flag = CVodeReInit(s->stiff_mem, t, s->y);
+        }
+    } else {
+        flag = solver_init(s, t);
+        st->setup_time += s->create_time;
+    }
+    st->setup_time += solver_stats_lap(&mark);
+    if (flag != CV_SUCCESS) {
+        return flag;
+    }
+
+    // An input or exact_end stops the run at its last output time; otherwise lift a stop time left unreached
+    if (s->input_fn != NULL) {
+        memcpy(s->input_params, s->params, (size_t)m->n_params * sizeof(realtype));
+    }
+    int stop = s->input_fn != NULL || s->exact_end;
+    if (stop || s->stop_time_set) {
+        realtype t_stop = stop ? t_out[n_out - 1] : INFINITY;
+        CVodeSetStopTime(s->cvode_mem, t_stop);
+        if (s->stiff_mem != NULL) {
+            CVodeSetStopTime(s->stiff_mem, t_stop);
+        }
+        s->stop_time_set = stop;
+        s->t_stop = t_stop;
+    }
+
+    if (s->stiff_mem != NULL) {
+        flag = run_automatic(s, t_out, n_out, out, &mark);
+        collect_stats(s);
+        return flag;
+    }
+
+    // Time-stepping loop over the requested output times
+    for (int k = 1; k < n_out; k++) {
+        if (t_out[k] > t) {
+            flag = CVode(s->cvode_mem, t_out[k], s->y, &t, CV_NORMAL);
+            st->integrate_time += solver_stats_lap(&mark);
+            if (flag < 0) {
+                solver_stats_collect_cvode(s->cvode_mem, st);
+                return flag;
+            }
+        }
+        memcpy(out + (size_t)k * n, y, (size_t)n * sizeof(realtype));
+        st->output_time += solver_stats_lap(&mark);
+    }
+    solver_stats_collect_cvode(s->cvode_mem, st);
+    return 0;
+}
+
+// Function to build the cache key of a run: everything the trajectory depends on
+static void run_key(const circuit_solver *s, const realtype *params, const realtype *y0,
+                    const realtype *t_out, int n_out, result_cache_key *key) {
+    const circuit_model *m = s->model;
+    result_cache_key_init(key);
+    result_cache_key_add_string(key, "circuit_solver");
+    result_cache_key_add_string(key, m->name);
+    result_cache_key_add_int(key, CIRCUITS_VERSION);
+    result_cache_key_add_int(key, sizeof(realtype));
+    result_cache_key_add_int(key, m->n_species);
+    result_cache_key_add_int(key, m->n_params);
+    result_cache_key_add(key, params != NULL ? params : m->default_params, m->n_params * sizeof(realtype));
+    result_cache_key_add(key, y0 != NULL ? y0 : m->default_y0, m->n_species * sizeof(realtype));
+    result_cache_key_add_double(key, s->options.rtol);
+    result_cache_key_add_double(key, s->options.atol);
+    result_cache_key_add_int(key, s->options.method);
+    result_cache_key_add_int(key, s->options.max_steps);
+    result_cache_key_add_int(key, n_out);
+    result_cache_key_add(key, t_out, n_out * sizeof(realtype));
+    if (s->exact_end) {
+        result_cache_key_add_string(key, "exact_end");
+    }
+}
+
+int circuit_solver_run(circuit_solver *s, const realtype *params, const realtype *y0,
+                       const realtype *t_out, int n_out, realtype *out) {
+    solver_stats *st = &s->stats;
+    memset(st, 0, sizeof(*st));
+    if (n_out <= 0) {
+        return 0;
+    }
+    double mark = solver_stats_clock();
+    if (s->cache == NULL || s->input_fn != NULL) {
+        return run_cvode(s, params, y0, t_out, n_out, out, mark);
+    }
+    result_cache_key key;
+    size_t n_bytes = (size_t)n_out * s->model->n_species * sizeof(realtype);
+    run_key(s, params, y0, t_out, n_out, &key);
+    int flag = 0;
+    if (result_cache_get(s->cache, &key, out, n_bytes) == 0) {
+        st->output_time = solver_stats_lap(&mark);
+    } else {
+        st->setup_time = solver_stats_lap(&mark);
+        flag = run_cvode(s, params, y0, t_out, n_out, out, mark);
+        if (flag == 0) {
+            mark = solver_stats_clock();
+            result_cache_put(s->cache, &key, out, n_bytes);
+            st->output_time += solver_stats_lap(&mark);
+        }
+    }
+    result_cache_key_free(&key);
+    return flag;
+}
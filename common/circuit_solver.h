@@ -0,0 +1,67 @@
+#ifndef CIRCUIT_SOLVER_H
+#define CIRCUIT_SOLVER_H
+
+#include "circuits.h"
+#include "solver_stats.h"
+#include "result_cache.h"
+
+// Reusable CVODE context for one circuit
+//
+// The CVODE memory, vectors, matrix and linear solver are created once and
+// every run only re-initializes them with CVodeReInit, so sweeps, batches
+// and fits pay the setup cost once per thread instead of once per solve.
+// A solver is not thread-safe; use one per thread.
+
+#define CIRCUIT_ADAMS 0  // CV_ADAMS with Newton iteration, as in the drivers
+#define CIRCUIT_BDF 1    // CV_BDF with Newton iteration
+// Start with CV_ADAMS and fixed-point iteration, which needs no Jacobian or
+// linear solves, and switch to CV_BDF with Newton iteration while the
+// estimated h * rho(J) shows the step is limited by stability rather than
+// accuracy (or an Adams step fails); switch back once the fast transient has
+// decayed. Switches are counted in solver_stats.n_method_switches.
+#define CIRCUIT_AUTO 2
+
+typedef struct {
+    realtype rtol;      // 0 for the drivers' 1e-4
+    realtype atol;      // 0 for the drivers' 1e-8
+    long max_steps;     // 0 for the CVODE default
+    int method;
+} circuit_solver_options;
+
+typedef struct circuit_solver circuit_solver;
+
+circuit_solver *circuit_solver_create(const circuit_model *model, const circuit_solver_options *options);
+void circuit_solver_free(circuit_solver *s);
+
+// Solve from t_out[0] and store the state at every t_out[k] in
+// out[k * n_species + j]; out[0..n_species) is y0 itself. params or y0 may be
+// NULL for the model defaults. Returns 0 or the failing CVODE flag.
+int circuit_solver_run(circuit_solver *s, const realtype *params, const realtype *y0,
+                       const realtype *t_out, int n_out, realtype *out);
+
+const circuit_model *circuit_solver_model(const circuit_solver *s);
+
+// Serve runs from cache when the model, CIRCUITS_VERSION, parameters, y0,
+// options and t_out match a stored run, and store every new successful run
+// (NULL: off, the default). Only for registry circuits, whose name
+// identifies the dynamics; a hit leaves the CVODE counters at zero.
+void circuit_solver_set_cache(circuit_solver *s, result_cache *cache);
+
+// External input u(t) = fn(t, ctx) in place of parameter param during runs
+// (fn NULL removes it). Runs with an input stop exactly at their last output
+// time (CVodeSetStopTime), so a piecewise input is integrated one smooth
+// piece per run and CVODE never steps across a discontinuity. They also
+// bypass the result cache, whose key does not cover the input.
+typedef double (*circuit_input_fn)(double t, void *ctx);
+void circuit_solver_set_input(circuit_solver *s, int param, circuit_input_fn fn, void *ctx);
+
+// Stop runs exactly at their last output time (CVodeSetStopTime) instead of
+// stepping past it and interpolating back (0, the default), for right-hand
+// sides with a jump there, such as a forcing that switches at that time. The
+// model sees the stop time as the time just before it, the left limit of the jump.
+void circuit_solver_set_exact_end(circuit_solver *s, int exact);
+
+// Statistics of the last circuit_solver_run(), also filled in when it fails
+const solver_stats *circuit_solver_stats(const circuit_solver *s);
+
+#endif
@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <string.h>
+#include "circuits.h"
+#include "circuit_models.h"
+
+#define N_OF(a) ((int)(sizeof(a) / sizeof((a)[0])))
+#define CIRCUIT(name, sp, pn, def, y0, rhs, input) \
+    {name, N_OF(sp), N_OF(pn), sp, pn, def, y0, rhs, NULL, input, NULL}
+#define CIRCUIT_JAC(name, sp, pn, def, y0, rhs, jac, input) \
+    {name, N_OF(sp), N_OF(pn), sp, pn, def, y0, rhs, jac, input, NULL}
+
+static const circuit_model circuits[] = {
+    CIRCUIT_JAC("simple_gene_expression", simple_species, simple_params, simple_defaults, simple_y0, simple_rhs, simple_jac, -1),
+    CIRCUIT("repression", repression_species, repression_params, repression_defaults, repression_y0, repression_rhs, -1),
+    CIRCUIT_JAC("repression_intervals", intervals_species, intervals_params, intervals_defaults, intervals_y0, intervals_rhs, intervals_jac, -1),
+    CIRCUIT("activation", activation_species, activation_params, activation_defaults, activation_y0, activation_rhs, -1),
+    CIRCUIT_JAC("transcription_translation", tt_species, tt_params, tt_defaults, tt_y0, tt_rhs, tt_jac, -1),
+    CIRCUIT_JAC("negative_autoregulation", nar_species, hill_params, nar_defaults, nar_y0, nar_rhs, nar_jac, -1),
+    CIRCUIT_JAC("positive_autoregulation", nar_species, hill_params, par_defaults, par_y0, par_rhs, par_jac, -1),
+    CIRCUIT("ffl", ffl_species, ffl_params, ffl_defaults, ffl_y0, ffl_rhs, 10),
+    CIRCUIT_JAC("iffl", iffl_species, iffl_params, iffl_defaults, iffl_y0, iffl_rhs, iffl_jac, -1),
+    CIRCUIT_JAC("dichotomous_feedback", df_species, df_params, df_defaults, df_y0, df_rhs, df_jac, 14),
+};
+
+int circuit_count(void) {
+    return N_OF(circuits);
+}
+
+const circuit_model *circuit_at(int i) {
+    return i >= 0 && i < N_OF(circuits) ? &circuits[i] : NULL;
+}
+
+const circuit_model *circuit_lookup(const char *name) {
+    for (int i = 0; i < N_OF(circuits); i++) {
+        if (strcmp(circuits[i].name, name) == 0) {
+            return &circuits[i];
+        }
+    }
+    return NULL;
+}
+
+int circuit_param_index(const circuit_model *model, const char *name) {
+    for (int k = 0; k < model->n_params; k++) {
+        if (strcmp(model->param_names[k], name) == 0) {
+            return k;
+        }
+    }
+    return -1;
+}
+
+int circuit_species_index(const circuit_model *model, const char *name) {
+    for (int j = 0; j < model->n_species; j++) {
+        if (strcmp(model->species_names[j], name) == 0) {
+            return j;
+        }
+    }
+    return -1;
+}
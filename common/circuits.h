@@ -0,0 +1,43 @@
+#ifndef CIRCUITS_H
+#define CIRCUITS_H
+
+#include <sundials/sundials_types.h>  // defs. of realtype
+
+// Registry of the circuits in this repository with runtime parameters
+//
+// Each circuit is the same model as its standalone driver, but the #define
+// constants become a parameter vector (defaults are the driver values) so
+// one compiled core can solve any point of a parameter sweep. The models
+// themselves are written once, in circuit_models.h, which the C++ drivers
+// share through simulator.hpp.
+
+// Right-hand side of a circuit: ydot = f(t, y; p)
+typedef int (*circuit_rhs_fn)(realtype t, const realtype *y, realtype *ydot, const realtype *p, const void *data);
+
+// Optional dense Jacobian, column-major: jac[j * n + i] = d f_i / d y_j
+typedef int (*circuit_jac_fn)(realtype t, const realtype *y, realtype *jac, const realtype *p, const void *data);
+
+// Part of the result cache keys (result_cache.h): bump it whenever a right-hand side changes
+#define CIRCUITS_VERSION 2
+
+typedef struct circuit_model {
+    const char *name;
+    int n_species;
+    int n_params;
+    const char *const *species_names;
+    const char *const *param_names;
+    const realtype *default_params;
+    const realtype *default_y0;
+    circuit_rhs_fn rhs;
+    circuit_jac_fn jac;      // NULL: CVODE uses difference quotients
+    int input_param;         // index of the external input parameter, -1 if none
+    const void *data;        // passed through to rhs and jac
+} circuit_model;
+
+int circuit_count(void);
+const circuit_model *circuit_at(int i);
+const circuit_model *circuit_lookup(const char *name);
+int circuit_param_index(const circuit_model *model, const char *name);
+int circuit_species_index(const circuit_model *model, const char *name);
+
+#endif
@@ -0,0 +1,320 @@
+#include <stdio.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "rng.h"
+#include "cle.h"
+#include "ensemble_runner.h"
+
+#define DEFAULT_STEP 0.01
+#define NORMAL_BLOCK_STEPS 64   // steps' worth of Gaussian increments drawn at once
+
+struct cle_solver {
+    const reaction_network *network;
+    cle_options options;
+    rng_state rng;
+    // Stoichiometry as per-reaction lists of (species, change)
+    int *nz_start;              // [n_reactions + 1]
+    int *nz_species;
+    double *nz_change;
+    // Work arrays
+    double *x;                  // state
+    double *a;                  // propensities at x
+    double *a_support;          // propensities at the Milstein support point
+    double *y;                  // Milstein support point
+    double *drift;              // S^T a
+    double *increment;          // per-reaction increment of the reaction count
+    double *z;                  // block of standard normals
+    int z_next, z_size;
+    solver_stats stats;
+};
+
+cle_solver *cle_solver_create(const reaction_network *network, const cle_options *options) {
+    cle_solver *s = calloc(1, sizeof(*s));
+    if (s == NULL) {
+        return NULL;
+    }
+    s->network = network;
+    if (options != NULL) {
+        s->options = *options;
+    }
+    if (s->options.h <= 0) {
+        s->options.h = DEFAULT_STEP;
+    }
+    if (s->options.method != CLE_EULER_MARUYAMA && s->options.method != CLE_MILSTEIN) {
+        fprintf(stderr, "Error in cle_solver_create: unknown method %d\n", s->options.method);
+        free(s);
+        return NULL;
+    }
+
+    int n = network->n_species, R = network->n_reactions, nnz = 0;
+    for (int k = 0; k < R * n; k++) {
+        nnz += network->stoich[k] != 0;
+    }
+    s->nz_start = malloc((R + 1) * sizeof(int));
+    s->nz_species = malloc((nnz > 0 ? nnz : 1) * sizeof(int));
+    s->nz_change = malloc((nnz > 0 ? nnz : 1) * sizeof(double));
+    s->z_size = NORMAL_BLOCK_STEPS * R;
+    s->x = malloc((4 * n + 3 * R + s->z_size) * sizeof(double));
+    if (s->nz_start == NULL || s->nz_species == NULL || s->nz_change == NULL || s->x == NULL) {
+        fprintf(stderr, "Error in cle_solver_create: out of memory\n");
+        cle_solver_free(s);
+        return NULL;
+    }
+    s->y = s->x + n;
+    s->drift = s->y + n;
+    s->a = s->drift + n;
+    s->a_support = s->a + R;
+    s->increment = s->a_support + R;
+    s->z = s->increment + R;
+    s->z_next = s->z_size;
+
+    nnz = 0;
+    for (int r = 0; r < R; r++) {
+        s->nz_start[r] = nnz;
+        for (int i = 0; i < n; i++) {
+            if (network->stoich[r * n + i] != 0) {
+                s->nz_species[nnz] = i;
+                s->nz_change[nnz] = network->stoich[r * n + i];
+                nnz++;
+            }
+        }
+    }
+    s->nz_start[R] = nnz;
+    return s;
+}
+
+void cle_solver_free(cle_solver *s) {
+    if (s == NULL) {
+        return;
+    }
+    free(s->nz_start);
+    free(s->nz_species);
+    free(s->nz_change);
+    free(s->x);
+    free(s);
+}
+
+const solver_stats *cle_solver_stats(const cle_solver *s) {
+    return &s->stats;
+}
+
+// Function to get the next n_reactions standard normals, refilling the block when it runs out
+static const double *next_normals(cle_solver *s) {
+    int R = s->network->n_reactions;
+    if (s->z_next + R > s->z_size) {
+        rng_normals(&s->rng, s->z, s->z_size);
+        s->z_next = 0;
+    }
+    const double *z = s->z + s->z_next;
+    s->z_next += R;
+    return z;
+}
+
+// Function to evaluate the propensities at x, clamped at zero
+static void propensities(cle_solver *s, const double *x, double *a, const double *p) {
+    int R = s->network->n_reactions;
+    s->network->propensities(x, a, p);
+    for (int r = 0; r < R; r++) {
+        a[r] = a[r] > 0 ? a[r] : 0;
+    }
+    s->stats.n_rhs_evals++;
+}
+
+// Function to add S^T increment to x and project the result onto x >= 0
+static void apply_increments(cle_solver *s, double *x) {
+    int n = s->network->n_species, R = s->network->n_reactions;
+    for (int r = 0; r < R; r++) {
+        for (int k = s->nz_start[r]; k < s->nz_start[r + 1]; k++) {
+            x[s->nz_species[k]] += s->nz_change[k] * s->increment[r];
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        x[i] = x[i] > 0 ? x[i] : 0;
+    }
+}
+
+// Function to advance x by one step of size h
+static void cle_step(cle_solver *s, const double *p, double h) {
+    int n = s->network->n_species, R = s->network->n_reactions;
+    double *x = s->x, *a = s->a;
+    double sqrt_h = sqrt(h);
+    const double *z = next_normals(s);
+    propensities(s, x, a, p);
+
+    if (s->options.method == CLE_EULER_MARUYAMA) {
+        for (int r = 0; r < R; r++) {
+            s->increment[r] = a[r] * h + sqrt(a[r]) * sqrt_h * z[r];
+        }
+    } else {
+        // Derivative-free Milstein: the derivative of reaction r's noise term along itself
+        // is taken from the support point y = x + drift h + S_r sqrt(a_r) sqrt(h)
+        for (int i = 0; i < n; i++) {
+            s->drift[i] = 0;
+        }
+        for (int r = 0; r < R; r++) {
+            for (int k = s->nz_start[r]; k < s->nz_start[r + 1]; k++) {
+                s->drift[s->nz_species[k]] += s->nz_change[k] * a[r];
+            }
+        }
+        for (int r = 0; r < R; r++) {
+            double sigma = sqrt(a[r]);
+            double dW = sqrt_h * z[r];
+            double correction = 0;
+            if (s->nz_start[r + 1] > s->nz_start[r] && sigma > 0) {
+                for (int i = 0; i < n; i++) {
+                    s->y[i] = x[i] + s->drift[i] * h;
+                }
+                for (int k = s->nz_start[r]; k < s->nz_start[r + 1]; k++) {
+                    s->y[s->nz_species[k]] += s->nz_change[k] * sigma * sqrt_h;
+                }
+                for (int i = 0; i < n; i++) {
+                    s->y[i] = s->y[i] > 0 ? s->y[i] : 0;
+                }
+                propensities(s, s->y, s->a_support, p);
+                correction = (sqrt(s->a_support[r]) - sigma) / (2 * sqrt_h) * (dW * dW - h);
+            }
+            s->increment[r] = a[r] * h + sigma * dW + correction;
+        }
+    }
+    apply_increments(s, x);
+    s->stats.n_steps++;
+}
+
+int cle_solver_run(cle_solver *s, const double *params, const double *x0, long run,
+                   void *out, const output_spec *spec, int n_steps, double dt) {
+    const reaction_network *net = s->network;
+    double mark = solver_stats_clock();
+    solver_stats *st = &s->stats;
+    memset(st, 0, sizeof(*st));
+
+    output_spec o;
+    if (output_spec_resolve(spec, net->n_species, n_steps, &o) != 0) {
+        return -1;
+    }
+    const double *p = params != NULL ? params : net->default_params;
+    rng_seed(&s->rng, s->options.seed, (uint64_t)run);
+    s->z_next = s->z_size;
+    if (x0 != NULL) {
+        memcpy(s->x, x0, net->n_species * sizeof(double));
+    } else {
+        memset(s->x, 0, net->n_species * sizeof(double));
+    }
+    double t = 0.0, h = s->options.h;
+    st->setup_time = solver_stats_lap(&mark);
+
+    int n_samples = o.n_samples > 0 ? o.n_samples : n_steps;
+    for (int i = 0; i < n_samples; i++) {
+        double t_sample = o.n_samples > 0 ? o.sample_times[i] : i * dt;
+        if (o.n_samples == 0 && i % o.stride != 0) {
+            continue;
+        }
+        // Fixed steps up to the sample time, the last one shortened to land on it
+        while (t < t_sample) {
+            if (t_sample - t <= h * (1 + 1e-9)) {
+                cle_step(s, p, t_sample - t);
+                t = t_sample;
+            } else {
+                cle_step(s, p, h);
+                t += h;
+            }
+        }
+        st->integrate_time += solver_stats_lap(&mark);
+        output_spec_store(&o, out, o.n_samples > 0 ? i : i / o.stride, s->x);
+        st->output_time += solver_stats_lap(&mark);
+    }
+    st->last_step = h;
+    return 0;
+}
+
+typedef struct {
+    const reaction_network *network;
+    const cle_options *options;
+    const double *params;
+    const double *x0;
+    char *out;
+    const output_spec *spec;
+    size_t run_bytes;
+    int n_steps;
+    double dt;
+    int failed;
+    solver_stats total;
+} cle_job;
+
+static void cle_worker(ensemble_runner *r, int thread, void *arg) {
+    cle_job *job = arg;
+    cle_solver *s = cle_solver_create(job->network, job->options);
+    solver_stats total = {0};
+    int failed = s == NULL;
+    long run, end;
+    (void)thread;
+    while (!failed && ensemble_runner_next(r, &run, &end)) {
+        failed = cle_solver_run(s, job->params, job->x0, run, job->out + run * job->run_bytes,
+                                job->spec, job->n_steps, job->dt) != 0;
+        const solver_stats *st = cle_solver_stats(s);
+        total.n_steps += st->n_steps;
+        total.n_rhs_evals += st->n_rhs_evals;
+        total.last_step = st->last_step;
+        total.setup_time += st->setup_time;
+        total.integrate_time += st->integrate_time;
+        total.output_time += st->output_time;
+    }
+    cle_solver_free(s);
+
+    pthread_mutex_lock(&r->lock);
+    job->failed |= failed;
+    job->total.n_steps += total.n_steps;
+    job->total.n_rhs_evals += total.n_rhs_evals;
+    job->total.last_step = total.last_step;
+    job->total.setup_time += total.setup_time;
+    job->total.integrate_time += total.integrate_time;
+    job->total.output_time += total.output_time;
+    pthread_mutex_unlock(&r->lock);
+}
+
+int cle_ensemble(const reaction_network *network, const cle_options *options, const double *params,
+                 const double *x0, void *out, const output_spec *spec, long run_stride,
+                 int n_runs, int n_steps, double dt, int threads, solver_stats *stats) {
+    output_spec o;
+    if (output_spec_resolve(spec, network->n_species, n_steps, &o) != 0) {
+        return -1;
+    }
+    if (run_stride == 0) {
+        if (spec->time_stride != 0 || spec->species_stride != 0) {
+            fprintf(stderr, "Error in cle_ensemble: run_stride is required with custom strides\n");
+            return -1;
+        }
+        run_stride = (long)output_spec_num_samples(&o, n_steps) * o.n_species;
+    }
+    // The capacity covers the whole buffer, so the runs are checked here rather than one by one
+    long extent = output_spec_extent(&o, n_steps);
+    if (run_stride < 0 || (n_runs > 1 && run_stride > (LONG_MAX - extent) / (n_runs - 1))) {
+        fprintf(stderr, "Error in cle_ensemble: invalid run_stride %ld\n", run_stride);
+        return -1;
+    }
+    if (o.capacity > 0 && n_runs > 0 && (n_runs - 1) * run_stride + extent > o.capacity) {
+        fprintf(stderr, "Error in cle_ensemble: %d runs do not fit in %ld elements\n", n_runs, o.capacity);
+        return -1;
+    }
+    output_spec run_spec = *spec;
+    run_spec.capacity = 0;
+
+    cle_job job = {0};
+    job.network = network;
+    job.options = options;
+    job.params = params;
+    job.x0 = x0;
+    job.out = out;
+    job.spec = &run_spec;
+    job.run_bytes = (size_t)run_stride * (o.dtype == OUTPUT_SPEC_FLOAT32 ? sizeof(float) : sizeof(double));
+    job.n_steps = n_steps;
+    job.dt = dt;
+    ensemble_runner_run(n_runs, 1, threads, cle_worker, &job);
+
+    if (stats != NULL) {
+        *stats = job.total;
+    }
+    return job.failed ? -1 : 0;
+}
@@ -0,0 +1,59 @@
+#ifndef CLE_H
+#define CLE_H
+
+#include <stdint.h>
+#include "reaction_network.h"
+#include "output_spec.h"
+#include "solver_stats.h"
+
+// Chemical Langevin equation for a reaction_network
+//
+//   dX = sum_r S_r a_r(X) dt + sum_r S_r sqrt(a_r(X)) dW_r
+//
+// with one Wiener process per reaction, so for moderate copy numbers the
+// noise statistics follow the SSA at the cost of a fixed-step SDE solve.
+// Propensities are clamped at zero inside the square roots and the state is
+// projected back onto X >= 0 after every step, so species that run out do
+// not go negative. Gaussian increments are drawn in blocks (rng_normals).
+//
+// CLE_EULER_MARUYAMA has strong order 1/2 and costs one propensity
+// evaluation per step. CLE_MILSTEIN adds the derivative-free Milstein
+// correction of each reaction's own noise term (n_reactions extra
+// evaluations per step); the mixed iterated integrals are dropped, so it is
+// of strong order 1 when the noise is commutative and no worse than
+// Euler-Maruyama otherwise.
+
+#define CLE_EULER_MARUYAMA 0
+#define CLE_MILSTEIN 1
+
+typedef struct {
+    int method;       // CLE_EULER_MARUYAMA or CLE_MILSTEIN
+    double h;         // time step, 0 for 0.01
+    uint64_t seed;    // run k uses random stream k of this seed
+} cle_options;
+
+typedef struct cle_solver cle_solver;
+
+cle_solver *cle_solver_create(const reaction_network *network, const cle_options *options);
+void cle_solver_free(cle_solver *s);
+
+// Simulate run number run from x0 (NULL: all zero) with parameters params
+// (NULL: the network defaults) and store the samples selected by spec, in
+// the same layout as the SSA: sample i at t = i * dt of the n_steps grid, or
+// at spec->sample_times. Returns 0 or -1 on an invalid spec.
+int cle_solver_run(cle_solver *s, const double *params, const double *x0, long run,
+                   void *out, const output_spec *spec, int n_steps, double dt);
+
+// Statistics of the last run: steps, propensity evaluations (as n_rhs_evals) and timings
+const solver_stats *cle_solver_stats(const cle_solver *s);
+
+// Simulate runs 0..n_runs-1 on threads threads (<= 0: all CPUs). Run k is
+// written at out + k * run_stride elements; run_stride 0 places the runs
+// one after the other when spec uses the default contiguous layout. The
+// output does not depend on the number of threads. stats, when not NULL,
+// receives the totals over all runs. Returns 0 or -1.
+int cle_ensemble(const reaction_network *network, const cle_options *options, const double *params,
+                 const double *x0, void *out, const output_spec *spec, long run_stride,
+                 int n_runs, int n_steps, double dt, int threads, solver_stats *stats);
+
+#endif
@@ -0,0 +1,70 @@
+#include <stdlib.h>
+#include <unistd.h>
+#include "ensemble_runner.h"
+
+typedef struct {
+    ensemble_runner *runner;
+    int thread;
+    ensemble_worker_fn worker;
+    void *job;
+} worker_args;
+
+static void *worker_main(void *arg) {
+    worker_args *a = arg;
+    a->worker(a->runner, a->thread, a->job);
+    return NULL;
+}
+
+int ensemble_runner_next(ensemble_runner *r, long *first, long *last) {
+    pthread_mutex_lock(&r->lock);
+    *first = r->next;
+    *last = r->n_items - *first > r->batch ? *first + r->batch : r->n_items;
+    if (*first < *last) {
+        r->next = *last;
+    }
+    pthread_mutex_unlock(&r->lock);
+    return *first < *last;
+}
+
+int ensemble_runner_threads(long n_items, long batch, int threads) {
+    long n_batches = batch > 1 ? (n_items + batch - 1) / batch : n_items;
+    if (threads <= 0) {
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads > n_batches) {
+        threads = (int)n_batches;
+    }
+    return threads > 0 ? threads : 1;
+}
+
+int ensemble_runner_run(long n_items, long batch, int threads, ensemble_worker_fn worker, void *job) {
+    ensemble_runner r;
+    r.n_items = n_items;
+    r.batch = batch > 0 ? batch : 1;
+    r.next = 0;
+    pthread_mutex_init(&r.lock, NULL);
+    threads = ensemble_runner_threads(n_items, r.batch, threads);
+
+    int started = 0;
+    if (threads > 1) {
+        pthread_t *ids = malloc((size_t)threads * sizeof(pthread_t));
+        worker_args *args = malloc((size_t)threads * sizeof(worker_args));
+        for (; ids != NULL && args != NULL && started < threads; started++) {
+            args[started] = (worker_args){&r, started, worker, job};
+            if (pthread_create(&ids[started], NULL, worker_main, &args[started]) != 0) {
+                break;
+            }
+        }
+        for (int i = 0; i < started; i++) {
+            pthread_join(ids[i], NULL);
+        }
+        free(ids);
+        free(args);
+    }
+    if (started == 0) {
+        worker(&r, 0, job);
+        started = 1;
+    }
+    pthread_mutex_destroy(&r.lock);
+    return started;
+}
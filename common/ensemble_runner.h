@@ -0,0 +1,35 @@
+#ifndef ENSEMBLE_RUNNER_H
+#define ENSEMBLE_RUNNER_H
+
+#include <pthread.h>
+
+// Thread pool shared by the ensemble drivers
+//
+// Items 0..n_items-1 (runs, rows, blocks, starts...) are handed out batch
+// consecutive items at a time from a shared counter, so a fast thread simply
+// takes more of them. Each worker builds its own state (solver, buffers),
+// loops on ensemble_runner_next() and merges its results under the runner's
+// lock before it returns. When no thread can be started, the worker runs on
+// the calling thread, so a run never fails for lack of threads.
+
+typedef struct {
+    long n_items;
+    long batch;
+    long next;              // shared work counter
+    pthread_mutex_t lock;   // guards next; workers may merge their results under it
+} ensemble_runner;
+
+// Worker body, run once per thread; thread is 0..threads-1
+typedef void (*ensemble_worker_fn)(ensemble_runner *r, int thread, void *job);
+
+// Function to take the next batch [*first, *last); 0 when every item is taken
+int ensemble_runner_next(ensemble_runner *r, long *first, long *last);
+
+// Number of threads a run would use: threads (<= 0: all CPUs), at most one per batch, at least 1
+int ensemble_runner_threads(long n_items, long batch, int threads);
+
+// Function to run worker on ensemble_runner_threads() threads over n_items items (batch 0 for 1)
+// and wait for them; returns the number of threads that ran
+int ensemble_runner_run(long n_items, long batch, int threads, ensemble_worker_fn worker, void *job);
+
+#endif
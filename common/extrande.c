@@ -0,0 +1,297 @@
+#include <stdio.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "rng.h"
+#include "extrande.h"
+#include "ensemble_runner.h"
+
+#define DEFAULT_LOOKAHEAD 1.0
+
+struct extrande_solver {
+    const reaction_network *network;
+    extrande_options options;
+    rng_state rng;
+    double *p;                  // parameters with the current input
+    double *x;                  // state
+    double *a;                  // propensities at the candidate time
+    double *a_lo, *a_hi;        // propensities at the ends of the input range
+    long n_thinned;
+    solver_stats stats;
+};
+
+extrande_solver *extrande_create(const reaction_network *network, const extrande_options *options) {
+    if (network->input_param < 0) {
+        fprintf(stderr, "Error in extrande_create: network %s has no input\n", network->name);
+        return NULL;
+    }
+    extrande_solver *s = calloc(1, sizeof(*s));
+    if (s == NULL) {
+        return NULL;
+    }
+    s->network = network;
+    if (options != NULL) {
+        s->options = *options;
+    }
+    if (s->options.lookahead <= 0) {
+        s->options.lookahead = DEFAULT_LOOKAHEAD;
+    }
+    int n = network->n_species, R = network->n_reactions;
+    s->p = malloc((network->n_params + n + 3 * R) * sizeof(double));
+    if (s->p == NULL) {
+        free(s);
+        return NULL;
+    }
+    s->x = s->p + network->n_params;
+    s->a = s->x + n;
+    s->a_lo = s->a + R;
+    s->a_hi = s->a_lo + R;
+    return s;
+}
+
+void extrande_free(extrande_solver *s) {
+    if (s == NULL) {
+        return;
+    }
+    free(s->p);
+    free(s);
+}
+
+const solver_stats *extrande_stats(const extrande_solver *s) {
+    return &s->stats;
+}
+
+long extrande_num_thinned(const extrande_solver *s) {
+    return s->n_thinned;
+}
+
+// Function to evaluate the propensities at input value u, clamped at zero
+static double propensities_at(extrande_solver *s, double u, double *a) {
+    const reaction_network *net = s->network;
+    s->p[net->input_param] = u;
+    net->propensities(s->x, a, s->p);
+    s->stats.n_rhs_evals++;
+    double a0 = 0;
+    for (int r = 0; r < net->n_reactions; r++) {
+        a[r] = a[r] > 0 ? a[r] : 0;
+        a0 += a[r];
+    }
+    return a0;
+}
+
+// Function to fire the reaction selected by target in [0, sum a)
+static void fire(extrande_solver *s, const double *a, double target) {
+    const reaction_network *net = s->network;
+    int n = net->n_species, R = net->n_reactions, reaction = -1;
+    double sum = 0;
+    for (int r = 0; r < R; r++) {
+        if (a[r] > 0) {
+            sum += a[r];
+            reaction = r;
+            if (target < sum) {
+                break;
+            }
+        }
+    }
+    if (reaction < 0) {
+        return;
+    }
+    const int *S = net->stoich + reaction * n;
+    for (int i = 0; i < n; i++) {
+        s->x[i] += S[i];
+    }
+    if (reaction < SOLVER_STATS_MAX_REACTIONS) {
+        s->stats.reaction_events[reaction]++;
+    }
+}
+
+// Function to advance from *t to t_sample
+static void advance(extrande_solver *s, const input_schedule *u, double *t, double t_sample) {
+    const reaction_network *net = s->network;
+    int R = net->n_reactions;
+    while (*t < t_sample) {
+        // Window on which the input range is known
+        double t_end = input_schedule_next_break(u, *t);
+        t_end = t_end < t_sample ? t_end : t_sample;
+        double u_lo, u_hi;
+        input_schedule_range(u, *t, t_end, &u_lo, &u_hi);
+        if (u_lo != u_hi && *t + s->options.lookahead < t_end) {
+            t_end = *t + s->options.lookahead;
+            input_schedule_range(u, *t, t_end, &u_lo, &u_hi);
+        }
+        int constant = u_lo == u_hi;
+
+        // Events until the window ends; the bound only changes with the state
+        int state_changed = 1;
+        double bound = 0;
+        while (*t < t_end) {
+            if (state_changed) {
+                bound = propensities_at(s, u_lo, s->a_lo);
+                if (!constant) {
+                    propensities_at(s, u_hi, s->a_hi);
+                    bound = 0;
+                    for (int r = 0; r < R; r++) {
+                        bound += s->a_lo[r] > s->a_hi[r] ? s->a_lo[r] : s->a_hi[r];
+                    }
+                }
+                state_changed = 0;
+            }
+            if (bound <= 0) {
+                *t = t_end;
+                break;
+            }
+            double tau = -log(rng_uniform(&s->rng)) / bound;
+            if (*t + tau >= t_end) {
+                *t = t_end;   // memoryless: the next window starts afresh
+                break;
+            }
+            *t += tau;
+            s->stats.n_steps++;
+            double target = rng_uniform(&s->rng) * bound;
+            if (constant) {
+                fire(s, s->a_lo, target);
+            } else {
+                double a0 = propensities_at(s, input_schedule_value(u, *t), s->a);
+                if (target >= a0) {
+                    s->n_thinned++;   // extra reaction, the state is unchanged
+                    continue;
+                }
+                fire(s, s->a, target);
+            }
+            state_changed = 1;
+        }
+    }
+}
+
+int extrande_run(extrande_solver *s, const double *params, const input_schedule *u, const double *x0,
+                 long run, void *out, const output_spec *spec, int n_steps, double dt) {
+    const reaction_network *net = s->network;
+    double mark = solver_stats_clock();
+    solver_stats *st = &s->stats;
+    memset(st, 0, sizeof(*st));
+    st->n_reactions = net->n_reactions < SOLVER_STATS_MAX_REACTIONS ? net->n_reactions : SOLVER_STATS_MAX_REACTIONS;
+    s->n_thinned = 0;
+
+    output_spec o;
+    if (output_spec_resolve(spec, net->n_species, n_steps, &o) != 0) {
+        return -1;
+    }
+    memcpy(s->p, params != NULL ? params : net->default_params, net->n_params * sizeof(double));
+    rng_seed(&s->rng, s->options.seed, (uint64_t)run);
+    if (x0 != NULL) {
+        memcpy(s->x, x0, net->n_species * sizeof(double));
+    } else {
+        memset(s->x, 0, net->n_species * sizeof(double));
+    }
+    double t = 0.0;
+    st->setup_time = solver_stats_lap(&mark);
+
+    int n_samples = o.n_samples > 0 ? o.n_samples : n_steps;
+    for (int i = 0; i < n_samples; i++) {
+        double t_sample = o.n_samples > 0 ? o.sample_times[i] : i * dt;
+        if (o.n_samples == 0 && i % o.stride != 0) {
+            continue;
+        }
+        advance(s, u, &t, t_sample);
+        st->integrate_time += solver_stats_lap(&mark);
+        output_spec_store(&o, out, o.n_samples > 0 ? i : i / o.stride, s->x);
+        st->output_time += solver_stats_lap(&mark);
+    }
+    return 0;
+}
+
+typedef struct {
+    const reaction_network *network;
+    const extrande_options *options;
+    const double *params;
+    const input_schedule *u;
+    const double *x0;
+    char *out;
+    const output_spec *spec;
+    size_t run_bytes;
+    int n_steps;
+    double dt;
+    int failed;
+    solver_stats total;
+} extrande_job;
+
+// Function to add the counters and timings of one run to a total
+static void add_stats(solver_stats *total, const solver_stats *st) {
+    total->n_steps += st->n_steps;
+    total->n_rhs_evals += st->n_rhs_evals;
+    total->setup_time += st->setup_time;
+    total->integrate_time += st->integrate_time;
+    total->output_time += st->output_time;
+    total->n_reactions = st->n_reactions;
+    for (int r = 0; r < st->n_reactions; r++) {
+        total->reaction_events[r] += st->reaction_events[r];
+    }
+}
+
+static void extrande_worker(ensemble_runner *r, int thread, void *arg) {
+    extrande_job *job = arg;
+    extrande_solver *s = extrande_create(job->network, job->options);
+    solver_stats total = {0};
+    int failed = s == NULL;
+    long run, end;
+    (void)thread;
+    while (!failed && ensemble_runner_next(r, &run, &end)) {
+        failed = extrande_run(s, job->params, job->u, job->x0, run, job->out + run * job->run_bytes,
+                              job->spec, job->n_steps, job->dt) != 0;
+        add_stats(&total, extrande_stats(s));
+    }
+    extrande_free(s);
+
+    pthread_mutex_lock(&r->lock);
+    job->failed |= failed;
+    add_stats(&job->total, &total);
+    pthread_mutex_unlock(&r->lock);
+}
+
+int extrande_ensemble(const reaction_network *network, const extrande_options *options, const double *params,
+                      const input_schedule *u, const double *x0, void *out, const output_spec *spec,
+                      long run_stride, int n_runs, int n_steps, double dt, int threads, solver_stats *stats) {
+    output_spec o;
+    if (output_spec_resolve(spec, network->n_species, n_steps, &o) != 0) {
+        return -1;
+    }
+    if (run_stride == 0) {
+        if (spec->time_stride != 0 || spec->species_stride != 0) {
+            fprintf(stderr, "Error in extrande_ensemble: run_stride is required with custom strides\n");
+            return -1;
+        }
+        run_stride = (long)output_spec_num_samples(&o, n_steps) * o.n_species;
+    }
+    // The capacity covers the whole buffer, so the runs are checked here rather than one by one
+    long extent = output_spec_extent(&o, n_steps);
+    if (run_stride < 0 || (n_runs > 1 && run_stride > (LONG_MAX - extent) / (n_runs - 1))) {
+        fprintf(stderr, "Error in extrande_ensemble: invalid run_stride %ld\n", run_stride);
+        return -1;
+    }
+    if (o.capacity > 0 && n_runs > 0 && (n_runs - 1) * run_stride + extent > o.capacity) {
+        fprintf(stderr, "Error in extrande_ensemble: %d runs do not fit in %ld elements\n", n_runs, o.capacity);
+        return -1;
+    }
+    output_spec run_spec = *spec;
+    run_spec.capacity = 0;
+
+    extrande_job job = {0};
+    job.network = network;
+    job.options = options;
+    job.params = params;
+    job.u = u;
+    job.x0 = x0;
+    job.out = out;
+    job.spec = &run_spec;
+    job.run_bytes = (size_t)run_stride * (o.dtype == OUTPUT_SPEC_FLOAT32 ? sizeof(float) : sizeof(double));
+    job.n_steps = n_steps;
+    job.dt = dt;
+    ensemble_runner_run(n_runs, 1, threads, extrande_worker, &job);
+
+    if (stats != NULL) {
+        *stats = job.total;
+    }
+    return job.failed ? -1 : 0;
+}
@@ -0,0 +1,56 @@
+#ifndef EXTRANDE_H
+#define EXTRANDE_H
+
+#include <stdint.h>
+#include "reaction_network.h"
+#include "input_schedule.h"
+#include "output_spec.h"
+#include "solver_stats.h"
+
+// Exact SSA of a reaction_network driven by a time-dependent input
+//
+// The input u(t) replaces the network's input parameter. Between events the
+// propensities only change through u, so over a window [t, t_end) they are
+// bounded by B = sum_r max(a_r(u_lo), a_r(u_hi)), with [u_lo, u_hi] the
+// range of u on the window. This assumes every propensity is monotone in the
+// input, as for mass action and Hill terms. Candidate events are drawn from
+// a Poisson process of rate B and accepted with probability a_0(t) / B; the
+// rejected ones are the "extra" reaction of the Extrande method, which
+// leaves the state unchanged. Windows end at the next output time, at the
+// next jump or kink of the schedule and, for continuously varying inputs,
+// after lookahead. On windows where the input is constant (constant and
+// piecewise constant inputs, pulse trains) the bound is exact and the method
+// reduces to the direct SSA, with no rejections.
+
+typedef struct {
+    double lookahead;   // longest window over which a varying input is bounded, 0 for 1
+    uint64_t seed;      // run k uses random stream k of this seed
+} extrande_options;
+
+typedef struct extrande_solver extrande_solver;
+
+// Solver for network, whose input_param must be set
+extrande_solver *extrande_create(const reaction_network *network, const extrande_options *options);
+void extrande_free(extrande_solver *s);
+
+// Simulate run number run from x0 (NULL: all zero) with parameters params (NULL: the
+// network defaults) and input u, and store the samples selected by spec in the SSA
+// layout. Returns 0 or -1 on an invalid spec.
+int extrande_run(extrande_solver *s, const double *params, const input_schedule *u, const double *x0,
+                 long run, void *out, const output_spec *spec, int n_steps, double dt);
+
+// Statistics of the last run: reaction events, candidate events (as n_steps), propensity
+// evaluations (as n_rhs_evals) and timings
+const solver_stats *extrande_stats(const extrande_solver *s);
+
+// Rejected candidate events of the last run
+long extrande_num_thinned(const extrande_solver *s);
+
+// Simulate runs 0..n_runs-1 on threads threads (<= 0: all CPUs), with the same layout and
+// thread-independent results as cle_ensemble. stats, when not NULL, receives the totals.
+// Returns 0 or -1.
+int extrande_ensemble(const reaction_network *network, const extrande_options *options, const double *params,
+                      const input_schedule *u, const double *x0, void *out, const output_spec *spec,
+                      long run_stride, int n_runs, int n_steps, double dt, int threads, solver_stats *stats);
+
+#endif
@@ -0,0 +1,354 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "circuit_solver.h"
+#include "sensitivity.h"
+#include "sobol.h"
+#include "fit.h"
+#include "ensemble_runner.h"
+
+#define DEFAULT_STARTS 16
+#define DEFAULT_MAX_ITER 200
+#define DEFAULT_TOL 1e-10
+
+typedef struct {
+    const fit_problem *problem;
+    fit_options options;
+    const sensitivity_model *sm;
+    const double *starts;       // [n_starts][n_fit] in optimization coordinates
+    fit_result *results;
+} fit_job;
+
+// Per-thread solver and buffers, reused for every start and iteration
+typedef struct {
+    const fit_problem *problem;
+    const fit_options *options;
+    const sensitivity_model *sm;
+    circuit_solver *solver;
+    realtype *params, *y0, *t_out, *out;
+    double *r, *J;              // residuals [m] and their Jacobian [m][n_fit] at the current point
+    double *r_trial, *J_trial;  // swapped with r and J when a step is accepted
+    double *buffer;             // the block holding all four
+    int m;                      // number of residuals
+} fit_work;
+
+// Function to map optimization coordinates to a parameter value
+static double to_param(const fit_options *o, double x) {
+    return o->log_scale ? exp(x) : x;
+}
+
+// Function to solve at the point x and fill r and J; returns the cost, INFINITY if the solve fails
+static double evaluate(fit_work *w, const double *x, double *r, double *J) {
+    const fit_problem *pr = w->problem;
+    int P = pr->n_fit, N = w->sm->n_states;
+    for (int k = 0; k < P; k++) {
+        w->params[pr->fit_params[k]] = to_param(w->options, x[k]);
+    }
+    if (circuit_solver_run(w->solver, w->params, w->y0, w->t_out, pr->n_times + 1, w->out) != 0) {
+        return INFINITY;
+    }
+    double cost = 0;
+    for (int t = 0; t < pr->n_times; t++) {
+        const realtype *y = w->out + (size_t)(t + 1) * N;   // row 0 is t0
+        for (int o = 0; o < pr->n_obs; o++) {
+            int i = pr->obs_species[o], row = t * pr->n_obs + o;
+            double weight = pr->weights != NULL ? pr->weights[o] : 1.0;
+            r[row] = weight * (y[i] - pr->data[row]);
+            cost += 0.5 * r[row] * r[row];
+            for (int k = 0; k < P; k++) {
+                double scale = w->options->log_scale ? to_param(w->options, x[k]) : 1.0;
+                J[row * P + k] = weight * y[sensitivity_model_index(w->sm, i, k)] * scale;
+            }
+        }
+    }
+    return isfinite(cost) ? cost : INFINITY;
+}
+
+// Function to form A = J^T J and g = J^T r
+static void normal_equations(const double *J, const double *r, int m, int P, double *A, double *g) {
+    memset(A, 0, P * P * sizeof(double));
+    memset(g, 0, P * sizeof(double));
+    for (int row = 0; row < m; row++) {
+        const double *Jr = J + row * P;
+        for (int a = 0; a < P; a++) {
+            g[a] += Jr[a] * r[row];
+            for (int b = 0; b <= a; b++) {
+                A[a * P + b] += Jr[a] * Jr[b];
+            }
+        }
+    }
+    for (int a = 0; a < P; a++) {
+        for (int b = a + 1; b < P; b++) {
+            A[a * P + b] = A[b * P + a];
+        }
+    }
+}
+
+// Function to solve (A + mu diag(A)) d = -g by Cholesky; returns -1 if the matrix is not positive definite
+static int damped_step(const double *A, const double *g, double mu, int P, double *d) {
+    double L[FIT_MAX_PARAMS * FIT_MAX_PARAMS];
+    for (int a = 0; a < P; a++) {
+        for (int b = 0; b <= a; b++) {
+            double sum = A[a * P + b];
+            if (a == b) {
+                sum += mu * fmax(A[a * P + a], 1e-12);
+            }
+            for (int k = 0; k < b; k++) {
+                sum -= L[a * P + k] * L[b * P + k];
+            }
+            if (a == b) {
+                if (sum <= 0) {
+                    return -1;
+                }
+                L[a * P + a] = sqrt(sum);
+            } else {
+                L[a * P + b] = sum / L[b * P + b];
+            }
+        }
+    }
+    for (int a = 0; a < P; a++) {
+        double sum = -g[a];
+        for (int k = 0; k < a; k++) {
+            sum -= L[a * P + k] * d[k];
+        }
+        d[a] = sum / L[a * P + a];
+    }
+    for (int a = P - 1; a >= 0; a--) {
+        double sum = d[a];
+        for (int k = a + 1; k < P; k++) {
+            sum -= L[k * P + a] * d[k];
+        }
+        d[a] = sum / L[a * P + a];
+    }
+    return 0;
+}
+
+// Function to run Levenberg-Marquardt from x (optimization coordinates, inside the box)
+static void levenberg_marquardt(fit_work *w, const double *lo, const double *hi, double *x, fit_result *result) {
+    const fit_problem *pr = w->problem;
+    int P = pr->n_fit;
+    double tol = w->options->tol;
+    double A[FIT_MAX_PARAMS * FIT_MAX_PARAMS], g[FIT_MAX_PARAMS], d[FIT_MAX_PARAMS], x_trial[FIT_MAX_PARAMS];
+
+    result->iterations = 0;
+    result->status = 1;
+    double cost = evaluate(w, x, w->r, w->J);
+    if (!isfinite(cost)) {
+        result->status = -1;
+    } else {
+        normal_equations(w->J, w->r, w->m, P, A, g);
+        double mu = 1e-3, nu = 2;
+        for (int iter = 0; iter < w->options->max_iter; iter++) {
+            result->iterations = iter + 1;
+            if (damped_step(A, g, mu, P, d) != 0) {
+                mu *= nu;
+                nu *= 2;
+                continue;
+            }
+            double step = 0, size = 0;
+            for (int k = 0; k < P; k++) {
+                x_trial[k] = fmin(fmax(x[k] + d[k], lo[k]), hi[k]);
+                d[k] = x_trial[k] - x[k];
+                step += d[k] * d[k];
+                size += x[k] * x[k];
+            }
+            if (sqrt(step) <= tol * (sqrt(size) + tol)) {
+                result->status = 0;
+                break;
+            }
+            // Decrease predicted by the quadratic model
+            double predicted = 0;
+            for (int a = 0; a < P; a++) {
+                double Ad = 0;
+                for (int b = 0; b < P; b++) {
+                    Ad += A[a * P + b] * d[b];
+                }
+                predicted -= g[a] * d[a] + 0.5 * d[a] * Ad;
+            }
+            double trial = evaluate(w, x_trial, w->r_trial, w->J_trial);
+            double rho = predicted > 0 ? (cost - trial) / predicted : -1;
+            if (isfinite(trial) && trial < cost && rho > 0) {
+                double decrease = cost - trial;
+                cost = trial;
+                memcpy(x, x_trial, P * sizeof(double));
+                double *swap = w->r;
+                w->r = w->r_trial;
+                w->r_trial = swap;
+                swap = w->J;
+                w->J = w->J_trial;
+                w->J_trial = swap;
+                normal_equations(w->J, w->r, w->m, P, A, g);
+                double factor = 1 - pow(2 * rho - 1, 3);
+                mu *= factor > 1.0 / 3 ? factor : 1.0 / 3;
+                nu = 2;
+                if (decrease <= tol * cost) {
+                    result->status = 0;
+                    break;
+                }
+            } else {
+                mu *= nu;
+                nu *= 2;
+            }
+        }
+    }
+    result->cost = cost;
+    for (int k = 0; k < P; k++) {
+        result->params[k] = to_param(w->options, x[k]);
+    }
+}
+
+static void fit_worker(ensemble_runner *r, int thread, void *arg) {
+    fit_job *job = arg;
+    const fit_problem *pr = job->problem;
+    const circuit_model *base = pr->model;
+    int P = pr->n_fit, N = job->sm->n_states;
+    fit_work w = {0};
+    w.problem = pr;
+    w.options = &job->options;
+    w.sm = job->sm;
+    w.m = pr->n_times * pr->n_obs;
+    circuit_solver_options so = {job->options.rtol, job->options.atol, 0, CIRCUIT_BDF};
+    w.solver = circuit_solver_create(&job->sm->model, &so);
+    w.params = malloc(sizeof(realtype) * (base->n_params + N + (pr->n_times + 1) * (1 + (size_t)N)));
+    w.buffer = malloc(sizeof(double) * 2 * (size_t)w.m * (1 + P));
+    int failed = w.solver == NULL || w.params == NULL || w.buffer == NULL;
+    if (!failed) {
+        w.y0 = w.params + base->n_params;
+        w.t_out = w.y0 + N;
+        w.out = w.t_out + pr->n_times + 1;
+        w.r = w.buffer;
+        w.r_trial = w.r + w.m;
+        w.J = w.r_trial + w.m;
+        w.J_trial = w.J + (size_t)w.m * P;
+        for (int k = 0; k < base->n_params; k++) {
+            w.params[k] = pr->params != NULL ? pr->params[k] : base->default_params[k];
+        }
+        memcpy(w.y0, job->sm->y0, N * sizeof(realtype));
+        for (int i = 0; pr->y0 != NULL && i < base->n_species; i++) {
+            w.y0[i] = pr->y0[i];
+        }
+        w.t_out[0] = pr->t0;
+        for (int t = 0; t < pr->n_times; t++) {
+            w.t_out[t + 1] = pr->times[t];
+        }
+    }
+
+    double lo[FIT_MAX_PARAMS], hi[FIT_MAX_PARAMS], x[FIT_MAX_PARAMS];
+    for (int k = 0; k < P; k++) {
+        lo[k] = job->options.log_scale ? log(pr->lower[k]) : pr->lower[k];
+        hi[k] = job->options.log_scale ? log(pr->upper[k]) : pr->upper[k];
+    }
+    long start, end;
+    (void)thread;
+    while (!failed && ensemble_runner_next(r, &start, &end)) {
+        memcpy(x, job->starts + (size_t)start * P, P * sizeof(double));
+        levenberg_marquardt(&w, lo, hi, x, &job->results[start]);
+    }
+    if (failed) {
+        fprintf(stderr, "Error in fit_run: cannot create the solver\n");
+    }
+    circuit_solver_free(w.solver);
+    free(w.params);
+    free(w.buffer);
+}
+
+int fit_run(const fit_problem *problem, const fit_options *options, fit_result *results, fit_result *best) {
+    const fit_problem *pr = problem;
+    int P = pr->n_fit;
+    if (P < 1 || P > FIT_MAX_PARAMS || pr->n_obs < 1 || pr->n_times < 1) {
+        fprintf(stderr, "Error in fit_run: invalid problem size\n");
+        return -1;
+    }
+    for (int k = 0; k < P; k++) {
+        if (!(pr->lower[k] <= pr->upper[k]) || (options != NULL && options->log_scale && pr->lower[k] <= 0)) {
+            fprintf(stderr, "Error in fit_run: invalid bounds for parameter %d\n", k);
+            return -1;
+        }
+    }
+    for (int o = 0; o < pr->n_obs; o++) {
+        if (pr->obs_species[o] < 0 || pr->obs_species[o] >= pr->model->n_species) {
+            fprintf(stderr, "Error in fit_run: observed species %d out of range\n", pr->obs_species[o]);
+            return -1;
+        }
+    }
+
+    fit_job job = {0};
+    job.problem = pr;
+    if (options != NULL) {
+        job.options = *options;
+    }
+    if (job.options.n_starts <= 0) {
+        job.options.n_starts = DEFAULT_STARTS;
+    }
+    if (job.options.max_iter <= 0) {
+        job.options.max_iter = DEFAULT_MAX_ITER;
+    }
+    if (job.options.tol <= 0) {
+        job.options.tol = DEFAULT_TOL;
+    }
+    if (job.options.rtol <= 0) {
+        job.options.rtol = 1e-8;
+    }
+    if (job.options.atol <= 0) {
+        job.options.atol = 1e-10;
+    }
+    int n_starts = job.options.n_starts;
+
+    sensitivity_model sm;
+    if (sensitivity_model_init(&sm, pr->model, P, pr->fit_params) != 0) {
+        return -1;
+    }
+    job.sm = &sm;
+
+    // Start 0 at the given parameters, the others on a Sobol sequence over the box
+    double *starts = malloc(sizeof(double) * n_starts * P);
+    fit_result *own = results != NULL ? NULL : malloc(sizeof(fit_result) * n_starts);
+    job.results = results != NULL ? results : own;
+    if (starts == NULL || job.results == NULL) {
+        free(starts);
+        free(own);
+        sensitivity_model_free(&sm);
+        return -1;
+    }
+    sobol_state sobol;
+    sobol_init(&sobol, P, job.options.seed);
+    for (int s = 0; s < n_starts; s++) {
+        double u[FIT_MAX_PARAMS];
+        if (s > 0) {
+            sobol_next(&sobol, u);
+        }
+        for (int k = 0; k < P; k++) {
+            int j = pr->fit_params[k];
+            double lo = job.options.log_scale ? log(pr->lower[k]) : pr->lower[k];
+            double hi = job.options.log_scale ? log(pr->upper[k]) : pr->upper[k];
+            double x;
+            if (s > 0) {
+                x = lo + u[k] * (hi - lo);
+            } else {
+                double p0 = pr->params != NULL ? pr->params[j] : pr->model->default_params[j];
+                x = job.options.log_scale ? log(fmax(p0, pr->lower[k])) : p0;
+            }
+            starts[(size_t)s * P + k] = fmin(fmax(x, lo), hi);
+        }
+        job.results[s].status = -1;
+        job.results[s].cost = INFINITY;
+    }
+    job.starts = starts;
+
+    ensemble_runner_run(n_starts, 1, job.options.threads, fit_worker, &job);
+
+    int best_start = -1;
+    for (int s = 0; s < n_starts; s++) {
+        if (job.results[s].status >= 0 && (best_start < 0 || job.results[s].cost < job.results[best_start].cost)) {
+            best_start = s;
+        }
+    }
+    if (best != NULL && best_start >= 0) {
+        *best = job.results[best_start];
+    }
+    free(starts);
+    free(own);
+    sensitivity_model_free(&sm);
+    return best_start;
+}
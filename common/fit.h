@@ -0,0 +1,63 @@
+#ifndef FIT_H
+#define FIT_H
+
+#include <stdint.h>
+#include "circuits.h"
+
+// Least-squares parameter estimation against time-course data
+//
+// The cost is 1/2 sum_t sum_o (w_o (y_o(t; p) - data_o(t)))^2 over the
+// observed species o. Each start runs Levenberg-Marquardt (Nielsen's damping
+// update) with the residual Jacobian taken from the forward sensitivity
+// equations (sensitivity.c), so one solve gives the residuals and their
+// derivatives. Parameters are optimized in log space when log_scale is set
+// (they must then be positive) and kept inside [lower, upper].
+//
+// Start 0 is the initial parameter vector; the others are Sobol points in
+// the box (log-uniform with log_scale). Starts run on a pool of threads,
+// each with one circuit_solver reused for every start and iteration, and
+// the best start wins with ties going to the lowest index, so the result
+// does not depend on the number of threads.
+
+#define FIT_MAX_PARAMS 16
+
+typedef struct {
+    const circuit_model *model;
+    const realtype *params;       // full parameter vector, NULL for the defaults; fitted entries are the start 0 values
+    const realtype *y0;           // NULL for the defaults
+    int n_fit;
+    const int *fit_params;        // indices of the fitted parameters
+    const double *lower;          // per fitted parameter
+    const double *upper;
+    int n_obs;
+    const int *obs_species;       // observed species
+    const double *weights;        // per observed species, NULL for 1
+    double t0;                    // start of the solve, where y0 holds
+    int n_times;
+    const double *times;          // increasing, not before t0
+    const double *data;           // data[t * n_obs + o]
+} fit_problem;
+
+typedef struct {
+    int n_starts;       // 0 for 16
+    int max_iter;       // per start, 0 for 200
+    double tol;         // relative cost decrease and step size, 0 for 1e-10
+    int log_scale;
+    int threads;        // <= 0: all CPUs
+    uint64_t seed;      // digital shift of the Sobol points, 0 for none
+    realtype rtol;      // solver tolerances, 0 for 1e-8 and 1e-10
+    realtype atol;
+} fit_options;
+
+typedef struct {
+    double params[FIT_MAX_PARAMS];   // fitted values, in the order of fit_params
+    double cost;
+    int iterations;
+    int status;         // 0 converged, 1 iteration limit, -1 every solve failed
+} fit_result;
+
+// Fit every start; results (n_starts entries, may be NULL) receives each start and best
+// the best one. Returns the index of the best start or -1.
+int fit_run(const fit_problem *problem, const fit_options *options, fit_result *results, fit_result *best);
+
+#endif
@@ -0,0 +1,829 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "fsp.h"
+
+#define DEFAULT_TOL 1e-6
+#define DEFAULT_MAX_STATES 4000000
+#define DEFAULT_KRYLOV_DIM 30
+#define DEFAULT_SIZE 32
+#define KRYLOV_TOL 1e-12     // local error of exp(t A) p per unit time
+#define PADE_DEGREE 6
+#define MAX_REACTIONS 64
+
+struct fsp_solver {
+    const reaction_network *network;
+    double *params;
+    fsp_options options;
+    int n;
+    int size[FSP_MAX_SPECIES];
+    long stride[FSP_MAX_SPECIES];
+    long n_states;
+    // Generator in CSR by destination, n_states + n rows with the sinks last
+    long *row_start;
+    long *col;
+    double *val;
+    double norm;             // infinity norm of the generator
+    double *p;               // distribution on the box followed by the sinks
+    double sink_mass;
+};
+
+static void decode(const fsp_solver *s, long index, int *x) {
+    for (int i = 0; i < s->n; i++) {
+        x[i] = (int)((index / s->stride[i]) % s->size[i]);
+    }
+}
+
+long fsp_state_index(const fsp_solver *s, const int *x) {
+    long index = 0;
+    for (int i = 0; i < s->n; i++) {
+        if (x[i] < 0 || x[i] >= s->size[i]) {
+            return -1;
+        }
+        index += x[i] * s->stride[i];
+    }
+    return index;
+}
+
+// Function to set the strides and state count of the box; -1 if it is over the limit
+static int set_box(fsp_solver *s) {
+    long n_states = 1;
+    for (int i = 0; i < s->n; i++) {
+        s->stride[i] = n_states;
+        n_states *= s->size[i];
+        if (n_states > s->options.max_states) {
+            fprintf(stderr, "Error in fsp: the state space exceeds %ld states\n", s->options.max_states);
+            return -1;
+        }
+    }
+    s->n_states = n_states;
+    return 0;
+}
+
+// Function to get the destination of reaction r from state x: the state index,
+// n_states + i for the sink of species i when it leaves the box, -1 if it goes negative
+static long destination(const fsp_solver *s, const int *x, int r) {
+    const int *S = s->network->stoich + r * s->n;
+    long index = 0;
+    for (int i = 0; i < s->n; i++) {
+        int y = x[i] + S[i];
+        if (y < 0) {
+            return -1;
+        }
+        if (y >= s->size[i]) {
+            return s->n_states + i;
+        }
+        index += y * s->stride[i];
+    }
+    return index;
+}
+
+// Function to build the CSR generator of the current box
+static int build_generator(fsp_solver *s) {
+    const reaction_network *net = s->network;
+    int n = s->n, R = net->n_reactions;
+    long n_rows = s->n_states + n;
+    long max_entries = s->n_states * (R + 1);
+    long *dst = malloc(max_entries * sizeof(long));
+    long *src = malloc(max_entries * sizeof(long));
+    double *rate = malloc(max_entries * sizeof(double));
+    free(s->row_start);
+    free(s->col);
+    free(s->val);
+    s->row_start = calloc(n_rows + 1, sizeof(long));
+    if (dst == NULL || src == NULL || rate == NULL || s->row_start == NULL) {
+        fprintf(stderr, "Error in fsp: out of memory for the generator\n");
+        free(dst);
+        free(src);
+        free(rate);
+        return -1;
+    }
+
+    // Transitions as (destination, source, rate) triplets, the diagonal first
+    long n_entries = 0;
+    int x[FSP_MAX_SPECIES];
+    double xd[FSP_MAX_SPECIES], a[MAX_REACTIONS];
+    for (long k = 0; k < s->n_states; k++) {
+        decode(s, k, x);
+        for (int i = 0; i < n; i++) {
+            xd[i] = x[i];
+        }
+        net->propensities(xd, a, s->params);
+        long diag = n_entries++;
+        dst[diag] = src[diag] = k;
+        rate[diag] = 0;
+        for (int r = 0; r < R; r++) {
+            long y = a[r] > 0 ? destination(s, x, r) : -1;
+            if (y < 0) {
+                continue;
+            }
+            dst[n_entries] = y;
+            src[n_entries] = k;
+            rate[n_entries] = a[r];
+            n_entries++;
+            rate[diag] -= a[r];
+        }
+    }
+
+    // Counting sort by destination row
+    for (long e = 0; e < n_entries; e++) {
+        s->row_start[dst[e] + 1]++;
+    }
+    for (long k = 0; k < n_rows; k++) {
+        s->row_start[k + 1] += s->row_start[k];
+    }
+    s->col = malloc(n_entries * sizeof(long));
+    s->val = malloc(n_entries * sizeof(double));
+    long *fill = malloc(n_rows * sizeof(long));
+    if (s->col == NULL || s->val == NULL || fill == NULL) {
+        fprintf(stderr, "Error in fsp: out of memory for the generator\n");
+        free(fill);
+        free(dst);
+        free(src);
+        free(rate);
+        return -1;
+    }
+    memcpy(fill, s->row_start, n_rows * sizeof(long));
+    for (long e = 0; e < n_entries; e++) {
+        long slot = fill[dst[e]]++;
+        s->col[slot] = src[e];
+        s->val[slot] = rate[e];
+    }
+    s->norm = 0;
+    for (long k = 0; k < n_rows; k++) {
+        double sum = 0;
+        for (long e = s->row_start[k]; e < s->row_start[k + 1]; e++) {
+            sum += fabs(s->val[e]);
+        }
+        s->norm = fmax(s->norm, sum);
+    }
+    free(fill);
+    free(dst);
+    free(src);
+    free(rate);
+    return 0;
+}
+
+// Function to compute y = A x
+static void matvec(const fsp_solver *s, const double *x, double *y) {
+    long n_rows = s->n_states + s->n;
+    for (long k = 0; k < n_rows; k++) {
+        double sum = 0;
+        for (long e = s->row_start[k]; e < s->row_start[k + 1]; e++) {
+            sum += s->val[e] * x[s->col[e]];
+        }
+        y[k] = sum;
+    }
+}
+
+fsp_solver *fsp_create(const reaction_network *network, const double *params, const int *size,
+                       const fsp_options *options) {
+    if (network->n_species > FSP_MAX_SPECIES || network->n_reactions > MAX_REACTIONS) {
+        fprintf(stderr, "Error in fsp_create: %s is too large for the finite state projection\n", network->name);
+        return NULL;
+    }
+    fsp_solver *s = calloc(1, sizeof(*s));
+    if (s == NULL) {
+        return NULL;
+    }
+    s->network = network;
+    s->n = network->n_species;
+    if (options != NULL) {
+        s->options = *options;
+    }
+    if (s->options.tol <= 0) {
+        s->options.tol = DEFAULT_TOL;
+    }
+    if (s->options.max_states <= 0) {
+        s->options.max_states = DEFAULT_MAX_STATES;
+    }
+    if (s->options.krylov_dim <= 1) {
+        s->options.krylov_dim = DEFAULT_KRYLOV_DIM;
+    }
+    s->params = malloc((network->n_params > 0 ? network->n_params : 1) * sizeof(double));
+    if (s->params == NULL) {
+        free(s);
+        return NULL;
+    }
+    memcpy(s->params, params != NULL ? params : network->default_params, network->n_params * sizeof(double));
+    for (int i = 0; i < s->n; i++) {
+        s->size[i] = size != NULL && size[i] > 0 ? size[i] : DEFAULT_SIZE;
+    }
+    if (set_box(s) != 0 || build_generator(s) != 0) {
+        fsp_free(s);
+        return NULL;
+    }
+    return s;
+}
+
+void fsp_free(fsp_solver *s) {
+    if (s == NULL) {
+        return;
+    }
+    free(s->params);
+    free(s->row_start);
+    free(s->col);
+    free(s->val);
+    free(s->p);
+    free(s);
+}
+
+long fsp_num_states(const fsp_solver *s) {
+    return s->n_states;
+}
+
+int fsp_size(const fsp_solver *s, int species) {
+    return s->size[species];
+}
+
+double fsp_sink_mass(const fsp_solver *s) {
+    return s->sink_mass;
+}
+
+// Function to double the box along one species and carry the distribution p
+// (box and sinks) over to it; p is reallocated
+static int expand(fsp_solver *s, int species, double **p) {
+    fsp_solver old = *s;
+    s->size[species] *= 2;
+    if (set_box(s) != 0) {
+        *s = old;
+        return -1;
+    }
+    double *q = calloc(s->n_states + s->n, sizeof(double));
+    if (q == NULL) {
+        *s = old;
+        return -1;
+    }
+    int x[FSP_MAX_SPECIES];
+    for (long k = 0; k < old.n_states; k++) {
+        decode(&old, k, x);
+        q[fsp_state_index(s, x)] = (*p)[k];
+    }
+    for (int i = 0; i < s->n; i++) {
+        q[s->n_states + i] = (*p)[old.n_states + i];
+    }
+    free(*p);
+    *p = q;
+    return build_generator(s);
+}
+
+// Function to compute F = exp(A) of a dense k x k matrix (row-major) by
+// scaling and squaring with a diagonal Pade approximant
+static int dense_expm(int k, const double *A, double *F) {
+    int kk = k * k;
+    double *X = malloc(5 * kk * sizeof(double));
+    if (X == NULL) {
+        return -1;
+    }
+    double *P = X + kk, *N = P + kk, *D = N + kk, *T = D + kk;
+
+    double norm = 0;
+    for (int i = 0; i < k; i++) {
+        double sum = 0;
+        for (int j = 0; j < k; j++) {
+            sum += fabs(A[i * k + j]);
+        }
+        norm = fmax(norm, sum);
+    }
+    int squarings = norm > 0.5 ? (int)ceil(log2(norm / 0.5)) : 0;
+    double scale = ldexp(1.0, -squarings);
+    for (int e = 0; e < kk; e++) {
+        X[e] = scale * A[e];
+    }
+
+    // N = sum c_j X^j and D = sum c_j (-X)^j
+    double c = 1.0;
+    for (int e = 0; e < kk; e++) {
+        P[e] = (e % (k + 1) == 0);
+        N[e] = D[e] = P[e];
+    }
+    for (int j = 1; j <= PADE_DEGREE; j++) {
+        c *= (double)(PADE_DEGREE - j + 1) / (j * (2 * PADE_DEGREE - j + 1));
+        for (int r = 0; r < k; r++) {
+            for (int q = 0; q < k; q++) {
+                double sum = 0;
+                for (int m = 0; m < k; m++) {
+                    sum += P[r * k + m] * X[m * k + q];
+                }
+                T[r * k + q] = sum;
+            }
+        }
+        memcpy(P, T, kk * sizeof(double));
+        double sign = j % 2 ? -1.0 : 1.0;
+        for (int e = 0; e < kk; e++) {
+            N[e] += c * P[e];
+            D[e] += sign * c * P[e];
+        }
+    }
+
+    // F = D^-1 N, Gaussian elimination with partial pivoting
+    for (int col = 0; col < k; col++) {
+        int pivot = col;
+        for (int r = col + 1; r < k; r++) {
+            if (fabs(D[r * k + col]) > fabs(D[pivot * k + col])) {
+                pivot = r;
+            }
+        }
+        if (D[pivot * k + col] == 0) {
+            free(X);
+            return -1;
+        }
+        if (pivot != col) {
+            for (int q = 0; q < k; q++) {
+                double tmp = D[col * k + q];
+                D[col * k + q] = D[pivot * k + q];
+                D[pivot * k + q] = tmp;
+                tmp = N[col * k + q];
+                N[col * k + q] = N[pivot * k + q];
+                N[pivot * k + q] = tmp;
+            }
+        }
+        for (int r = col + 1; r < k; r++) {
+            double l = D[r * k + col] / D[col * k + col];
+            if (l == 0) {
+                continue;
+            }
+            for (int q = col; q < k; q++) {
+                D[r * k + q] -= l * D[col * k + q];
+            }
+            for (int q = 0; q < k; q++) {
+                N[r * k + q] -= l * N[col * k + q];
+            }
+        }
+    }
+    for (int r = k - 1; r >= 0; r--) {
+        for (int q = 0; q < k; q++) {
+            double sum = N[r * k + q];
+            for (int m = r + 1; m < k; m++) {
+                sum -= D[r * k + m] * F[m * k + q];
+            }
+            F[r * k + q] = sum / D[r * k + r];
+        }
+    }
+
+    // Undo the scaling
+    for (int sq = 0; sq < squarings; sq++) {
+        for (int r = 0; r < k; r++) {
+            for (int q = 0; q < k; q++) {
+                double sum = 0;
+                for (int m = 0; m < k; m++) {
+                    sum += F[r * k + m] * F[m * k + q];
+                }
+                T[r * k + q] = sum;
+            }
+        }
+        memcpy(F, T, kk * sizeof(double));
+    }
+    free(X);
+    return 0;
+}
+
+// Function to round a step size to two significant digits, as Expokit does
+static double round_step(double tau) {
+    double s = pow(10.0, floor(log10(tau)) - 1);
+    return ceil(tau / s) * s;
+}
+
+static double norm2(const double *x, long n) {
+    double sum = 0;
+    for (long k = 0; k < n; k++) {
+        sum += x[k] * x[k];
+    }
+    return sqrt(sum);
+}
+
+// Function to replace w by exp(t_final A) w with the Krylov method of Expokit's
+// dgexpv: Arnoldi with m vectors, an augmented Hessenberg matrix for the error
+// estimate and step-size control
+static int krylov_expv(const fsp_solver *s, double t_final, double *w) {
+    long N = s->n_states + s->n;
+    int m = s->options.krylov_dim < N ? s->options.krylov_dim : (int)N;
+    int mh = m + 2;
+    double *V = malloc((size_t)(m + 1) * N * sizeof(double));
+    double *H = malloc(2 * (size_t)mh * mh * sizeof(double));
+    if (V == NULL || H == NULL) {
+        free(V);
+        free(H);
+        return -1;
+    }
+    double *F = H + mh * mh;
+    const double tol = KRYLOV_TOL, gamma = 0.9, delta = 1.2;
+    double anorm = s->norm > 0 ? s->norm : 1.0;
+    double beta = norm2(w, N);
+    double t = 0;
+
+    // Initial step from the a priori error bound
+    double fact = pow((m + 1) / exp(1.0), m + 1) * sqrt(2 * M_PI * (m + 1));
+    double t_new = round_step((1 / anorm) * pow((fact * tol) / (4 * beta * anorm), 1.0 / m));
+    int flag = 0;
+
+    while (t < t_final && beta > 0) {
+        double tau = fmin(t_final - t, t_new);
+
+        // Arnoldi
+        memset(H, 0, (size_t)mh * mh * sizeof(double));
+        for (long k = 0; k < N; k++) {
+            V[k] = w[k] / beta;
+        }
+        int breakdown = 0, mb = m;
+        double avnorm = 0;
+        for (int j = 0; j < m; j++) {
+            double *v_next = V + (size_t)(j + 1) * N;
+            matvec(s, V + (size_t)j * N, v_next);
+            for (int i = 0; i <= j; i++) {
+                const double *vi = V + (size_t)i * N;
+                double h = 0;
+                for (long k = 0; k < N; k++) {
+                    h += vi[k] * v_next[k];
+                }
+                for (long k = 0; k < N; k++) {
+                    v_next[k] -= h * vi[k];
+                }
+                H[i * mh + j] = h;
+            }
+            double h = norm2(v_next, N);
+            if (h <= 1e-12 * anorm) {
+                // Happy breakdown: the Krylov space is invariant, the step is exact
+                breakdown = 1;
+                mb = j + 1;
+                tau = t_final - t;
+                break;
+            }
+            H[(j + 1) * mh + j] = h;
+            for (long k = 0; k < N; k++) {
+                v_next[k] /= h;
+            }
+        }
+        if (!breakdown) {
+            H[(m + 1) * mh + m] = 1;
+            double *av = malloc(N * sizeof(double));
+            if (av == NULL) {
+                flag = -1;
+                break;
+            }
+            matvec(s, V + (size_t)m * N, av);
+            avnorm = norm2(av, N);
+            free(av);
+        }
+        int mx = breakdown ? mb : m + 2;
+
+        // Exponential of the small matrix, shrinking the step until the error estimate passes
+        double err_loc = 0, xm = 1.0 / m;
+        int accepted = 0;
+        for (int attempt = 0; attempt < 10 && !accepted; attempt++) {
+            double *Ht = malloc((size_t)mx * mx * sizeof(double));
+            if (Ht == NULL) {
+                break;
+            }
+            for (int i = 0; i < mx; i++) {
+                for (int j = 0; j < mx; j++) {
+                    Ht[i * mx + j] = tau * H[i * mh + j];
+                }
+            }
+            int ok = dense_expm(mx, Ht, F) == 0;
+            free(Ht);
+            if (!ok) {
+                break;
+            }
+            if (breakdown) {
+                err_loc = 0;
+                accepted = 1;
+                break;
+            }
+            double p1 = fabs(F[m * mx]) * beta;
+            double p2 = fabs(F[(m + 1) * mx]) * beta * avnorm;
+            if (p1 > 10 * p2) {
+                err_loc = p2;
+                xm = 1.0 / m;
+            } else if (p1 > p2) {
+                err_loc = p1 * p2 / (p1 - p2);
+                xm = 1.0 / m;
+            } else {
+                err_loc = p1;
+                xm = 1.0 / (m - 1);
+            }
+            if (err_loc <= delta * tau * tol) {
+                accepted = 1;
+            } else {
+                tau = round_step(gamma * tau * pow(tau * tol / err_loc, xm));
+            }
+        }
+        if (!accepted) {
+            fprintf(stderr, "Error in fsp: the Krylov step failed at t = %g\n", t);
+            flag = -1;
+            break;
+        }
+
+        // w = beta V F e_1, with the extra basis vector of the augmented matrix
+        int n_basis = breakdown ? mb : m + 1;
+        for (long k = 0; k < N; k++) {
+            double sum = 0;
+            for (int j = 0; j < n_basis; j++) {
+                sum += V[(size_t)j * N + k] * F[j * mx];
+            }
+            w[k] = beta * sum;
+        }
+        beta = norm2(w, N);
+        t += tau;
+        if (!breakdown) {
+            t_new = round_step(gamma * tau * pow(tau * tol / fmax(err_loc, 1e-300), xm));
+        }
+    }
+    free(V);
+    free(H);
+    return flag;
+}
+
+int fsp_solve(fsp_solver *s, const int *x0, const double *t_out, int n_out, fsp_output_fn output, void *ctx) {
+    // Grow the box until it holds x0
+    for (int i = 0; i < s->n; i++) {
+        while (x0[i] >= s->size[i]) {
+            s->size[i] *= 2;
+        }
+        if (x0[i] < 0) {
+            fprintf(stderr, "Error in fsp_solve: negative initial state\n");
+            return -1;
+        }
+    }
+    if (set_box(s) != 0 || build_generator(s) != 0) {
+        return -1;
+    }
+    free(s->p);
+    s->p = calloc(s->n_states + s->n, sizeof(double));
+    double *saved = NULL;
+    if (s->p == NULL) {
+        return -1;
+    }
+    s->p[fsp_state_index(s, x0)] = 1.0;
+    s->sink_mass = 0;
+    if (n_out > 0 && output != NULL) {
+        output(0, t_out[0], s->p, s, ctx);
+    }
+
+    int flag = 0;
+    for (int k = 1; k < n_out && flag == 0; k++) {
+        long n_total = s->n_states + s->n;
+        free(saved);
+        saved = malloc(n_total * sizeof(double));
+        if (saved == NULL) {
+            flag = -1;
+            break;
+        }
+        memcpy(saved, s->p, n_total * sizeof(double));
+
+        for (;;) {
+            flag = krylov_expv(s, t_out[k] - t_out[k - 1], s->p);
+            if (flag != 0) {
+                break;
+            }
+            // Probability that left through each species' boundary
+            int worst = 0;
+            double sink = 0;
+            for (int i = 0; i < s->n; i++) {
+                double leaked = s->p[s->n_states + i];
+                sink += leaked;
+                if (leaked - saved[s->n_states + i] > s->p[s->n_states + worst] - saved[s->n_states + worst]) {
+                    worst = i;
+                }
+            }
+            s->sink_mass = sink;
+            if (sink <= s->options.tol) {
+                break;
+            }
+            // Repeat the interval on a larger box
+            flag = expand(s, worst, &saved);
+            if (flag != 0) {
+                break;
+            }
+            free(s->p);
+            s->p = malloc((s->n_states + s->n) * sizeof(double));
+            if (s->p == NULL) {
+                flag = -1;
+                break;
+            }
+            memcpy(s->p, saved, (s->n_states + s->n) * sizeof(double));
+        }
+        if (flag == 0 && output != NULL) {
+            output(k, t_out[k], s->p, s, ctx);
+        }
+    }
+    free(saved);
+    return flag;
+}
+
+void fsp_marginal(const fsp_solver *s, const double *p, int species, double *out) {
+    int x[FSP_MAX_SPECIES];
+    for (int j = 0; j < s->size[species]; j++) {
+        out[j] = 0;
+    }
+    for (long k = 0; k < s->n_states; k++) {
+        decode(s, k, x);
+        out[x[species]] += p[k];
+    }
+}
+
+// Function to build the banded matrix of the reflecting truncation: -A (rows
+// are destinations) or, transposed, -Q (rows are sources); bw is the half bandwidth
+static double *build_band(const fsp_solver *s, int transpose, long *bw) {
+    const reaction_network *net = s->network;
+    int n = s->n, R = net->n_reactions;
+    long width = 0;
+    for (int r = 0; r < R; r++) {
+        long offset = 0;
+        for (int i = 0; i < n; i++) {
+            offset += net->stoich[r * n + i] * s->stride[i];
+        }
+        width = labs(offset) > width ? labs(offset) : width;
+    }
+    *bw = width;
+    long row = 2 * width + 1;
+    double *B = calloc((size_t)s->n_states * row, sizeof(double));
+    if (B == NULL) {
+        fprintf(stderr, "Error in fsp: out of memory for the banded matrix (%ld x %ld)\n", s->n_states, row);
+        return NULL;
+    }
+
+    int x[FSP_MAX_SPECIES];
+    double xd[FSP_MAX_SPECIES], a[MAX_REACTIONS];
+    for (long k = 0; k < s->n_states; k++) {
+        decode(s, k, x);
+        for (int i = 0; i < n; i++) {
+            xd[i] = x[i];
+        }
+        net->propensities(xd, a, s->params);
+        for (int r = 0; r < R; r++) {
+            long y = a[r] > 0 ? destination(s, x, r) : -1;
+            if (y < 0 || y >= s->n_states) {
+                continue;   // reflecting: transitions out of the box are dropped
+            }
+            B[k * row + width] += a[r];
+            if (transpose) {
+                B[k * row + (y - k) + width] -= a[r];
+            } else {
+                B[y * row + (k - y) + width] -= a[r];
+            }
+        }
+    }
+    return B;
+}
+
+// Function to solve the banded system B x = b in place (b becomes x) by
+// Gaussian elimination without pivoting; -1 on a zero pivot
+static int band_solve(double *B, long n, long bw, double *b) {
+    long row = 2 * bw + 1;
+#define BAND(i, j) B[(i) * row + ((j) - (i)) + bw]
+    for (long k = 0; k < n; k++) {
+        double pivot = BAND(k, k);
+        if (pivot == 0) {
+            return -1;
+        }
+        long last = k + bw < n - 1 ? k + bw : n - 1;
+        for (long i = k + 1; i <= last; i++) {
+            double l = BAND(i, k) / pivot;
+            if (l == 0) {
+                continue;
+            }
+            for (long j = k + 1; j <= last; j++) {
+                BAND(i, j) -= l * BAND(k, j);
+            }
+            b[i] -= l * b[k];
+        }
+    }
+    for (long i = n - 1; i >= 0; i--) {
+        double sum = b[i];
+        long last = i + bw < n - 1 ? i + bw : n - 1;
+        for (long j = i + 1; j <= last; j++) {
+            sum -= BAND(i, j) * b[j];
+        }
+        b[i] = sum / BAND(i, i);
+    }
+#undef BAND
+    return 0;
+}
+
+int fsp_stationary(const fsp_solver *s, const int *ref, double *p) {
+    int zero[FSP_MAX_SPECIES] = {0};
+    long r = fsp_state_index(s, ref != NULL ? ref : zero);
+    if (r < 0) {
+        fprintf(stderr, "Error in fsp_stationary: reference state outside the box\n");
+        return -1;
+    }
+    long bw;
+    double *B = build_band(s, 0, &bw);
+    if (B == NULL) {
+        return -1;
+    }
+    long row = 2 * bw + 1;
+
+    // p_ref = 1: its column moves to the right-hand side and its row becomes the identity
+    for (long i = 0; i < s->n_states; i++) {
+        p[i] = 0;
+    }
+    for (long i = r - bw > 0 ? r - bw : 0; i <= r + bw && i < s->n_states; i++) {
+        p[i] = -B[i * row + (r - i) + bw];
+        B[i * row + (r - i) + bw] = 0;
+    }
+    for (long j = r - bw > 0 ? r - bw : 0; j <= r + bw && j < s->n_states; j++) {
+        B[r * row + (j - r) + bw] = 0;
+    }
+    B[r * row + bw] = 1;
+    p[r] = 1;
+
+    int flag = band_solve(B, s->n_states, bw, p);
+    free(B);
+    if (flag != 0) {
+        fprintf(stderr, "Error in fsp_stationary: singular system, is the reference state recurrent?\n");
+        return -1;
+    }
+    double sum = 0;
+    for (long i = 0; i < s->n_states; i++) {
+        p[i] = p[i] > 0 ? p[i] : 0;   // round-off
+        sum += p[i];
+    }
+    for (long i = 0; i < s->n_states; i++) {
+        p[i] /= sum;
+    }
+    return 0;
+}
+
+int fsp_mean_first_passage(const fsp_solver *s, const int *from, int species, int threshold, int direction,
+                           double *time) {
+    long start = fsp_state_index(s, from);
+    if (start < 0 || species < 0 || species >= s->n) {
+        fprintf(stderr, "Error in fsp_mean_first_passage: invalid state or species\n");
+        return -1;
+    }
+    long bw;
+    double *B = build_band(s, 1, &bw);
+    double *tau = malloc(s->n_states * sizeof(double));
+    if (B == NULL || tau == NULL) {
+        free(B);
+        free(tau);
+        return -1;
+    }
+    long row = 2 * bw + 1;
+
+    // Rows of target states become tau = 0; the other rows are -Q tau = 1 without the target columns
+    int x[FSP_MAX_SPECIES];
+    for (long i = 0; i < s->n_states; i++) {
+        decode(s, i, x);
+        int target = direction > 0 ? x[species] >= threshold : x[species] <= threshold;
+        if (target) {
+            for (long j = 0; j < row; j++) {
+                B[i * row + j] = 0;
+            }
+            B[i * row + bw] = 1;
+            tau[i] = 0;
+        } else {
+            tau[i] = 1;
+        }
+    }
+    for (long i = 0; i < s->n_states; i++) {
+        for (long j = i - bw > 0 ? i - bw : 0; j <= i + bw && j < s->n_states; j++) {
+            if (j != i && tau[j] == 0 && tau[i] != 0) {
+                B[i * row + (j - i) + bw] = 0;
+            }
+        }
+    }
+
+    int flag = band_solve(B, s->n_states, bw, tau);
+    if (flag == 0) {
+        *time = tau[start];
+    } else {
+        fprintf(stderr, "Error in fsp_mean_first_passage: some states cannot reach the target\n");
+    }
+    free(B);
+    free(tau);
+    return flag;
+}
+
+int fsp_modes(const double *marginal, int n, double min_mass, int *modes, int max_modes) {
+    int count = 0;
+    for (int k = 0; k < n; k++) {
+        int left_ok = k == 0 || marginal[k] > marginal[k - 1];
+        int right_ok = k == n - 1 || marginal[k] >= marginal[k + 1];
+        if (!left_ok || !right_ok) {
+            continue;
+        }
+        // Mass of the peak between the minima on either side
+        int lo = k, hi = k;
+        while (lo > 0 && marginal[lo - 1] <= marginal[lo]) {
+            lo--;
+        }
+        while (hi < n - 1 && marginal[hi + 1] <= marginal[hi]) {
+            hi++;
+        }
+        double mass = 0;
+        for (int j = lo; j <= hi; j++) {
+            mass += marginal[j];
+        }
+        if (mass >= min_mass) {
+            if (count < max_modes) {
+                modes[count] = k;
+            }
+            count++;
+        }
+    }
+    return count;
+}
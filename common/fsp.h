@@ -0,0 +1,72 @@
+#ifndef FSP_H
+#define FSP_H
+
+#include "reaction_network.h"
+
+// Finite state projection of the chemical master equation
+//
+// The copy numbers are truncated to a box, 0 <= x_i < size_i, and the CME on
+// the box is the sparse generator A (dp/dt = A p, A[y][x] is the rate of
+// x -> y). Transitions that leave the box go to one sink state per species
+// instead, so the sink mass bounds the truncation error. Transient
+// distributions are computed with a Krylov approximation of exp(t A) p
+// (Arnoldi with error control, as in Expokit); when the sinks collect more
+// than the tolerance during an output interval, the box is doubled along
+// the species that leaked most and the interval is repeated.
+//
+// Stationary distributions and mean first passage times use the reflecting
+// truncation (transitions out of the box are dropped) and a banded direct
+// solve without pivoting, which is stable for these M-matrices and, unlike
+// an iterative solver, keeps its accuracy for the 1e-10 probabilities and
+// 1e6 passage times of rare switching. The band is the stride of the last
+// species, so this is meant for one or two species.
+
+#define FSP_MAX_SPECIES 4
+
+typedef struct {
+    double tol;          // allowed sink mass at every output time, 0 for 1e-6
+    long max_states;     // upper limit of the box, 0 for 4e6
+    int krylov_dim;      // Arnoldi basis size, 0 for 30
+} fsp_options;
+
+typedef struct fsp_solver fsp_solver;
+
+// Solver for network with parameters params (NULL: the network defaults) and
+// initial box sizes size (NULL: 32 per species)
+fsp_solver *fsp_create(const reaction_network *network, const double *params, const int *size,
+                       const fsp_options *options);
+void fsp_free(fsp_solver *s);
+
+// Called at every output time with the distribution on the current box
+typedef void (*fsp_output_fn)(int k, double t, const double *p, const fsp_solver *s, void *ctx);
+
+// Transient distributions from the state x0 at t_out[0] to every t_out[k].
+// Returns 0, or -1 when the box would exceed max_states or a step fails.
+int fsp_solve(fsp_solver *s, const int *x0, const double *t_out, int n_out, fsp_output_fn output, void *ctx);
+
+long fsp_num_states(const fsp_solver *s);
+int fsp_size(const fsp_solver *s, int species);
+long fsp_state_index(const fsp_solver *s, const int *x);
+
+// Probability that left the box during the last fsp_solve
+double fsp_sink_mass(const fsp_solver *s);
+
+// Marginal distribution of one species, out[0..fsp_size(s, species))
+void fsp_marginal(const fsp_solver *s, const double *p, int species, double *out);
+
+// Stationary distribution on the current box (p has fsp_num_states entries);
+// ref is a recurrent state (NULL: the empty state). Returns 0 or -1.
+int fsp_stationary(const fsp_solver *s, const int *ref, double *p);
+
+// Mean first passage time from state from to the states with
+// x[species] >= threshold (direction > 0) or x[species] <= threshold
+// (direction < 0). Returns 0, or -1 when the target cannot be reached.
+int fsp_mean_first_passage(const fsp_solver *s, const int *from, int species, int threshold, int direction,
+                           double *time);
+
+// Local maxima of a marginal distribution holding at least min_mass between
+// the neighbouring minima; returns the number of modes (positions in modes,
+// at most max_modes are stored)
+int fsp_modes(const double *marginal, int n, double min_mass, int *modes, int max_modes);
+
+#endif
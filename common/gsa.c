@@ -0,0 +1,440 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "circuit_solver.h"
+#include "rng.h"
+#include "sobol.h"
+#include "gsa.h"
+#include "ensemble_runner.h"
+
+#define GSA_BLOCK 16              // rows per block of work
+#define DEFAULT_BOOTSTRAP 200
+#define DEFAULT_CONFIDENCE 0.95
+#define DEFAULT_LEVELS 4
+
+typedef struct {
+    const gsa_problem *problem;
+    gsa_options options;
+    int morris;
+    long n_rows;
+    int n_stats;                  // running sums per replicate and output
+    int n_replicates;             // 1 + n_bootstrap; replicate 0 has unit weights
+    sobol_state sobol;            // Saltelli design, 2k dimensions
+    double shift[GSA_MAX_OUTPUTS];   // outputs at the centre of the box, subtracted before summing
+    double *sums;                 // [replicate][output][stat]
+    long n_failed;
+    long merged_blocks;           // blocks added to sums, in order, under the runner's lock
+    pthread_cond_t merged;
+} gsa_job;
+
+// Per-thread solver and buffers
+typedef struct {
+    const gsa_problem *problem;
+    circuit_solver *solver;
+    realtype *params, *t_out, *out;
+} gsa_work;
+
+double gsa_output_value(const gsa_output *output, const double *times, int n_times, const realtype *out,
+                        int n_species) {
+    int i = output->species;
+    double first = out[i], last = out[(size_t)(n_times - 1) * n_species + i];
+    switch (output->kind) {
+    case GSA_PEAK: {
+        double peak = first;
+        for (int k = 1; k < n_times; k++) {
+            peak = fmax(peak, out[(size_t)k * n_species + i]);
+        }
+        return peak;
+    }
+    case GSA_RESPONSE_TIME: {
+        double half = first + 0.5 * (last - first);
+        if (last == first) {
+            return times[0];
+        }
+        for (int k = 1; k < n_times; k++) {
+            double y = out[(size_t)k * n_species + i], y_prev = out[(size_t)(k - 1) * n_species + i];
+            if ((y - half) * (last - first) >= 0) {
+                return times[k - 1] + (half - y_prev) / (y - y_prev) * (times[k] - times[k - 1]);
+            }
+        }
+        return times[n_times - 1];
+    }
+    default:
+        return last;
+    }
+}
+
+// Function to set the factors from a point u of the unit cube and solve; fills f[n_outputs], returns 0 or -1
+static int evaluate(gsa_work *w, const double *u, double *f) {
+    const gsa_problem *pr = w->problem;
+    for (int k = 0; k < pr->n_factors; k++) {
+        double lo = pr->lower[k], hi = pr->upper[k];
+        w->params[pr->factors[k]] = pr->log_scale ? exp(log(lo) + u[k] * (log(hi) - log(lo))) : lo + u[k] * (hi - lo);
+    }
+    if (circuit_solver_run(w->solver, w->params, pr->y0, w->t_out, pr->n_times, w->out) != 0) {
+        return -1;
+    }
+    for (int o = 0; o < pr->n_outputs; o++) {
+        f[o] = gsa_output_value(&pr->outputs[o], pr->times, pr->n_times, w->out, pr->model->n_species);
+        if (!isfinite(f[o])) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int work_init(gsa_work *w, const gsa_problem *pr, const gsa_options *o) {
+    const circuit_model *m = pr->model;
+    circuit_solver_options so = {o->rtol, o->atol, 0, o->method};
+    w->problem = pr;
+    w->solver = circuit_solver_create(m, &so);
+    w->params = malloc(sizeof(realtype) * (m->n_params + pr->n_times * (1 + (size_t)m->n_species)));
+    if (w->solver == NULL || w->params == NULL) {
+        return -1;
+    }
+    w->t_out = w->params + m->n_params;
+    w->out = w->t_out + pr->n_times;
+    for (int k = 0; k < m->n_params; k++) {
+        w->params[k] = pr->params != NULL ? pr->params[k] : m->default_params[k];
+    }
+    for (int k = 0; k < pr->n_times; k++) {
+        w->t_out[k] = pr->times[k];
+    }
+    return 0;
+}
+
+static void work_free(gsa_work *w) {
+    circuit_solver_free(w->solver);
+    free(w->params);
+}
+
+// Function to draw the Poisson(1) bootstrap weights of one row; weight[0] is the estimate itself
+static void bootstrap_weights(rng_state *rng, int n_replicates, double *weight) {
+    weight[0] = 1;
+    for (int b = 1; b < n_replicates; b++) {
+        double u = rng_uniform(rng), p = exp(-1.0), cumulative = p;
+        int n = 0;
+        while (u > cumulative && n < 16) {
+            n++;
+            p /= n;
+            cumulative += p;
+        }
+        weight[b] = n;
+    }
+}
+
+// Function to run the k + 2 solves of Saltelli row n and add them to sums; returns 0 or -1
+static int sobol_row(gsa_job *job, gsa_work *w, long n, double *f, double *weight, double *sums) {
+    const gsa_problem *pr = job->problem;
+    int K = pr->n_factors, O = pr->n_outputs;
+    double u[2 * GSA_MAX_FACTORS], ab[GSA_MAX_FACTORS];
+    sobol_point(&job->sobol, n, u);
+    // f[0] from A, f[1] from B, f[2 + i] from A with column i of B
+    if (evaluate(w, u, f) != 0 || evaluate(w, u + K, f + O) != 0) {
+        return -1;
+    }
+    for (int i = 0; i < K; i++) {
+        memcpy(ab, u, K * sizeof(double));
+        ab[i] = u[K + i];
+        if (evaluate(w, ab, f + (2 + i) * O) != 0) {
+            return -1;
+        }
+    }
+    rng_state rng;
+    rng_seed(&rng, job->options.seed, n);
+    bootstrap_weights(&rng, job->n_replicates, weight);
+    for (int o = 0; o < O; o++) {
+        double fa = f[o] - job->shift[o], fb = f[O + o] - job->shift[o];
+        for (int b = 0; b < job->n_replicates; b++) {
+            double wt = weight[b];
+            if (wt == 0) {
+                continue;
+            }
+            double *s = sums + ((size_t)b * O + o) * job->n_stats;
+            s[0] += wt;
+            s[1] += wt * fa;
+            s[2] += wt * fb;
+            s[3] += wt * fa * fa;
+            s[4] += wt * fb * fb;
+            for (int i = 0; i < K; i++) {
+                double fab = f[(2 + i) * O + o] - job->shift[o];
+                s[5 + i] += wt * fb * (fab - fa);
+                s[5 + K + i] += wt * (fa - fab) * (fa - fab);
+            }
+        }
+    }
+    return 0;
+}
+
+// Function to run the k + 1 solves of Morris trajectory n and add its elementary effects to sums
+static int morris_row(gsa_job *job, gsa_work *w, long n, double *f, double *weight, double *sums) {
+    const gsa_problem *pr = job->problem;
+    int K = pr->n_factors, O = pr->n_outputs, p = job->options.levels;
+    double delta = p / (2.0 * (p - 1)), x[GSA_MAX_FACTORS] = {0}, sign[GSA_MAX_FACTORS], ee[GSA_MAX_FACTORS * GSA_MAX_OUTPUTS];
+    int order[GSA_MAX_FACTORS];
+    rng_state rng;
+    rng_seed(&rng, job->options.seed, n);
+    // Base point on the lower half of the grid, then each factor moves by +delta or -delta in random order
+    for (int i = 0; i < K; i++) {
+        x[i] = (double)(rng_next(&rng) % (p / 2)) / (p - 1);
+        sign[i] = 1;
+        if (rng_next(&rng) >> 63) {
+            x[i] += delta;
+            sign[i] = -1;
+        }
+        order[i] = i;
+    }
+    for (int i = K - 1; i > 0; i--) {
+        int j = (int)(rng_next(&rng) % (uint64_t)(i + 1)), swap = order[i];
+        order[i] = order[j];
+        order[j] = swap;
+    }
+    if (evaluate(w, x, f) != 0) {
+        return -1;
+    }
+    for (int step = 0; step < K; step++) {
+        int i = order[step];
+        double *prev = f + (step % 2) * O, *next = f + ((step + 1) % 2) * O;
+        x[i] += sign[i] * delta;
+        if (evaluate(w, x, next) != 0) {
+            return -1;
+        }
+        for (int o = 0; o < O; o++) {
+            ee[o * K + i] = (next[o] - prev[o]) / (sign[i] * delta);
+        }
+    }
+    bootstrap_weights(&rng, job->n_replicates, weight);
+    for (int b = 0; b < job->n_replicates; b++) {
+        double wt = weight[b];
+        if (wt == 0) {
+            continue;
+        }
+        for (int o = 0; o < O; o++) {
+            double *s = sums + ((size_t)b * O + o) * job->n_stats;
+            s[0] += wt;
+            for (int i = 0; i < K; i++) {
+                double e = ee[o * K + i];
+                s[1 + i] += wt * e;
+                s[1 + K + i] += wt * fabs(e);
+                s[1 + 2 * K + i] += wt * e * e;
+            }
+        }
+    }
+    return 0;
+}
+
+static void gsa_worker(ensemble_runner *r, int thread, void *arg) {
+    gsa_job *job = arg;
+    const gsa_problem *pr = job->problem;
+    size_t n_sums = (size_t)job->n_replicates * pr->n_outputs * job->n_stats;
+    gsa_work w = {0};
+    double *sums = malloc(sizeof(double) * (n_sums + job->n_replicates + (pr->n_factors + 2) * (size_t)pr->n_outputs));
+    if (work_init(&w, pr, &job->options) != 0 || sums == NULL) {
+        fprintf(stderr, "Error in gsa: cannot create the solver\n");
+        work_free(&w);
+        free(sums);
+        return;
+    }
+    double *weight = sums + n_sums, *f = weight + job->n_replicates;
+    long first, end;
+    (void)thread;
+    while (ensemble_runner_next(r, &first, &end)) {
+        long block = first / GSA_BLOCK, failed = 0;
+        memset(sums, 0, n_sums * sizeof(double));
+        for (long n = first; n < end; n++) {
+            int flag = job->morris ? morris_row(job, &w, n, f, weight, sums) : sobol_row(job, &w, n, f, weight, sums);
+            failed += flag != 0;
+        }
+        // Merge in block order so the sums do not depend on the thread count
+        pthread_mutex_lock(&r->lock);
+        while (job->merged_blocks != block) {
+            pthread_cond_wait(&job->merged, &r->lock);
+        }
+        for (size_t k = 0; k < n_sums; k++) {
+            job->sums[k] += sums[k];
+        }
+        job->n_failed += failed;
+        job->merged_blocks++;
+        pthread_cond_broadcast(&job->merged);
+        pthread_mutex_unlock(&r->lock);
+    }
+    work_free(&w);
+    free(sums);
+}
+
+// Function to validate the problem, fill the defaults and run every row into job->sums; returns 0 or -1
+static int run_job(gsa_job *job, const gsa_problem *pr, const gsa_options *options, long n_rows) {
+    int K = pr->n_factors;
+    if (K < 1 || K > GSA_MAX_FACTORS || pr->n_outputs < 1 || pr->n_outputs > GSA_MAX_OUTPUTS ||
+        pr->n_times < 2 || n_rows < 1) {
+        fprintf(stderr, "Error in gsa: invalid problem size\n");
+        return -1;
+    }
+    for (int k = 0; k < K; k++) {
+        if (!(pr->lower[k] <= pr->upper[k]) || (pr->log_scale && pr->lower[k] <= 0) ||
+            pr->factors[k] < 0 || pr->factors[k] >= pr->model->n_params) {
+            fprintf(stderr, "Error in gsa: invalid factor %d\n", k);
+            return -1;
+        }
+    }
+    for (int o = 0; o < pr->n_outputs; o++) {
+        if (pr->outputs[o].species < 0 || pr->outputs[o].species >= pr->model->n_species) {
+            fprintf(stderr, "Error in gsa: output %d has no species %d\n", o, pr->outputs[o].species);
+            return -1;
+        }
+    }
+    job->problem = pr;
+    if (options != NULL) {
+        job->options = *options;
+    }
+    if (job->options.n_bootstrap == 0) {
+        job->options.n_bootstrap = DEFAULT_BOOTSTRAP;
+    }
+    if (job->options.confidence <= 0 || job->options.confidence >= 1) {
+        job->options.confidence = DEFAULT_CONFIDENCE;
+    }
+    if (job->options.levels < 2 || job->options.levels % 2) {
+        job->options.levels = DEFAULT_LEVELS;
+    }
+    if (job->options.rtol <= 0) {
+        job->options.rtol = 1e-6;
+    }
+    if (job->options.atol <= 0) {
+        job->options.atol = 1e-10;
+    }
+    job->n_rows = n_rows;
+    job->n_replicates = 1 + (job->options.n_bootstrap > 0 ? job->options.n_bootstrap : 0);
+    job->n_stats = job->morris ? 1 + 3 * K : 5 + 2 * K;
+    if (!job->morris) {
+        sobol_init(&job->sobol, 2 * K, job->options.seed);
+    }
+    job->sums = calloc((size_t)job->n_replicates * pr->n_outputs * job->n_stats, sizeof(double));
+    if (job->sums == NULL) {
+        return -1;
+    }
+
+    // Outputs at the centre of the box as the origin of the sums, against cancellation in the variance
+    gsa_work w = {0};
+    double centre[GSA_MAX_FACTORS];
+    for (int k = 0; k < K; k++) {
+        centre[k] = 0.5;
+    }
+    if (work_init(&w, pr, &job->options) != 0 || evaluate(&w, centre, job->shift) != 0) {
+        memset(job->shift, 0, sizeof(job->shift));
+    }
+    work_free(&w);
+
+    pthread_cond_init(&job->merged, NULL);
+    long n_blocks = (n_rows + GSA_BLOCK - 1) / GSA_BLOCK;
+    ensemble_runner_run(n_rows, GSA_BLOCK, job->options.threads, gsa_worker, job);
+    pthread_cond_destroy(&job->merged);
+    if (job->merged_blocks != n_blocks) {
+        free(job->sums);
+        return -1;
+    }
+    return 0;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Function to get the bootstrap interval of the replicates v[1..n_replicates) (v[0] is the estimate)
+static void interval(double *v, int n_replicates, double confidence, double *lo, double *hi) {
+    if (n_replicates < 2) {
+        *lo = *hi = v[0];
+        return;
+    }
+    int n = n_replicates - 1;
+    qsort(v + 1, n, sizeof(double), compare_doubles);
+    double alpha = 0.5 * (1 - confidence);
+    *lo = v[1 + (int)floor(alpha * (n - 1) + 0.5)];
+    *hi = v[1 + (int)floor((1 - alpha) * (n - 1) + 0.5)];
+}
+
+int gsa_sobol(const gsa_problem *problem, const gsa_options *options, long n_rows, gsa_sobol_result *results) {
+    gsa_job job = {0};
+    if (run_job(&job, problem, options, n_rows) != 0) {
+        return -1;
+    }
+    int K = problem->n_factors, O = problem->n_outputs, R = job.n_replicates;
+    double *first = malloc(sizeof(double) * R * 2 * K);
+    if (first == NULL) {
+        fprintf(stderr, "Error in gsa_sobol: out of memory\n");
+        free(job.sums);
+        return -1;
+    }
+    double *total = first + R * K;
+    for (int o = 0; o < O; o++) {
+        gsa_sobol_result *res = &results[o];
+        for (int b = 0; b < R; b++) {
+            const double *s = job.sums + ((size_t)b * O + o) * job.n_stats;
+            double W = s[0], mean = W > 0 ? (s[1] + s[2]) / (2 * W) : 0;
+            double variance = W > 0 ? (s[3] + s[4]) / (2 * W) - mean * mean : 0;
+            for (int i = 0; i < K; i++) {
+                first[i * R + b] = variance > 0 ? s[5 + i] / W / variance : 0;
+                total[i * R + b] = variance > 0 ? s[5 + K + i] / (2 * W) / variance : 0;
+            }
+            if (b == 0) {
+                res->mean = job.shift[o] + mean;
+                res->variance = variance;
+            }
+        }
+        for (int i = 0; i < K; i++) {
+            res->first[i] = first[i * R];
+            res->total[i] = total[i * R];
+            interval(first + i * R, R, job.options.confidence, &res->first_lo[i], &res->first_hi[i]);
+            interval(total + i * R, R, job.options.confidence, &res->total_lo[i], &res->total_hi[i]);
+        }
+        res->n_failed = job.n_failed;
+        res->n_rows = n_rows - job.n_failed;
+    }
+    free(first);
+    free(job.sums);
+    return 0;
+}
+
+int gsa_morris(const gsa_problem *problem, const gsa_options *options, long n_rows, gsa_morris_result *results) {
+    gsa_job job = {0};
+    job.morris = 1;
+    if (run_job(&job, problem, options, n_rows) != 0) {
+        return -1;
+    }
+    int K = problem->n_factors, O = problem->n_outputs, R = job.n_replicates;
+    double *mu_star = malloc(sizeof(double) * R * 2 * K);
+    if (mu_star == NULL) {
+        fprintf(stderr, "Error in gsa_morris: out of memory\n");
+        free(job.sums);
+        return -1;
+    }
+    double *sigma = mu_star + R * K;
+    for (int o = 0; o < O; o++) {
+        gsa_morris_result *res = &results[o];
+        for (int b = 0; b < R; b++) {
+            const double *s = job.sums + ((size_t)b * O + o) * job.n_stats;
+            double W = s[0];
+            for (int i = 0; i < K; i++) {
+                double mu = W > 0 ? s[1 + i] / W : 0;
+                mu_star[i * R + b] = W > 0 ? s[1 + K + i] / W : 0;
+                sigma[i * R + b] = W > 1 ? sqrt(fmax(0, (s[1 + 2 * K + i] - W * mu * mu) / (W - 1))) : 0;
+                if (b == 0) {
+                    res->mu[i] = mu;
+                }
+            }
+        }
+        for (int i = 0; i < K; i++) {
+            res->mu_star[i] = mu_star[i * R];
+            res->sigma[i] = sigma[i * R];
+            interval(mu_star + i * R, R, job.options.confidence, &res->mu_star_lo[i], &res->mu_star_hi[i]);
+            interval(sigma + i * R, R, job.options.confidence, &res->sigma_lo[i], &res->sigma_hi[i]);
+        }
+        res->n_failed = job.n_failed;
+        res->n_rows = n_rows - job.n_failed;
+    }
+    free(mu_star);
+    free(job.sums);
+    return 0;
+}
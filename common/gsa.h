@@ -0,0 +1,95 @@
+#ifndef GSA_H
+#define GSA_H
+
+#include <stdint.h>
+#include "circuits.h"
+
+// Global sensitivity analysis of scalar circuit outputs
+//
+// The factors are selected parameters varied over a box (log-uniformly with
+// log_scale). Every model run solves the circuit once on the time grid and
+// reduces the trajectory to the requested scalar outputs.
+//
+//   - gsa_sobol: first-order (Saltelli 2010) and total (Jansen) Sobol
+//     indices from N base rows, each needing the matrices A and B of one
+//     2k-dimensional Sobol point and the k mixed rows AB_i: N (k + 2) runs.
+//   - gsa_morris: elementary effects (mean mu, mean absolute mu*, standard
+//     deviation sigma) on r one-at-a-time trajectories over a p-level grid:
+//     r (k + 1) runs.
+//
+// Rows are evaluated in blocks on a pool of threads, each thread with one
+// circuit_solver reused for all its runs. Only running sums are kept, so
+// memory does not grow with the number of rows. Confidence intervals come
+// from the Poisson bootstrap: each row enters replicate b with a Poisson(1)
+// weight drawn from random stream (seed, row), so the replicates are
+// accumulated alongside the estimate without storing any output. Block sums
+// are merged in block order, so the results do not depend on the number of
+// threads.
+
+#define GSA_MAX_FACTORS 14    // 2k Sobol dimensions for the Saltelli design
+#define GSA_MAX_OUTPUTS 16
+
+#define GSA_FINAL 0           // value at the last time (the steady state if the run has settled)
+#define GSA_PEAK 1            // largest value on the time grid
+#define GSA_RESPONSE_TIME 2   // first time half way from the initial to the final value
+
+typedef struct {
+    int kind;
+    int species;
+} gsa_output;
+
+typedef struct {
+    const circuit_model *model;
+    const realtype *params;       // fixed parameters, NULL for the defaults
+    const realtype *y0;           // NULL for the defaults
+    int n_factors;
+    const int *factors;           // indices of the varied parameters
+    const double *lower;          // per factor
+    const double *upper;
+    int log_scale;                // sample log-uniformly (bounds must be positive)
+    int n_outputs;
+    const gsa_output *outputs;
+    int n_times;
+    const double *times;          // increasing; the solve starts at times[0]
+} gsa_problem;
+
+typedef struct {
+    int threads;                  // <= 0: all CPUs
+    uint64_t seed;                // Sobol digital shift, Morris trajectories and bootstrap weights
+    int n_bootstrap;              // replicates, 0 for 200, < 0 for none
+    double confidence;            // interval level, 0 for 0.95
+    int levels;                   // Morris grid levels (even), 0 for 4
+    realtype rtol;                // solver tolerances, 0 for 1e-6 and 1e-10
+    realtype atol;
+    int method;                   // CIRCUIT_ADAMS, CIRCUIT_BDF or CIRCUIT_AUTO
+} gsa_options;
+
+// Per output; the _lo and _hi entries are the bootstrap interval (equal to the estimate without bootstrap)
+typedef struct {
+    double mean, variance;
+    double first[GSA_MAX_FACTORS], first_lo[GSA_MAX_FACTORS], first_hi[GSA_MAX_FACTORS];
+    double total[GSA_MAX_FACTORS], total_lo[GSA_MAX_FACTORS], total_hi[GSA_MAX_FACTORS];
+    long n_rows;                  // rows used
+    long n_failed;                // rows dropped because a solve failed
+} gsa_sobol_result;
+
+typedef struct {
+    double mu[GSA_MAX_FACTORS];
+    double mu_star[GSA_MAX_FACTORS], mu_star_lo[GSA_MAX_FACTORS], mu_star_hi[GSA_MAX_FACTORS];
+    double sigma[GSA_MAX_FACTORS], sigma_lo[GSA_MAX_FACTORS], sigma_hi[GSA_MAX_FACTORS];
+    long n_rows;                  // trajectories used
+    long n_failed;
+} gsa_morris_result;
+
+// Sobol indices from n_rows base rows; results has n_outputs entries. Returns 0 or -1.
+int gsa_sobol(const gsa_problem *problem, const gsa_options *options, long n_rows, gsa_sobol_result *results);
+
+// Morris elementary effects from n_rows trajectories, in units of the output per unit of the
+// (log-)scaled box; results has n_outputs entries. Returns 0 or -1.
+int gsa_morris(const gsa_problem *problem, const gsa_options *options, long n_rows, gsa_morris_result *results);
+
+// Scalar output of a trajectory out[k * n_species + i] on times[0..n_times)
+double gsa_output_value(const gsa_output *output, const double *times, int n_times, const realtype *out,
+                        int n_species);
+
+#endif
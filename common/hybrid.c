@@ -0,0 +1,352 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <cvode/cvode.h>             // prototypes for CVODE functions and constants
+#include <nvector/nvector_serial.h>  // serial N_Vector types, functions, and macros
+#include <sunmatrix/sunmatrix_dense.h> // access to dense SUNMatrix
+#include <sunlinsol/sunlinsol_dense.h> // access to dense SUNLinearSolver
+#include "rng.h"
+#include "hybrid.h"
+
+#define DEFAULT_MIN_COUNT 100.0
+#define DEFAULT_MIN_RATE 10.0
+
+struct hybrid_solver {
+    const reaction_network *network;
+    hybrid_options options;
+    const double *params;
+    rng_state rng;
+    // CVODE state: the species followed by the discrete hazard G
+    void *cvode_mem;
+    N_Vector y;
+    SUNMatrix A;
+    SUNLinearSolver LS;
+    int initialized;
+    int uncounted;           // CVODE counters since the last (re)initialization not yet in stats
+    char *continuous;        // per reaction: 1 when integrated as ODE
+    int n_continuous;
+    double threshold;        // Exp(1) hazard at which the next discrete reaction fires
+    double *x;               // species as doubles for the propensity function
+    double *a;
+    long n_repartitions;
+    solver_stats stats;
+};
+
+// Function to compute the ODE of the continuous reactions and the discrete hazard rate
+static int hybrid_rhs(realtype t, N_Vector y, N_Vector ydot, void *user_data) {
+    hybrid_solver *s = user_data;
+    const reaction_network *net = s->network;
+    int n = net->n_species, R = net->n_reactions;
+    realtype *yv = N_VGetArrayPointer(y), *dv = N_VGetArrayPointer(ydot);
+    for (int i = 0; i < n; i++) {
+        s->x[i] = yv[i] > 0 ? yv[i] : 0;
+        dv[i] = 0;
+    }
+    net->propensities(s->x, s->a, s->params);
+    double hazard = 0;
+    for (int r = 0; r < R; r++) {
+        double a = s->a[r] > 0 ? s->a[r] : 0;
+        if (s->continuous[r]) {
+            const int *S = net->stoich + r * n;
+            for (int i = 0; i < n; i++) {
+                dv[i] += S[i] * a;
+            }
+        } else {
+            hazard += a;
+        }
+    }
+    dv[n] = hazard;
+    return 0;
+}
+
+// Root of G - threshold: the next discrete event
+static int hybrid_root(realtype t, N_Vector y, realtype *gout, void *user_data) {
+    hybrid_solver *s = user_data;
+    gout[0] = NV_Ith_S(y, s->network->n_species) - s->threshold;
+    return 0;
+}
+
+hybrid_solver *hybrid_create(const reaction_network *network, const hybrid_options *options) {
+    hybrid_solver *s = calloc(1, sizeof(*s));
+    if (s == NULL) {
+        return NULL;
+    }
+    s->network = network;
+    if (options != NULL) {
+        s->options = *options;
+    }
+    if (s->options.min_count <= 0) {
+        s->options.min_count = DEFAULT_MIN_COUNT;
+    }
+    if (s->options.min_rate <= 0) {
+        s->options.min_rate = DEFAULT_MIN_RATE;
+    }
+    if (s->options.rtol <= 0) {
+        s->options.rtol = 1e-6;
+    }
+    if (s->options.atol <= 0) {
+        s->options.atol = 1e-8;
+    }
+    int n = network->n_species, R = network->n_reactions;
+    s->continuous = calloc(R, 1);
+    s->x = malloc(n * sizeof(double));
+    s->a = malloc(R * sizeof(double));
+    s->y = N_VNew_Serial(n + 1);
+    s->cvode_mem = CVodeCreate(CV_BDF);
+    s->A = SUNDenseMatrix(n + 1, n + 1);
+    s->LS = s->A && s->y ? SUNLinSol_Dense(s->y, s->A) : NULL;
+    if (s->continuous == NULL || s->x == NULL || s->a == NULL || s->y == NULL || s->cvode_mem == NULL ||
+        s->LS == NULL) {
+        fprintf(stderr, "Error in hybrid_create\n");
+        hybrid_free(s);
+        return NULL;
+    }
+    return s;
+}
+
+void hybrid_free(hybrid_solver *s) {
+    if (s == NULL) {
+        return;
+    }
+    if (s->cvode_mem != NULL) {
+        CVodeFree(&s->cvode_mem);
+    }
+    if (s->LS != NULL) {
+        SUNLinSolFree(s->LS);
+    }
+    if (s->A != NULL) {
+        SUNMatDestroy(s->A);
+    }
+    if (s->y != NULL) {
+        N_VDestroy(s->y);
+    }
+    free(s->continuous);
+    free(s->x);
+    free(s->a);
+    free(s);
+}
+
+const solver_stats *hybrid_stats(const hybrid_solver *s) {
+    return &s->stats;
+}
+
+long hybrid_num_repartitions(const hybrid_solver *s) {
+    return s->n_repartitions;
+}
+
+// Function to add the CVODE counters since the last (re)initialization to the run statistics
+static void accumulate_cvode_stats(hybrid_solver *s) {
+    if (!s->uncounted) {
+        return;
+    }
+    s->uncounted = 0;
+    solver_stats part = {0};
+    solver_stats_collect_cvode(s->cvode_mem, &part);
+    s->stats.n_steps += part.n_steps;
+    s->stats.n_rhs_evals += part.n_rhs_evals;
+    s->stats.n_jac_evals += part.n_jac_evals;
+    s->stats.n_lin_setups += part.n_lin_setups;
+    s->stats.n_nonlin_iters += part.n_nonlin_iters;
+    s->stats.n_nonlin_conv_fails += part.n_nonlin_conv_fails;
+    s->stats.n_err_test_fails += part.n_err_test_fails;
+    s->stats.last_step = part.last_step;
+}
+
+// Function to classify every reaction at the current state; returns 1 if the partition changed
+static int repartition(hybrid_solver *s) {
+    const reaction_network *net = s->network;
+    int n = net->n_species, R = net->n_reactions, changed = 0;
+    realtype *y = N_VGetArrayPointer(s->y);
+    for (int i = 0; i < n; i++) {
+        s->x[i] = y[i] > 0 ? y[i] : 0;
+    }
+    net->propensities(s->x, s->a, s->params);
+    s->n_continuous = 0;
+    for (int r = 0; r < R; r++) {
+        int continuous = s->a[r] >= s->options.min_rate;
+        const int *S = net->stoich + r * n;
+        for (int i = 0; i < n && continuous; i++) {
+            continuous = S[i] == 0 || s->x[i] >= s->options.min_count;
+        }
+        changed |= continuous != s->continuous[r];
+        s->continuous[r] = (char)continuous;
+        s->n_continuous += continuous;
+    }
+    s->n_repartitions += changed;
+    return changed;
+}
+
+// Function to (re)start CVODE from the current state at time t
+static int restart_cvode(hybrid_solver *s, realtype t) {
+    accumulate_cvode_stats(s);
+    if (s->initialized) {
+        int flag = CVodeReInit(s->cvode_mem, t, s->y);
+        s->uncounted = flag == CV_SUCCESS;
+        return flag;
+    }
+    int flag = CVodeInit(s->cvode_mem, hybrid_rhs, t, s->y);
+    if (flag == CV_SUCCESS) {
+        flag = CVodeSStolerances(s->cvode_mem, s->options.rtol, s->options.atol);
+    }
+    if (flag == CV_SUCCESS) {
+        flag = CVodeSetLinearSolver(s->cvode_mem, s->LS, s->A);
+    }
+    if (flag == CV_SUCCESS) {
+        flag = CVodeSetUserData(s->cvode_mem, s);
+    }
+    if (flag == CV_SUCCESS) {
+        flag = CVodeRootInit(s->cvode_mem, 1, hybrid_root);
+    }
+    if (flag != CV_SUCCESS) {
+        fprintf(stderr, "Error initializing CVODE in hybrid_run\n");
+        return flag;
+    }
+    s->initialized = 1;
+    s->uncounted = 1;
+    return CV_SUCCESS;
+}
+
+// Function to fire one discrete reaction chosen by the propensities at the current state
+static void fire_discrete(hybrid_solver *s) {
+    const reaction_network *net = s->network;
+    int n = net->n_species, R = net->n_reactions;
+    realtype *y = N_VGetArrayPointer(s->y);
+    for (int i = 0; i < n; i++) {
+        s->x[i] = y[i] > 0 ? y[i] : 0;
+    }
+    net->propensities(s->x, s->a, s->params);
+    double total = 0;
+    for (int r = 0; r < R; r++) {
+        total += !s->continuous[r] && s->a[r] > 0 ? s->a[r] : 0;
+    }
+    double target = rng_uniform(&s->rng) * total, sum = 0;
+    int fired = -1;
+    for (int r = 0; r < R; r++) {
+        if (!s->continuous[r] && s->a[r] > 0) {
+            sum += s->a[r];
+            fired = r;
+            if (target < sum) {
+                break;
+            }
+        }
+    }
+    if (fired < 0) {
+        return;
+    }
+    const int *S = net->stoich + fired * n;
+    for (int i = 0; i < n; i++) {
+        y[i] += S[i];
+        y[i] = y[i] > 0 ? y[i] : 0;
+    }
+    if (fired < SOLVER_STATS_MAX_REACTIONS) {
+        s->stats.reaction_events[fired]++;
+    }
+}
+
+// Function to advance to t_end with discrete reactions only: exact SSA, the propensities
+// are constant between events
+static void advance_discrete(hybrid_solver *s, double *t, double t_end) {
+    const reaction_network *net = s->network;
+    int n = net->n_species, R = net->n_reactions;
+    realtype *y = N_VGetArrayPointer(s->y);
+    while (*t < t_end) {
+        for (int i = 0; i < n; i++) {
+            s->x[i] = y[i];
+        }
+        net->propensities(s->x, s->a, s->params);
+        double total = 0;
+        for (int r = 0; r < R; r++) {
+            total += s->a[r] > 0 ? s->a[r] : 0;
+        }
+        double needed = s->threshold - y[n];   // hazard left until the next event
+        if (total <= 0 || *t + needed / total > t_end) {
+            y[n] += total * (t_end - *t);
+            *t = t_end;
+            break;
+        }
+        *t += needed / total;
+        fire_discrete(s);
+        y[n] = 0;
+        s->threshold = -log(rng_uniform(&s->rng));
+        if (repartition(s) && s->n_continuous > 0) {
+            break;   // continue with the ODE
+        }
+    }
+}
+
+int hybrid_run(hybrid_solver *s, const double *params, const double *x0, long run,
+               void *out, const output_spec *spec, int n_steps, double dt) {
+    const reaction_network *net = s->network;
+    int n = net->n_species;
+    double mark = solver_stats_clock();
+    solver_stats *st = &s->stats;
+    memset(st, 0, sizeof(*st));
+    st->n_reactions = net->n_reactions < SOLVER_STATS_MAX_REACTIONS ? net->n_reactions : SOLVER_STATS_MAX_REACTIONS;
+    s->n_repartitions = 0;
+
+    output_spec o;
+    if (output_spec_resolve(spec, n, n_steps, &o) != 0) {
+        return -1;
+    }
+    s->params = params != NULL ? params : net->default_params;
+    rng_seed(&s->rng, s->options.seed, (uint64_t)run);
+    realtype *y = N_VGetArrayPointer(s->y);
+    for (int i = 0; i < n; i++) {
+        y[i] = x0 != NULL ? x0[i] : 0;
+    }
+    y[n] = 0;
+    s->threshold = -log(rng_uniform(&s->rng));
+    memset(s->continuous, 0, net->n_reactions);
+    repartition(s);
+    s->n_repartitions = 0;
+    double t = 0.0;
+    int cvode_ready = 0;   // CVODE holds the current state
+    st->setup_time = solver_stats_lap(&mark);
+
+    int n_samples = o.n_samples > 0 ? o.n_samples : n_steps;
+    for (int k = 0; k < n_samples; k++) {
+        double t_sample = o.n_samples > 0 ? o.sample_times[k] : k * dt;
+        if (o.n_samples == 0 && k % o.stride != 0) {
+            continue;
+        }
+        while (t < t_sample) {
+            if (s->n_continuous == 0) {
+                advance_discrete(s, &t, t_sample);
+                cvode_ready = 0;
+                continue;
+            }
+            if (!cvode_ready) {
+                int flag = restart_cvode(s, t);
+                if (flag != CV_SUCCESS) {
+                    return flag;
+                }
+                cvode_ready = 1;
+            }
+            realtype t_reached;
+            int flag = CVode(s->cvode_mem, t_sample, s->y, &t_reached, CV_NORMAL);
+            if (flag < 0) {
+                accumulate_cvode_stats(s);
+                return flag;
+            }
+            t = t_reached;
+            if (flag == CV_ROOT_RETURN) {
+                fire_discrete(s);
+                y[n] = 0;
+                s->threshold = -log(rng_uniform(&s->rng));
+                repartition(s);
+                cvode_ready = 0;   // the state jumped
+            } else if (repartition(s)) {
+                cvode_ready = 0;   // the right-hand side changed
+            }
+        }
+        st->integrate_time += solver_stats_lap(&mark);
+        for (int i = 0; i < n; i++) {
+            s->x[i] = y[i];
+        }
+        output_spec_store(&o, out, o.n_samples > 0 ? k : k / o.stride, s->x);
+        st->output_time += solver_stats_lap(&mark);
+    }
+    accumulate_cvode_stats(s);
+    return 0;
+}
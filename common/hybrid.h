@@ -0,0 +1,52 @@
+#ifndef HYBRID_H
+#define HYBRID_H
+
+#include <stdint.h>
+#include <sundials/sundials_types.h>  // defs. of realtype
+#include "reaction_network.h"
+#include "output_spec.h"
+#include "solver_stats.h"
+
+// Hybrid SSA/ODE simulation of a reaction_network
+//
+// Reactions are split into a continuous and a discrete set. A reaction is
+// continuous while its propensity is at least min_rate and every species it
+// changes has at least min_count copies; the continuous reactions drive the
+// ODE dx/dt = sum_{r continuous} S_r a_r(x), integrated with CVODE. The
+// discrete reactions fire exactly as in the SSA with time-varying
+// propensities: CVODE also integrates their total hazard
+// G(t) = int sum_{r discrete} a_r(x(s)) ds and a rootfinding function stops
+// the integration when G reaches an Exp(1) threshold, where the reaction is
+// chosen with probability a_r / sum a. The partition is updated after every
+// event and at every output time, so species move between the two regimes
+// as their abundance changes. With no continuous reaction the run is the
+// exact SSA and CVODE is not called.
+
+typedef struct {
+    double min_count;   // copies a continuous reaction needs in every species it changes, 0 for 100
+    double min_rate;    // propensity a continuous reaction needs, 0 for 10
+    realtype rtol;      // 0 for 1e-6
+    realtype atol;      // 0 for 1e-8
+    uint64_t seed;      // run k uses random stream k of this seed
+} hybrid_options;
+
+typedef struct hybrid_solver hybrid_solver;
+
+hybrid_solver *hybrid_create(const reaction_network *network, const hybrid_options *options);
+void hybrid_free(hybrid_solver *s);
+
+// Simulate run number run from x0 (NULL: all zero) with parameters params
+// (NULL: the network defaults) and store the samples selected by spec in the
+// SSA layout (sample i at t = i * dt, or at spec->sample_times). Returns 0,
+// -1 on an invalid spec or the failing CVODE flag.
+int hybrid_run(hybrid_solver *s, const double *params, const double *x0, long run,
+               void *out, const output_spec *spec, int n_steps, double dt);
+
+// Statistics of the last run: discrete events per reaction, CVODE counters summed over
+// the re-initializations after each event, and timings
+const solver_stats *hybrid_stats(const hybrid_solver *s);
+
+// Number of partition changes in the last run
+long hybrid_num_repartitions(const hybrid_solver *s);
+
+#endif
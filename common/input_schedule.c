@@ -0,0 +1,112 @@
+#include <math.h>
+#include "input_schedule.h"
+
+// Function to find the last point at or before t (-1 before the first point)
+static int find_segment(const input_schedule *u, double t) {
+    int lo = -1, hi = u->n_points - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (u->times[mid] <= t) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+// Function to compute the pulse number and phase of t in a pulse train
+static double pulse_phase(const input_schedule *u, double t, double *pulse) {
+    *pulse = floor((t - u->start) / u->period);
+    return t - u->start - *pulse * u->period;
+}
+
+double input_schedule_value(const input_schedule *u, double t) {
+    switch (u->kind) {
+        case INPUT_PIECEWISE_CONSTANT: {
+            int k = find_segment(u, t);
+            return u->values[k > 0 ? k : 0];
+        }
+        case INPUT_PIECEWISE_LINEAR: {
+            int k = find_segment(u, t);
+            if (k < 0) {
+                return u->values[0];
+            }
+            if (k == u->n_points - 1) {
+                return u->values[k];
+            }
+            double w = (t - u->times[k]) / (u->times[k + 1] - u->times[k]);
+            return u->values[k] + w * (u->values[k + 1] - u->values[k]);
+        }
+        case INPUT_PULSE_TRAIN: {
+            double pulse;
+            if (t < u->start) {
+                return u->low;
+            }
+            return pulse_phase(u, t, &pulse) < u->width ? u->high : u->low;
+        }
+        case INPUT_FUNCTION:
+            return u->fn(t, u->ctx);
+        default:
+            return u->value;
+    }
+}
+
+void input_schedule_range(const input_schedule *u, double t0, double t1, double *lo, double *hi) {
+    switch (u->kind) {
+        case INPUT_PIECEWISE_CONSTANT:
+        case INPUT_PIECEWISE_LINEAR: {
+            // Extremes are at t0, at the points inside the window and, for the continuous
+            // linear input, at t1
+            double a = input_schedule_value(u, t0);
+            double b = u->kind == INPUT_PIECEWISE_LINEAR ? input_schedule_value(u, t1) : a;
+            *lo = a < b ? a : b;
+            *hi = a < b ? b : a;
+            for (int k = find_segment(u, t0) + 1; k < u->n_points && u->times[k] < t1; k++) {
+                *lo = u->values[k] < *lo ? u->values[k] : *lo;
+                *hi = u->values[k] > *hi ? u->values[k] : *hi;
+            }
+            return;
+        }
+        case INPUT_PULSE_TRAIN: {
+            double v0 = input_schedule_value(u, t0);
+            double next = input_schedule_next_break(u, t0);
+            double other = v0 == u->high ? u->low : u->high;
+            *lo = v0;
+            *hi = v0;
+            if (next < t1) {
+                *lo = other < v0 ? other : v0;
+                *hi = other > v0 ? other : v0;
+            }
+            return;
+        }
+        case INPUT_FUNCTION:
+            *lo = u->lower;
+            *hi = u->upper;
+            return;
+        default:
+            *lo = u->value;
+            *hi = u->value;
+    }
+}
+
+double input_schedule_next_break(const input_schedule *u, double t) {
+    switch (u->kind) {
+        case INPUT_PIECEWISE_CONSTANT:
+        case INPUT_PIECEWISE_LINEAR: {
+            int k = find_segment(u, t) + 1;
+            return k < u->n_points ? u->times[k] : INFINITY;
+        }
+        case INPUT_PULSE_TRAIN: {
+            double pulse;
+            if (t < u->start) {
+                return u->start;
+            }
+            double phase = pulse_phase(u, t, &pulse);
+            double next = u->start + pulse * u->period + (phase < u->width ? u->width : u->period);
+            return next > t ? next : nextafter(t, INFINITY);   // rounding at a pulse edge
+        }
+        default:
+            return INFINITY;
+    }
+}
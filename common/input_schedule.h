@@ -0,0 +1,40 @@
+#ifndef INPUT_SCHEDULE_H
+#define INPUT_SCHEDULE_H
+
+// Time-dependent inputs for the stochastic solvers
+//
+// An input_schedule gives the value u(t) of an input parameter (e.g. the
+// inducer I of the dichotomous feedback network) and, for the thinning
+// solver in extrande.c, the range of u over a time window and the next time
+// where u jumps or bends. Schedules only point at the caller's arrays.
+
+#define INPUT_CONSTANT 0
+#define INPUT_PIECEWISE_CONSTANT 1   // values[k] on [times[k], times[k+1]), values[0] before times[0]
+#define INPUT_PIECEWISE_LINEAR 2     // linear between the points, constant outside them
+#define INPUT_PULSE_TRAIN 3          // high on [start + k period, start + k period + width), low otherwise
+#define INPUT_FUNCTION 4             // fn(t, ctx), with lower <= fn <= upper for all t
+
+typedef struct {
+    int kind;
+    double value;                  // INPUT_CONSTANT
+    int n_points;                  // INPUT_PIECEWISE_*: increasing times and their values
+    const double *times;
+    const double *values;
+    double low, high;              // INPUT_PULSE_TRAIN
+    double period, width, start;
+    double (*fn)(double t, void *ctx);   // INPUT_FUNCTION
+    void *ctx;
+    double lower, upper;
+} input_schedule;
+
+// Value of the input at time t
+double input_schedule_value(const input_schedule *u, double t);
+
+// Lower and upper bound of the input on [t0, t1), so a jump at t1 is not included;
+// exact except for INPUT_FUNCTION, which returns its global bounds
+void input_schedule_range(const input_schedule *u, double t0, double t1, double *lo, double *hi);
+
+// First time after t where the input jumps or changes slope, INFINITY if there is none
+double input_schedule_next_break(const input_schedule *u, double t);
+
+#endif
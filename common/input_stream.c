@@ -0,0 +1,360 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "input_stream.h"
+
+#define LINE_SIZE 65536
+
+struct input_stream {
+    FILE *fp;
+    int own_fp;
+    int column;
+    int interpolation;
+    int chunk;
+    double *times;            // window of samples, times[0] is sample base
+    double *values;
+    long capacity;
+    long n;                   // samples in the window
+    long base;                // index of times[0] in the whole signal
+    long n_read;
+    long peak;
+    long line_number;
+    int eof;
+    int error;
+    char *line;
+    double first_time;
+    double last_time;
+    // Current piece: segments start..last of the window, from t_start to t_end;
+    // segment k is [times[k], times[k + 1]), segment -1 lies before the first sample
+    long start, last;
+    double t_start, t_end;
+    long cursor;              // segment of the last evaluation
+    double slope_left, slope_right;   // INPUT_SPLINE: Hermite slopes of the cursor segment
+    long slope_segment;
+};
+
+static input_stream *stream_new(FILE *fp, int own_fp, int column, int interpolation, int chunk) {
+    input_stream *s = calloc(1, sizeof(*s));
+    if (s == NULL) {
+        return NULL;
+    }
+    s->fp = fp;
+    s->own_fp = own_fp;
+    s->column = column > 0 ? column : 1;
+    s->interpolation = interpolation;
+    s->chunk = chunk > 0 ? chunk : INPUT_STREAM_DEFAULT_CHUNK;
+    s->line = malloc(LINE_SIZE);
+    s->t_start = -INFINITY;
+    s->slope_segment = -2;
+    if (s->line == NULL) {
+        input_stream_close(s);
+        return NULL;
+    }
+    return s;
+}
+
+// Function to parse one line into (time, value); returns 1 for a sample, 0 for a line to skip, -1 for an error
+static int parse_line(input_stream *s, double *t, double *v) {
+    char *p = s->line;
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    if (*p == '\0' || *p == '#') {
+        return 0;
+    }
+    char *end;
+    *t = strtod(p, &end);
+    if (end == p) {
+        // A header is only allowed before the first sample
+        return s->n_read == 0 ? 0 : -1;
+    }
+    for (int c = 0; c < s->column; c++) {
+        p = end;
+        while (*p == ',' || *p == ';' || *p == ' ' || *p == '\t') {
+            p++;
+        }
+        *v = strtod(p, &end);
+        if (end == p) {
+            return -1;
+        }
+    }
+    return isfinite(*t) && isfinite(*v) ? 1 : -1;
+}
+
+// Function to read up to one chunk of samples, first dropping the samples before
+// the current piece that no interpolation can need any more; returns the number read
+static long read_chunk(input_stream *s) {
+    if (s->eof || s->error) {
+        return 0;
+    }
+    long keep = s->start - 1;   // INPUT_SPLINE needs the sample before the piece for its first slope
+    if (keep > 0 && s->n + s->chunk > s->capacity) {
+        memmove(s->times, s->times + keep, sizeof(double) * (s->n - keep));
+        memmove(s->values, s->values + keep, sizeof(double) * (s->n - keep));
+        s->n -= keep;
+        s->base += keep;
+        s->start -= keep;
+        s->last -= keep;
+        s->cursor -= keep;
+        s->slope_segment -= keep;
+    }
+    if (s->n + s->chunk > s->capacity) {
+        long capacity = s->n + s->chunk;
+        double *times = realloc(s->times, sizeof(double) * capacity);
+        if (times != NULL) {
+            s->times = times;
+        }
+        double *values = times != NULL ? realloc(s->values, sizeof(double) * capacity) : NULL;
+        if (values == NULL) {
+            fprintf(stderr, "Error in input_stream: out of memory\n");
+            s->error = 1;
+            return 0;
+        }
+        s->values = values;
+        s->capacity = capacity;
+    }
+
+    long count = 0;
+    while (count < s->chunk) {
+        if (fgets(s->line, LINE_SIZE, s->fp) == NULL) {
+            s->eof = 1;
+            break;
+        }
+        s->line_number++;
+        double t, v;
+        int flag = parse_line(s, &t, &v);
+        if (flag == 0) {
+            continue;
+        }
+        long n = s->n;
+        if (flag < 0) {
+            fprintf(stderr, "Error in input_stream: cannot read the time and column %d on line %ld\n", s->column,
+                    s->line_number);
+            s->error = 1;
+            break;
+        }
+        if ((n > 0 && t < s->times[n - 1]) || (n > 1 && t == s->times[n - 1] && t == s->times[n - 2])) {
+            fprintf(stderr, "Error in input_stream: line %ld goes back in time or repeats a jump\n",
+                    s->line_number);
+            s->error = 1;
+            break;
+        }
+        if (s->n_read == 0) {
+            s->first_time = t;
+        }
+        s->times[n] = t;
+        s->values[n] = v;
+        s->last_time = t;
+        s->n++;
+        s->n_read++;
+        count++;
+    }
+    if (s->n > s->peak) {
+        s->peak = s->n;
+    }
+    if (s->eof && s->n_read == 0 && !s->error) {
+        fprintf(stderr, "Error in input_stream: no samples\n");
+        s->error = 1;
+    }
+    return count;
+}
+
+input_stream *input_stream_open_file(FILE *fp, int column, int interpolation, int chunk) {
+    input_stream *s = stream_new(fp, 0, column, interpolation, chunk);
+    if (s != NULL && (read_chunk(s), s->error)) {
+        input_stream_close(s);
+        return NULL;
+    }
+    return s;
+}
+
+input_stream *input_stream_open(const char *path, int column, int interpolation, int chunk) {
+    int is_stdin = strcmp(path, "-") == 0;
+    FILE *fp = is_stdin ? stdin : fopen(path, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Error in input_stream: cannot open %s\n", path);
+        return NULL;
+    }
+    input_stream *s = stream_new(fp, !is_stdin, column, interpolation, chunk);
+    if (s == NULL) {
+        if (!is_stdin) {
+            fclose(fp);
+        }
+        return NULL;
+    }
+    read_chunk(s);
+    if (s->error) {
+        input_stream_close(s);
+        return NULL;
+    }
+    return s;
+}
+
+void input_stream_close(input_stream *s) {
+    if (s == NULL) {
+        return;
+    }
+    if (s->own_fp && s->fp != NULL) {
+        fclose(s->fp);
+    }
+    free(s->times);
+    free(s->values);
+    free(s->line);
+    free(s);
+}
+
+// Function to tell whether window sample k is the first of a jump (the next sample has the same time)
+static int jump_at(const input_stream *s, long k) {
+    return k + 1 < s->n && s->times[k + 1] == s->times[k];
+}
+
+// Function to tell whether the linear interpolant has a kink at window sample k (the slope changes)
+static int kink_at(const input_stream *s, long k) {
+    if (k < 1 || k + 1 >= s->n || s->times[k - 1] == s->times[k] || s->times[k + 1] == s->times[k]) {
+        return 0;
+    }
+    double d0 = (s->values[k] - s->values[k - 1]) / (s->times[k] - s->times[k - 1]);
+    double d1 = (s->values[k + 1] - s->values[k]) / (s->times[k + 1] - s->times[k]);
+    return d0 != d1;
+}
+
+// Function to find the segment of t in the window: the last sample at or before t, -1 before the first
+static long find_segment(const input_stream *s, double t) {
+    long lo = -1, hi = s->n - 1;
+    while (lo < hi) {
+        long mid = (lo + hi + 1) / 2;
+        if (s->times[mid] <= t) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+double input_stream_piece(input_stream *s, double t) {
+    if (s->error || t < s->t_start || isnan(t)) {
+        return NAN;
+    }
+    s->t_start = t;
+    // The piece needs the samples up to its end and, for the slopes, two past t
+    s->start = find_segment(s, t);
+    while (!s->eof && !s->error && s->n - s->start < 4) {
+        read_chunk(s);
+        s->start = find_segment(s, t);
+    }
+    if (s->error) {
+        return NAN;
+    }
+    long k = s->start;
+    s->cursor = k;
+    s->slope_segment = -2;
+    if (k < 0) {
+        // Constant first value up to the first sample
+        s->last = k;
+        s->t_end = s->times[0];
+        return s->t_end;
+    }
+
+    // Scan the loaded samples for the first discontinuity after t
+    long j = k + 1;
+    for (; j < s->n; j++) {
+        if (s->interpolation == INPUT_HOLD     ? s->values[j] != s->values[j - 1]
+            : s->interpolation == INPUT_LINEAR ? jump_at(s, j) || kink_at(s, j)
+                                               : jump_at(s, j)) {
+            break;
+        }
+    }
+    if (j < s->n) {
+        s->t_end = s->times[j];
+    } else if (s->eof) {
+        s->t_end = INFINITY;
+    } else {
+        // No discontinuity in the window: stop where the interpolation data runs out
+        j = s->n - (s->interpolation == INPUT_SPLINE ? 2 : 1);
+        s->t_end = s->times[j];
+    }
+    s->last = j - 1;   // the last segment of the piece starts at times[j - 1]
+    return s->t_end;
+}
+
+// Function to compute the PCHIP slope at window sample i, using only segments of width > 0 on either side
+static double pchip_slope(const input_stream *s, long i) {
+    int has_left = i > 0 && s->times[i - 1] < s->times[i];
+    int has_right = i + 1 < s->n && s->times[i + 1] > s->times[i];
+    double h0 = has_left ? s->times[i] - s->times[i - 1] : 0;
+    double h1 = has_right ? s->times[i + 1] - s->times[i] : 0;
+    double d0 = has_left ? (s->values[i] - s->values[i - 1]) / h0 : 0;
+    double d1 = has_right ? (s->values[i + 1] - s->values[i]) / h1 : 0;
+    if (!has_left) {
+        return d1;
+    }
+    if (!has_right) {
+        return d0;
+    }
+    if (d0 * d1 <= 0) {
+        return 0;   // local extremum: flat, so the curve does not overshoot
+    }
+    double w0 = 2 * h1 + h0, w1 = h1 + 2 * h0;
+    return (w0 + w1) / (w0 / d0 + w1 / d1);
+}
+
+double input_stream_value(input_stream *s, double t) {
+    if (t > s->t_end) {
+        t = s->t_end;   // left limit at the end of the piece
+    }
+    if (t < s->t_start) {
+        t = s->t_start;
+    }
+    long k = s->cursor;
+    while (k < s->last && s->times[k + 1] <= t) {
+        k++;
+    }
+    while (k > s->start && s->times[k] > t) {
+        k--;
+    }
+    s->cursor = k;
+    if (k < 0) {
+        return s->values[0];
+    }
+    if (k + 1 >= s->n || s->interpolation == INPUT_HOLD) {
+        return s->values[k];
+    }
+    double t0 = s->times[k], t1 = s->times[k + 1];
+    double v0 = s->values[k], v1 = s->values[k + 1];
+    double h = t1 - t0, w = (t - t0) / h;
+    if (s->interpolation == INPUT_LINEAR) {
+        return v0 + w * (v1 - v0);
+    }
+    if (s->slope_segment != k) {
+        s->slope_left = pchip_slope(s, k);
+        s->slope_right = pchip_slope(s, k + 1);
+        s->slope_segment = k;
+    }
+    // Cubic Hermite basis on [t0, t1]
+    double w2 = w * w, w3 = w2 * w;
+    return (2 * w3 - 3 * w2 + 1) * v0 + (w3 - 2 * w2 + w) * h * s->slope_left + (-2 * w3 + 3 * w2) * v1 +
+           (w3 - w2) * h * s->slope_right;
+}
+
+double input_stream_first_time(const input_stream *s) {
+    return s->first_time;
+}
+
+double input_stream_last_time(const input_stream *s) {
+    return s->last_time;
+}
+
+int input_stream_eof(const input_stream *s) {
+    return s->eof;
+}
+
+long input_stream_n_read(const input_stream *s) {
+    return s->n_read;
+}
+
+long input_stream_peak_window(const input_stream *s) {
+    return s->peak;
+}
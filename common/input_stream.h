@@ -0,0 +1,59 @@
+#ifndef INPUT_STREAM_H
+#define INPUT_STREAM_H
+
+#include <stdio.h>
+
+// Time-series inputs streamed from a file or pipe
+//
+// Samples "time,value[,value...]" (CSV or whitespace separated; a header and
+// lines starting with '#' are skipped) are read in chunks into a window that
+// only spans the samples the integrator can still ask for, so memory stays
+// bounded however long the signal is. Times must not decrease. A repeated
+// time is a jump: the first value is the left limit, the second the value
+// from then on.
+//
+// The integrator goes forward in smooth pieces: input_stream_piece(s, t)
+// returns the end of the piece starting at t (the next jump of the input, or
+// of its slope for INPUT_LINEAR, or the end of the loaded window) and drops
+// the samples before t. Until the next call, input_stream_value() evaluates
+// that piece only, so the solver sees the left limit at a jump at the piece
+// end and never steps across it.
+//
+// Before the first sample the input is the first value, after the last
+// sample the last value.
+
+#define INPUT_HOLD 0      // zero-order hold: values[k] on [times[k], times[k+1]); every change is a jump
+#define INPUT_LINEAR 1    // linear between samples; a piece ends wherever the slope changes
+#define INPUT_SPLINE 2    // monotone cubic Hermite (PCHIP): continuous slope, so pieces span samples
+
+#define INPUT_STREAM_DEFAULT_CHUNK 65536
+
+typedef struct input_stream input_stream;
+
+// Open path ("-" for stdin) and read value column column (1 for the first
+// after the time); chunk samples are read at a time, 0 for the default
+input_stream *input_stream_open(const char *path, int column, int interpolation, int chunk);
+
+// Same on an open stream (a pipe, a socket); fp is not closed by input_stream_close
+input_stream *input_stream_open_file(FILE *fp, int column, int interpolation, int chunk);
+
+void input_stream_close(input_stream *s);
+
+// Start a smooth piece at t, never earlier than the start of the previous
+// piece; returns its end (INFINITY after the last sample) or NAN on a read or
+// format error
+double input_stream_piece(input_stream *s, double t);
+
+// Value of the input at t on the current piece
+double input_stream_value(input_stream *s, double t);
+
+// First and last sample time read so far; the last one is final once input_stream_eof() holds
+double input_stream_first_time(const input_stream *s);
+double input_stream_last_time(const input_stream *s);
+int input_stream_eof(const input_stream *s);
+
+// Samples read so far, and the largest number held at once
+long input_stream_n_read(const input_stream *s);
+long input_stream_peak_window(const input_stream *s);
+
+#endif
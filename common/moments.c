@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "moments.h"
+
+int moment_model_cov_index(const moment_model *mm, int i, int j) {
+    int n = mm->network->n_species;
+    if (i > j) {
+        int tmp = i;
+        i = j;
+        j = tmp;
+    }
+    return n + i * n - i * (i - 1) / 2 + (j - i);
+}
+
+void moment_model_unpack(const moment_model *mm, const realtype *y, double *mean, double *cov) {
+    int n = mm->network->n_species;
+    for (int i = 0; i < n; i++) {
+        mean[i] = y[i];
+    }
+    if (cov != NULL) {
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                cov[i * n + j] = y[moment_model_cov_index(mm, i, j)];
+            }
+        }
+    }
+}
+
+// Function to get the finite-difference step for species value x
+static double fd_step(double x, double scale) {
+    return scale * fmax(1.0, fabs(x));
+}
+
+// Function to compute the right-hand side of the moment equations
+static int moments_rhs(realtype t, const realtype *y, realtype *ydot, const realtype *p, const void *data) {
+    const moment_model *mm = data;
+    const reaction_network *net = mm->network;
+    int n = net->n_species, R = net->n_reactions;
+    const int *S = net->stoich;
+    double x[MOMENTS_MAX_SPECIES] = {0}, xp[MOMENTS_MAX_SPECIES], params[MOMENTS_MAX_PARAMS];
+    double a[MOMENTS_MAX_REACTIONS], a_eff[MOMENTS_MAX_REACTIONS];
+    double ap[MOMENTS_MAX_REACTIONS], am[MOMENTS_MAX_REACTIONS];
+    double Ja[MOMENTS_MAX_REACTIONS * MOMENTS_MAX_SPECIES];   // Ja[r * n + j] = d a_r / d x_j
+    double A[MOMENTS_MAX_SPECIES * MOMENTS_MAX_SPECIES];      // A = S^T Ja
+    double C[MOMENTS_MAX_SPECIES * MOMENTS_MAX_SPECIES];
+
+    for (int k = 0; k < net->n_params; k++) {
+        params[k] = p[k];
+    }
+    for (int i = 0; i < n; i++) {
+        x[i] = y[i];
+        xp[i] = y[i];
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            C[i * n + j] = y[moment_model_cov_index(mm, i, j)];
+        }
+    }
+    net->propensities(x, a, params);
+
+    // Jacobian of the propensities: central differences, or forward differences
+    // near zero, where the propensities may not be defined for negative states
+    double sqrt_eps = sqrt(DBL_EPSILON), cbrt_eps = cbrt(DBL_EPSILON);
+    for (int j = 0; j < n; j++) {
+        double hc = fd_step(x[j], cbrt_eps);
+        if (x[j] - hc >= 0) {
+            xp[j] = x[j] + hc;
+            net->propensities(xp, ap, params);
+            xp[j] = x[j] - hc;
+            net->propensities(xp, am, params);
+            for (int r = 0; r < R; r++) {
+                Ja[r * n + j] = (ap[r] - am[r]) / (2 * hc);
+            }
+        } else {
+            double hf = fd_step(x[j], sqrt_eps);
+            xp[j] = x[j] + hf;
+            net->propensities(xp, ap, params);
+            for (int r = 0; r < R; r++) {
+                Ja[r * n + j] = (ap[r] - a[r]) / hf;
+            }
+        }
+        xp[j] = x[j];
+    }
+
+    // Effective propensities: a(m), plus 1/2 H:C for the second-order closure
+    for (int r = 0; r < R; r++) {
+        a_eff[r] = a[r];
+    }
+    if (mm->closure == MOMENTS_SECOND_ORDER) {
+        // Forward second differences, so the states stay non-negative
+        double h[MOMENTS_MAX_SPECIES];
+        double a_i[MOMENTS_MAX_SPECIES * MOMENTS_MAX_REACTIONS];   // a(x + h_i e_i)
+        double qrt_eps = sqrt(sqrt_eps);
+        for (int i = 0; i < n; i++) {
+            h[i] = fd_step(x[i], qrt_eps);
+            xp[i] = x[i] + h[i];
+            net->propensities(xp, a_i + i * R, params);
+            xp[i] = x[i];
+        }
+        for (int i = 0; i < n; i++) {
+            for (int j = i; j < n; j++) {
+                if (C[i * n + j] == 0) {
+                    continue;
+                }
+                xp[i] += h[i];
+                xp[j] += h[j];
+                net->propensities(xp, ap, params);
+                xp[i] = x[i];
+                xp[j] = x[j];
+                double weight = (i == j ? 0.5 : 1.0) * C[i * n + j] / (h[i] * h[j]);
+                for (int r = 0; r < R; r++) {
+                    a_eff[r] += weight * (ap[r] - a_i[i * R + r] - a_i[j * R + r] + a[r]);
+                }
+            }
+        }
+    }
+
+    // Mean
+    for (int i = 0; i < n; i++) {
+        double sum = 0;
+        for (int r = 0; r < R; r++) {
+            sum += S[r * n + i] * a_eff[r];
+        }
+        ydot[i] = sum;
+    }
+
+    // A = S^T Ja
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            double sum = 0;
+            for (int r = 0; r < R; r++) {
+                sum += S[r * n + i] * Ja[r * n + j];
+            }
+            A[i * n + j] = sum;
+        }
+    }
+
+    // Covariance: A C + C A^T + S^T diag(a_eff) S, upper triangle
+    for (int i = 0; i < n; i++) {
+        for (int j = i; j < n; j++) {
+            double sum = 0;
+            for (int k = 0; k < n; k++) {
+                sum += A[i * n + k] * C[k * n + j] + C[i * n + k] * A[j * n + k];
+            }
+            for (int r = 0; r < R; r++) {
+                sum += S[r * n + i] * S[r * n + j] * a_eff[r];
+            }
+            ydot[moment_model_cov_index(mm, i, j)] = sum;
+        }
+    }
+    return 0;
+}
+
+int moment_model_init(moment_model *mm, const reaction_network *network, int closure) {
+    memset(mm, 0, sizeof(*mm));
+    int n = network->n_species;
+    if (n > MOMENTS_MAX_SPECIES || network->n_reactions > MOMENTS_MAX_REACTIONS || network->n_params > MOMENTS_MAX_PARAMS) {
+        fprintf(stderr, "Error in moment_model_init: %s is too large\n", network->name);
+        return -1;
+    }
+    if (closure != MOMENTS_LNA && closure != MOMENTS_SECOND_ORDER) {
+        fprintf(stderr, "Error in moment_model_init: unknown closure %d\n", closure);
+        return -1;
+    }
+    mm->network = network;
+    mm->closure = closure;
+
+    int n_states = n + n * (n + 1) / 2;
+    mm->n_states = n_states;
+    mm->names = calloc(n_states, sizeof(char *));
+    mm->y0 = calloc(n_states, sizeof(realtype));
+    mm->params = malloc((network->n_params > 0 ? network->n_params : 1) * sizeof(realtype));
+    if (mm->names == NULL || mm->y0 == NULL || mm->params == NULL) {
+        moment_model_free(mm);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        size_t len = strlen(network->species_names[i]) + 7;
+        mm->names[i] = malloc(len);
+        if (mm->names[i] == NULL) {
+            moment_model_free(mm);
+            return -1;
+        }
+        snprintf(mm->names[i], len, "Mean(%s)", network->species_names[i]);
+        for (int j = i; j < n; j++) {
+            int k = moment_model_cov_index(mm, i, j);
+            len = strlen(network->species_names[i]) + strlen(network->species_names[j]) + 7;
+            mm->names[k] = malloc(len);
+            if (mm->names[k] == NULL) {
+                moment_model_free(mm);
+                return -1;
+            }
+            snprintf(mm->names[k], len, "Cov(%s,%s)", network->species_names[i], network->species_names[j]);
+        }
+    }
+
+    circuit_model *m = &mm->model;
+    m->name = network->name;
+    m->n_species = n_states;
+    m->n_params = network->n_params;
+    m->species_names = (const char *const *)mm->names;
+    m->param_names = network->param_names;
+    for (int k = 0; k < network->n_params; k++) {
+        mm->params[k] = network->default_params[k];
+    }
+    m->default_params = mm->params;
+    m->default_y0 = mm->y0;
+    m->rhs = moments_rhs;
+    m->jac = NULL;
+    m->input_param = network->input_param;
+    m->data = mm;
+    return 0;
+}
+
+void moment_model_free(moment_model *mm) {
+    if (mm->names != NULL) {
+        for (int k = 0; k < mm->n_states; k++) {
+            free(mm->names[k]);
+        }
+    }
+    free(mm->names);
+    free(mm->y0);
+    free(mm->params);
+    memset(mm, 0, sizeof(*mm));
+}
@@ -0,0 +1,52 @@
+#ifndef MOMENTS_H
+#define MOMENTS_H
+
+#include "circuits.h"
+#include "reaction_network.h"
+
+// Moment equations generated from a reaction_network
+//
+// The mean m and covariance C of the copy numbers follow
+//
+//   dm/dt = S^T a_eff(m, C)
+//   dC/dt = A C + C A^T + S^T diag(a_eff(m, C)) S,   A = S^T da/dx (m)
+//
+// MOMENTS_LNA is the linear noise approximation, a_eff = a(m). The second
+// order closure (MOMENTS_SECOND_ORDER, Gaussian closure of the third
+// moments) adds the curvature of the propensities, a_eff = a(m) + 1/2 H:C,
+// which shifts the mean of nonlinear networks. The derivatives of the
+// propensities are taken by finite differences.
+//
+// The generated system is an ordinary circuit_model with n + n(n+1)/2
+// states, the mean followed by the upper triangle of C row by row, so it is
+// solved with circuit_solver like any circuit: one ODE solve gives the
+// variance and Fano factor trajectories instead of an SSA ensemble.
+
+#define MOMENTS_LNA 0
+#define MOMENTS_SECOND_ORDER 1
+
+#define MOMENTS_MAX_SPECIES 16
+#define MOMENTS_MAX_REACTIONS 64
+#define MOMENTS_MAX_PARAMS 64
+
+typedef struct {
+    circuit_model model;          // the augmented ODE, model.data points back here
+    const reaction_network *network;
+    int closure;
+    int n_states;                 // n + n(n+1)/2
+    char **names;                 // species names of the model, "Mean(X)" and "Cov(X,Y)"
+    realtype *params;             // default parameters of the network
+    realtype *y0;                 // zero mean and covariance
+} moment_model;
+
+// Generate the moment equations of network; -1 if the network is too large
+int moment_model_init(moment_model *mm, const reaction_network *network, int closure);
+void moment_model_free(moment_model *mm);
+
+// Index of Cov(X_i, X_j) in the state vector
+int moment_model_cov_index(const moment_model *mm, int i, int j);
+
+// Split one state vector into the mean [n] and the full covariance [n][n]; cov may be NULL
+void moment_model_unpack(const moment_model *mm, const realtype *y, double *mean, double *cov);
+
+#endif
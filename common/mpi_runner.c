@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "trajectory_io.h"
+#include "mpi_runner.h"
+
+#define CHUNKS_PER_THREAD 4
+#define MAX_CHUNK_BYTES (1L << 30)   // one MPI_File_write_at count must fit an int
+
+typedef struct {
+    const mpi_run_config *config;
+    mpi_item_fn fn;
+    void *ctx;
+    struct traj_header header;
+    int threads;
+    int n_stats;                  // n_times * n_species
+    const double *shift;          // item 0
+    unsigned char *block;         // run blocks of the current chunk
+    long start, end;              // current chunk, end < 0 when there is none left
+    long next;                    // next item of the chunk
+    pthread_mutex_t lock;
+    pthread_barrier_t chunk_ready, chunk_done;
+    double *sums;                 // per thread: count, sum, sum of squares per stat
+    long *failed;                 // per thread
+} rank_job;
+
+typedef struct {
+    rank_job *job;
+    int thread;
+} thread_arg;
+
+// Function to simulate the items of the current chunk on one thread
+static void run_items(rank_job *job, int thread, double *params, double *out) {
+    const mpi_run_config *c = job->config;
+    int n = job->n_stats;
+    double *count = job->sums + (size_t)thread * 3 * n, *sum = count + n, *sum_sq = sum + n;
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        long item = job->next++;
+        pthread_mutex_unlock(&job->lock);
+        if (item >= job->end) {
+            break;
+        }
+        memset(params, 0, sizeof(double) * c->n_params);
+        if (job->fn(item, thread, params, out, job->ctx) != 0) {
+            for (int k = 0; k < n; k++) {
+                out[k] = NAN;
+            }
+            job->failed[thread]++;
+        }
+        for (int k = 0; k < n; k++) {
+            if (!isnan(out[k])) {
+                double d = out[k] - job->shift[k];
+                count[k] += 1;
+                sum[k] += d;
+                sum_sq[k] += d * d;
+            }
+        }
+        if (c->path != NULL) {
+            traj_format_run(&job->header, params, out, TRAJ_ROW_MAJOR,
+                            job->block + (size_t)(item - job->start) * job->header.run_size);
+        }
+    }
+}
+
+static void *rank_worker(void *arg) {
+    thread_arg *a = arg;
+    rank_job *job = a->job;
+    double *params = malloc(sizeof(double) * ((size_t)job->config->n_params + job->n_stats + 1));
+    for (;;) {
+        pthread_barrier_wait(&job->chunk_ready);
+        if (job->end < 0) {
+            break;
+        }
+        if (params != NULL) {
+            run_items(job, a->thread, params, params + job->config->n_params);
+        }
+        pthread_barrier_wait(&job->chunk_done);
+    }
+    free(params);
+    return NULL;
+}
+
+int mpi_run_threads(MPI_Comm comm, int threads) {
+    if (threads > 0) {
+        return threads;
+    }
+    MPI_Comm node;
+    int local_ranks = 1;
+    if (MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node) == MPI_SUCCESS) {
+        MPI_Comm_size(node, &local_ranks);
+        MPI_Comm_free(&node);
+    }
+    threads = (int)sysconf(_SC_NPROCESSORS_ONLN) / local_ranks;
+    return threads > 0 ? threads : 1;
+}
+
+int mpi_run(MPI_Comm comm, const mpi_run_config *config, mpi_item_fn fn, void *ctx, mpi_run_result *result) {
+    const mpi_run_config *c = config;
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    rank_job job;
+    memset(&job, 0, sizeof(job));
+    job.config = c;
+    job.fn = fn;
+    job.ctx = ctx;
+    job.threads = mpi_run_threads(comm, c->threads);
+    job.n_stats = c->n_times * c->n_species;
+    if (c->n_items < 1 || c->n_times < 1 || c->n_species < 1) {
+        fprintf(stderr, "Error in mpi_run: invalid configuration\n");
+        return -1;
+    }
+
+    // Rank 0 lays out the output file, then every rank opens it
+    int flag = 0;
+    MPI_File fh = MPI_FILE_NULL;
+    if (c->path != NULL) {
+        if (rank == 0) {
+            flag = traj_file_create(c->path, c->dtype, c->n_species, c->species_names, c->n_params, c->param_names,
+                                    c->times, c->n_times, c->n_items, &job.header);
+        }
+        MPI_Bcast(&flag, 1, MPI_INT, 0, comm);
+        MPI_Bcast(&job.header, sizeof(job.header), MPI_BYTE, 0, comm);
+        if (flag != 0 || MPI_File_open(comm, c->path, MPI_MODE_WRONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+            fprintf(stderr, "Error in mpi_run: cannot open %s\n", c->path);
+            return -1;
+        }
+    }
+    long chunk = c->chunk > 0 ? c->chunk : (long)CHUNKS_PER_THREAD * job.threads;
+    if (c->path != NULL && chunk * (long)job.header.run_size > MAX_CHUNK_BYTES) {
+        chunk = MAX_CHUNK_BYTES / (long)job.header.run_size > 0 ? MAX_CHUNK_BYTES / (long)job.header.run_size : 1;
+    }
+
+    // Shared chunk counter on rank 0
+    long *counter;
+    MPI_Win win;
+    MPI_Win_allocate(rank == 0 ? sizeof(long) : 0, sizeof(long), MPI_INFO_NULL, comm, &counter, &win);
+    if (rank == 0) {
+        *counter = 0;
+    }
+    MPI_Barrier(comm);
+    MPI_Win_lock_all(0, win);
+
+    int n = job.n_stats;
+    double *shift = calloc((size_t)c->n_params + n, sizeof(double));
+    job.sums = calloc((size_t)job.threads * 3 * n, sizeof(double));
+    job.failed = calloc(job.threads, sizeof(long));
+    job.block = c->path != NULL ? malloc((size_t)chunk * job.header.run_size) : NULL;
+    thread_arg *args = malloc(sizeof(thread_arg) * job.threads);
+    pthread_t *workers = malloc(sizeof(pthread_t) * job.threads);
+    double *params = malloc(sizeof(double) * ((size_t)c->n_params + n + 1));   // rank thread's item
+    if (shift == NULL || job.sums == NULL || job.failed == NULL || args == NULL || workers == NULL || params == NULL ||
+        (c->path != NULL && job.block == NULL)) {
+        flag = -1;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &flag, 1, MPI_INT, MPI_MIN, comm);
+
+    // Item 0 as the origin of the sums, the same on every rank
+    if (flag == 0 && fn(0, 0, shift, shift + c->n_params, ctx) == 0) {
+        job.shift = shift + c->n_params;
+        for (int k = 0; k < n; k++) {
+            shift[c->n_params + k] = isnan(shift[c->n_params + k]) ? 0 : shift[c->n_params + k];
+        }
+    } else {
+        job.shift = shift != NULL ? shift + c->n_params : NULL;
+        if (shift != NULL) {
+            memset(shift, 0, sizeof(double) * ((size_t)c->n_params + n));
+        }
+    }
+
+    long n_local = 0;
+    if (flag == 0) {
+        pthread_mutex_init(&job.lock, NULL);
+        pthread_barrier_init(&job.chunk_ready, NULL, job.threads);
+        pthread_barrier_init(&job.chunk_done, NULL, job.threads);
+        int started = 1;
+        for (int t = 0; t < job.threads; t++) {
+            args[t].job = &job;
+            args[t].thread = t;
+        }
+        for (; started < job.threads; started++) {
+            if (pthread_create(&workers[started], NULL, rank_worker, &args[started]) != 0) {
+                fprintf(stderr, "Error in mpi_run: cannot start thread %d\n", started);
+                MPI_Abort(comm, 1);   // the barriers count on every thread, and the other ranks on this one
+            }
+        }
+        for (;;) {
+            long one = 1, index;
+            MPI_Fetch_and_op(&one, &index, MPI_LONG, 0, 0, MPI_SUM, win);
+            MPI_Win_flush(0, win);
+            job.start = index * chunk;
+            job.end = job.start < c->n_items ? (job.start + chunk < c->n_items ? job.start + chunk : c->n_items) : -1;
+            job.next = job.start;
+            pthread_barrier_wait(&job.chunk_ready);
+            if (job.end < 0) {
+                break;
+            }
+            run_items(&job, 0, params, params + c->n_params);
+            pthread_barrier_wait(&job.chunk_done);
+            n_local += job.end - job.start;
+            if (fh != MPI_FILE_NULL) {
+                MPI_Offset offset = (MPI_Offset)(job.header.runs_offset + (uint64_t)job.start * job.header.run_size);
+                if (MPI_File_write_at(fh, offset, job.block, (int)((job.end - job.start) * job.header.run_size),
+                                      MPI_BYTE, MPI_STATUS_IGNORE) != MPI_SUCCESS) {
+                    fprintf(stderr, "Error in mpi_run: cannot write items %ld..%ld\n", job.start, job.end - 1);
+                    flag = -1;
+                }
+            }
+        }
+        for (int t = 1; t < job.threads; t++) {
+            pthread_join(workers[t], NULL);
+        }
+        pthread_barrier_destroy(&job.chunk_ready);
+        pthread_barrier_destroy(&job.chunk_done);
+        pthread_mutex_destroy(&job.lock);
+    }
+    MPI_Win_unlock_all(win);
+    MPI_Win_free(&win);
+    if (fh != MPI_FILE_NULL) {
+        MPI_File_close(&fh);
+    }
+
+    // Threads in order, then ranks on rank 0
+    long failed = 0;
+    for (int t = 1; flag == 0 && t < job.threads; t++) {
+        for (int k = 0; k < 3 * n; k++) {
+            job.sums[k] += job.sums[(size_t)t * 3 * n + k];
+        }
+    }
+    for (int t = 0; flag == 0 && t < job.threads; t++) {
+        failed += job.failed[t];
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &flag, 1, MPI_INT, MPI_MIN, comm);
+    if (flag == 0) {
+        double *total = rank == 0 ? malloc(sizeof(double) * 3 * n) : NULL;
+        MPI_Reduce(job.sums, total, 3 * n, MPI_DOUBLE, MPI_SUM, 0, comm);
+        MPI_Reduce(&failed, &result->n_failed, 1, MPI_LONG, MPI_SUM, 0, comm);
+        if (total != NULL) {
+            for (int k = 0; k < n; k++) {
+                double count = total[k], mean = count > 0 ? total[n + k] / count : 0;
+                if (result->mean != NULL) {
+                    result->mean[k] = count > 0 ? job.shift[k] + mean : NAN;
+                }
+                if (result->variance != NULL) {
+                    result->variance[k] = count > 1 ? (total[2 * n + k] - count * mean * mean) / (count - 1) : NAN;
+                }
+            }
+        }
+        free(total);
+        result->n_local = n_local;
+        result->threads = job.threads;
+    }
+    free(shift);
+    free(job.sums);
+    free(job.failed);
+    free(job.block);
+    free(args);
+    free(workers);
+    free(params);
+    return flag;
+}
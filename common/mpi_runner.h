@@ -0,0 +1,59 @@
+#ifndef MPI_RUNNER_H
+#define MPI_RUNNER_H
+
+#include <mpi.h>
+
+// Ensembles and sweeps distributed over MPI ranks
+//
+// Items 0..n_items-1 (the runs of a stochastic ensemble or the rows of a
+// parameter sweep) are handed out in chunks of consecutive items through an
+// atomic counter in a window on rank 0 (MPI_Fetch_and_op), so every rank,
+// rank 0 included, takes the next chunk as soon as it is free and no rank is
+// spent on a master loop. Within a rank a pool of threads shares each chunk;
+// only the rank's main thread calls MPI (MPI_THREAD_FUNNELED).
+//
+// Output: rank 0 lays out a .bctr file (trajectory_io.h) of n_items runs,
+// and the runs of a chunk, being consecutive, are written by their rank as
+// one contiguous MPI_File_write_at. Statistics: the mean and variance of
+// every species at every time over all items are accumulated per rank
+// (shifted by item 0 against cancellation) and combined on rank 0 with
+// MPI_Reduce.
+//
+// Item k must depend only on k (the stochastic solvers use random stream k
+// for run k), so the output file is identical for any number of ranks and
+// threads. The moments agree to rounding, since the summation order follows
+// the distribution, and exactly for integer copy numbers.
+
+// Simulate item on thread thread (0..threads-1 of this rank): fill params[n_params]
+// and out[k * n_species + i] on the time grid; returns 0 or -1 (the item is stored as NaN)
+typedef int (*mpi_item_fn)(long item, int thread, double *params, double *out, void *ctx);
+
+typedef struct {
+    long n_items;
+    int n_species;
+    const char *const *species_names;
+    int n_params;
+    const char *const *param_names;
+    int n_times;
+    const double *times;
+    const char *path;             // .bctr output, NULL for the statistics only
+    int dtype;                    // TRAJ_FLOAT64 or TRAJ_FLOAT32
+    int threads;                  // per rank, <= 0: the node's CPUs divided among its ranks
+    long chunk;                   // items per chunk, 0 for 4 per thread
+} mpi_run_config;
+
+typedef struct {
+    double *mean;                 // [n_times][n_species], filled on rank 0 when not NULL
+    double *variance;
+    long n_failed;                // over all ranks (rank 0)
+    long n_local;                 // items simulated by this rank
+    int threads;                  // threads used by this rank
+} mpi_run_result;
+
+// Collective over comm; returns 0 or -1 on every rank
+int mpi_run(MPI_Comm comm, const mpi_run_config *config, mpi_item_fn fn, void *ctx, mpi_run_result *result);
+
+// Threads per rank for threads <= 0, for sizing per-thread state before mpi_run (collective)
+int mpi_run_threads(MPI_Comm comm, int threads);
+
+#endif
@@ -0,0 +1,497 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sundials/sundials_math.h>  // SUNRabs, SUNRsqrt
+#include "nvector_arena.h"
+
+#define CACHE_LINE 64
+#define ROUND_UP(x) (((x) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE)
+
+typedef struct {
+    // Same first members as struct _N_VectorContent_Serial, so the serial macros work
+    sunindextype length;
+    booleantype own_data;     // always SUNFALSE, the data lives in the slot
+    realtype *data;
+    // Arena bookkeeping
+    nvector_arena *arena;
+    int slot;                 // -1 for a heap fallback
+} arena_content;
+
+// Start of every slot: the vector, its content, then the data at data_offset
+typedef struct {
+    struct _generic_N_Vector v;
+    arena_content content;
+} arena_header;
+
+struct nvector_arena {
+    sunindextype length;
+    int capacity;
+    size_t data_offset;
+    size_t slot_size;
+    unsigned char *slots;
+    int *free_slots;          // stack of free slot indices
+    int n_free;
+    int in_use;
+    struct _generic_N_Vector_Ops ops;  // shared by every vector of the arena
+};
+
+#define CONTENT(v) ((arena_content *)(v)->content)
+#define DATA(v) (CONTENT(v)->data)
+
+// Element loops, written once with the length as an argument. The per-length
+// wrappers below pass a constant, so the compiler unrolls them completely.
+
+static inline void linearsum_n(sunindextype n, realtype a, N_Vector x, realtype b, N_Vector y, N_Vector z) {
+    const realtype *xd = DATA(x), *yd = DATA(y);
+    realtype *zd = DATA(z);
+    for (sunindextype i = 0; i < n; i++) {
+        zd[i] = a * xd[i] + b * yd[i];
+    }
+}
+
+static inline void const_n(sunindextype n, realtype c, N_Vector z) {
+    realtype *zd = DATA(z);
+    for (sunindextype i = 0; i < n; i++) {
+        zd[i] = c;
+    }
+}
+
+static inline void prod_n(sunindextype n, N_Vector x, N_Vector y, N_Vector z) {
+    const realtype *xd = DATA(x), *yd = DATA(y);
+    realtype *zd = DATA(z);
+    for (sunindextype i = 0; i < n; i++) {
+        zd[i] = xd[i] * yd[i];
+    }
+}
+
+static inline void div_n(sunindextype n, N_Vector x, N_Vector y, N_Vector z) {
+    const realtype *xd = DATA(x), *yd = DATA(y);
+    realtype *zd = DATA(z);
+    for (sunindextype i = 0; i < n; i++) {
+        zd[i] = xd[i] / yd[i];
+    }
+}
+
+static inline void scale_n(sunindextype n, realtype c, N_Vector x, N_Vector z) {
+    const realtype *xd = DATA(x);
+    realtype *zd = DATA(z);
+    for (sunindextype i = 0; i < n; i++) {
+        zd[i] = c * xd[i];
+    }
+}
+
+static inline void abs_n(sunindextype n, N_Vector x, N_Vector z) {
+    const realtype *xd = DATA(x);
+    realtype *zd = DATA(z);
+    for (sunindextype i = 0; i < n; i++) {
+        zd[i] = SUNRabs(xd[i]);
+    }
+}
+
+static inline void inv_n(sunindextype n, N_Vector x, N_Vector z) {
+    const realtype *xd = DATA(x);
+    realtype *zd = DATA(z);
+    for (sunindextype i = 0; i < n; i++) {
+        zd[i] = RCONST(1.0) / xd[i];
+    }
+}
+
+static inline void addconst_n(sunindextype n, N_Vector x, realtype b, N_Vector z) {
+    const realtype *xd = DATA(x);
+    realtype *zd = DATA(z);
+    for (sunindextype i = 0; i < n; i++) {
+        zd[i] = xd[i] + b;
+    }
+}
+
+static inline realtype dotprod_n(sunindextype n, N_Vector x, N_Vector y) {
+    const realtype *xd = DATA(x), *yd = DATA(y);
+    realtype sum = 0;
+    for (sunindextype i = 0; i < n; i++) {
+        sum += xd[i] * yd[i];
+    }
+    return sum;
+}
+
+static inline realtype maxnorm_n(sunindextype n, N_Vector x) {
+    const realtype *xd = DATA(x);
+    realtype max = 0;
+    for (sunindextype i = 0; i < n; i++) {
+        realtype a = SUNRabs(xd[i]);
+        max = a > max ? a : max;
+    }
+    return max;
+}
+
+static inline realtype wsqrsum_n(sunindextype n, N_Vector x, N_Vector w) {
+    const realtype *xd = DATA(x), *wd = DATA(w);
+    realtype sum = 0;
+    for (sunindextype i = 0; i < n; i++) {
+        realtype p = xd[i] * wd[i];
+        sum += p * p;
+    }
+    return sum;
+}
+
+static inline realtype wsqrsummask_n(sunindextype n, N_Vector x, N_Vector w, N_Vector id) {
+    const realtype *xd = DATA(x), *wd = DATA(w), *idd = DATA(id);
+    realtype sum = 0;
+    for (sunindextype i = 0; i < n; i++) {
+        realtype p = idd[i] > 0 ? xd[i] * wd[i] : 0;
+        sum += p * p;
+    }
+    return sum;
+}
+
+static inline realtype min_n(sunindextype n, N_Vector x) {
+    const realtype *xd = DATA(x);
+    realtype min = xd[0];
+    for (sunindextype i = 1; i < n; i++) {
+        min = xd[i] < min ? xd[i] : min;
+    }
+    return min;
+}
+
+// z = sum_j c[j] X[j]; as in the serial vector, z may only alias X[0]
+static inline int linearcombination_n(sunindextype n, int nvec, realtype *c, N_Vector *X, N_Vector z) {
+    realtype *zd = DATA(z);
+    const realtype *xd = DATA(X[0]);
+    for (sunindextype i = 0; i < n; i++) {
+        zd[i] = c[0] * xd[i];
+    }
+    for (int j = 1; j < nvec; j++) {
+        xd = DATA(X[j]);
+        for (sunindextype i = 0; i < n; i++) {
+            zd[i] += c[j] * xd[i];
+        }
+    }
+    return 0;
+}
+
+// Z[j] = a[j] x + Y[j]
+static inline int scaleaddmulti_n(sunindextype n, int nvec, realtype *a, N_Vector x, N_Vector *Y, N_Vector *Z) {
+    const realtype *xd = DATA(x);
+    for (int j = 0; j < nvec; j++) {
+        const realtype *yd = DATA(Y[j]);
+        realtype *zd = DATA(Z[j]);
+        for (sunindextype i = 0; i < n; i++) {
+            zd[i] = a[j] * xd[i] + yd[i];
+        }
+    }
+    return 0;
+}
+
+// d[j] = x . Y[j]
+static inline int dotprodmulti_n(sunindextype n, int nvec, N_Vector x, N_Vector *Y, realtype *d) {
+    for (int j = 0; j < nvec; j++) {
+        d[j] = dotprod_n(n, x, Y[j]);
+    }
+    return 0;
+}
+
+// One set of ops per length: FIXED_LENGTH gives the unrolled versions,
+// RUNTIME_LENGTH the generic ones for longer vectors
+#define FIXED_LENGTH(N, v) N
+#define RUNTIME_LENGTH(N, v) (CONTENT(v)->length)
+
+#define DEFINE_OPS(N, LENGTH)                                                                            \
+    static void linearsum_##N(realtype a, N_Vector x, realtype b, N_Vector y, N_Vector z) {              \
+        linearsum_n(LENGTH(N, z), a, x, b, y, z);                                                        \
+    }                                                                                                    \
+    static void const_##N(realtype c, N_Vector z) { const_n(LENGTH(N, z), c, z); }                       \
+    static void prod_##N(N_Vector x, N_Vector y, N_Vector z) { prod_n(LENGTH(N, z), x, y, z); }          \
+    static void div_##N(N_Vector x, N_Vector y, N_Vector z) { div_n(LENGTH(N, z), x, y, z); }            \
+    static void scale_##N(realtype c, N_Vector x, N_Vector z) { scale_n(LENGTH(N, z), c, x, z); }        \
+    static void abs_##N(N_Vector x, N_Vector z) { abs_n(LENGTH(N, z), x, z); }                           \
+    static void inv_##N(N_Vector x, N_Vector z) { inv_n(LENGTH(N, z), x, z); }                           \
+    static void addconst_##N(N_Vector x, realtype b, N_Vector z) { addconst_n(LENGTH(N, z), x, b, z); }  \
+    static realtype dotprod_##N(N_Vector x, N_Vector y) { return dotprod_n(LENGTH(N, x), x, y); }        \
+    static realtype maxnorm_##N(N_Vector x) { return maxnorm_n(LENGTH(N, x), x); }                       \
+    static realtype wrmsnorm_##N(N_Vector x, N_Vector w) {                                               \
+        return SUNRsqrt(wsqrsum_n(LENGTH(N, x), x, w) / LENGTH(N, x));                                   \
+    }                                                                                                    \
+    static realtype wrmsnormmask_##N(N_Vector x, N_Vector w, N_Vector id) {                              \
+        return SUNRsqrt(wsqrsummask_n(LENGTH(N, x), x, w, id) / LENGTH(N, x));                           \
+    }                                                                                                    \
+    static realtype wsqrsum_##N(N_Vector x, N_Vector w) { return wsqrsum_n(LENGTH(N, x), x, w); }        \
+    static realtype wsqrsummask_##N(N_Vector x, N_Vector w, N_Vector id) {                               \
+        return wsqrsummask_n(LENGTH(N, x), x, w, id);                                                    \
+    }                                                                                                    \
+    static realtype min_##N(N_Vector x) { return min_n(LENGTH(N, x), x); }                               \
+    static int linearcombination_##N(int nvec, realtype *c, N_Vector *X, N_Vector z) {                   \
+        return linearcombination_n(LENGTH(N, z), nvec, c, X, z);                                         \
+    }                                                                                                    \
+    static int scaleaddmulti_##N(int nvec, realtype *a, N_Vector x, N_Vector *Y, N_Vector *Z) {          \
+        return scaleaddmulti_n(LENGTH(N, x), nvec, a, x, Y, Z);                                          \
+    }                                                                                                    \
+    static int dotprodmulti_##N(int nvec, N_Vector x, N_Vector *Y, realtype *d) {                        \
+        return dotprodmulti_n(LENGTH(N, x), nvec, x, Y, d);                                              \
+    }                                                                                                    \
+    static void set_ops_##N(N_Vector_Ops ops) {                                                          \
+        ops->nvlinearsum = linearsum_##N;                                                                \
+        ops->nvconst = const_##N;                                                                        \
+        ops->nvprod = prod_##N;                                                                          \
+        ops->nvdiv = div_##N;                                                                            \
+        ops->nvscale = scale_##N;                                                                        \
+        ops->nvabs = abs_##N;                                                                            \
+        ops->nvinv = inv_##N;                                                                            \
+        ops->nvaddconst = addconst_##N;                                                                  \
+        ops->nvdotprod = dotprod_##N;                                                                    \
+        ops->nvmaxnorm = maxnorm_##N;                                                                    \
+        ops->nvwrmsnorm = wrmsnorm_##N;                                                                  \
+        ops->nvwrmsnormmask = wrmsnormmask_##N;                                                          \
+        ops->nvmin = min_##N;                                                                            \
+        ops->nvlinearcombination = linearcombination_##N;                                                \
+        ops->nvscaleaddmulti = scaleaddmulti_##N;                                                        \
+        ops->nvdotprodmulti = dotprodmulti_##N;                                                          \
+        ops->nvdotprodlocal = dotprod_##N;                                                               \
+        ops->nvmaxnormlocal = maxnorm_##N;                                                               \
+        ops->nvminlocal = min_##N;                                                                       \
+        ops->nvwsqrsumlocal = wsqrsum_##N;                                                               \
+        ops->nvwsqrsummasklocal = wsqrsummask_##N;                                                       \
+    }
+
+DEFINE_OPS(1, FIXED_LENGTH)
+DEFINE_OPS(2, FIXED_LENGTH)
+DEFINE_OPS(3, FIXED_LENGTH)
+DEFINE_OPS(4, FIXED_LENGTH)
+DEFINE_OPS(5, FIXED_LENGTH)
+DEFINE_OPS(6, FIXED_LENGTH)
+DEFINE_OPS(7, FIXED_LENGTH)
+DEFINE_OPS(8, FIXED_LENGTH)
+DEFINE_OPS(9, FIXED_LENGTH)
+DEFINE_OPS(10, FIXED_LENGTH)
+DEFINE_OPS(11, FIXED_LENGTH)
+DEFINE_OPS(12, FIXED_LENGTH)
+DEFINE_OPS(13, FIXED_LENGTH)
+DEFINE_OPS(14, FIXED_LENGTH)
+DEFINE_OPS(15, FIXED_LENGTH)
+DEFINE_OPS(16, FIXED_LENGTH)
+DEFINE_OPS(any, RUNTIME_LENGTH)
+
+static void (*const set_unrolled_ops[NVECTOR_ARENA_MAX_UNROLLED + 1])(N_Vector_Ops) = {
+    NULL, set_ops_1, set_ops_2, set_ops_3, set_ops_4, set_ops_5, set_ops_6, set_ops_7, set_ops_8,
+    set_ops_9, set_ops_10, set_ops_11, set_ops_12, set_ops_13, set_ops_14, set_ops_15, set_ops_16
+};
+
+// Ops that are not on the hot path, for any length
+
+static N_Vector_ID arena_getvectorid(N_Vector v) {
+    return SUNDIALS_NVEC_SERIAL;  // serial-compatible content, see nvector_arena.h
+}
+
+static N_Vector arena_take(nvector_arena *arena, int with_data);
+
+static N_Vector arena_clone(N_Vector w) {
+    return arena_take(CONTENT(w)->arena, 1);
+}
+
+static N_Vector arena_cloneempty(N_Vector w) {
+    return arena_take(CONTENT(w)->arena, 0);
+}
+
+static void arena_destroy(N_Vector v) {
+    if (v == NULL) {
+        return;
+    }
+    arena_content *c = CONTENT(v);
+    nvector_arena *arena = c->arena;
+    arena->in_use--;
+    if (c->slot >= 0) {
+        arena->free_slots[arena->n_free++] = c->slot;
+    } else {
+        free(v);  // heap fallback: the header is the start of the block
+    }
+}
+
+static void arena_space(N_Vector v, sunindextype *lrw, sunindextype *liw) {
+    *lrw = CONTENT(v)->length;
+    *liw = 2;
+}
+
+static realtype *arena_getarraypointer(N_Vector v) {
+    return DATA(v);
+}
+
+static void arena_setarraypointer(realtype *data, N_Vector v) {
+    DATA(v) = data;  // the slot stays reserved, N_VDestroy still returns it
+}
+
+static void *arena_getcommunicator(N_Vector v) {
+    return NULL;
+}
+
+static sunindextype arena_getlength(N_Vector v) {
+    return CONTENT(v)->length;
+}
+
+static realtype arena_wl2norm(N_Vector x, N_Vector w) {
+    return SUNRsqrt(wsqrsum_n(CONTENT(x)->length, x, w));
+}
+
+static realtype arena_l1norm(N_Vector x) {
+    const realtype *xd = DATA(x);
+    realtype sum = 0;
+    for (sunindextype i = 0; i < CONTENT(x)->length; i++) {
+        sum += SUNRabs(xd[i]);
+    }
+    return sum;
+}
+
+static void arena_compare(realtype c, N_Vector x, N_Vector z) {
+    const realtype *xd = DATA(x);
+    realtype *zd = DATA(z);
+    for (sunindextype i = 0; i < CONTENT(x)->length; i++) {
+        zd[i] = SUNRabs(xd[i]) >= c ? RCONST(1.0) : RCONST(0.0);
+    }
+}
+
+static booleantype arena_invtest(N_Vector x, N_Vector z) {
+    const realtype *xd = DATA(x);
+    realtype *zd = DATA(z);
+    booleantype ok = SUNTRUE;
+    for (sunindextype i = 0; i < CONTENT(x)->length; i++) {
+        if (xd[i] == RCONST(0.0)) {
+            ok = SUNFALSE;
+        } else {
+            zd[i] = RCONST(1.0) / xd[i];
+        }
+    }
+    return ok;
+}
+
+static booleantype arena_constrmask(N_Vector c, N_Vector x, N_Vector m) {
+    const realtype *cd = DATA(c), *xd = DATA(x);
+    realtype *md = DATA(m);
+    booleantype ok = SUNTRUE;
+    for (sunindextype i = 0; i < CONTENT(x)->length; i++) {
+        md[i] = RCONST(0.0);
+        if (cd[i] == RCONST(0.0)) {
+            continue;
+        }
+        // |c| = 2: x must have the sign of c; |c| = 1: x may also be 0
+        if ((SUNRabs(cd[i]) > RCONST(1.5) && xd[i] * cd[i] <= RCONST(0.0)) ||
+            (SUNRabs(cd[i]) > RCONST(0.5) && xd[i] * cd[i] < RCONST(0.0))) {
+            md[i] = RCONST(1.0);
+            ok = SUNFALSE;
+        }
+    }
+    return ok;
+}
+
+static realtype arena_minquotient(N_Vector num, N_Vector denom) {
+    const realtype *nd = DATA(num), *dd = DATA(denom);
+    realtype min = BIG_REAL;
+    for (sunindextype i = 0; i < CONTENT(num)->length; i++) {
+        if (dd[i] != RCONST(0.0) && nd[i] / dd[i] < min) {
+            min = nd[i] / dd[i];
+        }
+    }
+    return min;
+}
+
+nvector_arena *nvector_arena_create(sunindextype length, int capacity) {
+    if (length <= 0) {
+        return NULL;
+    }
+    nvector_arena *arena = calloc(1, sizeof(*arena));
+    if (arena == NULL) {
+        return NULL;
+    }
+    arena->length = length;
+    arena->capacity = capacity > 0 ? capacity : NVECTOR_ARENA_DEFAULT_CAPACITY;
+    arena->data_offset = ROUND_UP(sizeof(arena_header));
+    arena->slot_size = arena->data_offset + ROUND_UP((size_t)length * sizeof(realtype));
+    arena->free_slots = malloc(sizeof(int) * arena->capacity);
+    void *slots = NULL;
+    if (arena->free_slots == NULL ||
+        posix_memalign(&slots, CACHE_LINE, arena->slot_size * (size_t)arena->capacity) != 0) {
+        fprintf(stderr, "Error allocating the N_Vector arena\n");
+        free(arena->free_slots);
+        free(arena);
+        return NULL;
+    }
+    arena->slots = slots;
+    // Hand out the lowest slots first, so the vectors of a solver stay together
+    for (int i = 0; i < arena->capacity; i++) {
+        arena->free_slots[i] = arena->capacity - 1 - i;
+    }
+    arena->n_free = arena->capacity;
+
+    N_Vector_Ops ops = &arena->ops;
+    if (length <= NVECTOR_ARENA_MAX_UNROLLED) {
+        set_unrolled_ops[length](ops);
+    } else {
+        set_ops_any(ops);
+    }
+    ops->nvgetvectorid = arena_getvectorid;
+    ops->nvclone = arena_clone;
+    ops->nvcloneempty = arena_cloneempty;
+    ops->nvdestroy = arena_destroy;
+    ops->nvspace = arena_space;
+    ops->nvgetarraypointer = arena_getarraypointer;
+    ops->nvsetarraypointer = arena_setarraypointer;
+    ops->nvgetcommunicator = arena_getcommunicator;
+    ops->nvgetlength = arena_getlength;
+    ops->nvwl2norm = arena_wl2norm;
+    ops->nvl1norm = arena_l1norm;
+    ops->nvcompare = arena_compare;
+    ops->nvinvtest = arena_invtest;
+    ops->nvconstrmask = arena_constrmask;
+    ops->nvminquotient = arena_minquotient;
+    ops->nvl1normlocal = arena_l1norm;
+    ops->nvinvtestlocal = arena_invtest;
+    ops->nvconstrmasklocal = arena_constrmask;
+    ops->nvminquotientlocal = arena_minquotient;
+    return arena;
+}
+
+void nvector_arena_free(nvector_arena *arena) {
+    if (arena == NULL) {
+        return;
+    }
+    if (arena->in_use != 0) {
+        fprintf(stderr, "Warning: N_Vector arena freed with %d vectors in use\n", arena->in_use);
+    }
+    free(arena->slots);
+    free(arena->free_slots);
+    free(arena);
+}
+
+// Function to take a slot (or a heap block when the arena is full) and set up the vector in it
+static N_Vector arena_take(nvector_arena *arena, int with_data) {
+    arena_header *h;
+    int slot = -1;
+    if (arena->n_free > 0) {
+        slot = arena->free_slots[--arena->n_free];
+        h = (arena_header *)(arena->slots + (size_t)slot * arena->slot_size);
+    } else {
+        void *block = NULL;
+        if (posix_memalign(&block, CACHE_LINE, arena->slot_size) != 0) {
+            return NULL;
+        }
+        h = block;
+    }
+    h->v.content = &h->content;
+    h->v.ops = &arena->ops;
+    h->content.length = arena->length;
+    h->content.own_data = SUNFALSE;
+    h->content.data = with_data ? (realtype *)((unsigned char *)h + arena->data_offset) : NULL;
+    h->content.arena = arena;
+    h->content.slot = slot;
+    arena->in_use++;
+    return &h->v;
+}
+
+N_Vector N_VNew_Arena(nvector_arena *arena) {
+    N_Vector v = arena_take(arena, 1);
+    if (v != NULL) {
+        memset(DATA(v), 0, (size_t)arena->length * sizeof(realtype));
+    }
+    return v;
+}
+
+int nvector_arena_in_use(const nvector_arena *arena) {
+    return arena->in_use;
+}
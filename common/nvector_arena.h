@@ -0,0 +1,42 @@
+#ifndef NVECTOR_ARENA_H
+#define NVECTOR_ARENA_H
+
+#include <sundials/sundials_nvector.h>  // generic N_Vector
+#include <nvector/nvector_serial.h>     // serial content layout and NV_Ith_S
+
+// Arena-backed N_Vector for small fixed-size systems
+//
+// Every vector of one solver context (y and every work vector CVODE, the
+// nonlinear solver and the linear solver clone from it) lives in a single
+// contiguous, cache-line aligned block, one slot per vector, with the ops
+// table shared by all of them. Cloning takes a free slot and N_VDestroy
+// gives it back, so creating and freeing thousands of small solvers does
+// not fragment the heap. When the arena is full, clones fall back to one
+// heap block each.
+//
+// The content starts with the layout of the serial vector and the vector
+// reports SUNDIALS_NVEC_SERIAL, so NV_Ith_S/NV_DATA_S, the dense SUNMatrix
+// and SUNLinSol_Dense work on it and the CVodeInit call sites stay as they
+// are. For lengths up to NVECTOR_ARENA_MAX_UNROLLED the ops are compiled
+// once per length so the loops are fully unrolled; the fused
+// N_VLinearCombination, N_VScaleAddMulti and N_VDotProdMulti are provided.
+// An arena is not thread-safe; use one per solver context.
+
+#define NVECTOR_ARENA_MAX_UNROLLED 16
+#define NVECTOR_ARENA_DEFAULT_CAPACITY 64  // enough for CVODE (Adams or BDF) with Newton and a dense solver
+
+typedef struct nvector_arena nvector_arena;
+
+// Arena of capacity vectors of the given length (0 for the default capacity)
+nvector_arena *nvector_arena_create(sunindextype length, int capacity);
+
+// Free the arena; every vector taken from it must have been destroyed
+void nvector_arena_free(nvector_arena *arena);
+
+// New vector from the arena, zero-filled; release it with N_VDestroy
+N_Vector N_VNew_Arena(nvector_arena *arena);
+
+// Number of vectors currently taken from the arena, heap fallbacks included
+int nvector_arena_in_use(const nvector_arena *arena);
+
+#endif
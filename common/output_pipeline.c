@@ -0,0 +1,498 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+#include "output_pipeline.h"
+#include "trajectory_io.h"
+
+#define DEFAULT_CHUNK_ROWS 4096
+#define DEFAULT_N_CHUNKS 8
+#define DEFAULT_SIGNIFICANT_DIGITS 10
+#define LINE_FLUSH_BYTES (1 << 16)
+
+typedef struct output_chunk {
+    struct output_chunk *next;
+    output_stream *stream;
+    int n_rows;
+    int last;      // final chunk of its stream
+    double *rows;
+} output_chunk;
+
+struct output_stream {
+    output_pipeline *p;
+    long run;
+    double *params;
+    output_chunk *chunk;
+    int error;     // p->error as of the last chunk handed to or taken from the pool
+    // Binary mode: the whole run, gathered by the writer thread
+    double *run_rows;
+    long run_n_rows;
+    long run_capacity;
+};
+
+struct output_pipeline {
+    output_config config;   // names must stay valid until output_pipeline_close()
+    char *path;
+    FILE *fp;
+    traj_writer *traj;
+    long n_times;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t chunk_free;
+    pthread_cond_t chunk_ready;
+    output_chunk *chunks;
+    double *chunk_storage;
+    output_chunk *free_list;
+    output_chunk *queue_head;
+    output_chunk *queue_tail;
+    int closing;
+    int error;       // set by the writer thread, read by the solver threads; under lock
+    long next_run;
+
+    char *text;      // CSV formatting buffer, owned by the writer thread
+    size_t text_len;
+};
+
+static const double pow10_table[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Function to format a double with a given number of significant digits
+// using integer arithmetic; values outside [1e-5, 1e15) fall back to %e
+int format_double(char *buf, double value, int significant_digits) {
+    int sig = significant_digits < 1 ? 1 : (significant_digits > 17 ? 17 : significant_digits);
+    if (!isfinite(value)) {
+        return sprintf(buf, "%g", value);
+    }
+    if (value == 0.0) {
+        buf[0] = '0';
+        buf[1] = '\0';
+        return 1;
+    }
+
+    char *p = buf;
+    double a = value;
+    if (a < 0) {
+        *p++ = '-';
+        a = -a;
+    }
+    if (a < 1e-5 || a >= 1e15) {
+        return (int)(p - buf) + sprintf(p, "%.*e", sig - 1, a);
+    }
+
+    // Decimal exponent of the leading digit
+    int e10 = 0;
+    if (a >= 1.0) {
+        while (e10 < 15 && a >= pow10_table[e10 + 1]) {
+            e10++;
+        }
+    } else {
+        e10 = -1;
+        while (a * pow10_table[-e10] < 1.0) {
+            e10--;
+        }
+    }
+    int decimals = sig - 1 - e10;
+    int zeros = 0;  // integer digits beyond the requested precision
+    if (decimals < 0) {
+        zeros = -decimals;
+        decimals = 0;
+    }
+    uint64_t m = (uint64_t)(a / pow10_table[zeros] * pow10_table[decimals] + 0.5);
+
+    // Digits of the mantissa, most significant first
+    char rev[24], frac[32];
+    int n = 0, nf = 0;
+    do {
+        rev[n++] = (char)('0' + m % 10);
+        m /= 10;
+    } while (m > 0);
+
+    if (n > decimals) {
+        for (int i = 0; i < n - decimals; i++) {
+            *p++ = rev[n - 1 - i];
+        }
+        for (int i = 0; i < zeros; i++) {
+            *p++ = '0';
+        }
+        for (int i = n - decimals; i < n; i++) {
+            frac[nf++] = rev[n - 1 - i];
+        }
+    } else {
+        *p++ = '0';
+        for (int i = 0; i < decimals - n; i++) {
+            frac[nf++] = '0';
+        }
+        for (int i = 0; i < n; i++) {
+            frac[nf++] = rev[n - 1 - i];
+        }
+    }
+
+    // Fraction, without trailing zeros
+    while (nf > 0 && frac[nf - 1] == '0') {
+        nf--;
+    }
+    if (nf > 0) {
+        *p++ = '.';
+        memcpy(p, frac, (size_t)nf);
+        p += nf;
+    }
+    *p = '\0';
+    return (int)(p - buf);
+}
+
+// Function to record a write error for the solver threads
+static void set_error(output_pipeline *p) {
+    pthread_mutex_lock(&p->lock);
+    p->error = 1;
+    pthread_mutex_unlock(&p->lock);
+}
+
+static void text_flush(output_pipeline *p) {
+    if (p->text_len > 0 && fwrite(p->text, 1, p->text_len, p->fp) != p->text_len) {
+        set_error(p);
+    }
+    p->text_len = 0;
+}
+
+// Function to format one chunk as CSV lines
+static void write_csv_chunk(output_pipeline *p, const output_chunk *c) {
+    const output_config *cfg = &p->config;
+    const output_stream *s = c->stream;
+    for (int i = 0; i < c->n_rows; i++) {
+        char *q = p->text + p->text_len;
+        if (cfg->run_column) {
+            q += sprintf(q, "%ld,", s->run);
+        }
+        for (int k = 0; k < cfg->n_params; k++) {
+            q += format_double(q, s->params[k], cfg->significant_digits);
+            *q++ = ',';
+        }
+        const double *row = c->rows + (size_t)i * cfg->n_columns;
+        for (int j = 0; j < cfg->n_columns; j++) {
+            q += format_double(q, row[j], cfg->significant_digits);
+            *q++ = j + 1 < cfg->n_columns ? ',' : '\n';
+        }
+        p->text_len = (size_t)(q - p->text);
+        if (p->text_len >= LINE_FLUSH_BYTES) {
+            text_flush(p);
+        }
+    }
+}
+
+// Function to gather one chunk into its run; the run is written once complete
+static void write_binary_chunk(output_pipeline *p, const output_chunk *c) {
+    const output_config *cfg = &p->config;
+    output_stream *s = c->stream;
+    long needed = s->run_n_rows + c->n_rows;
+    if (needed > s->run_capacity) {
+        long capacity = s->run_capacity ? s->run_capacity : cfg->chunk_rows;
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+        double *rows = realloc(s->run_rows, (size_t)capacity * cfg->n_columns * sizeof(double));
+        if (rows == NULL) {
+            set_error(p);
+            return;
+        }
+        s->run_rows = rows;
+        s->run_capacity = capacity;
+    }
+    memcpy(s->run_rows + (size_t)s->run_n_rows * cfg->n_columns, c->rows,
+           (size_t)c->n_rows * cfg->n_columns * sizeof(double));
+    s->run_n_rows = needed;
+    if (!c->last) {
+        return;
+    }
+
+    int n_species = cfg->n_columns - 1;
+    if (p->traj == NULL) {
+        // The first completed run defines the shared time grid
+        double *times = malloc((size_t)(s->run_n_rows + 1) * sizeof(double));
+        if (times == NULL) {
+            set_error(p);
+            return;
+        }
+        for (long i = 0; i < s->run_n_rows; i++) {
+            times[i] = s->run_rows[(size_t)i * cfg->n_columns];
+        }
+        p->traj = traj_writer_open(p->path, cfg->binary_dtype, n_species, cfg->column_names + 1,
+                                   cfg->n_params, cfg->param_names, times, (uint64_t)s->run_n_rows);
+        p->n_times = s->run_n_rows;
+        free(times);
+        if (p->traj == NULL) {
+            set_error(p);
+            return;
+        }
+    }
+    if (s->run_n_rows != p->n_times) {
+        fprintf(stderr, "Error: run %ld has %ld rows, expected %ld\n", s->run, s->run_n_rows, p->n_times);
+        set_error(p);
+        return;
+    }
+    // Drop the Time column in place
+    for (long i = 0; i < s->run_n_rows; i++) {
+        memmove(s->run_rows + (size_t)i * n_species, s->run_rows + (size_t)i * cfg->n_columns + 1,
+                (size_t)n_species * sizeof(double));
+    }
+    if (traj_writer_append(p->traj, s->params, s->run_rows, TRAJ_ROW_MAJOR) != 0) {
+        set_error(p);
+    }
+}
+
+static void *writer_main(void *arg) {
+    output_pipeline *p = arg;
+    for (;;) {
+        pthread_mutex_lock(&p->lock);
+        while (p->queue_head == NULL && !p->closing) {
+            pthread_cond_wait(&p->chunk_ready, &p->lock);
+        }
+        output_chunk *c = p->queue_head;
+        if (c == NULL) {
+            pthread_mutex_unlock(&p->lock);
+            break;
+        }
+        p->queue_head = c->next;
+        if (p->queue_head == NULL) {
+            p->queue_tail = NULL;
+        }
+        pthread_mutex_unlock(&p->lock);
+
+        if (p->config.format == OUTPUT_CSV) {
+            write_csv_chunk(p, c);
+        } else {
+            write_binary_chunk(p, c);
+        }
+        output_stream *finished = c->last ? c->stream : NULL;
+
+        pthread_mutex_lock(&p->lock);
+        c->next = p->free_list;
+        p->free_list = c;
+        pthread_cond_signal(&p->chunk_free);
+        pthread_mutex_unlock(&p->lock);
+
+        if (finished != NULL) {
+            free(finished->params);
+            free(finished->run_rows);
+            free(finished);
+        }
+    }
+    if (p->config.format == OUTPUT_CSV) {
+        text_flush(p);
+    }
+    return NULL;
+}
+
+// Function to close the file and free a pipeline that output_pipeline_open could not finish
+static void discard_pipeline(output_pipeline *p) {
+    if (p->fp != NULL && p->fp != stdout) {
+        fclose(p->fp);
+    }
+    free(p->text);
+    free(p->chunks);
+    free(p->chunk_storage);
+    free(p->path);
+    free(p);
+}
+
+// Function to create the chunk pool, open the file and start the writer thread
+output_pipeline *output_pipeline_open(const char *path, const output_config *config) {
+    output_pipeline *p = calloc(1, sizeof(*p));
+    if (p == NULL) {
+        return NULL;
+    }
+    p->config = *config;
+    output_config *cfg = &p->config;
+    if (cfg->chunk_rows <= 0) {
+        cfg->chunk_rows = DEFAULT_CHUNK_ROWS;
+    }
+    if (cfg->n_chunks <= 0) {
+        cfg->n_chunks = DEFAULT_N_CHUNKS;
+    }
+    if (cfg->significant_digits <= 0) {
+        cfg->significant_digits = DEFAULT_SIGNIFICANT_DIGITS;
+    }
+    if (cfg->binary_dtype == 0) {
+        cfg->binary_dtype = TRAJ_FLOAT64;
+    }
+    if (cfg->format == OUTPUT_AUTO) {
+        size_t len = strlen(path);
+        cfg->format = len >= 5 && strcmp(path + len - 5, ".bctr") == 0 ? OUTPUT_BINARY : OUTPUT_CSV;
+    }
+    p->path = strdup(path);
+    if (p->path == NULL) {
+        discard_pipeline(p);
+        return NULL;
+    }
+
+    if (cfg->format == OUTPUT_CSV) {
+        p->fp = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+        if (p->fp == NULL) {
+            discard_pipeline(p);
+            return NULL;
+        }
+        // Room for one full line of the widest formatted values past the flush threshold
+        p->text = malloc(LINE_FLUSH_BYTES + (size_t)(cfg->n_columns + cfg->n_params + 1) * 32);
+        if (p->text == NULL) {
+            fprintf(stderr, "Error allocating the output buffer for %s\n", path);
+            discard_pipeline(p);
+            return NULL;
+        }
+        if (cfg->run_column) {
+            fprintf(p->fp, "Run,");
+        }
+        for (int k = 0; k < cfg->n_params; k++) {
+            fprintf(p->fp, "%s,", cfg->param_names[k]);
+        }
+        for (int j = 0; j < cfg->n_columns; j++) {
+            fprintf(p->fp, "%s%c", cfg->column_names[j], j + 1 < cfg->n_columns ? ',' : '\n');
+        }
+    }
+
+    p->chunks = calloc((size_t)cfg->n_chunks, sizeof(output_chunk));
+    p->chunk_storage = malloc((size_t)cfg->n_chunks * cfg->chunk_rows * cfg->n_columns * sizeof(double));
+    if (p->chunks == NULL || p->chunk_storage == NULL) {
+        fprintf(stderr, "Error allocating %d output chunks of %d rows for %s\n", cfg->n_chunks, cfg->chunk_rows, path);
+        discard_pipeline(p);
+        return NULL;
+    }
+    for (int i = 0; i < cfg->n_chunks; i++) {
+        p->chunks[i].rows = p->chunk_storage + (size_t)i * cfg->chunk_rows * cfg->n_columns;
+        p->chunks[i].next = p->free_list;
+        p->free_list = &p->chunks[i];
+    }
+
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->chunk_free, NULL);
+    pthread_cond_init(&p->chunk_ready, NULL);
+    if (pthread_create(&p->thread, NULL, writer_main, p) != 0) {
+        fprintf(stderr, "Error starting the output writer thread\n");
+        discard_pipeline(p);
+        return NULL;
+    }
+    return p;
+}
+
+// Function to drain the queue, stop the writer and close the file
+int output_pipeline_close(output_pipeline *p) {
+    pthread_mutex_lock(&p->lock);
+    p->closing = 1;
+    pthread_cond_signal(&p->chunk_ready);
+    pthread_mutex_unlock(&p->lock);
+    pthread_join(p->thread, NULL);
+
+    // The writer has exited, so its error flag needs no lock from here on
+    int error = p->error;
+    if (p->config.format == OUTPUT_CSV) {
+        if (p->fp == stdout) {
+            fflush(stdout);
+        } else if (fclose(p->fp) != 0) {
+            error = 1;
+        }
+    } else {
+        if (p->traj == NULL) {
+            // No run completed: still leave a valid, empty file
+            p->traj = traj_writer_open(p->path, p->config.binary_dtype, p->config.n_columns - 1,
+                                       p->config.column_names + 1, p->config.n_params,
+                                       p->config.param_names, NULL, 0);
+        }
+        if (p->traj == NULL || traj_writer_close(p->traj) != 0) {
+            error = 1;
+        }
+    }
+    if (error) {
+        fprintf(stderr, "Error writing output file %s\n", p->path);
+    }
+
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->chunk_free);
+    pthread_cond_destroy(&p->chunk_ready);
+    free(p->text);
+    free(p->chunks);
+    free(p->chunk_storage);
+    free(p->path);
+    free(p);
+    return error ? -1 : 0;
+}
+
+// Function to take a chunk from the pool, blocking while all are in flight
+static output_chunk *acquire_chunk(output_pipeline *p, output_stream *s) {
+    pthread_mutex_lock(&p->lock);
+    while (p->free_list == NULL) {
+        pthread_cond_wait(&p->chunk_free, &p->lock);
+    }
+    output_chunk *c = p->free_list;
+    p->free_list = c->next;
+    s->error = p->error;
+    pthread_mutex_unlock(&p->lock);
+
+    c->next = NULL;
+    c->stream = s;
+    c->n_rows = 0;
+    c->last = 0;
+    return c;
+}
+
+// Function to queue a chunk for the writer; returns the pipeline's error flag
+static int submit_chunk(output_pipeline *p, output_chunk *c) {
+    pthread_mutex_lock(&p->lock);
+    if (p->queue_tail != NULL) {
+        p->queue_tail->next = c;
+    } else {
+        p->queue_head = c;
+    }
+    p->queue_tail = c;
+    pthread_cond_signal(&p->chunk_ready);
+    int error = p->error;
+    pthread_mutex_unlock(&p->lock);
+    return error;
+}
+
+output_stream *output_stream_open(output_pipeline *p, const double *params) {
+    output_stream *s = calloc(1, sizeof(*s));
+    if (s == NULL) {
+        return NULL;
+    }
+    s->p = p;
+    s->params = malloc((size_t)(p->config.n_params + 1) * sizeof(double));
+    if (s->params == NULL) {
+        free(s);
+        return NULL;
+    }
+    if (p->config.n_params > 0) {
+        memcpy(s->params, params, (size_t)p->config.n_params * sizeof(double));
+    }
+    pthread_mutex_lock(&p->lock);
+    s->run = p->next_run++;
+    pthread_mutex_unlock(&p->lock);
+    return s;
+}
+
+// Function to append one row; blocks only when the whole pool is queued
+int output_stream_write(output_stream *s, const double *row) {
+    output_pipeline *p = s->p;
+    if (s->chunk == NULL) {
+        s->chunk = acquire_chunk(p, s);
+    }
+    output_chunk *c = s->chunk;
+    memcpy(c->rows + (size_t)c->n_rows * p->config.n_columns, row, (size_t)p->config.n_columns * sizeof(double));
+    if (++c->n_rows == p->config.chunk_rows) {
+        s->error = submit_chunk(p, c);
+        s->chunk = NULL;
+    }
+    return s->error ? -1 : 0;
+}
+
+// Function to hand the last chunk to the writer; the writer frees the stream
+int output_stream_close(output_stream *s) {
+    output_pipeline *p = s->p;
+    if (s->chunk == NULL) {
+        s->chunk = acquire_chunk(p, s);
+    }
+    s->chunk->last = 1;
+    return submit_chunk(p, s->chunk) ? -1 : 0;
+}
@@ -0,0 +1,47 @@
+#ifndef OUTPUT_PIPELINE_H
+#define OUTPUT_PIPELINE_H
+
+// Asynchronous output pipeline
+//
+// Solver threads append rows (Time first, then one value per species) to an
+// output_stream. Rows go into fixed-size chunks taken from a bounded pool;
+// full chunks are queued for a dedicated writer thread that formats them as
+// CSV or appends them to a binary trajectory file (trajectory_io.h) while the
+// solver keeps integrating into the next chunk. When every chunk is in
+// flight, producers block until the writer returns one (backpressure).
+//
+// One pipeline may serve many concurrent streams, one per run; in binary
+// mode each stream becomes one run block and the time grid is taken from
+// the first run that completes.
+
+#define OUTPUT_AUTO 0    // CSV, or binary when the path ends in ".bctr"
+#define OUTPUT_CSV 1
+#define OUTPUT_BINARY 2
+
+typedef struct {
+    int format;
+    int n_columns;                    // values per row, Time first
+    const char *const *column_names;
+    int n_params;                     // parameters attached to each stream
+    const char *const *param_names;
+    int run_column;                   // CSV only: prefix every row with the run number
+    int chunk_rows;                   // rows per chunk, 0 for the default
+    int n_chunks;                     // chunks in the pool, 0 for the default
+    int significant_digits;           // CSV precision, 0 for the default
+    int binary_dtype;                 // TRAJ_FLOAT64 (default) or TRAJ_FLOAT32
+} output_config;
+
+typedef struct output_pipeline output_pipeline;
+typedef struct output_stream output_stream;
+
+output_pipeline *output_pipeline_open(const char *path, const output_config *config);
+int output_pipeline_close(output_pipeline *p);
+
+output_stream *output_stream_open(output_pipeline *p, const double *params);
+int output_stream_write(output_stream *s, const double *row);
+int output_stream_close(output_stream *s);
+
+// Fast replacement for snprintf("%.*g"); returns the number of characters written
+int format_double(char *buf, double value, int significant_digits);
+
+#endif
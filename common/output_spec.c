@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <limits.h>
+#include "output_spec.h"
+
+int output_spec_resolve(const output_spec *spec, int n_total, int n_steps, output_spec *resolved) {
+    *resolved = *spec;
+    if (resolved->n_species <= 0) {
+        resolved->n_species = n_total;
+        resolved->species = NULL;
+    }
+    if (resolved->species != NULL) {
+        for (int j = 0; j < resolved->n_species; j++) {
+            if (resolved->species[j] < 0 || resolved->species[j] >= n_total) {
+                fprintf(stderr, "Error in output spec: species %d out of range\n", resolved->species[j]);
+                return -1;
+            }
+        }
+    } else if (resolved->n_species > n_total) {
+        fprintf(stderr, "Error in output spec: %d species requested, model has %d\n", resolved->n_species, n_total);
+        return -1;
+    }
+    if (resolved->stride < 1) {
+        resolved->stride = 1;
+    }
+    if (resolved->n_samples > 0) {
+        if (resolved->sample_times == NULL) {
+            fprintf(stderr, "Error in output spec: sample_times is NULL\n");
+            return -1;
+        }
+        for (int k = 1; k < resolved->n_samples; k++) {
+            if (resolved->sample_times[k] < resolved->sample_times[k - 1]) {
+                fprintf(stderr, "Error in output spec: sample_times must be increasing\n");
+                return -1;
+            }
+        }
+    }
+    if (resolved->dtype != OUTPUT_SPEC_FLOAT64 && resolved->dtype != OUTPUT_SPEC_FLOAT32) {
+        fprintf(stderr, "Error in output spec: unknown dtype %d\n", resolved->dtype);
+        return -1;
+    }
+    if (resolved->time_stride == 0 && resolved->species_stride == 0) {
+        resolved->time_stride = resolved->n_species;
+        resolved->species_stride = 1;
+    }
+    if (resolved->time_stride < 0 || resolved->species_stride < 0 || resolved->capacity < 0) {
+        fprintf(stderr, "Error in output spec: negative stride or capacity\n");
+        return -1;
+    }
+
+    // A zero stride would write every sample (or species) to the same element
+    int n_samples = output_spec_num_samples(resolved, n_steps);
+    if (resolved->species_stride == 0 && resolved->n_species > 1) {
+        fprintf(stderr, "Error in output spec: species_stride is 0 with %d species\n", resolved->n_species);
+        return -1;
+    }
+    if (resolved->time_stride == 0 && n_samples > 1) {
+        fprintf(stderr, "Error in output spec: time_stride is 0 with %d samples\n", n_samples);
+        return -1;
+    }
+    if (n_samples > 1 && resolved->time_stride > LONG_MAX / 2 / (n_samples - 1)) {
+        fprintf(stderr, "Error in output spec: time_stride %ld too large\n", resolved->time_stride);
+        return -1;
+    }
+    if (resolved->n_species > 1 && resolved->species_stride > LONG_MAX / 2 / (resolved->n_species - 1)) {
+        fprintf(stderr, "Error in output spec: species_stride %ld too large\n", resolved->species_stride);
+        return -1;
+    }
+    long extent = output_spec_extent(resolved, n_steps);
+    if (resolved->capacity > 0 && extent > resolved->capacity) {
+        fprintf(stderr, "Error in output spec: %d samples need %ld elements, buffer has %ld\n",
+                n_samples, extent, resolved->capacity);
+        return -1;
+    }
+    return 0;
+}
+
+int output_spec_num_samples(const output_spec *spec, int n_steps) {
+    if (spec->n_samples > 0) {
+        return spec->n_samples;
+    }
+    int stride = spec->stride < 1 ? 1 : spec->stride;
+    return (n_steps + stride - 1) / stride;
+}
+
+long output_spec_extent(const output_spec *spec, int n_steps) {
+    int n_samples = output_spec_num_samples(spec, n_steps);
+    if (n_samples <= 0 || spec->n_species <= 0) {
+        return 0;
+    }
+    return (n_samples - 1) * spec->time_stride + (spec->n_species - 1) * spec->species_stride + 1;
+}
+
+void output_spec_store(const output_spec *spec, void *out, long k, const double *state) {
+    long base = k * spec->time_stride;
+    if (spec->dtype == OUTPUT_SPEC_FLOAT32) {
+        float *dst = out;
+        for (int j = 0; j < spec->n_species; j++) {
+            dst[base + j * spec->species_stride] = (float)state[spec->species ? spec->species[j] : j];
+        }
+    } else {
+        double *dst = out;
+        for (int j = 0; j < spec->n_species; j++) {
+            dst[base + j * spec->species_stride] = state[spec->species ? spec->species[j] : j];
+        }
+    }
+}
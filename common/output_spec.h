@@ -0,0 +1,44 @@
+#ifndef OUTPUT_SPEC_H
+#define OUTPUT_SPEC_H
+
+// Output specification for the ctypes results buffers
+//
+// Selects which species are stored, at which steps (every stride-th step of
+// the uniform grid, or an explicit list of sample times), in float64 or
+// float32, and where each value goes: element (sample k, selected species j)
+// is written to out[k * time_stride + j * species_stride]. With both strides
+// 0 the buffer is row-major and contiguous, [n_samples][n_species]. Strides
+// are counted in elements, i.e. NumPy strides divided by the item size, so
+// the buffer can be any NumPy array view. Strides must not be negative, and a
+// stride may only be 0 along an axis of length 1. When capacity is set, the
+// elements written must fall inside out[0..capacity).
+
+#define OUTPUT_SPEC_FLOAT64 0
+#define OUTPUT_SPEC_FLOAT32 1
+
+typedef struct {
+    int n_species;              // number of selected species, 0 for all
+    const int *species;         // selected species indices, NULL for 0..n_species-1
+    int stride;                 // store every stride-th step of the uniform grid (0 or 1: all)
+    int n_samples;              // number of explicit sample times, 0 for the uniform grid
+    const double *sample_times; // increasing sample times, used when n_samples > 0
+    int dtype;                  // OUTPUT_SPEC_FLOAT64 or OUTPUT_SPEC_FLOAT32
+    long time_stride;           // elements between consecutive samples
+    long species_stride;        // elements between consecutive selected species
+    long capacity;              // elements available at out, 0 for unchecked
+} output_spec;
+
+// Fill in the defaults for a model with n_total species and a uniform grid of
+// n_steps steps; -1 on invalid input or when the samples do not fit in capacity
+int output_spec_resolve(const output_spec *spec, int n_total, int n_steps, output_spec *resolved);
+
+// Number of samples stored for a uniform grid of n_steps steps
+int output_spec_num_samples(const output_spec *spec, int n_steps);
+
+// Number of elements from out[0] to the last one written by a resolved spec, 0 when nothing is
+long output_spec_extent(const output_spec *spec, int n_steps);
+
+// Write the selected species of state as sample k
+void output_spec_store(const output_spec *spec, void *out, long k, const double *state);
+
+#endif
@@ -0,0 +1,83 @@
+import ctypes
+import numpy as np
+
+# ctypes mirror of output_spec.h. make_output_spec() describes an existing
+# NumPy array, so the C library writes its samples straight into that array
+# (any layout, float32 or float64) without a Python-side copy or reshape.
+
+OUTPUT_SPEC_FLOAT64 = 0
+OUTPUT_SPEC_FLOAT32 = 1
+
+
+class OutputSpec(ctypes.Structure):
+    _fields_ = [
+        ('n_species', ctypes.c_int),
+        ('species', ctypes.POINTER(ctypes.c_int)),
+        ('stride', ctypes.c_int),
+        ('n_samples', ctypes.c_int),
+        ('sample_times', ctypes.POINTER(ctypes.c_double)),
+        ('dtype', ctypes.c_int),
+        ('time_stride', ctypes.c_long),
+        ('species_stride', ctypes.c_long),
+        ('capacity', ctypes.c_long),
+    ]
+
+
+def make_output_spec(out, species=None, stride=1, sample_times=None, species_axis=1, n_steps=None):
+    """Spec for writing into out, a 2-D array with samples along one axis and
+    the selected species along species_axis. With n_steps, out must have one
+    row per stored step of the uniform grid; the C side checks the strides
+    against the array's extent in any case."""
+    if out.dtype == np.float64:
+        dtype = OUTPUT_SPEC_FLOAT64
+    elif out.dtype == np.float32:
+        dtype = OUTPUT_SPEC_FLOAT32
+    else:
+        raise TypeError('out must be float32 or float64')
+    if out.ndim != 2 or out.size == 0:
+        raise ValueError('out must be a non-empty 2-D array')
+    if species_axis not in (0, 1):
+        raise ValueError('species_axis must be 0 or 1')
+    if not out.flags.writeable:
+        raise ValueError('out must be writeable')
+    if any(s < 0 or s % out.itemsize != 0 for s in out.strides):
+        raise ValueError('out must have non-negative strides that are multiples of its item size')
+    if stride < 1:
+        raise ValueError('stride must be at least 1')
+    strides = [s // out.itemsize for s in out.strides]
+    time_axis = 1 - species_axis
+    if sample_times is None and n_steps is not None and out.shape[time_axis] != (n_steps + stride - 1) // stride:
+        raise ValueError('out has room for %d samples, %d steps with stride %d store %d'
+                         % (out.shape[time_axis], n_steps, stride, (n_steps + stride - 1) // stride))
+
+    spec = OutputSpec()
+    spec.dtype = dtype
+    spec.stride = stride
+    spec.time_stride = strides[time_axis]
+    spec.species_stride = strides[species_axis]
+    if species is not None:
+        species = np.ascontiguousarray(species, dtype=np.intc)
+        if len(species) != out.shape[species_axis]:
+            raise ValueError('out has room for %d species, %d selected' % (out.shape[species_axis], len(species)))
+        spec.n_species = len(species)
+        spec.species = species.ctypes.data_as(ctypes.POINTER(ctypes.c_int))
+    else:
+        spec.n_species = out.shape[species_axis]
+    if sample_times is not None:
+        sample_times = np.ascontiguousarray(sample_times, dtype=np.float64)
+        if len(sample_times) != out.shape[time_axis]:
+            raise ValueError('out has room for %d samples, %d requested' % (out.shape[time_axis], len(sample_times)))
+        spec.n_samples = len(sample_times)
+        spec.sample_times = sample_times.ctypes.data_as(ctypes.POINTER(ctypes.c_double))
+    # Elements spanned by the view, from its first element to its last
+    spec.capacity = sum((n - 1) * st for n, st in zip(out.shape, strides)) + 1
+    # Keep the index arrays alive as long as the spec
+    spec._keep = (species, sample_times)
+    return spec
+
+
+def declare_spec_function(func):
+    """Set the ctypes signature of a solve_*_spec(out, spec, n_steps, dt, I) function."""
+    func.argtypes = [ctypes.c_void_p, ctypes.POINTER(OutputSpec), ctypes.c_int, ctypes.c_double, ctypes.c_double]
+    func.restype = ctypes.c_int
+    return func
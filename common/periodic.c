@@ -0,0 +1,679 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "periodic.h"
+
+#define DEFAULT_TOL 1e-6
+#define DEFAULT_MAX_ITER 20
+#define MAX_HALVINGS 4           // Newton step halvings while the residual grows
+#define MAX_QR_ITERATIONS 30     // per eigenvalue
+
+struct periodic_solver {
+    const circuit_model *base;
+    circuit_model variational;   // y, then the monodromy columns; data points back here
+    circuit_solver_options options;
+    circuit_solver *plain;
+    circuit_solver *augmented;   // created on the first variational solve
+    int input_param;
+    circuit_input_fn input_fn;
+    void *input_ctx;
+    realtype *z;                 // augmented state
+    realtype *out;               // two rows of the augmented state
+};
+
+// Variational right-hand side: y' = f(t, y) and Phi_k' = J(t, y) Phi_k for every column k
+static int variational_rhs(realtype t, const realtype *y, realtype *ydot, const realtype *p, const void *data) {
+    const periodic_solver *ps = data;
+    const circuit_model *m = ps->base;
+    int n = m->n_species;
+    realtype yp[PERIODIC_MAX_SPECIES], fp[PERIODIC_MAX_SPECIES], J[PERIODIC_MAX_SPECIES * PERIODIC_MAX_SPECIES];
+
+    int flag = m->rhs(t, y, ydot, p, m->data);
+    if (flag != 0) {
+        return flag;
+    }
+    if (m->jac != NULL) {
+        flag = m->jac(t, y, J, p, m->data);
+        if (flag != 0) {
+            return flag;
+        }
+    }
+    realtype ynorm = 0;
+    for (int i = 0; i < n; i++) {
+        ynorm = fmax(ynorm, fabs(y[i]));
+    }
+    for (int k = 0; k < n; k++) {
+        const realtype *v = y + (1 + k) * n;
+        realtype *dv = ydot + (1 + k) * n;
+        if (m->jac != NULL) {
+            for (int i = 0; i < n; i++) {
+                realtype sum = 0;
+                for (int j = 0; j < n; j++) {
+                    sum += J[j * n + i] * v[j];
+                }
+                dv[i] = sum;
+            }
+            continue;
+        }
+        // J v = |v| J (v / |v|) by one directional difference quotient, which
+        // stays finite when a column of Phi has decayed to nearly nothing
+        realtype vnorm = 0;
+        for (int i = 0; i < n; i++) {
+            vnorm = fmax(vnorm, fabs(v[i]));
+        }
+        if (vnorm == 0) {
+            memset(dv, 0, sizeof(realtype) * n);
+            continue;
+        }
+        realtype h = sqrt(UNIT_ROUNDOFF) * fmax(1.0, ynorm);
+        for (int i = 0; i < n; i++) {
+            yp[i] = y[i] + h * (v[i] / vnorm);
+        }
+        flag = m->rhs(t, yp, fp, p, m->data);
+        if (flag != 0) {
+            return flag;
+        }
+        for (int i = 0; i < n; i++) {
+            dv[i] = vnorm * ((fp[i] - ydot[i]) / h);
+        }
+    }
+    return 0;
+}
+
+periodic_solver *periodic_solver_create(const circuit_model *model, const circuit_solver_options *options) {
+    int n = model->n_species;
+    if (n > PERIODIC_MAX_SPECIES) {
+        fprintf(stderr, "Error in periodic_solver_create: %s is too large\n", model->name);
+        return NULL;
+    }
+    periodic_solver *ps = calloc(1, sizeof(*ps));
+    if (ps == NULL) {
+        return NULL;
+    }
+    ps->base = model;
+    if (options != NULL) {
+        ps->options = *options;
+    }
+    ps->input_param = -1;
+
+    circuit_model *v = &ps->variational;
+    v->name = model->name;
+    v->n_species = n * (1 + n);
+    v->n_params = model->n_params;
+    v->param_names = model->param_names;
+    v->default_params = model->default_params;
+    v->rhs = variational_rhs;
+    v->input_param = model->input_param;
+    v->data = ps;
+
+    ps->plain = circuit_solver_create(model, &ps->options);
+    ps->z = malloc(sizeof(realtype) * v->n_species);
+    ps->out = malloc(sizeof(realtype) * 2 * v->n_species);
+    if (ps->plain == NULL || ps->z == NULL || ps->out == NULL) {
+        periodic_solver_free(ps);
+        return NULL;
+    }
+    circuit_solver_set_exact_end(ps->plain, 1);
+    return ps;
+}
+
+void periodic_solver_free(periodic_solver *ps) {
+    if (ps == NULL) {
+        return;
+    }
+    circuit_solver_free(ps->plain);
+    circuit_solver_free(ps->augmented);
+    free(ps->z);
+    free(ps->out);
+    free(ps);
+}
+
+void periodic_solver_set_input(periodic_solver *ps, int param, circuit_input_fn fn, void *ctx) {
+    ps->input_param = param;
+    ps->input_fn = fn;
+    ps->input_ctx = ctx;
+    circuit_solver_set_input(ps->plain, param, fn, ctx);
+    if (ps->augmented != NULL) {
+        circuit_solver_set_input(ps->augmented, param, fn, ctx);
+    }
+}
+
+// Function to add the statistics of one run to the totals
+static void add_stats(solver_stats *total, const solver_stats *st) {
+    total->n_steps += st->n_steps;
+    total->n_rhs_evals += st->n_rhs_evals;
+    total->n_jac_evals += st->n_jac_evals;
+    total->n_lin_setups += st->n_lin_setups;
+    total->n_nonlin_iters += st->n_nonlin_iters;
+    total->n_nonlin_conv_fails += st->n_nonlin_conv_fails;
+    total->n_err_test_fails += st->n_err_test_fails;
+    total->n_method_switches += st->n_method_switches;
+    total->last_step = st->last_step;
+    total->setup_time += st->setup_time;
+    total->integrate_time += st->integrate_time;
+    total->output_time += st->output_time;
+}
+
+// Function to check the period and breaks; -1 if they do not describe a period
+static int check_options(const periodic_options *o) {
+    if (!(o->period > 0) || o->n_breaks < 0 || o->n_breaks > PERIODIC_MAX_BREAKS) {
+        fprintf(stderr, "Error in periodic_solve: bad period or number of breaks\n");
+        return -1;
+    }
+    for (int b = 0; b < o->n_breaks; b++) {
+        if (!(o->breaks[b] > (b > 0 ? o->breaks[b - 1] : 0)) || !(o->breaks[b] < o->period)) {
+            fprintf(stderr, "Error in periodic_solve: breaks must increase inside (0, period)\n");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Function to map the state y (n_state values) through one period with solver s, piece by piece
+static int period_map(periodic_solver *ps, circuit_solver *s, int n_state, const realtype *params, realtype *y,
+                      const periodic_options *o, periodic_result *r) {
+    realtype t_out[2] = {0, 0};
+    for (int b = 0; b <= o->n_breaks; b++) {
+        t_out[0] = t_out[1];
+        t_out[1] = b < o->n_breaks ? o->breaks[b] : o->period;
+        int flag = circuit_solver_run(s, params, y, t_out, 2, ps->out);
+        add_stats(&r->stats, circuit_solver_stats(s));
+        if (flag != 0) {
+            return flag;
+        }
+        memcpy(y, ps->out + n_state, sizeof(realtype) * n_state);
+    }
+    r->n_periods++;
+    return 0;
+}
+
+// Function to compute phi = phi_T(y) and the monodromy matrix M (column-major) at y
+static int period_with_monodromy(periodic_solver *ps, const realtype *params, const realtype *y,
+                                 const periodic_options *o, periodic_result *r, realtype *phi, realtype *M) {
+    int n = ps->base->n_species;
+    if (o->monodromy == PERIODIC_FINITE_DIFFERENCE) {
+        memcpy(phi, y, sizeof(realtype) * n);
+        int flag = period_map(ps, ps->plain, n, params, phi, o, r);
+        if (flag != 0) {
+            return flag;
+        }
+        // Perturbations well above the integration error, which the quotients divide by h
+        realtype rtol = ps->options.rtol > 0 ? ps->options.rtol : 1e-4;
+        for (int j = 0; j < n; j++) {
+            realtype *col = M + (size_t)j * n;
+            realtype h = sqrt(rtol) * fmax(1.0, fabs(y[j]));
+            memcpy(col, y, sizeof(realtype) * n);
+            col[j] += h;
+            flag = period_map(ps, ps->plain, n, params, col, o, r);
+            if (flag != 0) {
+                return flag;
+            }
+            for (int i = 0; i < n; i++) {
+                col[i] = (col[i] - phi[i]) / h;
+            }
+        }
+        return 0;
+    }
+
+    if (ps->augmented == NULL) {
+        ps->augmented = circuit_solver_create(&ps->variational, &ps->options);
+        if (ps->augmented == NULL) {
+            return -1;
+        }
+        circuit_solver_set_exact_end(ps->augmented, 1);
+        if (ps->input_fn != NULL) {
+            circuit_solver_set_input(ps->augmented, ps->input_param, ps->input_fn, ps->input_ctx);
+        }
+    }
+    // z = (y, I): the columns of Phi follow y, so they are the columns of M at the end
+    realtype *z = ps->z;
+    memcpy(z, y, sizeof(realtype) * n);
+    memset(z + n, 0, sizeof(realtype) * n * n);
+    for (int k = 0; k < n; k++) {
+        z[n + k * n + k] = 1;
+    }
+    int flag = period_map(ps, ps->augmented, n * (1 + n), params, z, o, r);
+    if (flag != 0) {
+        return flag;
+    }
+    memcpy(phi, z, sizeof(realtype) * n);
+    memcpy(M, z + n, sizeof(realtype) * n * n);
+    return 0;
+}
+
+// Function to solve A x = b in place (A column-major, overwritten) by Gaussian
+// elimination with partial pivoting; -1 if A is singular to working precision
+static int solve_linear(int n, realtype *A, realtype *b) {
+    realtype scale = 0;
+    for (int k = 0; k < n * n; k++) {
+        scale = fmax(scale, fabs(A[k]));
+    }
+#define A_(i, j) A[(j) * n + (i)]
+    for (int col = 0; col < n; col++) {
+        int pivot = col;
+        for (int r = col + 1; r < n; r++) {
+            if (fabs(A_(r, col)) > fabs(A_(pivot, col))) {
+                pivot = r;
+            }
+        }
+        if (!(fabs(A_(pivot, col)) > n * UNIT_ROUNDOFF * scale)) {
+            return -1;
+        }
+        if (pivot != col) {
+            for (int j = col; j < n; j++) {
+                realtype tmp = A_(col, j);
+                A_(col, j) = A_(pivot, j);
+                A_(pivot, j) = tmp;
+            }
+            realtype tmp = b[col];
+            b[col] = b[pivot];
+            b[pivot] = tmp;
+        }
+        for (int r = col + 1; r < n; r++) {
+            realtype l = A_(r, col) / A_(col, col);
+            for (int j = col + 1; j < n; j++) {
+                A_(r, j) -= l * A_(col, j);
+            }
+            b[r] -= l * b[col];
+        }
+    }
+    for (int r = n - 1; r >= 0; r--) {
+        realtype sum = b[r];
+        for (int j = r + 1; j < n; j++) {
+            sum -= A_(r, j) * b[j];
+        }
+        b[r] = sum / A_(r, r);
+    }
+#undef A_
+    return 0;
+}
+
+int periodic_solve(periodic_solver *ps, const realtype *params, const realtype *y, const periodic_options *options,
+                   periodic_result *result) {
+    const circuit_model *m = ps->base;
+    int n = m->n_species;
+    periodic_result *r = result;
+    memset(r, 0, sizeof(*r));
+    if (check_options(options) != 0) {
+        return -1;
+    }
+    realtype tol = options->tol > 0 ? options->tol : DEFAULT_TOL;
+    int max_iter = options->max_iter > 0 ? options->max_iter : DEFAULT_MAX_ITER;
+
+    realtype *x = r->y0;
+    memcpy(x, y != NULL ? y : m->default_y0, sizeof(realtype) * n);
+    for (int w = 0; w < options->warmup; w++) {
+        int flag = period_map(ps, ps->plain, n, params, x, options, r);
+        if (flag != 0) {
+            fprintf(stderr, "Error in CVode in warmup period %d: %d\n", w + 1, flag);
+            return flag;
+        }
+    }
+
+    realtype phi[PERIODIC_MAX_SPECIES], step[PERIODIC_MAX_SPECIES], x_prev[PERIODIC_MAX_SPECIES];
+    realtype M[PERIODIC_MAX_SPECIES * PERIODIC_MAX_SPECIES];
+    realtype last = INFINITY, lambda = 1;
+    int halvings = 0;
+    for (;;) {
+        int flag = period_with_monodromy(ps, params, x, options, r, phi, M);
+        realtype res = 0, xnorm = 0;
+        for (int i = 0; i < n && flag == 0; i++) {
+            res = fmax(res, fabs(phi[i] - x[i]));
+            xnorm = fmax(xnorm, fabs(x[i]));
+        }
+        for (int k = 0; k < n * n && flag == 0; k++) {
+            res = isfinite(M[k]) ? res : NAN;
+        }
+        // Damping: halve a step that made the residual grow or the integration fail
+        if (flag != 0 || !isfinite(res)) {
+            res = INFINITY;
+        }
+        if (res > last && halvings < MAX_HALVINGS) {
+            halvings++;
+            lambda /= 2;
+            for (int i = 0; i < n; i++) {
+                x[i] = x_prev[i] + lambda * step[i];
+            }
+            continue;
+        }
+        if (flag != 0) {
+            fprintf(stderr, "Error in CVode over the period from iterate %d: %d\n", r->n_iter, flag);
+            return flag;
+        }
+        if (isinf(res)) {
+            fprintf(stderr, "Error in periodic_solve: the period map is not finite\n");
+            return -1;
+        }
+        r->residual = res;
+        memcpy(r->monodromy, M, sizeof(realtype) * n * n);
+        if (res <= tol * (1 + xnorm)) {
+            r->converged = 1;
+            break;
+        }
+        if (r->n_iter == max_iter) {
+            break;
+        }
+
+        // Newton step: (M - I) step = x - phi
+        for (int i = 0; i < n; i++) {
+            M[i * n + i] -= 1;
+            step[i] = x[i] - phi[i];
+        }
+        if (solve_linear(n, M, step) != 0) {
+            fprintf(stderr, "Error in periodic_solve: M - I is singular (a multiplier is 1)\n");
+            return -1;
+        }
+        memcpy(x_prev, x, sizeof(realtype) * n);
+        for (int i = 0; i < n; i++) {
+            x[i] += step[i];
+        }
+        last = res;
+        lambda = 1;
+        halvings = 0;
+        r->n_iter++;
+    }
+
+    if (periodic_eigenvalues(n, r->monodromy, r->multiplier_re, r->multiplier_im) != 0) {
+        fprintf(stderr, "Error in periodic_solve: no Floquet multipliers\n");
+        return -1;
+    }
+    r->max_multiplier = hypot(r->multiplier_re[0], r->multiplier_im[0]);
+    return r->converged ? 0 : 1;
+}
+
+// Function to tell whether two times are the same up to a few ulps, so a row
+// rounded to just past a break is not handed to CVODE right next to it
+static int same_time(realtype a, realtype b) {
+    return fabs(a - b) <= 4 * UNIT_ROUNDOFF * fmax(fabs(a), fabs(b));
+}
+
+int periodic_solver_sample(periodic_solver *ps, const realtype *params, const realtype *y0,
+                           const periodic_options *options, int n_out, realtype *out) {
+    int n = ps->base->n_species;
+    if (check_options(options) != 0 || n_out < 2) {
+        return -1;
+    }
+    realtype *t_out = malloc(sizeof(realtype) * (n_out + 1));
+    realtype *rows = malloc(sizeof(realtype) * (n_out + 1) * n);
+    if (t_out == NULL || rows == NULL) {
+        free(t_out);
+        free(rows);
+        return -1;
+    }
+    realtype T = options->period;
+    realtype *y = out;   // state at the start of the piece, a row already written
+    memcpy(out, y0, sizeof(realtype) * n);
+    int k = 1;           // next row, at T k / (n_out - 1)
+    int flag = 0;
+    for (int b = 0; b <= options->n_breaks; b++) {
+        // The rows inside the piece, then its end, which is a row too when one falls
+        // on it; a row within a few ulps of the break is put exactly on it
+        int m = 0;
+        t_out[m++] = b > 0 ? options->breaks[b - 1] : 0;
+        realtype e = b < options->n_breaks ? options->breaks[b] : T;
+        for (; k < n_out - 1 && T * k / (n_out - 1) < e && !same_time(T * k / (n_out - 1), e); k++) {
+            t_out[m++] = T * k / (n_out - 1);
+        }
+        t_out[m++] = e;
+        flag = circuit_solver_run(ps->plain, params, y, t_out, m, rows);
+        if (flag != 0) {
+            fprintf(stderr, "Error in CVode on [%g, %g]: %d\n", t_out[0], e, flag);
+            break;
+        }
+        memcpy(out + (size_t)(k - (m - 2)) * n, rows + n, sizeof(realtype) * (m - 2) * n);
+        if (b == options->n_breaks) {
+            k = n_out - 1;
+        } else if (k >= n_out - 1 || !same_time(T * k / (n_out - 1), e)) {
+            // The break is not a row: keep its state in the spare row after the table
+            memcpy(rows + (size_t)n_out * n, rows + (size_t)(m - 1) * n, sizeof(realtype) * n);
+            y = rows + (size_t)n_out * n;
+            continue;
+        }
+        memcpy(out + (size_t)k * n, rows + (size_t)(m - 1) * n, sizeof(realtype) * n);
+        y = out + (size_t)k * n;
+        k++;
+    }
+    free(t_out);
+    free(rows);
+    return flag;
+}
+
+// Function to reduce the n x n row-major matrix a to upper Hessenberg form by
+// similarity transformations with elimination and partial pivoting
+static void hessenberg(int n, double *a) {
+#define H(i, j) a[(i) * n + (j)]
+    for (int m = 1; m < n - 1; m++) {
+        double x = 0;
+        int i = m;
+        for (int j = m; j < n; j++) {
+            if (fabs(H(j, m - 1)) > fabs(x)) {
+                x = H(j, m - 1);
+                i = j;
+            }
+        }
+        if (i != m) {
+            for (int j = m - 1; j < n; j++) {
+                double tmp = H(i, j);
+                H(i, j) = H(m, j);
+                H(m, j) = tmp;
+            }
+            for (int j = 0; j < n; j++) {
+                double tmp = H(j, i);
+                H(j, i) = H(j, m);
+                H(j, m) = tmp;
+            }
+        }
+        if (x != 0) {
+            for (i = m + 1; i < n; i++) {
+                double y = H(i, m - 1);
+                if (y != 0) {
+                    y /= x;
+                    H(i, m - 1) = 0;
+                    for (int j = m; j < n; j++) {
+                        H(i, j) -= y * H(m, j);
+                    }
+                    for (int j = 0; j < n; j++) {
+                        H(j, m) += y * H(j, i);
+                    }
+                }
+            }
+        }
+    }
+#undef H
+}
+
+// Function to find the eigenvalues of the upper Hessenberg matrix a (row-major,
+// destroyed) by the shifted QR algorithm with Francis double steps; -1 if an
+// eigenvalue takes more than MAX_QR_ITERATIONS iterations
+static int hessenberg_eigenvalues(int n, double *a, double *wr, double *wi) {
+    // One-based indices below, as in the usual statement of the algorithm
+#define H(i, j) a[((i) - 1) * n + (j) - 1]
+#define WR(i) wr[(i) - 1]
+#define WI(i) wi[(i) - 1]
+    double anorm = 0;
+    for (int i = 1; i <= n; i++) {
+        for (int j = i > 1 ? i - 1 : 1; j <= n; j++) {
+            anorm += fabs(H(i, j));
+        }
+    }
+    int nn = n, l;
+    double t = 0;
+    double p = 0, q = 0, r = 0, s, w, x, y, z;
+    while (nn >= 1) {
+        int its = 0;
+        do {
+            // Look for a small subdiagonal element
+            for (l = nn; l >= 2; l--) {
+                s = fabs(H(l - 1, l - 1)) + fabs(H(l, l));
+                if (s == 0) {
+                    s = anorm;
+                }
+                if (fabs(H(l, l - 1)) + s == s) {
+                    H(l, l - 1) = 0;
+                    break;
+                }
+            }
+            x = H(nn, nn);
+            if (l == nn) {
+                // One root found
+                WR(nn) = x + t;
+                WI(nn) = 0;
+                nn--;
+            } else {
+                y = H(nn - 1, nn - 1);
+                w = H(nn, nn - 1) * H(nn - 1, nn);
+                if (l == nn - 1) {
+                    // Two roots found
+                    p = 0.5 * (y - x);
+                    q = p * p + w;
+                    z = sqrt(fabs(q));
+                    x += t;
+                    if (q >= 0) {
+                        z = p + (p >= 0 ? fabs(z) : -fabs(z));
+                        WR(nn - 1) = WR(nn) = x + z;
+                        if (z != 0) {
+                            WR(nn) = x - w / z;
+                        }
+                        WI(nn - 1) = WI(nn) = 0;
+                    } else {
+                        WR(nn - 1) = WR(nn) = x + p;
+                        WI(nn - 1) = z;
+                        WI(nn) = -z;
+                    }
+                    nn -= 2;
+                } else {
+                    if (its == MAX_QR_ITERATIONS) {
+                        return -1;
+                    }
+                    if (its == 10 || its == 20) {
+                        // Exceptional shift
+                        t += x;
+                        for (int i = 1; i <= nn; i++) {
+                            H(i, i) -= x;
+                        }
+                        s = fabs(H(nn, nn - 1)) + fabs(H(nn - 1, nn - 2));
+                        y = x = 0.75 * s;
+                        w = -0.4375 * s * s;
+                    }
+                    its++;
+                    // Form the shift and look for two consecutive small subdiagonal elements
+                    int m;
+                    for (m = nn - 2; m >= l; m--) {
+                        z = H(m, m);
+                        r = x - z;
+                        s = y - z;
+                        p = (r * s - w) / H(m + 1, m) + H(m, m + 1);
+                        q = H(m + 1, m + 1) - z - r - s;
+                        r = H(m + 2, m + 1);
+                        s = fabs(p) + fabs(q) + fabs(r);
+                        p /= s;
+                        q /= s;
+                        r /= s;
+                        if (m == l) {
+                            break;
+                        }
+                        double u = fabs(H(m, m - 1)) * (fabs(q) + fabs(r));
+                        double v = fabs(p) * (fabs(H(m - 1, m - 1)) + fabs(z) + fabs(H(m + 1, m + 1)));
+                        if (u + v == v) {
+                            break;
+                        }
+                    }
+                    for (int i = m + 2; i <= nn; i++) {
+                        H(i, i - 2) = 0;
+                        if (i != m + 2) {
+                            H(i, i - 3) = 0;
+                        }
+                    }
+                    // Double QR step on rows l..nn and columns m..nn
+                    for (int k = m; k <= nn - 1; k++) {
+                        if (k != m) {
+                            p = H(k, k - 1);
+                            q = H(k + 1, k - 1);
+                            r = 0;
+                            if (k != nn - 1) {
+                                r = H(k + 2, k - 1);
+                            }
+                            if ((x = fabs(p) + fabs(q) + fabs(r)) != 0) {
+                                p /= x;
+                                q /= x;
+                                r /= x;
+                            }
+                        }
+                        s = sqrt(p * p + q * q + r * r);
+                        if (p < 0) {
+                            s = -s;
+                        }
+                        if (s != 0) {
+                            if (k == m) {
+                                if (l != m) {
+                                    H(k, k - 1) = -H(k, k - 1);
+                                }
+                            } else {
+                                H(k, k - 1) = -s * x;
+                            }
+                            p += s;
+                            x = p / s;
+                            y = q / s;
+                            z = r / s;
+                            q /= p;
+                            r /= p;
+                            for (int j = k; j <= nn; j++) {
+                                p = H(k, j) + q * H(k + 1, j);
+                                if (k != nn - 1) {
+                                    p += r * H(k + 2, j);
+                                    H(k + 2, j) -= p * z;
+                                }
+                                H(k + 1, j) -= p * y;
+                                H(k, j) -= p * x;
+                            }
+                            int mmin = nn < k + 3 ? nn : k + 3;
+                            for (int i = l; i <= mmin; i++) {
+                                p = x * H(i, k) + y * H(i, k + 1);
+                                if (k != nn - 1) {
+                                    p += z * H(i, k + 2);
+                                    H(i, k + 2) -= p * r;
+                                }
+                                H(i, k + 1) -= p * q;
+                                H(i, k) -= p;
+                            }
+                        }
+                    }
+                }
+            }
+        } while (nn >= 1 && l < nn - 1);
+    }
+#undef H
+#undef WR
+#undef WI
+    return 0;
+}
+
+int periodic_eigenvalues(int n, const realtype *a, double *re, double *im) {
+    double h[PERIODIC_MAX_SPECIES * PERIODIC_MAX_SPECIES];
+    if (n < 1 || n > PERIODIC_MAX_SPECIES) {
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            h[i * n + j] = a[j * n + i];
+        }
+    }
+    hessenberg(n, h);
+    if (hessenberg_eigenvalues(n, h, re, im) != 0) {
+        return -1;
+    }
+    // Insertion sort by decreasing modulus; a complex pair keeps its order (positive imaginary part first)
+    for (int i = 1; i < n; i++) {
+        double xr = re[i], xi = im[i], mod = hypot(xr, xi);
+        int j = i - 1;
+        while (j >= 0 && hypot(re[j], im[j]) < mod) {
+            re[j + 1] = re[j];
+            im[j + 1] = im[j];
+            j--;
+        }
+        re[j + 1] = xr;
+        im[j + 1] = xi;
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+#ifndef PERIODIC_H
+#define PERIODIC_H
+
+#include "circuits.h"
+#include "circuit_solver.h"
+
+// Periodic steady state of a periodically forced circuit by shooting
+//
+// Under a forcing of period T the response after the transients is the
+// orbit through the fixed point y* = phi_T(y*) of the period map, the flow
+// over one period from t = 0. periodic_solve() finds it by Newton's method
+// on G(y) = phi_T(y) - y,
+//
+//   (M - I) dy = -G(y),   M = d phi_T / d y (the monodromy matrix)
+//
+// with M from the variational equations dPhi/dt = J(t, y) Phi, Phi(0) = I,
+// integrated together with y as one circuit_model of n (1 + n) states (J Phi
+// from the model's Jacobian or by directional difference quotients, as in
+// sensitivity.h), or from n + 1 period integrations with perturbed initial
+// states. A Newton iteration costs one period integration of the augmented
+// system, and a handful of them replace the dozens of periods a slowly
+// decaying transient needs. The eigenvalues of M on the orbit are its
+// Floquet multipliers: the orbit is stable when they all lie inside the
+// unit circle, and the largest modulus is the factor by which a
+// perturbation shrinks per period.
+//
+// The forcing must have period T and phase 0 at t = 0 (repression_intervals
+// with PERIOD = T, or an input added with periodic_solver_set_input). Each
+// period is integrated in pieces between the breaks, the times where the
+// forcing jumps, restarting CVODE and stopping it exactly at the end of
+// each piece, where the forcing keeps its value on the piece. Autonomous oscillators, whose period is unknown and whose
+// M - I is singular, are not covered.
+
+#define PERIODIC_MAX_SPECIES 32
+#define PERIODIC_MAX_BREAKS 16
+
+#define PERIODIC_VARIATIONAL 0         // monodromy from the variational equations
+#define PERIODIC_FINITE_DIFFERENCE 1   // monodromy from n + 1 perturbed period integrations
+
+typedef struct {
+    realtype period;
+    int n_breaks;
+    realtype breaks[PERIODIC_MAX_BREAKS];   // increasing times in (0, period) where the forcing jumps
+    int monodromy;      // PERIODIC_VARIATIONAL or PERIODIC_FINITE_DIFFERENCE
+    realtype tol;       // 0 for 1e-6: converged when max |G(y)| <= tol (1 + max |y|)
+    int max_iter;       // 0 for 20 Newton iterations
+    int warmup;         // plain periods integrated from the guess before Newton
+} periodic_options;
+
+typedef struct {
+    realtype y0[PERIODIC_MAX_SPECIES];      // state on the orbit at t = 0
+    realtype monodromy[PERIODIC_MAX_SPECIES * PERIODIC_MAX_SPECIES];   // n x n, column-major
+    double multiplier_re[PERIODIC_MAX_SPECIES];   // Floquet multipliers by decreasing modulus
+    double multiplier_im[PERIODIC_MAX_SPECIES];
+    double max_multiplier;    // largest modulus
+    realtype residual;        // max |phi_T(y0) - y0|
+    int n_iter;               // Newton steps taken
+    long n_periods;           // period integrations, an augmented one counting once
+    int converged;
+    solver_stats stats;       // summed over every integration
+} periodic_result;
+
+typedef struct periodic_solver periodic_solver;
+
+periodic_solver *periodic_solver_create(const circuit_model *model, const circuit_solver_options *options);
+void periodic_solver_free(periodic_solver *ps);
+
+// External periodic input in place of parameter param, as circuit_solver_set_input
+void periodic_solver_set_input(periodic_solver *ps, int param, circuit_input_fn fn, void *ctx);
+
+// Find the periodic orbit starting from the guess y (NULL for the model's
+// y0); params may be NULL for the defaults. Returns 0 when converged, 1 when
+// not (result holds the last iterate), -1 on bad options or a singular
+// M - I, or the failing CVODE flag.
+int periodic_solve(periodic_solver *ps, const realtype *params, const realtype *y, const periodic_options *options,
+                   periodic_result *result);
+
+// Sample the trajectory from y0 at n_out >= 2 equally spaced times on
+// [0, period] into out[k * n_species + i]; returns 0 or the failing CVODE flag
+int periodic_solver_sample(periodic_solver *ps, const realtype *params, const realtype *y0,
+                           const periodic_options *options, int n_out, realtype *out);
+
+// Eigenvalues of the n x n column-major matrix a by decreasing modulus,
+// complex pairs next to each other; -1 if the QR iteration does not converge
+int periodic_eigenvalues(int n, const realtype *a, double *re, double *im);
+
+#endif
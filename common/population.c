@@ -0,0 +1,420 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "rng.h"
+#include "population.h"
+#include "ensemble_runner.h"
+
+#define DEFAULT_DIVISION_TIME 30.0
+#define DEFAULT_STEP 0.1
+#define MIN_CYCLE_FRACTION 0.1   // shortest cell cycle, relative to the mean
+
+struct population {
+    const circuit_model *model;
+    const reaction_network *network;
+    population_options options;
+    int n_species, n_params, copy_param;
+    double *params;
+    long n_cells;
+    int n_blocks;
+    bio_real *state;            // species i of cell c at state[i * n_cells + c]
+    int *copies;
+    double *next_division;
+    rng_state *block_rng;       // one stream per block, kept between runs
+    long *block_divisions;
+    double t;
+};
+
+// Per-thread work arrays
+typedef struct {
+    double *p;                  // parameters with the cell's copy number
+    realtype *rp;               // the same as realtype for the circuit_model
+    double *x;                  // state of the current cell
+    double *a;                  // SSA propensities
+    realtype *y, *k1, *k2, *k3, *k4, *tmp;
+} cell_work;
+
+population *population_create(const circuit_model *model, const reaction_network *network, const double *params,
+                              const char *copy_param, long n_cells, const population_options *options) {
+    if ((model == NULL) == (network == NULL) || n_cells <= 0) {
+        fprintf(stderr, "Error in population_create: give one model or network and n_cells > 0\n");
+        return NULL;
+    }
+    population *pop = calloc(1, sizeof(*pop));
+    if (pop == NULL) {
+        return NULL;
+    }
+    pop->model = model;
+    pop->network = network;
+    if (options != NULL) {
+        pop->options = *options;
+    }
+    if (pop->options.division_time <= 0) {
+        pop->options.division_time = DEFAULT_DIVISION_TIME;
+    }
+    if (pop->options.h <= 0) {
+        pop->options.h = DEFAULT_STEP;
+    }
+    pop->n_species = model != NULL ? model->n_species : network->n_species;
+    pop->n_params = model != NULL ? model->n_params : network->n_params;
+    const char *const *names = model != NULL ? model->param_names : network->param_names;
+    pop->copy_param = -1;
+    for (int k = 0; copy_param != NULL && k < pop->n_params; k++) {
+        if (strcmp(names[k], copy_param) == 0) {
+            pop->copy_param = k;
+        }
+    }
+    if (copy_param != NULL && pop->copy_param < 0) {
+        fprintf(stderr, "Error in population_create: unknown parameter %s\n", copy_param);
+        free(pop);
+        return NULL;
+    }
+    pop->n_cells = n_cells;
+    pop->n_blocks = (int)((n_cells + POPULATION_BLOCK - 1) / POPULATION_BLOCK);
+    pop->params = malloc(pop->n_params * sizeof(double));
+    pop->state = calloc((size_t)pop->n_species * n_cells, sizeof(bio_real));
+    pop->copies = malloc(n_cells * sizeof(int));
+    pop->next_division = malloc(n_cells * sizeof(double));
+    pop->block_rng = malloc(pop->n_blocks * sizeof(rng_state));
+    pop->block_divisions = calloc(pop->n_blocks, sizeof(long));
+    if (pop->params == NULL || pop->state == NULL || pop->copies == NULL || pop->next_division == NULL ||
+        pop->block_rng == NULL || pop->block_divisions == NULL) {
+        fprintf(stderr, "Error in population_create: out of memory\n");
+        population_free(pop);
+        return NULL;
+    }
+    for (int k = 0; k < pop->n_params; k++) {
+        if (params != NULL) {
+            pop->params[k] = params[k];
+        } else {
+            pop->params[k] = model != NULL ? model->default_params[k] : network->default_params[k];
+        }
+    }
+    for (int b = 0; b < pop->n_blocks; b++) {
+        rng_seed(&pop->block_rng[b], pop->options.seed, (uint64_t)b);
+    }
+    // One copy each and cell cycle phases spread uniformly
+    for (long c = 0; c < n_cells; c++) {
+        pop->copies[c] = 1;
+        pop->next_division[c] = rng_uniform(&pop->block_rng[c / POPULATION_BLOCK]) * pop->options.division_time;
+    }
+    return pop;
+}
+
+void population_free(population *pop) {
+    if (pop == NULL) {
+        return;
+    }
+    free(pop->params);
+    free(pop->state);
+    free(pop->copies);
+    free(pop->next_division);
+    free(pop->block_rng);
+    free(pop->block_divisions);
+    free(pop);
+}
+
+void population_init_copies(population *pop, const double *weights, int max_copies) {
+    double total = 0;
+    for (int j = 0; j <= max_copies; j++) {
+        total += weights[j] > 0 ? weights[j] : 0;
+    }
+    for (long c = 0; c < pop->n_cells; c++) {
+        double target = rng_uniform(&pop->block_rng[c / POPULATION_BLOCK]) * total, sum = 0;
+        int j = 0;
+        for (; j < max_copies; j++) {
+            sum += weights[j] > 0 ? weights[j] : 0;
+            if (target < sum) {
+                break;
+            }
+        }
+        pop->copies[c] = j;
+    }
+}
+
+void population_set_state(population *pop, const double *x0) {
+    for (int i = 0; i < pop->n_species; i++) {
+        bio_real *xi = pop->state + (size_t)i * pop->n_cells;
+        for (long c = 0; c < pop->n_cells; c++) {
+            xi[c] = (bio_real)x0[i];
+        }
+    }
+}
+
+long population_num_cells(const population *pop) {
+    return pop->n_cells;
+}
+
+int population_num_species(const population *pop) {
+    return pop->n_species;
+}
+
+double population_time(const population *pop) {
+    return pop->t;
+}
+
+const bio_real *population_species(const population *pop, int species) {
+    return pop->state + (size_t)species * pop->n_cells;
+}
+
+const int *population_copies(const population *pop) {
+    return pop->copies;
+}
+
+long population_num_divisions(const population *pop) {
+    long total = 0;
+    for (int b = 0; b < pop->n_blocks; b++) {
+        total += pop->block_divisions[b];
+    }
+    return total;
+}
+
+// Function to draw Binomial(n, 1/2) as the number of set bits in n random bits
+static double binomial_half(rng_state *rng, double n) {
+    long k = (long)n, count = 0;
+    for (; k >= 64; k -= 64) {
+        count += __builtin_popcountll(rng_next(rng));
+    }
+    if (k > 0) {
+        count += __builtin_popcountll(rng_next(rng) >> (64 - k));
+    }
+    return (double)count;
+}
+
+// Function to draw the length of a cell cycle
+static double cycle_length(const population *pop, rng_state *rng) {
+    double T = pop->options.division_time, z = 0;
+    if (pop->options.division_cv > 0) {
+        rng_normals(rng, &z, 1);
+    }
+    double length = T * (1 + pop->options.division_cv * z);
+    return length > MIN_CYCLE_FRACTION * T ? length : MIN_CYCLE_FRACTION * T;
+}
+
+// Function to integrate the deterministic dynamics of one cell from t0 to t1 with RK4
+static void advance_ode(const population *pop, cell_work *w, double t0, double t1) {
+    const circuit_model *m = pop->model;
+    int n = pop->n_species;
+    double mu = log(2.0) / pop->options.division_time;
+    int n_steps = (int)ceil((t1 - t0) / pop->options.h - 1e-9);
+    n_steps = n_steps > 0 ? n_steps : 1;
+    realtype h = (t1 - t0) / n_steps;
+    realtype *y = w->y, *tmp = w->tmp;
+    realtype *k[4] = {w->k1, w->k2, w->k3, w->k4};
+    static const double c[4] = {0.0, 0.5, 0.5, 1.0};
+    for (int i = 0; i < n; i++) {
+        y[i] = w->x[i];
+    }
+    for (int s = 0; s < n_steps; s++) {
+        realtype t = t0 + s * h;
+        for (int stage = 0; stage < 4; stage++) {
+            for (int i = 0; i < n; i++) {
+                tmp[i] = stage == 0 ? y[i] : y[i] + c[stage] * h * k[stage - 1][i];
+            }
+            m->rhs(t + c[stage] * h, tmp, k[stage], w->rp, m->data);
+            for (int i = 0; i < n; i++) {
+                k[stage][i] -= mu * tmp[i];   // growth dilution
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            y[i] += h / 6 * (k[0][i] + 2 * k[1][i] + 2 * k[2][i] + k[3][i]);
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        w->x[i] = y[i];
+    }
+}
+
+// Function to run the exact SSA of one cell from t0 to t1
+static void advance_ssa(const population *pop, cell_work *w, rng_state *rng, double t0, double t1) {
+    const reaction_network *net = pop->network;
+    int n = net->n_species, R = net->n_reactions;
+    double t = t0;
+    for (;;) {
+        net->propensities(w->x, w->a, w->p);
+        double a0 = 0;
+        for (int r = 0; r < R; r++) {
+            w->a[r] = w->a[r] > 0 ? w->a[r] : 0;
+            a0 += w->a[r];
+        }
+        if (a0 <= 0) {
+            return;
+        }
+        t += -log(rng_uniform(rng)) / a0;
+        if (t >= t1) {
+            return;
+        }
+        double target = rng_uniform(rng) * a0, sum = 0;
+        int reaction = R - 1;
+        for (int r = 0; r < R; r++) {
+            sum += w->a[r];
+            if (target < sum) {
+                reaction = r;
+                break;
+            }
+        }
+        const int *S = net->stoich + reaction * n;
+        for (int i = 0; i < n; i++) {
+            w->x[i] += S[i];
+        }
+    }
+}
+
+// Function to advance the cells of block b from t0 to t1, dividing them on the way
+static void advance_block(population *pop, int b, cell_work *w, double t0, double t1) {
+    rng_state *rng = &pop->block_rng[b];
+    int n = pop->n_species;
+    long first = (long)b * POPULATION_BLOCK;
+    long last = first + POPULATION_BLOCK < pop->n_cells ? first + POPULATION_BLOCK : pop->n_cells;
+    for (long c = first; c < last; c++) {
+        for (int i = 0; i < n; i++) {
+            w->x[i] = pop->state[(size_t)i * pop->n_cells + c];
+        }
+        if (pop->copy_param >= 0) {
+            w->p[pop->copy_param] = pop->copies[c];
+            w->rp[pop->copy_param] = pop->copies[c];
+        }
+        double t = t0;
+        while (t < t1) {
+            double t_stop = pop->next_division[c] < t1 ? pop->next_division[c] : t1;
+            if (t_stop > t) {
+                if (pop->model != NULL) {
+                    advance_ode(pop, w, t, t_stop);
+                } else {
+                    advance_ssa(pop, w, rng, t, t_stop);
+                }
+            }
+            t = t_stop;
+            if (pop->next_division[c] <= t1) {
+                // Division: keep one daughter; molecules (SSA) and plasmids split binomially
+                if (pop->network != NULL) {
+                    for (int i = 0; i < n; i++) {
+                        w->x[i] = binomial_half(rng, w->x[i]);
+                    }
+                }
+                if (pop->options.plasmid) {
+                    pop->copies[c] = (int)binomial_half(rng, 2.0 * pop->copies[c]);
+                    if (pop->copy_param >= 0) {
+                        w->p[pop->copy_param] = pop->copies[c];
+                        w->rp[pop->copy_param] = pop->copies[c];
+                    }
+                }
+                pop->next_division[c] += cycle_length(pop, rng);
+                pop->block_divisions[b]++;
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            pop->state[(size_t)i * pop->n_cells + c] = (bio_real)w->x[i];
+        }
+    }
+}
+
+// Function to add the cells of block b to the histograms of one output time
+static void bin_block(const population *pop, int b, const population_histogram *spec, double *hist) {
+    long first = (long)b * POPULATION_BLOCK;
+    long last = first + POPULATION_BLOCK < pop->n_cells ? first + POPULATION_BLOCK : pop->n_cells;
+    int n_binned = spec->n_species > 0 ? spec->n_species : pop->n_species;
+    for (int j = 0; j < n_binned; j++) {
+        int i = spec->species != NULL ? spec->species[j] : j;
+        const bio_real *xi = pop->state + (size_t)i * pop->n_cells;
+        double lo = spec->lower[j], scale = spec->n_bins / (spec->upper[j] - spec->lower[j]);
+        double *h = hist + (size_t)j * spec->n_bins;
+        for (long c = first; c < last; c++) {
+            double position = (xi[c] - lo) * scale;
+            int bin = position < 0 ? 0 : position >= spec->n_bins ? spec->n_bins - 1 : (int)position;
+            h[bin] += 1;
+        }
+    }
+}
+
+typedef struct {
+    population *pop;
+    const double *t_out;
+    int n_out;
+    const population_histogram *spec;
+    double *hist;
+    size_t hist_size;
+    int failed;
+} population_job;
+
+static void population_worker(ensemble_runner *r, int thread, void *arg) {
+    population_job *job = arg;
+    population *pop = job->pop;
+    int n = pop->n_species;
+    int R = pop->network != NULL ? pop->network->n_reactions : 0;
+    cell_work w;
+    w.p = malloc((pop->n_params + n + R) * sizeof(double));
+    w.y = malloc((6 * n + pop->n_params) * sizeof(realtype));
+    double *hist = job->hist != NULL ? calloc(job->hist_size, sizeof(double)) : NULL;
+    int failed = w.p == NULL || w.y == NULL || (job->hist != NULL && hist == NULL);
+    if (!failed) {
+        memcpy(w.p, pop->params, pop->n_params * sizeof(double));
+        w.x = w.p + pop->n_params;
+        w.a = w.x + n;
+        w.k1 = w.y + n;
+        w.k2 = w.k1 + n;
+        w.k3 = w.k2 + n;
+        w.k4 = w.k3 + n;
+        w.tmp = w.k4 + n;
+        w.rp = w.tmp + n;
+        for (int k = 0; k < pop->n_params; k++) {
+            w.rp[k] = pop->params[k];
+        }
+    }
+    size_t per_output = job->hist_size / (job->n_out > 0 ? job->n_out : 1);
+    long b, end;
+    (void)thread;
+    while (!failed && ensemble_runner_next(r, &b, &end)) {
+        double t = pop->t;
+        for (int k = 0; k < job->n_out; k++) {
+            advance_block(pop, b, &w, t, job->t_out[k]);
+            t = job->t_out[k];
+            if (hist != NULL) {
+                bin_block(pop, b, job->spec, hist + k * per_output);
+            }
+        }
+    }
+
+    pthread_mutex_lock(&r->lock);
+    job->failed |= failed;
+    for (size_t k = 0; hist != NULL && k < job->hist_size; k++) {
+        job->hist[k] += hist[k];   // whole cell counts, so the sum does not depend on the order
+    }
+    pthread_mutex_unlock(&r->lock);
+    free(hist);
+    free(w.p);
+    free(w.y);
+}
+
+int population_run(population *pop, const double *t_out, int n_out, const population_histogram *spec,
+                   double *hist, int threads) {
+    for (int k = 0; k < n_out; k++) {
+        if (t_out[k] < (k > 0 ? t_out[k - 1] : pop->t)) {
+            fprintf(stderr, "Error in population_run: output times must increase from the current time\n");
+            return -1;
+        }
+    }
+    population_job job = {0};
+    job.pop = pop;
+    job.t_out = t_out;
+    job.n_out = n_out;
+    job.spec = spec;
+    if (hist != NULL) {
+        int n_binned = spec->n_species > 0 ? spec->n_species : pop->n_species;
+        if (spec->n_bins <= 0) {
+            fprintf(stderr, "Error in population_run: n_bins must be positive\n");
+            return -1;
+        }
+        job.hist = hist;
+        job.hist_size = (size_t)n_out * n_binned * spec->n_bins;
+        memset(hist, 0, job.hist_size * sizeof(double));
+    }
+    ensemble_runner_run(pop->n_blocks, 1, threads, population_worker, &job);
+
+    if (n_out > 0) {
+        pop->t = t_out[n_out - 1];
+    }
+    return job.failed ? -1 : 0;
+}
@@ -0,0 +1,84 @@
+#ifndef POPULATION_H
+#define POPULATION_H
+
+#include <stdint.h>
+#include "circuits.h"
+#include "reaction_network.h"
+#include "bio_real.h"
+
+// Population of growing and dividing cells
+//
+// Every cell carries the state of one circuit, its gene copy number and its
+// next division time, stored as structure-of-arrays (one array per species)
+// so the division, binning and copy-number passes stream through memory;
+// the state is stored as bio_real (float with -DBIO_SINGLE_PRECISION).
+// Cells are processed in blocks of POPULATION_BLOCK on a pool of threads;
+// block b always uses random stream b, so the results do not depend on the
+// number of threads.
+//
+// Intracellular dynamics are either
+//   - deterministic: a circuit_model (circuits.c) integrated with fixed-step
+//     RK4, in concentrations, with growth dilution -mu y added to every
+//     species (mu = ln 2 / division_time), or
+//   - stochastic: a reaction_network (reaction_network.c) simulated with the
+//     exact SSA, in copy numbers; dilution comes from the binomial
+//     partitioning of every species at division.
+// The copy number of a cell replaces the parameter copy_param. It is
+// inherited at division or, for plasmids, doubled and partitioned
+// binomially like the molecules.
+//
+// The number of cells is fixed: at division the cell continues as one of
+// its two daughters, so each slot follows a lineage.
+
+#define POPULATION_BLOCK 1024
+
+typedef struct {
+    double division_time;   // mean cell cycle length, 0 for 30
+    double division_cv;     // coefficient of variation of the cycle length
+    int plasmid;            // 1: copies double and split binomially at division, 0: inherited
+    double h;               // RK4 step of the deterministic dynamics, 0 for 0.1
+    uint64_t seed;
+} population_options;
+
+typedef struct {
+    int n_species;          // number of binned species, 0 for all
+    const int *species;     // their indices, NULL for 0..n_species-1
+    int n_bins;
+    const double *lower;    // per binned species; values outside go to the end bins
+    const double *upper;
+} population_histogram;
+
+typedef struct population population;
+
+// Population of n_cells with the dynamics of model (deterministic) or network (stochastic),
+// exactly one of the two not NULL, parameters params (NULL: the defaults) and the copy number
+// in the parameter named copy_param (NULL: none). All cells start at zero with one copy and
+// uniformly spread cell cycle phases.
+population *population_create(const circuit_model *model, const reaction_network *network, const double *params,
+                              const char *copy_param, long n_cells, const population_options *options);
+void population_free(population *pop);
+
+// Draw every cell's copy number from weights[0..max_copies] (unnormalized)
+void population_init_copies(population *pop, const double *weights, int max_copies);
+
+// Set every cell to the state x0
+void population_set_state(population *pop, const double *x0);
+
+// Advance to each t_out[k] (increasing, not before the current time) on threads threads
+// (<= 0: all CPUs) and, when hist is not NULL, store the number of cells per bin as
+// hist[k][j][bin] for the binned species j. Returns 0 or -1.
+int population_run(population *pop, const double *t_out, int n_out, const population_histogram *spec,
+                   double *hist, int threads);
+
+long population_num_cells(const population *pop);
+int population_num_species(const population *pop);
+double population_time(const population *pop);
+
+// Current values of one species and the copy numbers, one entry per cell
+const bio_real *population_species(const population *pop, int species);
+const int *population_copies(const population *pop);
+
+// Divisions so far
+long population_num_divisions(const population *pop);
+
+#endif
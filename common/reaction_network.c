@@ -0,0 +1,167 @@
+#include <string.h>
+#include <math.h>
+#include "reaction_network.h"
+
+// dichotomous feedback, the reactions of other_circuits/gillespie_dichotomous_feedback.c
+static const char *const df_species[] = {"HK", "HKp", "RR", "RRp", "SR", "SRp", "PH", "Output"};
+static const char *const df_reactions[] = {
+    "HK_production", "HK_degradation", "HK_autophosphorylation", "HKp_to_RR",
+    "HKp_to_SR", "Output_production", "Output_degradation", "HKp_degradation"
+};
+static const char *const df_params[] = {"BETA_HK", "BETA_RR", "BETA_SR", "BETA_PH", "DELTA", "KAP_MAX", "KDA",
+                                        "KT", "KTC", "KP", "KPC", "KOUT_MAX", "KDR", "N", "I"};
+static const double df_defaults[] = {1.0, 1.0, 1.0, 1.0, 0.1, 1.0, 1.0, 0.1, 0.1, 0.1, 0.1, 1.0, 1.0, 2.0, 1.0};
+static const int df_stoich[] = {
+    //  HK HKp  RR RRp  SR SRp  PH Output
+         1,  0,  0,  0,  0,  0,  0,  0,   // Production of HK
+        -1,  0,  0,  0,  0,  0,  0,  0,   // Degradation of HK
+        -1,  1,  0,  0,  0,  0,  0,  0,   // Autophosphorylation of HK
+         0, -1,  0,  1,  0,  0,  0,  0,   // Phosphotransfer from HKp to RR
+         0, -1,  0,  0,  0,  1,  0,  0,   // Phosphotransfer from HKp to SR
+         0,  0,  0,  0,  0,  0,  0,  1,   // Production of Output
+         0,  0,  0,  0,  0,  0,  0, -1,   // Degradation of Output
+         0, -1,  0,  0,  0,  0,  0,  0,   // Degradation of HKp
+};
+
+static void df_propensities(const double *x, double *a, const double *p) {
+    double kap = p[5] * p[14] / (p[14] + p[6]);
+    double r = pow(x[3] / p[12], p[13]);
+
+    a[0] = p[0];                  // Production of HK
+    a[1] = p[4] * x[0];           // Degradation of HK
+    a[2] = kap * x[0];            // Autophosphorylation of HK
+    a[3] = p[7] * x[1] * x[2];    // Phosphotransfer from HKp to RR
+    a[4] = p[8] * x[1] * x[4];    // Phosphotransfer from HKp to SR
+    a[5] = p[11] * r / (r + 1);   // Production of Output
+    a[6] = p[4] * x[7];           // Degradation of Output
+    a[7] = p[4] * x[1];           // Degradation of HKp
+}
+
+// dichotomous feedback with every reaction of the ODE model (df_rhs in circuits.c,
+// other_circuits/dichotomous_feedback_sundials.c), so its deterministic limit is that ODE;
+// the list above is the reduced model of the Gillespie driver
+static const char *const dff_reactions[] = {
+    "HK_production", "HK_degradation", "HK_autophosphorylation", "HKp_degradation",
+    "HKp_to_RR", "HKp_to_SR", "RR_production", "RR_degradation", "RRp_degradation",
+    "RRp_dephosphorylation_HK", "RRp_dephosphorylation_PH", "SR_production", "SR_degradation",
+    "SRp_degradation", "SRp_dephosphorylation_HK", "PH_production", "PH_degradation",
+    "Output_production", "Output_degradation"
+};
+static const int dff_stoich[] = {
+    //  HK HKp  RR RRp  SR SRp  PH Output
+         1,  0,  0,  0,  0,  0,  0,  0,   // Production of HK
+        -1,  0,  0,  0,  0,  0,  0,  0,   // Degradation of HK
+        -1,  1,  0,  0,  0,  0,  0,  0,   // Autophosphorylation of HK
+         0, -1,  0,  0,  0,  0,  0,  0,   // Degradation of HKp
+         1, -1, -1,  1,  0,  0,  0,  0,   // Phosphotransfer HKp + RR -> HK + RRp
+         1, -1,  0,  0, -1,  1,  0,  0,   // Phosphotransfer HKp + SR -> HK + SRp
+         0,  0,  1,  0,  0,  0,  0,  0,   // Production of RR
+         0,  0, -1,  0,  0,  0,  0,  0,   // Degradation of RR
+         0,  0,  0, -1,  0,  0,  0,  0,   // Degradation of RRp
+         0,  0,  1, -1,  0,  0,  0,  0,   // Dephosphorylation of RRp by HK
+         0,  0,  1, -1,  0,  0,  0,  0,   // Dephosphorylation of RRp by PH
+         0,  0,  0,  0,  1,  0,  0,  0,   // Production of SR
+         0,  0,  0,  0, -1,  0,  0,  0,   // Degradation of SR
+         0,  0,  0,  0,  0, -1,  0,  0,   // Degradation of SRp
+         0,  0,  0,  0,  1, -1,  0,  0,   // Dephosphorylation of SRp by HK
+         0,  0,  0,  0,  0,  0,  1,  0,   // Production of PH
+         0,  0,  0,  0,  0,  0, -1,  0,   // Degradation of PH
+         0,  0,  0,  0,  0,  0,  0,  1,   // Production of Output
+         0,  0,  0,  0,  0,  0,  0, -1,   // Degradation of Output
+};
+
+static void dff_propensities(const double *x, double *a, const double *p) {
+    double HK = x[0], HKp = x[1], RR = x[2], RRp = x[3], SR = x[4], SRp = x[5], PH = x[6], Output = x[7];
+    double DELTA = p[4];
+    double kap = p[5] * p[14] / (p[14] + p[6]);
+    double r = pow(RRp / p[12], p[13]);
+
+    a[0] = p[0];
+    a[1] = DELTA * HK;
+    a[2] = kap * HK;
+    a[3] = DELTA * HKp;
+    a[4] = p[7] * HKp * RR;
+    a[5] = p[8] * HKp * SR;
+    a[6] = p[1];
+    a[7] = DELTA * RR;
+    a[8] = DELTA * RRp;
+    a[9] = p[9] * HK * RRp;
+    a[10] = p[10] * PH * RRp;
+    a[11] = p[2];
+    a[12] = DELTA * SR;
+    a[13] = DELTA * SRp;
+    a[14] = p[10] * HK * SRp;
+    a[15] = p[3];
+    a[16] = DELTA * PH;
+    a[17] = p[11] * r / (r + 1);
+    a[18] = DELTA * Output;
+}
+
+// positive autoregulation (3_sticky_switches/positive_autoregulation_bistability.cpp) as a birth-death
+// process; ALPHA is a basal production rate, 0 as in the ODE, which makes the empty state absorbing
+static const char *const par_species[] = {"Protein"};
+static const char *const par_reactions[] = {"Protein_production", "Protein_degradation"};
+static const char *const par_params[] = {"BETA", "GAMMA", "K", "N", "ALPHA"};
+static const double par_defaults[] = {10.0, 1.0, 3.0, 5.0, 0.0};
+static const int par_stoich[] = {
+    1,    // Production of Protein
+    -1,   // Degradation of Protein
+};
+
+static void par_propensities(const double *x, double *a, const double *p) {
+    double xn = pow(x[0], p[3]);
+    a[0] = p[4] + p[0] * xn / (pow(p[2], p[3]) + xn);   // Production of Protein
+    a[1] = p[1] * x[0];                                  // Degradation of Protein
+}
+
+// incoherent feedforward loop dosage compensator (5_feedforward_dosage_compensator/iffl.cpp) in copy numbers;
+// both productions scale with the gene copy number COPY_NUMBER
+static const char *const iffl_species[] = {"X", "Y"};
+static const char *const iffl_reactions[] = {"X_production", "X_degradation", "Y_production", "Y_degradation"};
+static const char *const iffl_params[] = {"PRODUCTION_RATE_X", "DEGRADATION_RATE_X", "PRODUCTION_RATE_Y",
+                                          "DEGRADATION_RATE_Y", "HILL_COEFFICIENT", "COPY_NUMBER"};
+static const double iffl_defaults[] = {0.1, 0.05, 0.1, 0.05, 2.0, 1.0};
+static const int iffl_stoich[] = {
+    //  X   Y
+         1,  0,   // Production of X
+        -1,  0,   // Degradation of X
+         0,  1,   // Production of Y
+         0, -1,   // Degradation of Y
+};
+
+static void iffl_propensities(const double *x, double *a, const double *p) {
+    a[0] = p[0] * p[5];                                // Production of X
+    a[1] = p[1] * x[0];                                // Degradation of X
+    a[2] = p[2] * p[5] / (1 + pow(x[0], p[4]));        // Production of Y, repressed by X
+    a[3] = p[3] * x[1];                                // Degradation of Y
+}
+
+#define N_OF(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+static const reaction_network networks[] = {
+    {"dichotomous_feedback", N_OF(df_species), N_OF(df_reactions), N_OF(df_params), df_species, df_reactions,
+     df_params, df_defaults, df_stoich, df_propensities, 14},
+    {"dichotomous_feedback_full", N_OF(df_species), N_OF(dff_reactions), N_OF(df_params), df_species, dff_reactions,
+     df_params, df_defaults, dff_stoich, dff_propensities, 14},
+    {"positive_autoregulation", N_OF(par_species), N_OF(par_reactions), N_OF(par_params), par_species, par_reactions,
+     par_params, par_defaults, par_stoich, par_propensities, -1},
+    {"iffl", N_OF(iffl_species), N_OF(iffl_reactions), N_OF(iffl_params), iffl_species, iffl_reactions,
+     iffl_params, iffl_defaults, iffl_stoich, iffl_propensities, -1},
+};
+
+int reaction_network_count(void) {
+    return N_OF(networks);
+}
+
+const reaction_network *reaction_network_at(int i) {
+    return i >= 0 && i < N_OF(networks) ? &networks[i] : NULL;
+}
+
+const reaction_network *reaction_network_lookup(const char *name) {
+    for (int i = 0; i < N_OF(networks); i++) {
+        if (strcmp(networks[i].name, name) == 0) {
+            return &networks[i];
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,34 @@
+#ifndef REACTION_NETWORK_H
+#define REACTION_NETWORK_H
+
+// Reaction networks for the stochastic solvers
+//
+// A network is its stoichiometry (the state change of each reaction) and a
+// propensity function of the state and a parameter vector. The exact SSA,
+// the chemical Langevin equation and the other stochastic backends all read
+// the same list, so they simulate the same model.
+
+// Propensities a[0..n_reactions) of state x with parameters p
+typedef void (*reaction_propensity_fn)(const double *x, double *a, const double *p);
+
+typedef struct {
+    const char *name;
+    int n_species;
+    int n_reactions;
+    int n_params;
+    const char *const *species_names;
+    const char *const *reaction_names;
+    const char *const *param_names;
+    const double *default_params;
+    const int *stoich;                   // stoich[r * n_species + i]: change of species i when reaction r fires
+    reaction_propensity_fn propensities;
+    int input_param;                     // index of the external input in p, -1 if none
+} reaction_network;
+
+int reaction_network_count(void);
+const reaction_network *reaction_network_at(int i);
+
+// Network by name, NULL if unknown
+const reaction_network *reaction_network_lookup(const char *name);
+
+#endif
@@ -0,0 +1,357 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include "regime_map.h"
+#include "ensemble_runner.h"
+
+#define DEFAULT_COARSE 8
+#define DEFAULT_MAX_LEVEL 5
+#define PENDING INT32_MIN          // class of a point not classified yet
+#define FAILED_BIT 31              // class mask bit of failed evaluations
+
+// Points live on the lattice of the finest cells, resolution = coarse * 2^max_level per axis
+struct regime_map {
+    int dim;
+    double lower[REGIME_MAP_MAX_DIM], upper[REGIME_MAP_MAX_DIM];
+    int log_scale[REGIME_MAP_MAX_DIM];
+    int coarse, max_level;
+    long resolution;
+    int bits;                      // per coordinate in the hash key
+    long n_points, capacity;
+    uint32_t *coords;              // [n_points][dim]
+    int *cls;
+    uint64_t *table;               // open addressing: key + 1, 0 for empty
+    long *table_index;             // point of each slot
+    long table_size;               // power of two
+    long n_boundary, boundary_capacity;
+    uint32_t *boundary;            // lower corners of the finest boundary cells, [n_boundary][dim]
+};
+
+typedef struct {
+    const regime_map *map;
+    regime_classify_fn classify;
+    void *ctx;
+    long first;                    // item k of the runner is point first + k
+} classify_job;
+
+int regime_map_threads(const regime_map_options *options) {
+    int threads = options != NULL ? options->threads : 0;
+    return threads > 0 ? threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+}
+
+static uint64_t point_key(const regime_map *m, const uint32_t *c) {
+    uint64_t key = 0;
+    for (int i = 0; i < m->dim; i++) {
+        key |= (uint64_t)c[i] << (m->bits * i);
+    }
+    return key;
+}
+
+static uint64_t slot_hash(uint64_t key) {
+    key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ull;
+    key = (key ^ (key >> 27)) * 0x94d049bb133111ebull;
+    return key ^ (key >> 31);
+}
+
+// Function to find the slot of key, or the empty slot where it goes
+static long find_slot(const regime_map *m, uint64_t key) {
+    long mask = m->table_size - 1, slot = (long)(slot_hash(key) & (uint64_t)mask);
+    while (m->table[slot] != 0 && m->table[slot] != key + 1) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// Function to double the hash table; on failure the map keeps its old table
+static int grow_table(regime_map *m) {
+    long old_size = m->table_size;
+    long size = old_size > 0 ? 2 * old_size : 1024;
+    uint64_t *table = calloc(size, sizeof(uint64_t));
+    long *table_index = malloc(size * sizeof(long));
+    if (table == NULL || table_index == NULL) {
+        free(table);
+        free(table_index);
+        return -1;
+    }
+    uint64_t *old_table = m->table;
+    long *old_index = m->table_index;
+    m->table_size = size;
+    m->table = table;
+    m->table_index = table_index;
+    for (long s = 0; s < old_size; s++) {
+        if (old_table[s] != 0) {
+            long slot = find_slot(m, old_table[s] - 1);
+            m->table[slot] = old_table[s];
+            m->table_index[slot] = old_index[s];
+        }
+    }
+    free(old_table);
+    free(old_index);
+    return 0;
+}
+
+// Function to get the point at lattice coordinates c, adding it as pending if new; -1 on failure
+static long add_point(regime_map *m, const uint32_t *c) {
+    if (2 * (m->n_points + 1) > m->table_size && grow_table(m) != 0) {
+        return -1;
+    }
+    uint64_t key = point_key(m, c);
+    long slot = find_slot(m, key);
+    if (m->table[slot] != 0) {
+        return m->table_index[slot];
+    }
+    if (m->n_points == m->capacity) {
+        long capacity = m->capacity > 0 ? 2 * m->capacity : 1024;
+        uint32_t *coords = realloc(m->coords, capacity * m->dim * sizeof(uint32_t));
+        if (coords != NULL) {
+            m->coords = coords;
+        }
+        int *cls = realloc(m->cls, capacity * sizeof(int));
+        if (cls != NULL) {
+            m->cls = cls;
+        }
+        if (coords == NULL || cls == NULL) {
+            return -1;
+        }
+        m->capacity = capacity;
+    }
+    long k = m->n_points++;
+    memcpy(m->coords + k * m->dim, c, m->dim * sizeof(uint32_t));
+    m->cls[k] = PENDING;
+    m->table[slot] = key + 1;
+    m->table_index[slot] = k;
+    return k;
+}
+
+static int lookup_class(const regime_map *m, const uint32_t *c) {
+    long slot = find_slot(m, point_key(m, c));
+    return m->table[slot] != 0 ? m->cls[m->table_index[slot]] : PENDING;
+}
+
+// Function to convert lattice coordinates to parameter values
+static void to_params(const regime_map *m, const uint32_t *c, double *x) {
+    for (int i = 0; i < m->dim; i++) {
+        double u = (double)c[i] / m->resolution;
+        x[i] = m->log_scale[i] ? exp(log(m->lower[i]) + u * (log(m->upper[i]) - log(m->lower[i])))
+                               : m->lower[i] + u * (m->upper[i] - m->lower[i]);
+    }
+}
+
+static void classify_worker(ensemble_runner *r, int thread, void *arg) {
+    classify_job *job = arg;
+    const regime_map *m = job->map;
+    double x[REGIME_MAP_MAX_DIM];
+    long first, last;
+    while (ensemble_runner_next(r, &first, &last)) {
+        for (long k = job->first + first; k < job->first + last; k++) {
+            to_params(m, m->coords + k * m->dim, x);
+            int c = job->classify(x, thread, job->ctx);
+            m->cls[k] = c < 0 ? -1 : c;
+        }
+    }
+}
+
+// Function to classify the points [first, n_points) on threads threads
+static void classify_pending(regime_map *m, long first, int threads, regime_classify_fn classify, void *ctx) {
+    if (first >= m->n_points) {
+        return;
+    }
+    // Classifications are whole solves, so hand them out a few at a time
+    classify_job job = {m, classify, ctx, first};
+    ensemble_runner_run(m->n_points - first, 4, threads, classify_worker, &job);
+}
+
+// Function to get the mask of the classes at the 2^dim corners of the cell with lower corner c and size s
+static unsigned corner_classes(const regime_map *m, const uint32_t *c, uint32_t s) {
+    uint32_t corner[REGIME_MAP_MAX_DIM];
+    unsigned mask = 0;
+    for (int b = 0; b < (1 << m->dim); b++) {
+        for (int i = 0; i < m->dim; i++) {
+            corner[i] = c[i] + ((b >> i) & 1) * s;
+        }
+        int cls = lookup_class(m, corner);
+        mask |= cls >= 0 && cls < FAILED_BIT ? 1u << cls : 1u << FAILED_BIT;
+    }
+    return mask;
+}
+
+// Function to append the cell with lower corner c to a list of cells
+static int push_cell(uint32_t **cells, long *n, long *capacity, const uint32_t *c, int dim) {
+    if (*n == *capacity) {
+        long grown = *capacity > 0 ? 2 * *capacity : 1024;
+        uint32_t *list = realloc(*cells, grown * dim * sizeof(uint32_t));
+        if (list == NULL) {
+            return -1;
+        }
+        *cells = list;
+        *capacity = grown;
+    }
+    memcpy(*cells + *n * dim, c, dim * sizeof(uint32_t));
+    (*n)++;
+    return 0;
+}
+
+regime_map *regime_map_run(int dim, const double *lower, const double *upper, const int *log_scale,
+                           const regime_map_options *options, regime_classify_fn classify, void *ctx) {
+    int coarse = options != NULL && options->coarse > 0 ? options->coarse : DEFAULT_COARSE;
+    int max_level = options != NULL && options->max_level > 0 ? options->max_level : DEFAULT_MAX_LEVEL;
+    int threads = regime_map_threads(options);
+    if (dim < 1 || dim > REGIME_MAP_MAX_DIM) {
+        fprintf(stderr, "Error in regime_map_run: dim must be 1 to %d\n", REGIME_MAP_MAX_DIM);
+        return NULL;
+    }
+    int bits = 64 / dim < 31 ? 64 / dim : 31;
+    if (max_level > 30 || ((long)coarse << max_level) >= (1l << bits)) {
+        fprintf(stderr, "Error in regime_map_run: resolution %d x 2^%d too fine for %d dimensions\n", coarse,
+                max_level, dim);
+        return NULL;
+    }
+    for (int i = 0; i < dim; i++) {
+        if (!(lower[i] < upper[i]) || (log_scale != NULL && log_scale[i] && lower[i] <= 0)) {
+            fprintf(stderr, "Error in regime_map_run: invalid bounds on axis %d\n", i);
+            return NULL;
+        }
+    }
+    regime_map *m = calloc(1, sizeof(*m));
+    if (m == NULL) {
+        return NULL;
+    }
+    m->dim = dim;
+    m->coarse = coarse;
+    m->max_level = max_level;
+    m->resolution = (long)coarse << max_level;
+    m->bits = bits;
+    for (int i = 0; i < dim; i++) {
+        m->lower[i] = lower[i];
+        m->upper[i] = upper[i];
+        m->log_scale[i] = log_scale != NULL && log_scale[i];
+    }
+
+    // Level 0: every cell and corner of the coarse grid
+    uint32_t *cells = NULL, *next = NULL, c[REGIME_MAP_MAX_DIM], p[REGIME_MAP_MAX_DIM];
+    long n_cells = 0, cells_capacity = 0, n_next = 0, next_capacity = 0;
+    int failed = 0;
+    uint32_t size = 1u << max_level;
+    long n_coarse = 1, n_corners = 1;
+    for (int i = 0; i < dim; i++) {
+        n_coarse *= coarse;
+        n_corners *= coarse + 1;
+    }
+    for (long k = 0; k < n_corners && !failed; k++) {
+        long r = k;
+        for (int i = 0; i < dim; i++) {
+            p[i] = (uint32_t)(r % (coarse + 1)) * size;
+            r /= coarse + 1;
+        }
+        failed = add_point(m, p) < 0;
+    }
+    for (long k = 0; k < n_coarse && !failed; k++) {
+        long r = k;
+        for (int i = 0; i < dim; i++) {
+            c[i] = (uint32_t)(r % coarse) * size;
+            r /= coarse;
+        }
+        failed = push_cell(&cells, &n_cells, &cells_capacity, c, dim) != 0;
+    }
+    classify_pending(m, 0, threads, classify, ctx);
+
+    // Split the cells whose corners disagree, one level at a time
+    long n_children = 1, n_new = 1;
+    for (int i = 0; i < dim; i++) {
+        n_children *= 2;
+        n_new *= 3;
+    }
+    for (int level = 0; level <= max_level && !failed; level++) {
+        uint32_t s = size >> level, half = s / 2;
+        long first_pending = m->n_points;
+        n_next = 0;
+        for (long k = 0; k < n_cells && !failed; k++) {
+            const uint32_t *cell = cells + k * dim;
+            unsigned mask = corner_classes(m, cell, s);
+            if ((mask & (mask - 1)) == 0) {
+                continue;   // one class at every corner
+            }
+            if (level == max_level) {
+                failed = push_cell(&m->boundary, &m->n_boundary, &m->boundary_capacity, cell, dim) != 0;
+                continue;
+            }
+            for (long b = 0; b < n_children && !failed; b++) {
+                for (int i = 0; i < dim; i++) {
+                    c[i] = cell[i] + ((b >> i) & 1) * half;
+                }
+                failed = push_cell(&next, &n_next, &next_capacity, c, dim) != 0;
+            }
+            for (long t = 0; t < n_new && !failed; t++) {
+                long r = t;
+                for (int i = 0; i < dim; i++) {
+                    p[i] = cell[i] + (uint32_t)(r % 3) * half;
+                    r /= 3;
+                }
+                failed = add_point(m, p) < 0;
+            }
+        }
+        classify_pending(m, first_pending, threads, classify, ctx);
+        uint32_t *swap = cells;
+        cells = next;
+        next = swap;
+        long swap_capacity = cells_capacity;
+        cells_capacity = next_capacity;
+        next_capacity = swap_capacity;
+        n_cells = n_next;
+    }
+    free(cells);
+    free(next);
+    if (failed) {
+        fprintf(stderr, "Error in regime_map_run: out of memory\n");
+        regime_map_free(m);
+        return NULL;
+    }
+    return m;
+}
+
+void regime_map_free(regime_map *m) {
+    if (m == NULL) {
+        return;
+    }
+    free(m->coords);
+    free(m->cls);
+    free(m->table);
+    free(m->table_index);
+    free(m->boundary);
+    free(m);
+}
+
+long regime_map_num_evaluations(const regime_map *m) {
+    return m->n_points;
+}
+
+double regime_map_uniform_evaluations(const regime_map *m) {
+    return pow((double)m->resolution + 1, m->dim);
+}
+
+long regime_map_num_boundary(const regime_map *m) {
+    return m->n_boundary;
+}
+
+void regime_map_boundary_cell(const regime_map *m, long k, double *lo, double *hi, unsigned *classes) {
+    const uint32_t *c = m->boundary + k * m->dim;
+    uint32_t upper[REGIME_MAP_MAX_DIM];
+    for (int i = 0; i < m->dim; i++) {
+        upper[i] = c[i] + 1;
+    }
+    to_params(m, c, lo);
+    to_params(m, upper, hi);
+    if (classes != NULL) {
+        *classes = corner_classes(m, c, 1);
+    }
+}
+
+void regime_map_point(const regime_map *m, long k, double *x, int *cls) {
+    to_params(m, m->coords + k * m->dim, x);
+    if (cls != NULL) {
+        *cls = m->cls[k];
+    }
+}
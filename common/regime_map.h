@@ -0,0 +1,56 @@
+#ifndef REGIME_MAP_H
+#define REGIME_MAP_H
+
+// Adaptive mapping of regime boundaries in parameter space
+//
+// A box of 1 to 6 parameters (optionally log-scaled per axis) is covered by
+// a coarse grid of cells. Every corner is classified (e.g. monostable or
+// bistable, pulse or no pulse) and a cell whose corners disagree is split
+// into 2^dim children (a quadtree in 2D, an octree in 3D, ...), down to
+// max_level halvings; cells whose corners agree are not refined. The
+// boundary is the set of finest cells whose corners disagree.
+//
+// The tree is refined one level at a time: the new corners of all cells
+// split at a level are collected (corners shared between cells are
+// classified once, through a hash table of lattice points) and classified
+// as one batch on a pool of threads. The result does not depend on the
+// number of threads. Features smaller than a coarse cell that do not touch
+// any of its corners are not seen, so the coarse grid sets the smallest
+// region that is guaranteed to be found.
+
+#define REGIME_MAP_MAX_DIM 6
+
+// Class of the point x (in parameter units) on worker thread thread (0..threads-1);
+// a negative value marks a failed evaluation, which counts as a class of its own
+typedef int (*regime_classify_fn)(const double *x, int thread, void *ctx);
+
+typedef struct {
+    int coarse;              // cells per axis of the initial grid, 0 for 8
+    int max_level;           // halvings below the coarse grid, 0 for 5
+    int threads;             // <= 0: all CPUs
+} regime_map_options;
+
+typedef struct regime_map regime_map;
+
+// Map the box [lower, upper] of dim parameters; log_scale (NULL: none) marks the axes
+// refined in log space. Returns NULL on invalid input.
+regime_map *regime_map_run(int dim, const double *lower, const double *upper, const int *log_scale,
+                           const regime_map_options *options, regime_classify_fn classify, void *ctx);
+void regime_map_free(regime_map *m);
+
+// Number of threads the classifier is called from, for sizing per-thread state before the run
+int regime_map_threads(const regime_map_options *options);
+
+// Classified points and the number a uniform grid at the finest resolution would need
+long regime_map_num_evaluations(const regime_map *m);
+double regime_map_uniform_evaluations(const regime_map *m);
+
+// Finest cells on the boundary: bounds in parameter units and the bit mask of the
+// corner classes (bit c for class c, bit 31 for failures)
+long regime_map_num_boundary(const regime_map *m);
+void regime_map_boundary_cell(const regime_map *m, long k, double *lo, double *hi, unsigned *classes);
+
+// Every classified point, in the order of classification
+void regime_map_point(const regime_map *m, long k, double *x, int *cls);
+
+#endif
@@ -0,0 +1,412 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "result_cache.h"
+
+#define CACHE_MAGIC "BCRC"
+#define CACHE_FORMAT 1
+#define CACHE_SHARDS 256
+#define DEFAULT_MAX_BYTES (1024ull << 20)
+#define STALE_TEMP_SECONDS 3600   // temporary files left by a crashed writer
+#define EVICT_TO_FRACTION 0.875   // a sweep evicts down to this share of max_bytes
+
+typedef struct {
+    char magic[4];
+    uint32_t format;
+    uint64_t key_bytes;
+    uint64_t value_bytes;
+    uint64_t checksum;            // hash of the value
+} entry_header;
+
+struct result_cache {
+    char *dir;
+    uint64_t max_bytes;
+    long hits, misses, stores;
+    long next_temp;               // names the temporary files of this handle
+    // Bytes per shard as of the last sweep plus this handle's insertions since
+    uint64_t shard_bytes[CACHE_SHARDS];
+    uint64_t total_bytes;
+    int scanned;                  // totals are known (a first sweep has run)
+    pthread_mutex_t lock;
+    pthread_mutex_t sweep_lock;   // one sweep at a time
+};
+
+static uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static uint64_t mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// Function to hash n bytes to 128 bits: four independent multiply-rotate lanes over 32-byte
+// stripes, so the multiplications overlap, folded and finalized with the splitmix64 mixer
+static void hash128(const unsigned char *p, size_t n, uint64_t h[2]) {
+    const uint64_t k0 = 0x9e3779b97f4a7c15ull, k1 = 0xbf58476d1ce4e5b9ull, k2 = 0x94d049bb133111ebull;
+    uint64_t lane[4] = {k0 ^ n, k1 + n, k2 ^ (n << 1), k0 + k1}, w;
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        for (int j = 0; j < 4; j++) {
+            memcpy(&w, p + i + 8 * j, 8);
+            lane[j] = rotl(lane[j] ^ (w * k1), 31) * k2;
+        }
+    }
+    for (int j = 0; i < n; i += 8, j++) {
+        w = 0;
+        memcpy(&w, p + i, n - i < 8 ? n - i : 8);
+        lane[j] = rotl(lane[j] ^ (w * k1), 31) * k2;
+    }
+    h[0] = mix(lane[0] ^ rotl(lane[1], 17) ^ mix(lane[2]) ^ rotl(lane[3], 41));
+    h[1] = mix(lane[1] + rotl(lane[2], 23) + mix(lane[3] ^ h[0]) + lane[0]);
+}
+
+result_cache *result_cache_open(const char *dir, uint64_t max_bytes) {
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Error creating the cache directory %s\n", dir);
+        return NULL;
+    }
+    result_cache *c = calloc(1, sizeof(*c));
+    if (c == NULL || (c->dir = strdup(dir)) == NULL) {
+        free(c);
+        return NULL;
+    }
+    c->max_bytes = max_bytes > 0 ? max_bytes : DEFAULT_MAX_BYTES;
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_mutex_init(&c->sweep_lock, NULL);
+    return c;
+}
+
+void result_cache_close(result_cache *c) {
+    if (c == NULL) {
+        return;
+    }
+    pthread_mutex_destroy(&c->lock);
+    pthread_mutex_destroy(&c->sweep_lock);
+    free(c->dir);
+    free(c);
+}
+
+static result_cache *default_cache;
+static pthread_once_t default_once = PTHREAD_ONCE_INIT;
+
+static void open_default(void) {
+    const char *dir = getenv("BIOCIRCUITS_CACHE");
+    const char *mb = getenv("BIOCIRCUITS_CACHE_MB");
+    if (dir != NULL && dir[0] != '\0') {
+        default_cache = result_cache_open(dir, mb != NULL ? (uint64_t)atol(mb) << 20 : 0);
+    }
+}
+
+result_cache *result_cache_default(void) {
+    pthread_once(&default_once, open_default);
+    return default_cache;
+}
+
+void result_cache_key_init(result_cache_key *key) {
+    key->bytes = NULL;
+    key->n_bytes = 0;
+    key->capacity = 0;
+}
+
+void result_cache_key_free(result_cache_key *key) {
+    free(key->bytes);
+    result_cache_key_init(key);
+}
+
+void result_cache_key_add(result_cache_key *key, const void *data, size_t n_bytes) {
+    if (key->capacity == SIZE_MAX) {
+        return;
+    }
+    if (key->n_bytes + n_bytes > key->capacity) {
+        size_t capacity = key->capacity > 0 ? 2 * key->capacity : 256;
+        while (capacity < key->n_bytes + n_bytes) {
+            capacity *= 2;
+        }
+        unsigned char *bytes = realloc(key->bytes, capacity);
+        if (bytes == NULL) {
+            // An incomplete key must never match: leave it empty, which every lookup misses
+            free(key->bytes);
+            key->bytes = NULL;
+            key->n_bytes = 0;
+            key->capacity = SIZE_MAX;
+            return;
+        }
+        key->bytes = bytes;
+        key->capacity = capacity;
+    }
+    memcpy(key->bytes + key->n_bytes, data, n_bytes);
+    key->n_bytes += n_bytes;
+}
+
+void result_cache_key_add_string(result_cache_key *key, const char *s) {
+    size_t n = strlen(s);
+    result_cache_key_add_int(key, (long)n);
+    result_cache_key_add(key, s, n);
+}
+
+void result_cache_key_add_double(result_cache_key *key, double x) {
+    result_cache_key_add(key, &x, sizeof(x));
+}
+
+void result_cache_key_add_int(result_cache_key *key, long x) {
+    int64_t v = x;
+    result_cache_key_add(key, &v, sizeof(v));
+}
+
+// Function to format DIR/xx/<hash> (shard only when name is 0)
+static void entry_path(const result_cache *c, const uint64_t h[2], int name, char *path, size_t size) {
+    if (name) {
+        snprintf(path, size, "%s/%02x/%016llx%016llx", c->dir, (unsigned)(h[0] >> 56),
+                 (unsigned long long)h[0], (unsigned long long)h[1]);
+    } else {
+        snprintf(path, size, "%s/%02x", c->dir, (unsigned)(h[0] >> 56));
+    }
+}
+
+static void count(result_cache *c, long *counter) {
+    pthread_mutex_lock(&c->lock);
+    (*counter)++;
+    pthread_mutex_unlock(&c->lock);
+}
+
+int result_cache_get(result_cache *c, const result_cache_key *key, void *out, size_t n_bytes) {
+    if (c == NULL || key->n_bytes == 0) {
+        return -1;
+    }
+    uint64_t h[2];
+    char path[4096];
+    hash128(key->bytes, key->n_bytes, h);
+    entry_path(c, h, 1, path, sizeof(path));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        count(c, &c->misses);
+        return -1;
+    }
+    int hit = 0;
+    struct stat st;
+    size_t size = sizeof(entry_header) + key->n_bytes + n_bytes;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size == size) {
+        const unsigned char *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        if (map != MAP_FAILED) {
+            entry_header header;
+            memcpy(&header, map, sizeof(header));
+            const unsigned char *value = map + sizeof(header) + key->n_bytes;
+            uint64_t check[2];
+            if (memcmp(header.magic, CACHE_MAGIC, 4) == 0 && header.format == CACHE_FORMAT &&
+                header.key_bytes == key->n_bytes && header.value_bytes == n_bytes &&
+                memcmp(map + sizeof(header), key->bytes, key->n_bytes) == 0) {
+                hash128(value, n_bytes, check);
+                if (check[0] == header.checksum) {
+                    memcpy(out, value, n_bytes);
+                    hit = 1;
+                }
+            }
+            munmap((void *)map, size);
+        }
+    }
+    if (hit) {
+        futimens(fd, NULL);   // most recently used
+    }
+    close(fd);
+    count(c, hit ? &c->hits : &c->misses);
+    return hit ? 0 : -1;
+}
+
+typedef struct {
+    char name[64];
+    int shard;
+    struct timespec mtime;
+    off_t size;
+} shard_entry;
+
+static int compare_mtime(const void *a, const void *b) {
+    const shard_entry *x = a, *y = b;
+    if (x->mtime.tv_sec != y->mtime.tv_sec) {
+        return (x->mtime.tv_sec > y->mtime.tv_sec) - (x->mtime.tv_sec < y->mtime.tv_sec);
+    }
+    return (x->mtime.tv_nsec > y->mtime.tv_nsec) - (x->mtime.tv_nsec < y->mtime.tv_nsec);
+}
+
+// Function to list the entries of one shard into *entries, removing stale temporary files;
+// returns -1 when the list cannot grow
+static int scan_shard(const result_cache *c, int shard, shard_entry **entries, size_t *n, size_t *capacity,
+                      uint64_t *bytes) {
+    char dir[4096], path[4096 + 64];
+    snprintf(dir, sizeof(dir), "%s/%02x", c->dir, (unsigned)shard);
+    *bytes = 0;
+    DIR *d = opendir(dir);
+    if (d == NULL) {
+        return 0;
+    }
+    time_t now = time(NULL);
+    int status = 0;
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        struct stat st;
+        if (strlen(e->d_name) >= sizeof((*entries)->name) || strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+        if (stat(path, &st) != 0) {
+            continue;
+        }
+        if (e->d_name[0] == '.') {
+            if (now - st.st_mtime > STALE_TEMP_SECONDS) {
+                unlink(path);
+            }
+            continue;
+        }
+        if (*n == *capacity) {
+            size_t grown_capacity = *capacity > 0 ? 2 * *capacity : 256;
+            shard_entry *grown = realloc(*entries, grown_capacity * sizeof(shard_entry));
+            if (grown == NULL) {
+                status = -1;
+                break;
+            }
+            *entries = grown;
+            *capacity = grown_capacity;
+        }
+        shard_entry *entry = &(*entries)[(*n)++];
+        strcpy(entry->name, e->d_name);
+        entry->shard = shard;
+        entry->mtime = st.st_mtim;
+        entry->size = st.st_size;
+        *bytes += st.st_size;
+    }
+    closedir(d);
+    return status;
+}
+
+// Function to recount every shard and, when the cache is over max_bytes, evict the least
+// recently used entries across all shards down to EVICT_TO_FRACTION of it; the entry
+// keep (shard, name) was just written and is never evicted
+static void sweep(result_cache *c, int keep_shard, const char *keep_name) {
+    if (pthread_mutex_trylock(&c->sweep_lock) != 0) {
+        return;   // another thread is sweeping
+    }
+    shard_entry *entries = NULL;
+    size_t n = 0, capacity = 0;
+    uint64_t shard_bytes[CACHE_SHARDS], total = 0;
+    int complete = 1;
+    for (int k = 0; k < CACHE_SHARDS; k++) {
+        if (scan_shard(c, k, &entries, &n, &capacity, &shard_bytes[k]) != 0) {
+            complete = 0;
+        }
+        total += shard_bytes[k];
+    }
+
+    if (complete && total > c->max_bytes) {
+        uint64_t target = (uint64_t)(c->max_bytes * EVICT_TO_FRACTION);
+        char path[4096 + 64];
+        qsort(entries, n, sizeof(shard_entry), compare_mtime);
+        for (size_t k = 0; k < n && total > target; k++) {
+            if (entries[k].shard == keep_shard && strcmp(entries[k].name, keep_name) == 0) {
+                continue;
+            }
+            snprintf(path, sizeof(path), "%s/%02x/%s", c->dir, (unsigned)entries[k].shard, entries[k].name);
+            if (unlink(path) == 0) {
+                shard_bytes[entries[k].shard] -= entries[k].size;
+                total -= entries[k].size;
+            }
+        }
+    }
+    free(entries);
+
+    if (complete) {
+        pthread_mutex_lock(&c->lock);
+        memcpy(c->shard_bytes, shard_bytes, sizeof(shard_bytes));
+        c->total_bytes = total;
+        c->scanned = 1;
+        pthread_mutex_unlock(&c->lock);
+    }
+    pthread_mutex_unlock(&c->sweep_lock);
+}
+
+int result_cache_put(result_cache *c, const result_cache_key *key, const void *data, size_t n_bytes) {
+    if (c == NULL || key->n_bytes == 0) {
+        return -1;
+    }
+    uint64_t h[2], check[2];
+    char shard[4096], path[4096], temp[4096 + 64];
+    hash128(key->bytes, key->n_bytes, h);
+    hash128(data, n_bytes, check);
+    entry_path(c, h, 0, shard, sizeof(shard));
+    entry_path(c, h, 1, path, sizeof(path));
+    if (mkdir(shard, 0755) != 0 && errno != EEXIST) {
+        return -1;
+    }
+    pthread_mutex_lock(&c->lock);
+    long serial = c->next_temp++;
+    pthread_mutex_unlock(&c->lock);
+    snprintf(temp, sizeof(temp), "%s/.tmp-%ld-%lx-%ld", shard, (long)getpid(), (unsigned long)pthread_self(), serial);
+
+    // Write a private file and rename it into place, so readers never see a partial entry
+    struct stat old;
+    uint64_t replaced = stat(path, &old) == 0 ? (uint64_t)old.st_size : 0;
+    int fd = open(temp, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    entry_header header = {{'B', 'C', 'R', 'C'}, CACHE_FORMAT, key->n_bytes, n_bytes, check[0]};
+    const void *parts[3] = {&header, key->bytes, data};
+    size_t sizes[3] = {sizeof(header), key->n_bytes, n_bytes};
+    int ok = 1;
+    for (int p = 0; p < 3 && ok; p++) {
+        const char *q = parts[p];
+        size_t left = sizes[p];
+        while (left > 0) {
+            ssize_t written = write(fd, q, left);
+            if (written <= 0) {
+                ok = 0;
+                break;
+            }
+            q += written;
+            left -= (size_t)written;
+        }
+    }
+    if (close(fd) != 0 || !ok || rename(temp, path) != 0) {
+        unlink(temp);
+        return -1;
+    }
+
+    // Account for the entry and sweep only when the cache is over its limit
+    int k = (int)(h[0] >> 56);
+    uint64_t size = sizes[0] + sizes[1] + sizes[2];
+    pthread_mutex_lock(&c->lock);
+    c->stores++;
+    c->shard_bytes[k] += size;
+    c->total_bytes += size;
+    // Another process may have evicted behind our totals; never let them wrap
+    c->shard_bytes[k] -= replaced < c->shard_bytes[k] ? replaced : c->shard_bytes[k];
+    c->total_bytes -= replaced < c->total_bytes ? replaced : c->total_bytes;
+    int over = !c->scanned || c->total_bytes > c->max_bytes;
+    pthread_mutex_unlock(&c->lock);
+    if (over) {
+        sweep(c, k, strrchr(path, '/') + 1);
+    }
+    return 0;
+}
+
+void result_cache_counts(const result_cache *c, long *hits, long *misses, long *stores) {
+    pthread_mutex_lock((pthread_mutex_t *)&c->lock);
+    if (hits != NULL) {
+        *hits = c->hits;
+    }
+    if (misses != NULL) {
+        *misses = c->misses;
+    }
+    if (stores != NULL) {
+        *stores = c->stores;
+    }
+    pthread_mutex_unlock((pthread_mutex_t *)&c->lock);
+}
@@ -0,0 +1,62 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// On-disk cache of simulation results, addressed by their inputs
+//
+// A key is the byte string of everything a result depends on (model name and
+// version, parameters, y0, tolerances, time grid, ...), built with the
+// result_cache_key_add* calls. Its 128-bit hash names one file,
+// DIR/xx/<32 hex digits>, holding the full key and the result, so a hash
+// collision is detected and reads as a miss. Hits are served by mapping the
+// file and copying the result out, with no integration.
+//
+// Several processes and threads may share a directory: an entry is written
+// to a private temporary file and renamed into place, so readers see either
+// no entry or a complete one, and an entry unlinked while mapped stays
+// readable. Every hit refreshes the file's modification time. A handle keeps
+// per-shard (xx) byte totals, counted by a sweep of the directory on its first
+// insertion and updated by each insertion after. When the total goes over
+// max_bytes, a new sweep recounts all shards and evicts the least recently
+// used entries across them (LRU) down to 7/8 of max_bytes, never the entry
+// just written. Insertions by other processes are only seen at a sweep.
+//
+// When the environment variable BIOCIRCUITS_CACHE names a directory,
+// result_cache_default() returns a process-wide cache there, limited to
+// BIOCIRCUITS_CACHE_MB megabytes (default 1024).
+
+typedef struct result_cache result_cache;
+
+typedef struct {
+    unsigned char *bytes;
+    size_t n_bytes;
+    size_t capacity;
+} result_cache_key;
+
+// Open (and create) the cache directory; max_bytes 0 for 1 GiB
+result_cache *result_cache_open(const char *dir, uint64_t max_bytes);
+void result_cache_close(result_cache *c);
+
+// Process-wide cache from BIOCIRCUITS_CACHE, NULL when unset; do not close it
+result_cache *result_cache_default(void);
+
+void result_cache_key_init(result_cache_key *key);
+void result_cache_key_free(result_cache_key *key);
+void result_cache_key_add(result_cache_key *key, const void *data, size_t n_bytes);
+void result_cache_key_add_string(result_cache_key *key, const char *s);
+void result_cache_key_add_double(result_cache_key *key, double x);
+void result_cache_key_add_int(result_cache_key *key, long x);
+
+// Copy the result stored under key into out, which holds n_bytes; 0 on a hit, -1 on a miss
+// (including a stored result of another size)
+int result_cache_get(result_cache *c, const result_cache_key *key, void *out, size_t n_bytes);
+
+// Store n_bytes of data under key; returns 0 or -1 (the cache is then simply not filled)
+int result_cache_put(result_cache *c, const result_cache_key *key, const void *data, size_t n_bytes);
+
+// Hits, misses and insertions through this handle
+void result_cache_counts(const result_cache *c, long *hits, long *misses, long *stores);
+
+#endif
@@ -0,0 +1,34 @@
+#include <math.h>
+#include "rng.h"
+
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+void rng_seed(rng_state *rng, uint64_t seed, uint64_t stream) {
+    // Mix the stream in first so neighbouring streams start far apart
+    uint64_t x = seed ^ splitmix64(&stream);
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = splitmix64(&x);
+    }
+}
+
+void rng_normals(rng_state *rng, double *z, int n) {
+    int pairs = n / 2;
+    for (int i = 0; i < 2 * pairs; i++) {
+        z[i] = rng_uniform(rng);
+    }
+    for (int i = 0; i < pairs; i++) {
+        double r = sqrt(-2.0 * log(z[2 * i]));
+        double theta = 2.0 * M_PI * z[2 * i + 1];
+        z[2 * i] = r * cos(theta);
+        z[2 * i + 1] = r * sin(theta);
+    }
+    if (n % 2) {
+        double u1 = rng_uniform(rng), u2 = rng_uniform(rng);
+        z[n - 1] = sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+    }
+}
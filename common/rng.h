@@ -0,0 +1,46 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// Random numbers for the stochastic solvers
+//
+// xoshiro256** with the state seeded by splitmix64 from (seed, stream), so
+// run k of an ensemble always gets stream k and the results do not depend
+// on how runs are spread over threads. One generator per thread.
+
+typedef struct {
+    uint64_t s[4];
+} rng_state;
+
+// Seed the generator for one stream (e.g. the run index) of a seed
+void rng_seed(rng_state *rng, uint64_t seed, uint64_t stream);
+
+static inline uint64_t rng_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+// Next 64 random bits
+static inline uint64_t rng_next(rng_state *rng) {
+    uint64_t *s = rng->s;
+    uint64_t result = rng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rng_rotl(s[3], 45);
+    return result;
+}
+
+// Uniform in (0, 1), never exactly 0 or 1 (safe for log)
+static inline double rng_uniform(rng_state *rng) {
+    return ((rng_next(rng) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+// Fill z[0..n) with standard normals; the uniforms are drawn first and the
+// Box-Muller transform runs as a separate loop over the block, so it vectorizes
+void rng_normals(rng_state *rng, double *z, int n);
+
+#endif
@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "circuit_solver.h"
+#include "rng.h"
+#include "screen.h"
+#include "ensemble_runner.h"
+
+#define SCREEN_BLOCK 8                // candidates per block of work
+#define SCREEN_SEGMENTS 10            // coarse grid segments checked for settling
+#define DEFAULT_AUDIT_FRACTION 0.02
+#define FINE_DT 0.1
+
+typedef struct {
+    const screen_problem *problem;
+    screen_candidate *candidates;
+    const screen_fidelity *fidelity;  // of the current stage
+    int fine;
+    const double *times;
+    const realtype *t_out;
+    const long *indices;              // candidates of the current stage
+    long n_indices;
+    long n_done;                      // under the runner's lock
+} screen_job;
+
+// Per-thread solver and buffers
+typedef struct {
+    circuit_solver *solver;
+    realtype *y0, *out;
+} screen_work;
+
+// Function to check that out[start..end] stays within the settling tolerance of out[end]
+static int settled(const realtype *out, int n, int start, int end, const screen_fidelity *f) {
+    const realtype *last = out + (size_t)end * n;
+    for (int k = start; k < end; k++) {
+        for (int i = 0; i < n; i++) {
+            if (fabs(out[(size_t)k * n + i] - last[i]) > f->settle_tol * fabs(last[i]) + f->atol) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// Function to solve one candidate at the stage's fidelity, in segments when it may stop early; returns 0 or the CVODE flag
+static int solve(screen_job *job, screen_work *w, const realtype *params, long *rhs_evals) {
+    const screen_fidelity *f = job->fidelity;
+    int n = job->problem->model->n_species, N = f->n_times;
+    int segment = f->settle_tol > 0 ? (N - 1 + SCREEN_SEGMENTS - 1) / SCREEN_SEGMENTS : N - 1;
+    const realtype *y0 = job->problem->y0 != NULL ? job->problem->y0 : job->problem->model->default_y0;
+    memcpy(w->y0, y0, n * sizeof(realtype));
+    *rhs_evals = 0;
+    for (int start = 0; start < N - 1;) {
+        int end = start + segment < N - 1 ? start + segment : N - 1;
+        int flag = circuit_solver_run(w->solver, params, w->y0, job->t_out + start, end - start + 1,
+                                      w->out + (size_t)start * n);
+        *rhs_evals += circuit_solver_stats(w->solver)->n_rhs_evals;
+        if (flag != 0) {
+            return flag;
+        }
+        memcpy(w->y0, w->out + (size_t)end * n, n * sizeof(realtype));
+        if (f->settle_tol > 0 && end < N - 1 && settled(w->out, n, start, end, f)) {
+            for (int k = end + 1; k < N; k++) {
+                memcpy(w->out + (size_t)k * n, w->y0, n * sizeof(realtype));
+            }
+            break;
+        }
+        start = end;
+    }
+    return 0;
+}
+
+static void screen_worker(ensemble_runner *r, int thread, void *arg) {
+    screen_job *job = arg;
+    const screen_problem *pr = job->problem;
+    const screen_fidelity *f = job->fidelity;
+    int n = pr->model->n_species;
+    circuit_solver_options so = {f->rtol, f->atol, 0, f->method};
+    screen_work w = {circuit_solver_create(pr->model, &so), NULL, NULL};
+    w.y0 = malloc(sizeof(realtype) * n * (1 + (size_t)f->n_times));
+    if (w.solver == NULL || w.y0 == NULL) {
+        fprintf(stderr, "Error in screen: cannot create the solver\n");
+        circuit_solver_free(w.solver);
+        free(w.y0);
+        return;
+    }
+    w.out = w.y0 + n;
+    long first, end;
+    (void)thread;
+    while (ensemble_runner_next(r, &first, &end)) {
+        for (long b = first; b < end; b++) {
+            long c = job->indices != NULL ? job->indices[b] : b;
+            screen_candidate *cand = &job->candidates[c];
+            long rhs_evals;
+            double score = NAN;
+            if (solve(job, &w, pr->params + (size_t)c * pr->model->n_params, &rhs_evals) == 0) {
+                score = pr->score(job->times, f->n_times, w.out, n, pr->score_ctx);
+            }
+            if (job->fine) {
+                cand->fine_score = score;
+                cand->fine_rhs_evals = rhs_evals;
+                cand->hit = score >= pr->threshold;
+            } else {
+                cand->coarse_score = score;
+                cand->coarse_rhs_evals = rhs_evals;
+            }
+        }
+        pthread_mutex_lock(&r->lock);
+        job->n_done += end - first;
+        pthread_mutex_unlock(&r->lock);
+    }
+    circuit_solver_free(w.solver);
+    free(w.y0);
+}
+
+// Function to run one stage over the given candidates on the thread pool; returns 0 or -1
+static int run_stage(screen_job *job, int threads) {
+    job->n_done = 0;
+    ensemble_runner_run(job->n_indices, SCREEN_BLOCK, threads, screen_worker, job);
+    return job->n_done == job->n_indices ? 0 : -1;
+}
+
+// Function to fill the unset fields of a fidelity
+static void fidelity_defaults(screen_fidelity *f, realtype rtol, realtype atol, int n_times, double settle_tol) {
+    if (f->rtol <= 0) {
+        f->rtol = rtol;
+    }
+    if (f->atol <= 0) {
+        f->atol = atol;
+    }
+    if (f->n_times < 2) {
+        f->n_times = n_times < 2 ? 2 : n_times;
+    }
+    if (f->settle_tol == 0) {
+        f->settle_tol = settle_tol;
+    }
+}
+
+// Function to build the time grid of a fidelity
+static int time_grid(const screen_problem *pr, const screen_fidelity *f, double **times, realtype **t_out) {
+    *times = malloc(sizeof(double) * f->n_times);
+    *t_out = malloc(sizeof(realtype) * f->n_times);
+    if (*times == NULL || *t_out == NULL) {
+        return -1;
+    }
+    for (int k = 0; k < f->n_times; k++) {
+        (*times)[k] = pr->t0 + (pr->t_end - pr->t0) * k / (f->n_times - 1);
+        (*t_out)[k] = (*times)[k];
+    }
+    return 0;
+}
+
+// Function to find the one-sided upper bound p of a binomial rate with P(X <= k | n, p) = 1 - level
+static double binomial_upper(long k, long n, double level) {
+    if (n == 0 || k >= n) {
+        return 1;
+    }
+    double lo = (double)k / n, hi = 1;
+    for (int it = 0; it < 60; it++) {
+        double p = 0.5 * (lo + hi), cdf = 0;
+        for (long j = 0; j <= k; j++) {
+            cdf += exp(lgamma(n + 1.0) - lgamma(j + 1.0) - lgamma(n - j + 1.0) + j * log(p) + (n - j) * log1p(-p));
+        }
+        if (cdf > 1 - level) {
+            lo = p;
+        } else {
+            hi = p;
+        }
+    }
+    return 0.5 * (lo + hi);
+}
+
+int screen_run(const screen_problem *problem, const screen_options *options, screen_candidate *candidates,
+               screen_summary *summary) {
+    const screen_problem *pr = problem;
+    if (pr->model == NULL || pr->score == NULL || pr->params == NULL || pr->n_candidates < 0 ||
+        !(pr->t_end > pr->t0)) {
+        fprintf(stderr, "Error in screen: invalid problem\n");
+        return -1;
+    }
+    screen_options o = {0};
+    if (options != NULL) {
+        o = *options;
+    }
+    fidelity_defaults(&o.coarse, 1e-3, 1e-6, 51, 1e-3);
+    fidelity_defaults(&o.fine, 1e-4, 1e-8, (int)lround((pr->t_end - pr->t0) / FINE_DT) + 1, -1);
+    if (o.audit_fraction == 0) {
+        o.audit_fraction = DEFAULT_AUDIT_FRACTION;
+    }
+    int threads = o.threads;
+
+    double *times[2] = {NULL, NULL};
+    realtype *t_out[2] = {NULL, NULL};
+    long *indices = malloc(sizeof(long) * (pr->n_candidates + 1));
+    int flag = indices == NULL || time_grid(pr, &o.coarse, &times[0], &t_out[0]) != 0 ||
+               time_grid(pr, &o.fine, &times[1], &t_out[1]) != 0 ? -1 : 0;
+    screen_job job = {pr, candidates};
+    double mark = solver_stats_clock(), coarse_seconds = 0, fine_seconds = 0;
+
+    // Coarse pass over every candidate
+    if (flag == 0) {
+        for (long c = 0; c < pr->n_candidates; c++) {
+            screen_candidate blank = {NAN, NAN, 0, 0, 0, 0, 0};
+            candidates[c] = blank;
+        }
+        job.fidelity = &o.coarse;
+        job.times = times[0];
+        job.t_out = t_out[0];
+        job.n_indices = pr->n_candidates;
+        flag = run_stage(&job, threads);
+        coarse_seconds = solver_stats_lap(&mark);
+    }
+
+    // Fine pass over the passing (or failed) candidates and the audit sample of the rejected ones
+    if (flag == 0) {
+        long n = 0;
+        for (long c = 0; c < pr->n_candidates; c++) {
+            double score = candidates[c].coarse_score;
+            if (!(score < pr->threshold - o.margin)) {
+                candidates[c].refined = 1;
+            } else if (o.audit_fraction > 0) {
+                rng_state rng;
+                rng_seed(&rng, o.seed, c);
+                candidates[c].audited = rng_uniform(&rng) < o.audit_fraction;
+            }
+            if (candidates[c].refined || candidates[c].audited) {
+                indices[n++] = c;
+            }
+        }
+        job.fine = 1;
+        job.fidelity = &o.fine;
+        job.times = times[1];
+        job.t_out = t_out[1];
+        job.indices = indices;
+        job.n_indices = n;
+        flag = run_stage(&job, threads);
+        fine_seconds = solver_stats_lap(&mark);
+    }
+
+    if (flag == 0 && summary != NULL) {
+        screen_summary s = {0};
+        s.n_candidates = pr->n_candidates;
+        for (long c = 0; c < pr->n_candidates; c++) {
+            const screen_candidate *cand = &candidates[c];
+            s.n_refined += cand->refined;
+            s.n_audited += cand->audited;
+            s.n_hits += cand->refined && cand->hit;
+            s.n_false_positives += cand->refined && !cand->hit;
+            s.n_false_negatives += cand->audited && cand->hit;
+            s.n_failed += (cand->refined || cand->audited) && isnan(cand->fine_score);
+            s.coarse_rhs_evals += cand->coarse_rhs_evals;
+            s.fine_rhs_evals += cand->fine_rhs_evals;
+        }
+        s.false_negative_rate = s.n_audited > 0 ? (double)s.n_false_negatives / s.n_audited : 0;
+        s.false_negative_upper = binomial_upper(s.n_false_negatives, s.n_audited, 0.95);
+        s.expected_missed = s.false_negative_rate * (s.n_candidates - s.n_refined - s.n_audited);
+        s.coarse_seconds = coarse_seconds;
+        s.fine_seconds = fine_seconds;
+        *summary = s;
+    }
+    free(indices);
+    for (int k = 0; k < 2; k++) {
+        free(times[k]);
+        free(t_out[k]);
+    }
+    return flag;
+}
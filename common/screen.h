@@ -0,0 +1,85 @@
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include <stdint.h>
+#include "circuits.h"
+
+// Two-stage (multi-fidelity) screening of circuit candidates
+//
+// A candidate is one full parameter set of a registry circuit, and a
+// user-defined score of its trajectory decides whether it is a hit
+// (score >= threshold).
+//
+//   - Coarse pass: every candidate is solved at loose tolerances on a coarse
+//     output grid, in segments, and stops as soon as one segment is flat
+//     (the rest of the grid is filled with the settled state).
+//   - Fine pass: only the candidates whose coarse score reaches
+//     threshold - margin (or whose coarse solve failed) are solved again at
+//     the production settings, and only that score decides a hit.
+//
+// Rejected candidates are audited: each is also solved at the fine settings
+// with probability audit_fraction, drawn from random stream (seed,
+// candidate). Audited hits are false negatives of the coarse pass; their
+// rate among the audited and its one-sided 95% upper bound estimate how many
+// hits the screen has missed. Candidates are evaluated on a pool of threads
+// and the results do not depend on the number of threads.
+
+// Score of the trajectory out[k * n_species + i] on times[0..n_times); NaN marks a failure
+typedef double (*screen_score_fn)(const double *times, int n_times, const realtype *out, int n_species, void *ctx);
+
+typedef struct {
+    realtype rtol;
+    realtype atol;
+    int method;                   // CIRCUIT_ADAMS, CIRCUIT_BDF or CIRCUIT_AUTO
+    int n_times;                  // output points on [t0, t_end]
+    double settle_tol;            // stop once a segment changes less than this relative amount, < 0: never
+} screen_fidelity;
+
+typedef struct {
+    const circuit_model *model;
+    const realtype *y0;           // NULL for the defaults
+    long n_candidates;
+    const realtype *params;       // [candidate][n_params]
+    double t0, t_end;
+    screen_score_fn score;
+    void *score_ctx;              // shared by all threads
+    double threshold;
+} screen_problem;
+
+// Zero fields take the defaults: coarse rtol 1e-3, atol 1e-6, 51 points, settle_tol 1e-3;
+// fine rtol 1e-4, atol 1e-8 and dt = 0.1 (the drivers' settings), no early stop
+typedef struct {
+    screen_fidelity coarse, fine;
+    double margin;                // coarse threshold is threshold - margin
+    double audit_fraction;        // 0 for 0.02, < 0 for no audit
+    uint64_t seed;
+    int threads;                  // <= 0: all CPUs
+} screen_options;
+
+typedef struct {
+    double coarse_score;          // NaN when the coarse solve failed
+    double fine_score;            // NaN when not solved again or failed
+    long coarse_rhs_evals, fine_rhs_evals;
+    unsigned char refined;        // passed the coarse pass and was solved again
+    unsigned char audited;        // rejected by the coarse pass and solved again for the audit
+    unsigned char hit;            // fine_score >= threshold
+} screen_candidate;
+
+typedef struct {
+    long n_candidates;
+    long n_refined, n_audited, n_hits;
+    long n_false_positives;       // refined candidates that are not hits
+    long n_false_negatives;       // audited candidates that are hits
+    long n_failed;                // failed fine solves
+    double false_negative_rate;   // among the audited
+    double false_negative_upper;  // one-sided 95% Clopper-Pearson bound
+    double expected_missed;       // false_negative_rate times the rejected, unaudited candidates
+    long coarse_rhs_evals, fine_rhs_evals;
+    double coarse_seconds, fine_seconds;
+} screen_summary;
+
+// Screen every candidate; candidates has n_candidates entries, summary may be NULL. Returns 0 or -1.
+int screen_run(const screen_problem *problem, const screen_options *options, screen_candidate *candidates,
+               screen_summary *summary);
+
+#endif
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "sensitivity.h"
+
+static int sensitivity_rhs(realtype t, const realtype *y, realtype *ydot, const realtype *p, const void *data) {
+    const sensitivity_model *sm = data;
+    const circuit_model *m = sm->base;
+    int n = m->n_species;
+    realtype yp[SENSITIVITY_MAX_SPECIES], fp[SENSITIVITY_MAX_SPECIES], pp[SENSITIVITY_MAX_PARAMS];
+
+    int flag = m->rhs(t, y, ydot, p, m->data);
+    if (flag != 0) {
+        return flag;
+    }
+    memcpy(pp, p, m->n_params * sizeof(realtype));
+    for (int k = 0; k < sm->n_sens; k++) {
+        int j = sm->params[k];
+        const realtype *S = y + (1 + k) * n;
+        realtype h = sqrt(UNIT_ROUNDOFF) * (p[j] != 0 ? fabs(p[j]) : 1.0);
+        for (int i = 0; i < n; i++) {
+            yp[i] = y[i] + h * S[i];
+        }
+        pp[j] = p[j] + h;
+        flag = m->rhs(t, yp, fp, pp, m->data);
+        pp[j] = p[j];
+        if (flag != 0) {
+            return flag;
+        }
+        realtype *dS = ydot + (1 + k) * n;
+        for (int i = 0; i < n; i++) {
+            dS[i] = (fp[i] - ydot[i]) / h;
+        }
+    }
+    return 0;
+}
+
+int sensitivity_model_init(sensitivity_model *sm, const circuit_model *base, int n_sens, const int *params) {
+    memset(sm, 0, sizeof(*sm));
+    int n = base->n_species;
+    if (n > SENSITIVITY_MAX_SPECIES || base->n_params > SENSITIVITY_MAX_PARAMS || n_sens < 1 ||
+        n_sens > SENSITIVITY_MAX_PARAMS) {
+        fprintf(stderr, "Error in sensitivity_model_init: %s is too large\n", base->name);
+        return -1;
+    }
+    for (int k = 0; k < n_sens; k++) {
+        if (params[k] < 0 || params[k] >= base->n_params) {
+            fprintf(stderr, "Error in sensitivity_model_init: parameter %d out of range\n", params[k]);
+            return -1;
+        }
+        sm->params[k] = params[k];
+    }
+    sm->base = base;
+    sm->n_sens = n_sens;
+    sm->n_states = n * (1 + n_sens);
+    sm->names = calloc(sm->n_states, sizeof(char *));
+    sm->y0 = calloc(sm->n_states, sizeof(realtype));
+    if (sm->names == NULL || sm->y0 == NULL) {
+        sensitivity_model_free(sm);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        sm->y0[i] = base->default_y0[i];
+        sm->names[i] = strdup(base->species_names[i]);
+        for (int k = 0; k < n_sens; k++) {
+            const char *pname = base->param_names[params[k]];
+            size_t len = strlen(base->species_names[i]) + strlen(pname) + 9;
+            char *name = malloc(len);
+            if (name != NULL) {
+                snprintf(name, len, "d(%s)/d(%s)", base->species_names[i], pname);
+            }
+            sm->names[sensitivity_model_index(sm, i, k)] = name;
+        }
+    }
+    for (int k = 0; k < sm->n_states; k++) {
+        if (sm->names[k] == NULL) {
+            sensitivity_model_free(sm);
+            return -1;
+        }
+    }
+
+    circuit_model *m = &sm->model;
+    m->name = base->name;
+    m->n_species = sm->n_states;
+    m->n_params = base->n_params;
+    m->species_names = (const char *const *)sm->names;
+    m->param_names = base->param_names;
+    m->default_params = base->default_params;
+    m->default_y0 = sm->y0;
+    m->rhs = sensitivity_rhs;
+    m->jac = NULL;
+    m->input_param = base->input_param;
+    m->data = sm;
+    return 0;
+}
+
+void sensitivity_model_free(sensitivity_model *sm) {
+    if (sm->names != NULL) {
+        for (int k = 0; k < sm->n_states; k++) {
+            free(sm->names[k]);
+        }
+    }
+    free(sm->names);
+    free(sm->y0);
+    memset(sm, 0, sizeof(*sm));
+}
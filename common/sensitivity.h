@@ -0,0 +1,41 @@
+#ifndef SENSITIVITY_H
+#define SENSITIVITY_H
+
+#include "circuits.h"
+
+// Forward sensitivity equations of a circuit
+//
+// For the parameters p_k selected, S_k = dy/dp_k follows
+//
+//   dS_k/dt = J(y) S_k + df/dp_k,   S_k(0) = 0
+//
+// and the right-hand side is taken as one directional difference quotient
+// per parameter, (f(y + h S_k, p + h e_k) - f(y, p)) / h, as in the CVODES
+// DQ option. The generated system is an ordinary circuit_model with
+// n (1 + n_sens) states, y followed by S_0, S_1, ..., so circuit_solver
+// integrates the trajectory and its sensitivities together with the same
+// error control.
+
+#define SENSITIVITY_MAX_SPECIES 32
+#define SENSITIVITY_MAX_PARAMS 64
+
+typedef struct {
+    circuit_model model;          // the augmented ODE, model.data points back here
+    const circuit_model *base;
+    int n_sens;
+    int params[SENSITIVITY_MAX_PARAMS];   // index in base of each sensitivity parameter
+    int n_states;                 // n (1 + n_sens)
+    char **names;                 // the base species, then "d(X)/d(p)"
+    realtype *y0;                 // base y0 and zero sensitivities
+} sensitivity_model;
+
+// Generate the sensitivity system of base for the n_sens parameters params; -1 if too large
+int sensitivity_model_init(sensitivity_model *sm, const circuit_model *base, int n_sens, const int *params);
+void sensitivity_model_free(sensitivity_model *sm);
+
+// Index of dy_i/dp_k (k-th sensitivity parameter) in the state vector
+static inline int sensitivity_model_index(const sensitivity_model *sm, int i, int k) {
+    return (1 + k) * sm->base->n_species + i;
+}
+
+#endif
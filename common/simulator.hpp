@@ -0,0 +1,302 @@
+#ifndef SIMULATOR_HPP
+#define SIMULATOR_HPP
+
+#include <cstdio>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <type_traits>
+#include <math.h>
+#include <string.h>
+#include <cvode/cvode.h>               // prototypes for CVODE functions and constants
+#include <nvector/nvector_serial.h>    // serial N_Vector types, functions, and macros
+#include <sunmatrix/sunmatrix_dense.h> // access to dense SUNMatrix
+#include <sunlinsol/sunlinsol_dense.h> // access to dense SUNLinearSolver
+#include <sundials/sundials_types.h>   // defs. of realtype, sunindextype
+
+extern "C" {
+#include "output_pipeline.h"
+#include "solver_stats.h"
+#include "circuit_models.h"
+}
+
+// Generic CVODE driver for the per-model programs
+//
+// A model is a type holding only its physics:
+//
+//   struct model {
+//       static constexpr int dimension = 2;
+//       static constexpr const char *const *species_names = ...;   // dimension names
+//       struct params { ... };   // default-constructed to the model values
+//       static void rhs(realtype t, const realtype *y, realtype *ydot, const params &p);
+//       // optional, column-major: jac[j * dimension + i] = d f_i / d y_j (zeroed before the call)
+//       static void jacobian(realtype t, const realtype *y, realtype *jac, const params &p);
+//   };
+//
+// The drivers do not write their own: circuit_model_type turns a circuit of
+// circuit_models.h into one, so the registry and the drivers share a single
+// definition of each model, e.g.
+//
+//   using ffl = circuit_model_type<ffl_species, ffl_defaults, ffl_rhs>;
+//
+// Simulator<Model> owns the CVODE memory, state vector, dense matrix and
+// linear solver (freed in its destructor, also on early returns) and its
+// CVODE callbacks are instantiated for the model type, so the model's rhs
+// and jacobian are direct calls the compiler can inline, with the dimension
+// a compile-time constant. CVODE difference quotients are used when the
+// model has no jacobian. A simulator is not thread-safe; use one per thread.
+
+struct simulator_options {
+    realtype rtol = 1e-4;     // the drivers' tolerances
+    realtype atol = 1e-8;
+    int method = CV_ADAMS;    // CV_ADAMS or CV_BDF, both with Newton iteration
+    long max_steps = 0;       // 0 for the CVODE default
+};
+
+template <class Model, class = void>
+struct simulator_has_jacobian : std::false_type {};
+
+template <class Model>
+struct simulator_has_jacobian<Model, std::void_t<decltype(&Model::jacobian)>> : std::true_type {};
+
+// Parameters of a registry circuit, the values in registry order starting at its defaults
+template <auto &Defaults>
+struct circuit_params {
+    static constexpr int size = std::extent_v<std::remove_reference_t<decltype(Defaults)>>;
+    realtype values[size];
+
+    circuit_params() { std::copy(Defaults, Defaults + size, values); }
+    realtype &operator[](int k) { return values[k]; }
+    realtype operator[](int k) const { return values[k]; }
+};
+
+// The analytic Jacobian of a registry circuit, when it has one
+template <circuit_jac_fn Jac, class Params>
+struct circuit_model_jacobian {
+    static void jacobian(realtype t, const realtype *y, realtype *jac, const Params &p) {
+        Jac(t, y, jac, p.values, nullptr);
+    }
+};
+
+template <class Params>
+struct circuit_model_jacobian<nullptr, Params> {};
+
+// Model type of a circuit of circuit_models.h: the registry's names, defaults,
+// right-hand side and Jacobian, the functions called directly
+template <auto &Species, auto &Defaults, circuit_rhs_fn Rhs, circuit_jac_fn Jac = nullptr>
+struct circuit_model_type : circuit_model_jacobian<Jac, circuit_params<Defaults>> {
+    static constexpr int dimension = std::extent_v<std::remove_reference_t<decltype(Species)>>;
+    static constexpr const char *const *species_names = Species;
+    using params = circuit_params<Defaults>;
+
+    static void rhs(realtype t, const realtype *y, realtype *ydot, const params &p) {
+        Rhs(t, y, ydot, p.values, nullptr);
+    }
+};
+
+template <class Model>
+class Simulator {
+public:
+    static constexpr int dimension = Model::dimension;
+    static_assert(dimension > 0, "a model needs at least one species");
+    using params = typename Model::params;
+    using state = std::array<realtype, dimension>;
+
+    explicit Simulator(const params &p = params(), const simulator_options &options = simulator_options())
+        : params_(p), options_(options) {
+        y_.reset(N_VNew_Serial(dimension));
+        A_.reset(y_ != nullptr ? SUNDenseMatrix(dimension, dimension) : nullptr);
+        LS_.reset(A_ != nullptr ? SUNLinSol_Dense(y_.get(), A_.get()) : nullptr);
+        if (LS_ == nullptr) {
+            fprintf(stderr, "Error in Simulator: cannot create the vector, matrix or linear solver\n");
+            return;
+        }
+        cvode_mem_.reset(CVodeCreate(options_.method));
+        if (cvode_mem_ == nullptr) {
+            fprintf(stderr, "Error in CVodeCreate\n");
+        }
+    }
+
+    Simulator(const Simulator &) = delete;
+    Simulator &operator=(const Simulator &) = delete;
+
+    // False when construction failed; every call then fails too
+    bool ok() const { return cvode_mem_ != nullptr; }
+
+    // The parameters seen by the next call to rhs; may be changed between runs
+    params &parameters() { return params_; }
+    const params &parameters() const { return params_; }
+
+    // Function to start a run from y0 at t0, creating the CVODE context on the first call
+    int init(realtype t0, const state &y0) {
+        if (!ok()) {
+            return -1;
+        }
+        std::copy(y0.begin(), y0.end(), NV_DATA_S(y_.get()));
+        void *mem = cvode_mem_.get();
+        if (initialized_) {
+            int flag = CVodeReInit(mem, t0, y_.get());
+            if (flag != CV_SUCCESS) {
+                fprintf(stderr, "Error in CVodeReInit\n");
+            }
+            return flag;
+        }
+        int flag = CVodeInit(mem, rhs_callback, t0, y_.get());
+        if (flag != CV_SUCCESS) {
+            fprintf(stderr, "Error in CVodeInit\n");
+            return flag;
+        }
+        CVodeSetUserData(mem, &params_);
+        flag = CVodeSStolerances(mem, options_.rtol, options_.atol);
+        if (flag != CV_SUCCESS) {
+            fprintf(stderr, "Error in CVodeSStolerances\n");
+            return flag;
+        }
+        if (options_.max_steps > 0) {
+            CVodeSetMaxNumSteps(mem, options_.max_steps);
+        }
+        flag = CVodeSetLinearSolver(mem, LS_.get(), A_.get());
+        if (flag != CV_SUCCESS) {
+            fprintf(stderr, "Error in CVodeSetLinearSolver\n");
+            return flag;
+        }
+        if constexpr (simulator_has_jacobian<Model>::value) {
+            flag = CVodeSetJacFn(mem, jac_callback);
+            if (flag != CV_SUCCESS) {
+                fprintf(stderr, "Error in CVodeSetJacFn\n");
+                return flag;
+            }
+        }
+        initialized_ = true;
+        return CV_SUCCESS;
+    }
+
+    // Function to integrate to tout; *t is the time reached
+    int advance(realtype tout, realtype *t) { return CVode(cvode_mem_.get(), tout, y_.get(), t, CV_NORMAL); }
+
+    // Current state, dimension values
+    const realtype *y() const { return NV_DATA_S(y_.get()); }
+
+    // Function to solve from t_out[0] and store the state at every t_out[k] in
+    // out[k * dimension + i] (out[0..dimension) is y0); returns 0 or the failing CVODE flag
+    int sample(const state &y0, const realtype *t_out, int n_out, realtype *out) {
+        int flag = init(t_out[0], y0);
+        if (flag != CV_SUCCESS) {
+            return flag;
+        }
+        std::copy(y0.begin(), y0.end(), out);
+        for (int k = 1; k < n_out; k++) {
+            realtype t;
+            flag = advance(t_out[k], &t);
+            if (flag != CV_SUCCESS) {
+                fprintf(stderr, "Error in CVode at time %g\n", t);
+                return flag;
+            }
+            std::copy(y(), y() + dimension, out + (size_t)k * dimension);
+        }
+        return CV_SUCCESS;
+    }
+
+    // Function to run a driver: integrate from y0 at t = 0 in steps of dt
+    // until t_end, stream (Time, species...) rows to path ("-" for stdout, a
+    // path ending in .bctr for binary output) and report the statistics under
+    // label; returns the exit status for main()
+    int run(const char *label, const char *path, const state &y0, realtype t_end, realtype dt) {
+        stats_ = solver_stats();
+        double mark = solver_stats_clock();
+        realtype t = 0.0;
+        if (init(t, y0) != CV_SUCCESS) {
+            return 1;
+        }
+
+        const char *columns[dimension + 1] = {"Time"};
+        std::copy(Model::species_names, Model::species_names + dimension, columns + 1);
+        output_config config = {};
+        config.format = OUTPUT_AUTO;
+        config.n_columns = dimension + 1;
+        config.column_names = columns;
+        output_pipeline *out = output_pipeline_open(path, &config);
+        if (out == nullptr) {
+            fprintf(stderr, "Error opening file %s\n", path);
+            return 1;
+        }
+        output_stream *stream = output_stream_open(out, nullptr);
+        if (stream == nullptr) {
+            fprintf(stderr, "Error opening an output stream\n");
+            output_pipeline_close(out);
+            return 1;
+        }
+
+        stats_.setup_time = solver_stats_lap(&mark);
+
+        // Time-stepping loop
+        int status = 0;
+        double row[dimension + 1];
+        while (t < t_end) {
+            int flag = advance(t + dt, &t);
+            stats_.integrate_time += solver_stats_lap(&mark);
+            if (flag != CV_SUCCESS) {
+                fprintf(stderr, "Error in CVode at time %g\n", t);
+                status = 1;
+                break;
+            }
+            row[0] = t;
+            std::copy(y(), y() + dimension, row + 1);
+            output_stream_write(stream, row);
+            stats_.output_time += solver_stats_lap(&mark);
+        }
+
+        output_stream_close(stream);
+        if (output_pipeline_close(out) != 0) {
+            status = 1;
+        }
+        stats_.output_time += solver_stats_lap(&mark);
+        solver_stats_collect_cvode(cvode_mem_.get(), &stats_);
+        solver_stats_report(label, &stats_, nullptr);
+        return status;
+    }
+
+    // Statistics of the last run()
+    const solver_stats &stats() const { return stats_; }
+
+    void *cvode_mem() { return cvode_mem_.get(); }
+
+private:
+    static int rhs_callback(realtype t, N_Vector y, N_Vector ydot, void *user_data) {
+        Model::rhs(t, NV_DATA_S(y), NV_DATA_S(ydot), *static_cast<const params *>(user_data));
+        return 0;
+    }
+
+    static int jac_callback(realtype t, N_Vector y, N_Vector fy, SUNMatrix J, void *user_data,
+                            N_Vector tmp1, N_Vector tmp2, N_Vector tmp3) {
+        realtype *jac = SUNDenseMatrix_Data(J);
+        std::fill(jac, jac + dimension * dimension, realtype(0));
+        Model::jacobian(t, NV_DATA_S(y), jac, *static_cast<const params *>(user_data));
+        return 0;
+    }
+
+    struct vector_deleter {
+        void operator()(N_Vector v) const { N_VDestroy(v); }
+    };
+    struct matrix_deleter {
+        void operator()(SUNMatrix A) const { SUNMatDestroy(A); }
+    };
+    struct linear_solver_deleter {
+        void operator()(SUNLinearSolver LS) const { SUNLinSolFree(LS); }
+    };
+    struct cvode_deleter {
+        void operator()(void *mem) const { CVodeFree(&mem); }
+    };
+
+    params params_;
+    simulator_options options_;
+    solver_stats stats_ = solver_stats();
+    bool initialized_ = false;
+    // Declared so that CVODE is freed first
+    std::unique_ptr<std::remove_pointer_t<N_Vector>, vector_deleter> y_;
+    std::unique_ptr<std::remove_pointer_t<SUNMatrix>, matrix_deleter> A_;
+    std::unique_ptr<std::remove_pointer_t<SUNLinearSolver>, linear_solver_deleter> LS_;
+    std::unique_ptr<void, cvode_deleter> cvode_mem_;
+};
+
+#endif
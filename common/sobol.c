@@ -0,0 +1,101 @@
+#include "rng.h"
+#include "sobol.h"
+
+// Degree, interior coefficients and initial direction numbers of dimensions 2..SOBOL_MAX_DIM
+static const struct {
+    int degree;
+    uint32_t coefficients;
+    uint32_t m[7];
+} directions[SOBOL_MAX_DIM - 1] = {
+    {1, 0, {1}},
+    {2, 1, {1, 3}},
+    {3, 1, {1, 3, 1}},
+    {3, 2, {1, 1, 1}},
+    {4, 1, {1, 1, 3, 3}},
+    {4, 4, {1, 3, 5, 13}},
+    {5, 2, {1, 1, 5, 5, 17}},
+    {5, 4, {1, 1, 5, 5, 5}},
+    {5, 7, {1, 1, 7, 11, 19}},
+    {5, 11, {1, 1, 5, 1, 1}},
+    {5, 13, {1, 1, 1, 3, 11}},
+    {5, 14, {1, 3, 5, 5, 31}},
+    {6, 1, {1, 3, 3, 9, 7, 49}},
+    {6, 13, {1, 1, 1, 15, 21, 21}},
+    {6, 16, {1, 3, 1, 13, 27, 49}},
+    {6, 19, {1, 1, 1, 15, 7, 5}},
+    {6, 22, {1, 3, 1, 15, 13, 25}},
+    {6, 25, {1, 1, 5, 5, 19, 61}},
+    {7, 1, {1, 3, 7, 11, 23, 15, 103}},
+    {7, 4, {1, 3, 7, 13, 13, 15, 69}},
+    {7, 7, {1, 1, 3, 13, 7, 35, 63}},
+    {7, 8, {1, 3, 5, 9, 1, 25, 53}},
+    {7, 14, {1, 3, 1, 13, 9, 35, 107}},
+    {7, 19, {1, 3, 1, 5, 27, 61, 31}},
+    {7, 21, {1, 1, 5, 11, 19, 41, 61}},
+    {7, 28, {1, 3, 5, 3, 3, 13, 69}},
+    {7, 31, {1, 1, 7, 13, 1, 19, 1}},
+    {7, 32, {1, 3, 7, 5, 13, 19, 59}},
+};
+
+int sobol_init(sobol_state *s, int dim, uint64_t seed) {
+    if (dim < 1 || dim > SOBOL_MAX_DIM) {
+        return -1;
+    }
+    s->dim = dim;
+    s->index = 0;
+    // First dimension: van der Corput in base 2
+    for (int k = 0; k < 32; k++) {
+        s->v[0][k] = 1u << (31 - k);
+    }
+    for (int j = 1; j < dim; j++) {
+        int degree = directions[j - 1].degree;
+        uint32_t a = directions[j - 1].coefficients;
+        for (int k = 0; k < degree && k < 32; k++) {
+            s->v[j][k] = directions[j - 1].m[k] << (31 - k);
+        }
+        for (int k = degree; k < 32; k++) {
+            uint32_t v = s->v[j][k - degree] ^ (s->v[j][k - degree] >> degree);
+            for (int i = 1; i < degree; i++) {
+                if ((a >> (degree - 1 - i)) & 1) {
+                    v ^= s->v[j][k - i];
+                }
+            }
+            s->v[j][k] = v;
+        }
+    }
+    rng_state rng;
+    rng_seed(&rng, seed, 0);
+    for (int j = 0; j < dim; j++) {
+        s->x[j] = 0;
+        s->shift[j] = seed != 0 ? (uint32_t)(rng_next(&rng) >> 32) : 0;
+    }
+    return 0;
+}
+
+void sobol_next(sobol_state *s, double *u) {
+    // Gray code: flip the direction number of the lowest zero bit of the index
+    uint64_t i = s->index++;
+    int c = 0;
+    while (i & 1) {
+        i >>= 1;
+        c++;
+    }
+    for (int j = 0; j < s->dim; j++) {
+        s->x[j] ^= s->v[j][c < 32 ? c : 31];
+        u[j] = (s->x[j] ^ s->shift[j]) * (1.0 / 4294967296.0);
+    }
+}
+
+void sobol_point(const sobol_state *s, uint64_t index, double *u) {
+    uint64_t n = index + 1;
+    uint64_t gray = n ^ (n >> 1);
+    for (int j = 0; j < s->dim; j++) {
+        uint32_t x = 0;
+        for (int k = 0; k < 32 && (gray >> k) != 0; k++) {
+            if ((gray >> k) & 1) {
+                x ^= s->v[j][k];
+            }
+        }
+        u[j] = (x ^ s->shift[j]) * (1.0 / 4294967296.0);
+    }
+}
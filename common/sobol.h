@@ -0,0 +1,33 @@
+#ifndef SOBOL_H
+#define SOBOL_H
+
+#include <stdint.h>
+
+// Sobol low-discrepancy sequence for multi-start and sampling designs
+//
+// Direction numbers from primitive polynomials with the initial values of
+// Joe and Kuo, 32-bit Gray-code construction. With a nonzero seed every
+// dimension is XORed with a random 32-bit word (a digital shift), which
+// keeps the low-discrepancy structure and gives independent replicates.
+
+#define SOBOL_MAX_DIM 29
+
+typedef struct {
+    int dim;
+    uint32_t v[SOBOL_MAX_DIM][32];   // direction numbers
+    uint32_t x[SOBOL_MAX_DIM];       // current point
+    uint32_t shift[SOBOL_MAX_DIM];
+    uint64_t index;
+} sobol_state;
+
+// Start the sequence in dim dimensions; returns 0 or -1 if dim is out of range
+int sobol_init(sobol_state *s, int dim, uint64_t seed);
+
+// Next point in [0, 1)^dim; the origin of the unshifted sequence is skipped
+void sobol_next(sobol_state *s, double *u);
+
+// Point number index (0-based) of the sequence returned by sobol_next, without advancing it,
+// so threads can generate disjoint parts of one design
+void sobol_point(const sobol_state *s, uint64_t index, double *u);
+
+#endif
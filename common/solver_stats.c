@@ -0,0 +1,119 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "solver_stats.h"
+
+#define JSON_LINE_BYTES 4096
+
+double solver_stats_clock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+double solver_stats_lap(double *mark) {
+    double now = solver_stats_clock();
+    double elapsed = now - *mark;
+    *mark = now;
+    return elapsed;
+}
+
+typedef struct {
+    char *buf;
+    int size;
+    int n;     // length so far; may exceed size when the line does not fit
+} json_line;
+
+static void json_printf(json_line *j, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int room = j->n < j->size ? j->size - j->n : 0;
+    j->n += vsnprintf(room > 0 ? j->buf + j->n : NULL, room, format, args);
+    va_end(args);
+}
+
+// Function to append a JSON string, escaping quotes, backslashes and control characters
+static void json_string(json_line *j, const char *s) {
+    json_printf(j, "\"");
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            json_printf(j, "\\%c", c);
+        } else if (c < 0x20) {
+            json_printf(j, "\\u%04x", c);
+        } else {
+            json_printf(j, "%c", c);
+        }
+    }
+    json_printf(j, "\"");
+}
+
+// Function to format stats as one JSON line into buf; returns the length or -1 if it does not fit
+static int format_json(char *buf, int size, const char *label, const solver_stats *st, const char *const *reaction_names) {
+    json_line j = {buf, size, 0};
+    json_printf(&j, "{\"label\": ");
+    json_string(&j, label ? label : "");
+    json_printf(&j, ", \"steps\": %ld, \"rhs_evals\": %ld, \"jac_evals\": %ld, \"lin_setups\": %ld"
+                    ", \"nonlin_iters\": %ld, \"nonlin_conv_fails\": %ld, \"err_test_fails\": %ld, \"method_switches\": %ld"
+                    ", \"last_step\": %.6g, \"setup_s\": %.6g, \"integrate_s\": %.6g, \"output_s\": %.6g",
+                st->n_steps, st->n_rhs_evals, st->n_jac_evals, st->n_lin_setups,
+                st->n_nonlin_iters, st->n_nonlin_conv_fails, st->n_err_test_fails, st->n_method_switches,
+                st->last_step, st->setup_time, st->integrate_time, st->output_time);
+    if (st->n_reactions > 0) {
+        long total = 0;
+        json_printf(&j, ", \"reaction_events\": {");
+        for (int i = 0; i < st->n_reactions && i < SOLVER_STATS_MAX_REACTIONS; i++) {
+            if (i > 0) {
+                json_printf(&j, ", ");
+            }
+            if (reaction_names != NULL) {
+                json_string(&j, reaction_names[i]);
+            } else {
+                json_printf(&j, "\"%d\"", i);
+            }
+            json_printf(&j, ": %ld", st->reaction_events[i]);
+            total += st->reaction_events[i];
+        }
+        json_printf(&j, "}, \"events\": %ld", total);
+    }
+    json_printf(&j, "}\n");
+    return j.n < size ? j.n : -1;
+}
+
+void solver_stats_write_json(FILE *fp, const char *label, const solver_stats *stats, const char *const *reaction_names) {
+    char line[JSON_LINE_BYTES];
+    int n = format_json(line, sizeof(line), label, stats, reaction_names);
+    if (n > 0) {
+        fwrite(line, 1, n, fp);
+    }
+}
+
+void solver_stats_report(const char *label, const solver_stats *stats, const char *const *reaction_names) {
+    const char *target = getenv("BIOCIRCUITS_STATS");
+    if (target == NULL || target[0] == '\0') {
+        return;
+    }
+    char line[JSON_LINE_BYTES];
+    int n = format_json(line, sizeof(line), label, stats, reaction_names);
+    if (n <= 0) {
+        return;
+    }
+
+    // One write() on an O_APPEND descriptor, so lines from concurrent runs do not interleave
+    int fd = strcmp(target, "-") == 0 ? STDERR_FILENO : open(target, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Error opening %s\n", target);
+        return;
+    }
+    if (write(fd, line, n) != n) {
+        fprintf(stderr, "Error writing %s\n", target);
+    }
+    if (fd != STDERR_FILENO) {
+        close(fd);
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef SOLVER_STATS_H
+#define SOLVER_STATS_H
+
+#include <stdio.h>
+
+// Per-run solver statistics
+//
+// CVODE counters are read once at the end of a run (solver_stats_collect_cvode,
+// in solver_stats_cvode.c so the SSA libraries do not need CVODE), and the
+// wall time is split with a handful of monotonic clock reads per output row,
+// so collecting is cheap enough to leave on for every run.
+//
+// When the environment variable BIOCIRCUITS_STATS is set to a path (or "-"
+// for stderr), solver_stats_report() appends each run as one JSON line:
+//   {"label": "...", "steps": 512, "rhs_evals": 613, ..., "setup_s": 1.2e-05, ...}
+
+#define SOLVER_STATS_MAX_REACTIONS 32
+
+typedef struct {
+    // CVODE counters
+    long n_steps;
+    long n_rhs_evals;          // including the difference-quotient Jacobian evaluations
+    long n_jac_evals;
+    long n_lin_setups;
+    long n_nonlin_iters;
+    long n_nonlin_conv_fails;
+    long n_err_test_fails;
+    long n_method_switches;    // Adams <-> BDF switches of CIRCUIT_AUTO
+    double last_step;
+    // Wall time in seconds
+    double setup_time;         // creating and initializing the solver
+    double integrate_time;     // inside CVode() or the SSA loop
+    double output_time;        // storing or queueing the output rows
+    // SSA event counts, n_reactions == 0 for ODE runs
+    int n_reactions;
+    long reaction_events[SOLVER_STATS_MAX_REACTIONS];
+} solver_stats;
+
+// Monotonic clock in seconds
+double solver_stats_clock(void);
+
+// Seconds since *mark, and move *mark to now
+double solver_stats_lap(double *mark);
+
+// Read the counters of a CVODE memory block into stats (times are left as is)
+void solver_stats_collect_cvode(void *cvode_mem, solver_stats *stats);
+
+// Write stats as one JSON line; reaction_names may be NULL
+void solver_stats_write_json(FILE *fp, const char *label, const solver_stats *stats, const char *const *reaction_names);
+
+// Append stats to the BIOCIRCUITS_STATS target, no-op when it is unset
+void solver_stats_report(const char *label, const solver_stats *stats, const char *const *reaction_names);
+
+#endif
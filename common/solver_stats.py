@@ -0,0 +1,44 @@
+import ctypes
+from output_spec import OutputSpec
+
+# ctypes mirror of solver_stats.h, for the solve_*_stats() functions of the
+# ctypes libraries:
+#
+#   stats = SolverStats()
+#   lib.solve_dichotomous_feedback_stats(out, spec, n_steps, dt, I, ctypes.byref(stats))
+#   print(stats.to_dict())
+
+SOLVER_STATS_MAX_REACTIONS = 32
+
+
+class SolverStats(ctypes.Structure):
+    _fields_ = [
+        ('n_steps', ctypes.c_long),
+        ('n_rhs_evals', ctypes.c_long),
+        ('n_jac_evals', ctypes.c_long),
+        ('n_lin_setups', ctypes.c_long),
+        ('n_nonlin_iters', ctypes.c_long),
+        ('n_nonlin_conv_fails', ctypes.c_long),
+        ('n_err_test_fails', ctypes.c_long),
+        ('n_method_switches', ctypes.c_long),
+        ('last_step', ctypes.c_double),
+        ('setup_time', ctypes.c_double),
+        ('integrate_time', ctypes.c_double),
+        ('output_time', ctypes.c_double),
+        ('n_reactions', ctypes.c_int),
+        ('reaction_events', ctypes.c_long * SOLVER_STATS_MAX_REACTIONS),
+    ]
+
+    def to_dict(self):
+        d = {name: getattr(self, name) for name, _ in self._fields_[:-2]}
+        if self.n_reactions > 0:
+            d['reaction_events'] = list(self.reaction_events[:self.n_reactions])
+        return d
+
+
+def declare_stats_function(func):
+    """Set the ctypes signature of a solve_*_stats(out, spec, n_steps, dt, I, stats) function."""
+    func.argtypes = [ctypes.c_void_p, ctypes.POINTER(OutputSpec), ctypes.c_int, ctypes.c_double, ctypes.c_double,
+                     ctypes.POINTER(SolverStats)]
+    func.restype = ctypes.c_int
+    return func
@@ -0,0 +1,20 @@
+#include <cvode/cvode.h>             // prototypes for CVODE functions and constants
+#include "solver_stats.h"
+
+// CVODE part of solver_stats.h, kept apart so the SSA libraries link without CVODE
+
+void solver_stats_collect_cvode(void *cvode_mem, solver_stats *stats) {
+    long n_lin_rhs_evals = 0;
+    realtype last_step = 0;
+    CVodeGetNumSteps(cvode_mem, &stats->n_steps);
+    CVodeGetNumRhsEvals(cvode_mem, &stats->n_rhs_evals);
+    CVodeGetNumLinRhsEvals(cvode_mem, &n_lin_rhs_evals);
+    CVodeGetNumJacEvals(cvode_mem, &stats->n_jac_evals);
+    CVodeGetNumLinSolvSetups(cvode_mem, &stats->n_lin_setups);
+    CVodeGetNumNonlinSolvIters(cvode_mem, &stats->n_nonlin_iters);
+    CVodeGetNumNonlinSolvConvFails(cvode_mem, &stats->n_nonlin_conv_fails);
+    CVodeGetNumErrTestFails(cvode_mem, &stats->n_err_test_fails);
+    CVodeGetLastStep(cvode_mem, &last_step);
+    stats->n_rhs_evals += n_lin_rhs_evals;
+    stats->last_step = last_step;
+}
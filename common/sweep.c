@@ -0,0 +1,591 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "circuit_solver.h"
+#include "trajectory_io.h"
+#include "sweep.h"
+#include "ensemble_runner.h"
+
+#define SWEEP_MAGIC "BCSWEEP1"
+#define CHECKPOINT_MAGIC "BCSWCKP1"
+#define SWEEP_VERSION 1
+#define DEFAULT_SHARD_ROWS 64
+#define DEFAULT_CHECKPOINT_SECONDS 60.0
+#define POLL_SECONDS 1                // wait between scans while other workers hold the last shards
+#define STATUS_PENDING 0
+#define STATUS_DONE 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    int32_t method;
+    int64_t n_rows, shard_rows, n_shards;
+    int32_t n_params, n_species, n_times, segment;
+    double t0, t_end, rtol, atol;
+    uint32_t realtype_bytes;
+    uint32_t reserved;
+    char circuit[64];
+} manifest_header;
+
+typedef struct {
+    char magic[8];
+    int64_t shard, next_row, next_k, n_values;
+} checkpoint_header;
+
+struct sweep {
+    char *dir;
+    int fd;                       // manifest, for the status bytes
+    manifest_header h;
+    const circuit_model *model;
+    double *design;
+    double *times;
+    realtype *t_out;
+    off_t status_offset;
+    pthread_mutex_t lock;
+    long n_finished;              // by the current sweep_work call
+    long n_reserved;              // shards claimed or about to be, against max_shards
+    long n_failed_rows;
+};
+
+typedef struct {
+    sweep *s;
+    const sweep_work_options *options;
+    double checkpoint_seconds;
+    int error;
+} work_job;
+
+// Function to build the path of a shard file
+static void shard_path(const sweep *s, long shard, const char *suffix, char *path, size_t size) {
+    snprintf(path, size, "%s/shards/%06ld.%s", s->dir, shard, suffix);
+}
+
+// Function to write a whole buffer, retrying short writes; returns 0 or -1
+static int write_all(int fd, const void *data, size_t n_bytes) {
+    const char *p = data;
+    while (n_bytes > 0) {
+        ssize_t n = write(fd, p, n_bytes);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        n_bytes -= (size_t)n;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void *data, size_t n_bytes) {
+    char *p = data;
+    while (n_bytes > 0) {
+        ssize_t n = read(fd, p, n_bytes);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        n_bytes -= (size_t)n;
+    }
+    return 0;
+}
+
+// Function to write two buffers to the temporary file temp, sync it and rename it to path; returns 0 or -1
+static int write_atomic(const char *temp, const char *path, const void *a, size_t a_bytes, const void *b,
+                        size_t b_bytes) {
+    int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    int ok = write_all(fd, a, a_bytes) == 0 && write_all(fd, b, b_bytes) == 0 && fsync(fd) == 0;
+    if (close(fd) != 0 || !ok || rename(temp, path) != 0) {
+        unlink(temp);
+        return -1;
+    }
+    return 0;
+}
+
+int sweep_create(const char *dir, const sweep_config *config) {
+    const sweep_config *c = config;
+    const circuit_model *m = c->circuit != NULL ? circuit_lookup(c->circuit) : NULL;
+    if (m == NULL || c->n_rows < 1 || c->design == NULL || c->n_times < 2 || !(c->t_end > c->t0) ||
+        c->segment < 0 || strlen(c->circuit) >= sizeof(((manifest_header *)0)->circuit)) {
+        fprintf(stderr, "Error in sweep_create: invalid configuration\n");
+        return -1;
+    }
+    manifest_header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SWEEP_MAGIC, 8);
+    h.version = SWEEP_VERSION;
+    h.method = c->method;
+    h.n_rows = c->n_rows;
+    h.shard_rows = c->shard_rows > 0 ? c->shard_rows : DEFAULT_SHARD_ROWS;
+    h.n_shards = (h.n_rows + h.shard_rows - 1) / h.shard_rows;
+    h.n_params = m->n_params;
+    h.n_species = m->n_species;
+    h.n_times = c->n_times;
+    h.segment = c->segment;
+    h.t0 = c->t0;
+    h.t_end = c->t_end;
+    h.rtol = c->rtol > 0 ? c->rtol : 1e-4;
+    h.atol = c->atol > 0 ? c->atol : 1e-8;
+    h.realtype_bytes = sizeof(realtype);
+    strcpy(h.circuit, c->circuit);
+
+    size_t n_design = (size_t)h.n_rows * h.n_params;
+    size_t body_bytes = n_design * sizeof(double) + (size_t)h.n_shards;
+    unsigned char *body = calloc(body_bytes, 1);
+    if (body == NULL) {
+        return -1;
+    }
+    for (size_t k = 0; k < n_design; k++) {
+        ((double *)body)[k] = c->design[k];
+    }
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/shards", dir);
+    if ((mkdir(dir, 0755) != 0 && errno != EEXIST) || (mkdir(path, 0755) != 0 && errno != EEXIST)) {
+        fprintf(stderr, "Error in sweep_create: cannot create %s\n", path);
+        free(body);
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s/manifest", dir);
+
+    // Keep an identical manifest (and its progress); refuse to overwrite a different sweep
+    int fd = open(path, O_RDONLY);
+    int flag = 0;
+    if (fd >= 0) {
+        manifest_header old;
+        double *design = malloc(n_design * sizeof(double) + 1);
+        if (design == NULL || read_all(fd, &old, sizeof(old)) != 0 || memcmp(&old, &h, sizeof(h)) != 0 ||
+            read_all(fd, design, n_design * sizeof(double)) != 0 ||
+            memcmp(design, body, n_design * sizeof(double)) != 0) {
+            fprintf(stderr, "Error in sweep_create: %s holds a different sweep\n", path);
+            flag = -1;
+        }
+        free(design);
+        close(fd);
+    } else {
+        char temp[4200];
+        snprintf(temp, sizeof(temp), "%s.tmp-%ld", path, (long)getpid());
+        flag = write_atomic(temp, path, &h, sizeof(h), body, body_bytes);
+    }
+    if (flag != 0 && fd < 0) {
+        fprintf(stderr, "Error in sweep_create: cannot write %s\n", path);
+    }
+    free(body);
+    return flag;
+}
+
+// Function to read or write the status byte of a shard
+static int get_status(const sweep *s, long shard) {
+    unsigned char b = STATUS_PENDING;
+    return pread(s->fd, &b, 1, s->status_offset + shard) == 1 ? b : STATUS_PENDING;
+}
+
+static void set_status(sweep *s, long shard, int status) {
+    unsigned char b = (unsigned char)status;
+    if (pwrite(s->fd, &b, 1, s->status_offset + shard) != 1) {
+        fprintf(stderr, "Error in sweep: cannot update the manifest\n");
+    }
+}
+
+static int file_exists(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+sweep *sweep_open(const char *dir) {
+    sweep *s = calloc(1, sizeof(sweep));
+    if (s == NULL) {
+        return NULL;
+    }
+    s->fd = -1;
+    pthread_mutex_init(&s->lock, NULL);
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/manifest", dir);
+    if ((s->dir = strdup(dir)) == NULL || (s->fd = open(path, O_RDWR)) < 0 ||
+        read_all(s->fd, &s->h, sizeof(s->h)) != 0 || memcmp(s->h.magic, SWEEP_MAGIC, 8) != 0 ||
+        s->h.version != SWEEP_VERSION) {
+        fprintf(stderr, "Error in sweep_open: cannot read %s\n", path);
+        sweep_close(s);
+        return NULL;
+    }
+    manifest_header *h = &s->h;
+    h->circuit[sizeof(h->circuit) - 1] = '\0';
+    s->model = circuit_lookup(h->circuit);
+    size_t n_design = (size_t)h->n_rows * h->n_params;
+    s->design = malloc(n_design * sizeof(double) + 1);
+    s->times = malloc(sizeof(double) * h->n_times);
+    s->t_out = malloc(sizeof(realtype) * h->n_times);
+    if (s->model == NULL || s->model->n_params != h->n_params || s->model->n_species != h->n_species ||
+        h->realtype_bytes != sizeof(realtype) || h->n_times < 2 || s->design == NULL || s->times == NULL ||
+        s->t_out == NULL || read_all(s->fd, s->design, n_design * sizeof(double)) != 0) {
+        fprintf(stderr, "Error in sweep_open: %s does not match this build\n", path);
+        sweep_close(s);
+        return NULL;
+    }
+    s->status_offset = (off_t)(sizeof(manifest_header) + n_design * sizeof(double));
+    for (int k = 0; k < h->n_times; k++) {
+        s->times[k] = h->t0 + (h->t_end - h->t0) * k / (h->n_times - 1);
+        s->t_out[k] = s->times[k];
+    }
+
+    // The result files are the truth: a done shard without one runs again
+    for (long shard = 0; shard < h->n_shards; shard++) {
+        shard_path(s, shard, "bctr", path, sizeof(path));
+        int done = file_exists(path);
+        if (done != (get_status(s, shard) == STATUS_DONE)) {
+            set_status(s, shard, done ? STATUS_DONE : STATUS_PENDING);
+        }
+    }
+    return s;
+}
+
+void sweep_close(sweep *s) {
+    if (s == NULL) {
+        return;
+    }
+    pthread_mutex_destroy(&s->lock);
+    if (s->fd >= 0) {
+        close(s->fd);
+    }
+    free(s->design);
+    free(s->times);
+    free(s->t_out);
+    free(s->dir);
+    free(s);
+}
+
+const circuit_model *sweep_model(const sweep *s) {
+    return s->model;
+}
+
+static long shard_num_rows(const sweep *s, long shard) {
+    long first = shard * s->h.shard_rows;
+    return s->h.n_rows - first < s->h.shard_rows ? s->h.n_rows - first : s->h.shard_rows;
+}
+
+// Function to claim a pending shard by taking its lock; returns the shard (and the lock descriptor),
+// -1 when every shard is done, or -2 when the pending ones are all held by other workers
+static long claim_shard(sweep *s, int *lock_fd) {
+    char path[4096];
+    long busy = 0;
+    for (long shard = 0; shard < s->h.n_shards; shard++) {
+        if (get_status(s, shard) == STATUS_DONE) {
+            continue;
+        }
+        shard_path(s, shard, "lock", path, sizeof(path));
+        int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0 || flock(fd, LOCK_EX | LOCK_NB) != 0) {
+            busy++;
+            if (fd >= 0) {
+                close(fd);
+            }
+            continue;
+        }
+        // Finished between the status read and the lock?
+        shard_path(s, shard, "bctr", path, sizeof(path));
+        if (get_status(s, shard) == STATUS_DONE || file_exists(path)) {
+            close(fd);
+            continue;
+        }
+        *lock_fd = fd;
+        return shard;
+    }
+    return busy > 0 ? -2 : -1;
+}
+
+// Function to read the checkpoint of a shard into data; returns the next (row, k) or (0, 0) without a valid one
+static void read_checkpoint(const sweep *s, long shard, double *data, size_t n_values, long *next_row, long *next_k) {
+    char path[4096];
+    checkpoint_header c;
+    *next_row = *next_k = 0;
+    shard_path(s, shard, "ckpt", path, sizeof(path));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    size_t per_row = (size_t)s->h.n_times * s->h.n_species;
+    if (read_all(fd, &c, sizeof(c)) == 0 && memcmp(c.magic, CHECKPOINT_MAGIC, 8) == 0 && c.shard == shard &&
+        c.next_row >= 0 && c.next_row < shard_num_rows(s, shard) && c.next_k >= 0 && c.next_k < s->h.n_times - 1 &&
+        (size_t)c.n_values == c.next_row * per_row + (c.next_k + 1) * (size_t)s->h.n_species &&
+        (size_t)c.n_values <= n_values && read_all(fd, data, c.n_values * sizeof(double)) == 0) {
+        *next_row = c.next_row;
+        *next_k = c.next_k;
+    }
+    close(fd);
+}
+
+// Function to checkpoint the rows before next_row and row next_row up to output point next_k
+static int write_checkpoint(const sweep *s, long shard, const double *data, long next_row, long next_k) {
+    char path[4096], temp[4096];
+    checkpoint_header c;
+    memset(&c, 0, sizeof(c));
+    memcpy(c.magic, CHECKPOINT_MAGIC, 8);
+    c.shard = shard;
+    c.next_row = next_row;
+    c.next_k = next_k;
+    c.n_values = next_row * (int64_t)s->h.n_times * s->h.n_species + (next_k + 1) * (int64_t)s->h.n_species;
+    shard_path(s, shard, "ckpt", path, sizeof(path));
+    shard_path(s, shard, "ckpt.tmp", temp, sizeof(temp));
+    return write_atomic(temp, path, &c, sizeof(c), data, (size_t)c.n_values * sizeof(double));
+}
+
+// Function to write the finished shard as a .bctr file, atomically; returns 0 or -1
+static int write_shard(const sweep *s, long shard, const double *data) {
+    const circuit_model *m = s->model;
+    char path[4096], temp[4096];
+    shard_path(s, shard, "bctr", path, sizeof(path));
+    shard_path(s, shard, "bctr.tmp", temp, sizeof(temp));
+    traj_writer *w = traj_writer_open(temp, TRAJ_FLOAT64, m->n_species, m->species_names, m->n_params,
+                                      m->param_names, s->times, s->h.n_times);
+    if (w == NULL) {
+        return -1;
+    }
+    long n_rows = shard_num_rows(s, shard);
+    size_t per_row = (size_t)s->h.n_times * s->h.n_species;
+    int ok = 1;
+    for (long r = 0; r < n_rows && ok; r++) {
+        const double *params = s->design + (size_t)(shard * s->h.shard_rows + r) * s->h.n_params;
+        ok = traj_writer_append(w, params, data + r * per_row, TRAJ_ROW_MAJOR) == 0;
+    }
+    ok = traj_writer_close(w) == 0 && ok;
+    int fd = ok ? open(temp, O_RDONLY) : -1;
+    ok = fd >= 0 && fsync(fd) == 0;
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (!ok || rename(temp, path) != 0) {
+        unlink(temp);
+        return -1;
+    }
+    return 0;
+}
+
+static int stop_requested(const work_job *job) {
+    return job->options->stop != NULL && *job->options->stop;
+}
+
+// Function to run (or resume) one claimed shard; returns 0 when done, 1 when stopped at a checkpoint, -1 on error
+static int run_shard(work_job *job, circuit_solver *solver, long shard, realtype *params, realtype *y0, realtype *out) {
+    sweep *s = job->s;
+    const manifest_header *h = &s->h;
+    int n = h->n_species, N = h->n_times;
+    long n_rows = shard_num_rows(s, shard), next_row, next_k, failed_rows = 0;
+    size_t per_row = (size_t)N * n;
+    double *data = malloc(sizeof(double) * per_row * n_rows);
+    if (data == NULL) {
+        return -1;
+    }
+    read_checkpoint(s, shard, data, per_row * n_rows, &next_row, &next_k);
+    double last_checkpoint = solver_stats_clock();
+    for (long r = next_row; r < n_rows; r++) {
+        double *row = data + r * per_row;
+        for (int j = 0; j < h->n_params; j++) {
+            params[j] = s->design[(size_t)(shard * h->shard_rows + r) * h->n_params + j];
+        }
+        for (long k = r == next_row ? next_k : 0; k < N - 1;) {
+            long end = h->segment > 0 && k + h->segment < N - 1 ? k + h->segment : N - 1;
+            for (int i = 0; i < n; i++) {
+                y0[i] = k == 0 ? s->model->default_y0[i] : row[k * n + i];
+            }
+            if (circuit_solver_run(solver, params, y0, s->t_out + k, (int)(end - k + 1), out) != 0) {
+                // Keep the sweep going: the failed part of the row reads as NaN
+                for (size_t v = (size_t)(k + 1) * n; v < per_row; v++) {
+                    row[v] = NAN;
+                }
+                failed_rows++;
+                break;
+            }
+            for (size_t v = 0; v < (size_t)(end - k + 1) * n; v++) {
+                row[k * n + v] = out[v];
+            }
+            k = end;
+            if (k == N - 1 && r == n_rows - 1) {
+                break;
+            }
+            // Checkpoint at this split point (the start of the next row after the last point)
+            int stop = stop_requested(job);
+            if (stop || (job->checkpoint_seconds >= 0 && solver_stats_clock() - last_checkpoint >= job->checkpoint_seconds)) {
+                long cr = k == N - 1 ? r + 1 : r, ck = k == N - 1 ? 0 : k;
+                if (ck == 0) {
+                    // Point 0 of the next row is its y0 and is written before the row is run
+                    for (int i = 0; i < n; i++) {
+                        data[cr * per_row + i] = s->model->default_y0[i];
+                    }
+                }
+                if (write_checkpoint(s, shard, data, cr, ck) != 0) {
+                    fprintf(stderr, "Error in sweep: cannot checkpoint shard %ld\n", shard);
+                }
+                last_checkpoint = solver_stats_clock();
+                if (stop) {
+                    free(data);
+                    return 1;
+                }
+            }
+        }
+    }
+    int flag = write_shard(s, shard, data);
+    free(data);
+    if (flag != 0) {
+        fprintf(stderr, "Error in sweep: cannot write shard %ld\n", shard);
+        return -1;
+    }
+    set_status(s, shard, STATUS_DONE);
+    char path[4096];
+    shard_path(s, shard, "ckpt", path, sizeof(path));
+    unlink(path);
+    shard_path(s, shard, "ckpt.tmp", path, sizeof(path));
+    unlink(path);
+    pthread_mutex_lock(&s->lock);
+    s->n_failed_rows += failed_rows;
+    pthread_mutex_unlock(&s->lock);
+    return 0;
+}
+
+static void sweep_worker(ensemble_runner *r, int thread, void *arg) {
+    work_job *job = arg;
+    sweep *s = job->s;
+    const manifest_header *h = &s->h;
+    circuit_solver_options so = {(realtype)h->rtol, (realtype)h->atol, 0, h->method};
+    circuit_solver *solver = circuit_solver_create(s->model, &so);
+    realtype *params = malloc(sizeof(realtype) * (h->n_params + h->n_species * (1 + (size_t)h->n_times)));
+    if (solver == NULL || params == NULL) {
+        fprintf(stderr, "Error in sweep: cannot create the solver\n");
+        circuit_solver_free(solver);
+        free(params);
+        job->error = 1;
+        return;
+    }
+    realtype *y0 = params + h->n_params, *out = y0 + h->n_species;
+    // Shards are claimed through their lock files, not the runner's counter
+    (void)r;
+    (void)thread;
+    while (!stop_requested(job)) {
+        // Reserve one of the max_shards before claiming, so concurrent threads do not overshoot
+        pthread_mutex_lock(&s->lock);
+        int enough = job->options->max_shards > 0 && s->n_reserved >= job->options->max_shards;
+        s->n_reserved += !enough;
+        pthread_mutex_unlock(&s->lock);
+        int lock_fd = -1;
+        long shard = enough ? -1 : claim_shard(s, &lock_fd);
+        if (shard < 0 && !enough) {
+            pthread_mutex_lock(&s->lock);
+            s->n_reserved--;
+            pthread_mutex_unlock(&s->lock);
+        }
+        if (shard == -1) {
+            break;
+        }
+        if (shard == -2) {
+            // Wait for the other workers: a shard whose worker dies is taken over from its checkpoint
+            sleep(POLL_SECONDS);
+            continue;
+        }
+        int flag = run_shard(job, solver, shard, params, y0, out);
+        close(lock_fd);
+        if (flag < 0) {
+            job->error = 1;
+            break;
+        }
+        if (flag == 0) {
+            pthread_mutex_lock(&s->lock);
+            s->n_finished++;
+            pthread_mutex_unlock(&s->lock);
+        }
+    }
+    circuit_solver_free(solver);
+    free(params);
+}
+
+long sweep_work(sweep *s, const sweep_work_options *options) {
+    sweep_work_options o = {0};
+    if (options != NULL) {
+        o = *options;
+    }
+    work_job job = {s, &o, o.checkpoint_seconds != 0 ? o.checkpoint_seconds : DEFAULT_CHECKPOINT_SECONDS, 0};
+    if (job.checkpoint_seconds < 0) {
+        job.checkpoint_seconds = -1;
+    }
+    s->n_finished = 0;
+    s->n_reserved = 0;
+    s->n_failed_rows = 0;
+    ensemble_runner_run(s->h.n_shards, 1, o.threads, sweep_worker, &job);
+    if (s->n_failed_rows > 0) {
+        fprintf(stderr, "Warning: %ld rows failed to integrate and hold NaN\n", s->n_failed_rows);
+    }
+    return job.error ? -1 : s->n_finished;
+}
+
+void sweep_status(const sweep *s, long *n_shards, long *n_done, long *n_running, long *n_checkpointed) {
+    char path[4096];
+    long done = 0, running = 0, checkpointed = 0;
+    for (long shard = 0; shard < s->h.n_shards; shard++) {
+        if (get_status(s, shard) == STATUS_DONE) {
+            done++;
+            continue;
+        }
+        shard_path(s, shard, "ckpt", path, sizeof(path));
+        checkpointed += file_exists(path);
+        // A shared lock is refused only while a worker holds the claim
+        shard_path(s, shard, "lock", path, sizeof(path));
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            running += flock(fd, LOCK_SH | LOCK_NB) != 0;
+            close(fd);
+        }
+    }
+    *n_shards = s->h.n_shards;
+    *n_done = done;
+    *n_running = running;
+    *n_checkpointed = checkpointed;
+}
+
+int sweep_merge(const sweep *s, const char *path) {
+    const circuit_model *m = s->model;
+    const manifest_header *h = &s->h;
+    double *column_major = malloc(sizeof(double) * h->n_times * (size_t)h->n_species);
+    traj_writer *w = column_major != NULL ? traj_writer_open(path, TRAJ_FLOAT64, m->n_species, m->species_names,
+                                                             m->n_params, m->param_names, s->times, h->n_times)
+                                          : NULL;
+    int flag = w != NULL ? 0 : -1;
+    for (long shard = 0; shard < h->n_shards && flag == 0; shard++) {
+        char shard_file[4096];
+        shard_path(s, shard, "bctr", shard_file, sizeof(shard_file));
+        traj_reader *r = traj_reader_open(shard_file);
+        if (r == NULL || traj_reader_num_runs(r) != (uint64_t)shard_num_rows(s, shard) ||
+            traj_reader_header(r)->dtype != TRAJ_FLOAT64) {
+            fprintf(stderr, "Error in sweep_merge: shard %ld is missing or incomplete\n", shard);
+            traj_reader_close(r);
+            flag = -1;
+            break;
+        }
+        for (uint64_t run = 0; run < traj_reader_num_runs(r) && flag == 0; run++) {
+            for (int i = 0; i < m->n_species; i++) {
+                memcpy(column_major + (size_t)i * h->n_times, traj_reader_column(r, run, i), sizeof(double) * h->n_times);
+            }
+            flag = traj_writer_append(w, traj_reader_run_params(r, run), column_major, TRAJ_COLUMN_MAJOR);
+        }
+        traj_reader_close(r);
+    }
+    if (w != NULL && traj_writer_close(w) != 0) {
+        flag = -1;
+    }
+    if (flag != 0) {
+        unlink(path);
+    }
+    free(column_major);
+    return flag;
+}
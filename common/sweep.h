@@ -0,0 +1,74 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <signal.h>
+#include "circuits.h"
+
+// Resumable, sharded parameter sweeps of a registry circuit
+//
+// A sweep lives in one directory:
+//
+//   DIR/manifest            circuit, solver settings, time grid, the full
+//                           design (one parameter vector per row) and one
+//                           status byte per shard of shard_rows rows
+//   DIR/shards/NNNNNN.bctr  results of a finished shard (trajectory_io.h)
+//   DIR/shards/NNNNNN.lock  claim of a shard, held with flock()
+//   DIR/shards/NNNNNN.ckpt  checkpoint of an unfinished shard
+//
+// Any number of worker processes (and threads) pull shards from the same
+// manifest without a server: a shard is claimed by taking the exclusive
+// flock of its lock file, which the kernel drops when the holder dies, so a
+// preempted worker never leaves a stale claim. Shard results are written to
+// a temporary file and renamed into place before the shard is marked done,
+// so a result file is always complete; a done shard whose file is missing
+// is simply run again.
+//
+// Long integrations are split at fixed output points (every segment points,
+// restarting the solver from the stored state), and at these points a
+// shard's finished rows and the current row so far are checkpointed when
+// checkpoint_seconds have passed or a stop is requested. The split points do
+// not depend on when checkpoints happen, so a resumed sweep gives results
+// bit-identical to an uninterrupted one.
+
+typedef struct {
+    const char *circuit;          // registry name
+    long n_rows;
+    const realtype *design;       // [row][n_params] full parameter vectors
+    long shard_rows;              // rows per shard, 0 for 64
+    int n_times;                  // output points on [t0, t_end]
+    double t0, t_end;
+    realtype rtol, atol;          // 0 for 1e-4 and 1e-8
+    int method;                   // CIRCUIT_ADAMS, CIRCUIT_BDF or CIRCUIT_AUTO
+    int segment;                  // output points per integration segment, 0: whole rows
+} sweep_config;
+
+typedef struct {
+    int threads;                  // <= 0: all CPUs
+    double checkpoint_seconds;    // 0 for 60, < 0: only on stop
+    long max_shards;              // shards to finish before returning, 0: no limit
+    const volatile sig_atomic_t *stop;  // checkpoint and return once *stop is set (NULL: never)
+} sweep_work_options;
+
+typedef struct sweep sweep;
+
+// Create the sweep directory and manifest; an existing manifest is kept when its
+// configuration and design are identical (returns 0) and an error otherwise
+int sweep_create(const char *dir, const sweep_config *config);
+
+// Open an existing sweep, reconciling the shard status with the result files
+sweep *sweep_open(const char *dir);
+void sweep_close(sweep *s);
+
+const circuit_model *sweep_model(const sweep *s);
+
+// Pull and run shards until none is left (or max_shards or a stop);
+// returns the number of shards finished by this call, or -1
+long sweep_work(sweep *s, const sweep_work_options *options);
+
+// Shards in total, finished, claimed by a live worker, and with a checkpoint
+void sweep_status(const sweep *s, long *n_shards, long *n_done, long *n_running, long *n_checkpointed);
+
+// Concatenate every shard, in row order, into one .bctr file; fails unless all are done
+int sweep_merge(const sweep *s, const char *path);
+
+#endif
@@ -0,0 +1,418 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "trajectory_io.h"
+
+struct traj_writer {
+    FILE *fp;
+    struct traj_header header;
+    uint64_t *index;
+    uint64_t index_capacity;
+    void *column_buffer;  // one run worth of columns in the file dtype
+};
+
+struct traj_reader {
+    const unsigned char *base;
+    size_t size;
+    const struct traj_header *header;
+    const char **names;   // n_species species names followed by n_params parameter names
+    const uint64_t *index;
+    uint64_t n_runs;
+};
+
+static uint64_t align_up(uint64_t x) {
+    return (x + TRAJ_ALIGN - 1) & ~(uint64_t)(TRAJ_ALIGN - 1);
+}
+
+static int write_padding(FILE *fp, uint64_t from, uint64_t to) {
+    static const char zeros[TRAJ_ALIGN] = {0};
+    return to > from && fwrite(zeros, 1, to - from, fp) != to - from ? -1 : 0;
+}
+
+// Function to write the parameters and the filled column buffer as the next run
+static int write_run(traj_writer *w, const double *params) {
+    struct traj_header *h = &w->header;
+    uint64_t n_species = h->n_species;
+    uint64_t n_times = h->n_times;
+
+    if (h->n_runs == w->index_capacity) {
+        uint64_t capacity = w->index_capacity ? 2 * w->index_capacity : 64;
+        uint64_t *index = realloc(w->index, capacity * sizeof(uint64_t));
+        if (index == NULL) {
+            return -1;
+        }
+        w->index = index;
+        w->index_capacity = capacity;
+    }
+    uint64_t offset = h->runs_offset + h->n_runs * h->run_size;
+
+    uint64_t payload = h->n_params * sizeof(double) + n_species * n_times * h->dtype;
+    if ((h->n_params > 0 && fwrite(params, sizeof(double), h->n_params, w->fp) != h->n_params) ||
+        fwrite(w->column_buffer, h->dtype, n_species * n_times, w->fp) != n_species * n_times ||
+        write_padding(w->fp, payload, h->run_size) != 0) {
+        fprintf(stderr, "Error writing trajectory run %llu\n", (unsigned long long)h->n_runs);
+        return -1;
+    }
+    w->index[h->n_runs++] = offset;
+    return 0;
+}
+
+uint64_t traj_run_size(int dtype, int n_species, int n_params, uint64_t n_times) {
+    return align_up((uint64_t)n_params * sizeof(double) + (uint64_t)n_species * n_times * (uint64_t)dtype);
+}
+
+// Function to create a trajectory file and write everything up to the first run
+traj_writer *traj_writer_open(const char *path, int dtype,
+                              int n_species, const char *const *species_names,
+                              int n_params, const char *const *param_names,
+                              const double *times, uint64_t n_times) {
+    if (dtype != TRAJ_FLOAT32 && dtype != TRAJ_FLOAT64) {
+        fprintf(stderr, "Error in traj_writer_open: unsupported dtype %d\n", dtype);
+        return NULL;
+    }
+
+    traj_writer *w = calloc(1, sizeof(*w));
+    if (w == NULL) {
+        return NULL;
+    }
+    w->fp = fopen(path, "wb");
+    if (w->fp == NULL) {
+        fprintf(stderr, "Error opening file %s!\n", path);
+        free(w);
+        return NULL;
+    }
+    setvbuf(w->fp, NULL, _IOFBF, 1 << 20);
+
+    struct traj_header *h = &w->header;
+    memcpy(h->magic, TRAJ_MAGIC, sizeof(h->magic));
+    h->version = TRAJ_VERSION;
+    h->dtype = (uint32_t)dtype;
+    h->n_species = (uint32_t)n_species;
+    h->n_params = (uint32_t)n_params;
+    h->n_times = n_times;
+
+    // Names block
+    uint64_t names_size = 0;
+    for (int i = 0; i < n_species; i++) {
+        names_size += strlen(species_names[i]) + 1;
+    }
+    for (int i = 0; i < n_params; i++) {
+        names_size += strlen(param_names[i]) + 1;
+    }
+    h->names_offset = align_up(sizeof(*h));
+    h->names_size = names_size;
+    h->times_offset = align_up(h->names_offset + names_size);
+    h->runs_offset = align_up(h->times_offset + n_times * sizeof(double));
+    h->run_size = traj_run_size(dtype, n_species, n_params, n_times);
+
+    w->column_buffer = malloc((size_t)(n_species * n_times * dtype) + 1);
+    if (w->column_buffer == NULL) {
+        fclose(w->fp);
+        free(w);
+        return NULL;
+    }
+
+    int failed = fwrite(h, sizeof(*h), 1, w->fp) != 1;
+    failed |= write_padding(w->fp, sizeof(*h), h->names_offset);
+    for (int i = 0; i < n_species; i++) {
+        failed |= fwrite(species_names[i], 1, strlen(species_names[i]) + 1, w->fp) == 0;
+    }
+    for (int i = 0; i < n_params; i++) {
+        failed |= fwrite(param_names[i], 1, strlen(param_names[i]) + 1, w->fp) == 0;
+    }
+    failed |= write_padding(w->fp, h->names_offset + names_size, h->times_offset);
+    failed |= n_times > 0 && fwrite(times, sizeof(double), n_times, w->fp) != n_times;
+    failed |= write_padding(w->fp, h->times_offset + n_times * sizeof(double), h->runs_offset);
+
+    // Publish the header early so a crashed writer still leaves a readable file
+    fflush(w->fp);
+    if (failed) {
+        fprintf(stderr, "Error writing trajectory header to %s\n", path);
+        fclose(w->fp);
+        free(w->column_buffer);
+        free(w);
+        return NULL;
+    }
+    return w;
+}
+
+// Function to append one run whose values are given as float64 in either layout
+int traj_writer_append(traj_writer *w, const double *params, const double *data, int layout) {
+    const struct traj_header *h = &w->header;
+    uint64_t n_species = h->n_species;
+    uint64_t n_times = h->n_times;
+
+    if (h->dtype == TRAJ_FLOAT64 && layout == TRAJ_COLUMN_MAJOR) {
+        memcpy(w->column_buffer, data, n_species * n_times * sizeof(double));
+    } else if (h->dtype == TRAJ_FLOAT64) {
+        double *col = w->column_buffer;
+        for (uint64_t j = 0; j < n_species; j++) {
+            for (uint64_t i = 0; i < n_times; i++) {
+                col[j * n_times + i] = data[i * n_species + j];
+            }
+        }
+    } else {
+        float *col = w->column_buffer;
+        for (uint64_t j = 0; j < n_species; j++) {
+            for (uint64_t i = 0; i < n_times; i++) {
+                double v = layout == TRAJ_COLUMN_MAJOR ? data[j * n_times + i] : data[i * n_species + j];
+                col[j * n_times + i] = (float)v;
+            }
+        }
+    }
+    return write_run(w, params);
+}
+
+// Function to append one run whose values are given as float32 in either layout
+int traj_writer_append_f32(traj_writer *w, const double *params, const float *data, int layout) {
+    const struct traj_header *h = &w->header;
+    uint64_t n_species = h->n_species;
+    uint64_t n_times = h->n_times;
+
+    if (h->dtype == TRAJ_FLOAT32 && layout == TRAJ_COLUMN_MAJOR) {
+        memcpy(w->column_buffer, data, n_species * n_times * sizeof(float));
+    } else {
+        for (uint64_t j = 0; j < n_species; j++) {
+            for (uint64_t i = 0; i < n_times; i++) {
+                float v = layout == TRAJ_COLUMN_MAJOR ? data[j * n_times + i] : data[i * n_species + j];
+                if (h->dtype == TRAJ_FLOAT32) {
+                    ((float *)w->column_buffer)[j * n_times + i] = v;
+                } else {
+                    ((double *)w->column_buffer)[j * n_times + i] = v;
+                }
+            }
+        }
+    }
+    return write_run(w, params);
+}
+
+uint64_t traj_writer_num_runs(const traj_writer *w) {
+    return w->header.n_runs;
+}
+
+// Function to write the run index, finalize the header and free the writer
+int traj_writer_close(traj_writer *w) {
+    struct traj_header *h = &w->header;
+    int failed = 0;
+
+    h->index_offset = h->runs_offset + h->n_runs * h->run_size;
+    if (h->n_runs > 0 && fwrite(w->index, sizeof(uint64_t), h->n_runs, w->fp) != h->n_runs) {
+        failed = 1;
+    }
+    if (fseek(w->fp, 0, SEEK_SET) != 0 || fwrite(h, sizeof(*h), 1, w->fp) != 1) {
+        failed = 1;
+    }
+    if (fclose(w->fp) != 0) {
+        failed = 1;
+    }
+    if (failed) {
+        fprintf(stderr, "Error finalizing trajectory file\n");
+    }
+    free(w->index);
+    free(w->column_buffer);
+    free(w);
+    return failed ? -1 : 0;
+}
+
+// Function to write the prelude and index of a file of n_runs fixed-size runs placed by the caller
+int traj_file_create(const char *path, int dtype,
+                     int n_species, const char *const *species_names,
+                     int n_params, const char *const *param_names,
+                     const double *times, uint64_t n_times, uint64_t n_runs, struct traj_header *header) {
+    traj_writer *w = traj_writer_open(path, dtype, n_species, species_names, n_params, param_names, times, n_times);
+    if (w == NULL) {
+        return -1;
+    }
+    struct traj_header *h = &w->header;
+    h->n_runs = n_runs;
+    h->index_offset = h->runs_offset + n_runs * h->run_size;
+    int failed = fseek(w->fp, (long)h->index_offset, SEEK_SET) != 0;
+    for (uint64_t k = 0; k < n_runs && !failed; k++) {
+        uint64_t offset = h->runs_offset + k * h->run_size;
+        failed = fwrite(&offset, sizeof(offset), 1, w->fp) != 1;
+    }
+    failed |= fseek(w->fp, 0, SEEK_SET) != 0 || fwrite(h, sizeof(*h), 1, w->fp) != 1;
+    failed |= fclose(w->fp) != 0;
+    if (failed) {
+        fprintf(stderr, "Error writing trajectory header to %s\n", path);
+    }
+    *header = *h;
+    free(w->index);
+    free(w->column_buffer);
+    free(w);
+    return failed ? -1 : 0;
+}
+
+// Function to lay out one run (parameters, columns in the file dtype, zero padding) in a run_size block
+void traj_format_run(const struct traj_header *header, const double *params, const double *data, int layout,
+                     void *block) {
+    const struct traj_header *h = header;
+    uint64_t n_species = h->n_species;
+    uint64_t n_times = h->n_times;
+    unsigned char *b = block;
+    memcpy(b, params, h->n_params * sizeof(double));
+    unsigned char *col = b + h->n_params * sizeof(double);
+    for (uint64_t j = 0; j < n_species; j++) {
+        for (uint64_t i = 0; i < n_times; i++) {
+            double v = layout == TRAJ_COLUMN_MAJOR ? data[j * n_times + i] : data[i * n_species + j];
+            if (h->dtype == TRAJ_FLOAT64) {
+                ((double *)col)[j * n_times + i] = v;
+            } else {
+                ((float *)col)[j * n_times + i] = (float)v;
+            }
+        }
+    }
+    uint64_t payload = h->n_params * sizeof(double) + n_species * n_times * h->dtype;
+    memset(b + payload, 0, h->run_size - payload);
+}
+
+// Function to tell whether count items of item_size bytes at offset lie within a file of size bytes
+static int fits_in_file(uint64_t offset, uint64_t count, uint64_t item_size, uint64_t size) {
+    return offset <= size && count <= (size - offset) / item_size;
+}
+
+// Function to check that the header's sections, run blocks and index lie within the file
+// (every name takes at least its '\0', which bounds the name table too)
+static int check_layout(const traj_reader *r) {
+    const struct traj_header *h = r->header;
+    uint64_t size = r->size;
+    if (!fits_in_file(h->names_offset, h->names_size, 1, size) ||
+        !fits_in_file(h->times_offset, h->n_times, sizeof(double), size) || h->runs_offset > size ||
+        (uint64_t)h->n_species + h->n_params > h->names_size) {
+        return -1;
+    }
+    // A run block holds the parameters and every column
+    uint64_t params_size = (uint64_t)h->n_params * sizeof(double);
+    if (h->run_size < params_size ||
+        (h->n_times > 0 && h->n_species > (h->run_size - params_size) / (h->n_times * h->dtype))) {
+        return -1;
+    }
+    if (h->index_offset != 0 && fits_in_file(h->index_offset, h->n_runs, sizeof(uint64_t), size)) {
+        const uint64_t *index = (const uint64_t *)(r->base + h->index_offset);
+        for (uint64_t k = 0; k < h->n_runs; k++) {
+            if (!fits_in_file(index[k], 1, h->run_size, size)) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Function to map a trajectory file read-only and validate its header
+traj_reader *traj_reader_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error opening file %s!\n", path);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct traj_header)) {
+        fprintf(stderr, "Error: %s is not a trajectory file\n", path);
+        close(fd);
+        return NULL;
+    }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "Error in mmap for %s\n", path);
+        return NULL;
+    }
+
+    traj_reader *r = calloc(1, sizeof(*r));
+    if (r == NULL) {
+        fprintf(stderr, "Error allocating trajectory reader\n");
+        munmap(base, (size_t)st.st_size);
+        return NULL;
+    }
+    r->base = base;
+    r->size = (size_t)st.st_size;
+    r->header = base;
+    const struct traj_header *h = r->header;
+    if (memcmp(h->magic, TRAJ_MAGIC, sizeof(h->magic)) != 0 || h->version != TRAJ_VERSION ||
+        (h->dtype != TRAJ_FLOAT32 && h->dtype != TRAJ_FLOAT64) || check_layout(r) != 0) {
+        fprintf(stderr, "Error: %s is not a supported trajectory file\n", path);
+        traj_reader_close(r);
+        return NULL;
+    }
+
+    r->names = malloc(((size_t)h->n_species + h->n_params + 1) * sizeof(char *));
+    if (r->names == NULL) {
+        fprintf(stderr, "Error allocating trajectory reader\n");
+        traj_reader_close(r);
+        return NULL;
+    }
+    // Each name must end within the names section
+    const char *p = (const char *)r->base + h->names_offset;
+    const char *names_end = p + h->names_size;
+    for (uint64_t i = 0; i < (uint64_t)h->n_species + h->n_params; i++) {
+        const char *nul = memchr(p, '\0', (size_t)(names_end - p));
+        if (nul == NULL) {
+            fprintf(stderr, "Error: %s is not a supported trajectory file\n", path);
+            traj_reader_close(r);
+            return NULL;
+        }
+        r->names[i] = p;
+        p = nul + 1;
+    }
+
+    if (h->index_offset != 0 && fits_in_file(h->index_offset, h->n_runs, sizeof(uint64_t), r->size)) {
+        r->index = (const uint64_t *)(r->base + h->index_offset);
+        r->n_runs = h->n_runs;
+    } else {
+        // Unfinished file: every complete fixed-size block is a valid run
+        r->index = NULL;
+        r->n_runs = h->run_size ? (r->size - h->runs_offset) / h->run_size : 0;
+    }
+    return r;
+}
+
+void traj_reader_close(traj_reader *r) {
+    if (r == NULL) {
+        return;
+    }
+    munmap((void *)r->base, r->size);
+    free(r->names);
+    free(r);
+}
+
+const struct traj_header *traj_reader_header(const traj_reader *r) {
+    return r->header;
+}
+
+const char *traj_reader_species_name(const traj_reader *r, int species) {
+    return r->names[species];
+}
+
+const char *traj_reader_param_name(const traj_reader *r, int param) {
+    return r->names[r->header->n_species + param];
+}
+
+const double *traj_reader_times(const traj_reader *r) {
+    return (const double *)(r->base + r->header->times_offset);
+}
+
+uint64_t traj_reader_num_runs(const traj_reader *r) {
+    return r->n_runs;
+}
+
+static uint64_t run_offset(const traj_reader *r, uint64_t run) {
+    return r->index ? r->index[run] : r->header->runs_offset + run * r->header->run_size;
+}
+
+const double *traj_reader_run_params(const traj_reader *r, uint64_t run) {
+    return (const double *)(r->base + run_offset(r, run));
+}
+
+const void *traj_reader_column(const traj_reader *r, uint64_t run, int species) {
+    const struct traj_header *h = r->header;
+    return r->base + run_offset(r, run) + h->n_params * sizeof(double) + (uint64_t)species * h->n_times * h->dtype;
+}
+
+double traj_reader_value(const traj_reader *r, uint64_t run, int species, uint64_t time) {
+    const void *col = traj_reader_column(r, run, species);
+    return r->header->dtype == TRAJ_FLOAT64 ? ((const double *)col)[time] : ((const float *)col)[time];
+}
@@ -0,0 +1,88 @@
+#ifndef TRAJECTORY_IO_H
+#define TRAJECTORY_IO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Binary columnar trajectory format (.bctr)
+//
+// Layout (little-endian, every section 64-byte aligned):
+//   header      fixed 96 bytes, see struct traj_header
+//   names       species names then parameter names, each '\0'-terminated
+//   times       n_times float64 values shared by every run
+//   runs        one block per run: n_params float64 parameters, then
+//               n_species contiguous columns of n_times float32/float64
+//   index       n_runs uint64 byte offsets of the run blocks
+//
+// A file whose writer died before traj_writer_close() has index_offset 0;
+// readers then fall back to the fixed run_size to locate complete runs.
+
+#define TRAJ_MAGIC "BIOTRAJ1"
+#define TRAJ_VERSION 1
+#define TRAJ_ALIGN 64
+
+// Element types of the data columns (value is the element size in bytes)
+#define TRAJ_FLOAT32 4
+#define TRAJ_FLOAT64 8
+
+// Layout of the array handed to traj_writer_append()
+#define TRAJ_ROW_MAJOR 0     // data[time * n_species + species]
+#define TRAJ_COLUMN_MAJOR 1  // data[species * n_times + time]
+
+struct traj_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t dtype;
+    uint32_t n_species;
+    uint32_t n_params;
+    uint64_t n_times;
+    uint64_t n_runs;
+    uint64_t names_offset;
+    uint64_t names_size;
+    uint64_t times_offset;
+    uint64_t runs_offset;
+    uint64_t run_size;
+    uint64_t index_offset;
+    uint64_t reserved;
+};
+
+typedef struct traj_writer traj_writer;
+typedef struct traj_reader traj_reader;
+
+// Writer
+traj_writer *traj_writer_open(const char *path, int dtype,
+                              int n_species, const char *const *species_names,
+                              int n_params, const char *const *param_names,
+                              const double *times, uint64_t n_times);
+int traj_writer_append(traj_writer *w, const double *params, const double *data, int layout);
+int traj_writer_append_f32(traj_writer *w, const double *params, const float *data, int layout);
+uint64_t traj_writer_num_runs(const traj_writer *w);
+int traj_writer_close(traj_writer *w);
+
+// Size in bytes of one run block, used by writers that place runs themselves
+uint64_t traj_run_size(int dtype, int n_species, int n_params, uint64_t n_times);
+
+// Writers that place runs themselves (several processes or ranks writing one file):
+// traj_file_create writes the header, names, times and index of a file of exactly
+// n_runs runs and sizes it; run k is then the run_size bytes at
+// runs_offset + k * run_size, formatted by traj_format_run. Returns 0 or -1.
+int traj_file_create(const char *path, int dtype,
+                     int n_species, const char *const *species_names,
+                     int n_params, const char *const *param_names,
+                     const double *times, uint64_t n_times, uint64_t n_runs, struct traj_header *header);
+void traj_format_run(const struct traj_header *header, const double *params, const double *data, int layout,
+                     void *block);
+
+// Memory-mapped reader
+traj_reader *traj_reader_open(const char *path);
+void traj_reader_close(traj_reader *r);
+const struct traj_header *traj_reader_header(const traj_reader *r);
+const char *traj_reader_species_name(const traj_reader *r, int species);
+const char *traj_reader_param_name(const traj_reader *r, int param);
+const double *traj_reader_times(const traj_reader *r);
+uint64_t traj_reader_num_runs(const traj_reader *r);
+const double *traj_reader_run_params(const traj_reader *r, uint64_t run);
+const void *traj_reader_column(const traj_reader *r, uint64_t run, int species);
+double traj_reader_value(const traj_reader *r, uint64_t run, int species, uint64_t time);
+
+#endif
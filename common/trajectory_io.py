@@ -0,0 +1,120 @@
+import numpy as np
+
+# Reader for the binary columnar trajectory format written by trajectory_io.c.
+# The file is memory-mapped once and every accessor returns a zero-copy view.
+
+HEADER_DTYPE = np.dtype([
+    ('magic', 'S8'), ('version', '<u4'), ('dtype', '<u4'),
+    ('n_species', '<u4'), ('n_params', '<u4'), ('n_times', '<u8'), ('n_runs', '<u8'),
+    ('names_offset', '<u8'), ('names_size', '<u8'), ('times_offset', '<u8'),
+    ('runs_offset', '<u8'), ('run_size', '<u8'), ('index_offset', '<u8'), ('reserved', '<u8'),
+])
+MAGIC = b'BIOTRAJ1'
+
+
+def _fits_in_file(offset, count, item_size, size):
+    """Whether count items of item_size bytes at offset lie within a file of size bytes."""
+    return offset <= size and count * item_size <= size - offset
+
+
+class TrajectoryFile:
+    def __init__(self, path):
+        self.path = path
+        self._buf = np.memmap(path, dtype=np.uint8, mode='r')
+        if len(self._buf) < HEADER_DTYPE.itemsize:
+            raise ValueError(f'{path} is not a trajectory file')
+        header = np.frombuffer(self._buf, dtype=HEADER_DTYPE, count=1)[0]
+        if header['magic'] != MAGIC or header['version'] != 1 or header['dtype'] not in (4, 8) \
+                or not self._check_layout(header):
+            raise ValueError(f'{path} is not a supported trajectory file')
+        self.header = header
+        self.dtype = np.dtype('<f4') if header['dtype'] == 4 else np.dtype('<f8')
+        self.n_species = int(header['n_species'])
+        self.n_params = int(header['n_params'])
+        self.n_times = int(header['n_times'])
+
+        names_offset = int(header['names_offset'])
+        names = bytes(self._buf[names_offset:names_offset + int(header['names_size'])]).split(b'\0')
+        self.species = [n.decode() for n in names[:self.n_species]]
+        self.param_names = [n.decode() for n in names[self.n_species:self.n_species + self.n_params]]
+
+        self.times = np.frombuffer(self._buf, dtype='<f8', count=self.n_times,
+                                   offset=int(header['times_offset']))
+
+        runs_offset = int(header['runs_offset'])
+        run_size = int(header['run_size'])
+        if header['index_offset'] != 0 and _fits_in_file(int(header['index_offset']), int(header['n_runs']), 8,
+                                                          len(self._buf)):
+            self.n_runs = int(header['n_runs'])
+            self.index = np.frombuffer(self._buf, dtype='<u8', count=self.n_runs,
+                                       offset=int(header['index_offset']))
+        else:
+            # Unfinished file: keep every complete fixed-size run block
+            self.n_runs = (len(self._buf) - runs_offset) // run_size if run_size else 0
+            self.index = runs_offset + run_size * np.arange(self.n_runs, dtype=np.uint64)
+        # Runs appended by a single writer are equally spaced, which allows strided views
+        self._uniform = bool(np.all(self.index == runs_offset + run_size * np.arange(self.n_runs, dtype=np.uint64)))
+
+    def _check_layout(self, header):
+        """Same checks as traj_reader_open: sections, run blocks and index lie within the file."""
+        size = len(self._buf)
+        h = {name: int(header[name]) for name in HEADER_DTYPE.names if name != 'magic'}
+        if not _fits_in_file(h['names_offset'], h['names_size'], 1, size) \
+                or not _fits_in_file(h['times_offset'], h['n_times'], 8, size) or h['runs_offset'] > size \
+                or h['n_species'] + h['n_params'] > h['names_size']:
+            return False
+        # Every name ends with a '\0' inside the names section
+        names = self._buf[h['names_offset']:h['names_offset'] + h['names_size']]
+        if np.count_nonzero(names == 0) < h['n_species'] + h['n_params']:
+            return False
+        # A run block holds the parameters and every column
+        if h['run_size'] < 8 * h['n_params'] + h['n_species'] * h['n_times'] * h['dtype']:
+            return False
+        if h['index_offset'] != 0 and _fits_in_file(h['index_offset'], h['n_runs'], 8, size):
+            index = np.frombuffer(self._buf, dtype='<u8', count=h['n_runs'], offset=h['index_offset'])
+            if h['n_runs'] > 0 and (h['run_size'] > size or np.any(index > size - h['run_size'])):
+                return False
+        return True
+
+    def __len__(self):
+        return self.n_runs
+
+    def run(self, i):
+        """Array of shape (n_species, n_times) viewing run i."""
+        offset = int(self.index[i]) + 8 * self.n_params
+        return np.frombuffer(self._buf, dtype=self.dtype, count=self.n_species * self.n_times,
+                             offset=offset).reshape(self.n_species, self.n_times)
+
+    def run_params(self, i):
+        return np.frombuffer(self._buf, dtype='<f8', count=self.n_params, offset=int(self.index[i]))
+
+    def params(self):
+        """Array of shape (n_runs, n_params); a view when runs are equally spaced."""
+        if self.n_runs == 0:
+            return np.empty((0, self.n_params))
+        if not self._uniform:
+            return np.stack([self.run_params(i) for i in range(self.n_runs)])
+        offset = int(self.header['runs_offset'])
+        base = np.frombuffer(self._buf, dtype='<f8', count=(len(self._buf) - offset) // 8, offset=offset)
+        return np.lib.stride_tricks.as_strided(
+            base, shape=(self.n_runs, self.n_params), strides=(int(self.header['run_size']), 8), writeable=False)
+
+    def species_column(self, name):
+        """Array of shape (n_runs, n_times) for one species; a view when runs are equally spaced."""
+        j = self.species.index(name)
+        if self.n_runs == 0:
+            return np.empty((0, self.n_times), dtype=self.dtype)
+        if not self._uniform:
+            return np.stack([self.run(i)[j] for i in range(self.n_runs)])
+        offset = int(self.header['runs_offset']) + 8 * self.n_params + j * self.n_times * self.dtype.itemsize
+        base = np.frombuffer(self._buf, dtype=self.dtype,
+                             count=max(0, (len(self._buf) - offset) // self.dtype.itemsize), offset=offset)
+        return np.lib.stride_tricks.as_strided(
+            base, shape=(self.n_runs, self.n_times),
+            strides=(int(self.header['run_size']), self.dtype.itemsize), writeable=False)
+
+    def to_csv(self, path, i=0):
+        """Write run i in the Time,<species...> layout of the committed CSVs."""
+        table = np.column_stack([self.times, self.run(i).T])
+        np.savetxt(path, table, delimiter=',', header=','.join(['Time'] + self.species),
+                   comments='', fmt='%.17g')
@@ -1,13 +1,16 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <cvode/cvode.h>             // prototypes for CVODE functions and constants
 #include <nvector/nvector_serial.h>  // serial N_Vector types, functions, and macros
 #include <sundials/sundials_math.h>  // definition of SUNRabs
 #include <sunmatrix/sunmatrix_dense.h> // access to dense SUNMatrix
 #include <sunlinsol/sunlinsol_dense.h> // access to dense SUNLinearSolver
-#include <cvode/cvode_direct.h> // access to CVDls interface
 #include <sundials/sundials_types.h>  // defs. of realtype, sunindextype
+#include "../common/output_spec.h"
+#include "../common/solver_stats.h"
+#include "../common/result_cache.h"
 
 // Parameters for the model
 #define BETA_HK 1.0
@@ -25,6 +28,9 @@
 #define KDR 1.0
 #define N 2
 
+// Part of the result cache key: bump it whenever the model above changes
+#define MODEL_VERSION 1
+
 // Function for kap(I)
 realtype kap(realtype I) {
     return KAP_MAX * I / (I + KDA);
@@ -35,6 +41,20 @@ realtype kout(realtype RRp) {
     return KOUT_MAX * pow(RRp / KDR, N) / (pow(RRp / KDR, N) + 1);
 }
 
+// Function to store the state as sample k; output_spec takes double rows, and realtype is
+// float when SUNDIALS is built in single precision. When rows is not NULL the full state is
+// also kept there for the result cache.
+static void store_sample(const output_spec *s, void *out, long k, N_Vector y, double *rows) {
+    double row[8];
+    for (int i = 0; i < 8; i++) {
+        row[i] = NV_Ith_S(y, i);
+    }
+    output_spec_store(s, out, k, row);
+    if (rows != NULL) {
+        memcpy(rows + k * 8, row, sizeof(row));
+    }
+}
+
 // Function to compute the derivatives
 int dichotomous_feedback(realtype t, N_Vector y, N_Vector ydot, void *user_data) {
     realtype *params = (realtype *)user_data;
@@ -61,14 +81,68 @@ int dichotomous_feedback(realtype t, N_Vector y, N_Vector ydot, void *user_data)
     return 0;
 }
 
-// Function to solve the ODE and store results in an array
-void solve_dichotomous_feedback(double *results, int n_steps, double dt, double I) {
+// Function to solve the ODE, write the samples selected by spec straight into out
+// and, when stats is not NULL, fill in the CVODE counters and timings
+int solve_dichotomous_feedback_stats(void *out, const output_spec *spec, int n_steps, double dt, double I,
+                                     solver_stats *stats) {
+    solver_stats st = {0};
+    double mark = solver_stats_clock();
+
+    output_spec s;
+    if (output_spec_resolve(spec, 8, n_steps, &s) != 0) {
+        return -1;
+    }
+
+    // Result cache (BIOCIRCUITS_CACHE): every species at the sample times, whatever the layout of out
+    result_cache *cache = result_cache_default();
+    result_cache_key key;
+    double *rows = NULL;
+    int n_samples = output_spec_num_samples(&s, n_steps);
+    if (cache != NULL) {
+        result_cache_key_init(&key);
+        result_cache_key_add_string(&key, "dichotomous_feedback_sundials");
+        result_cache_key_add_int(&key, MODEL_VERSION);
+        result_cache_key_add_int(&key, sizeof(realtype));
+        result_cache_key_add_int(&key, n_steps);
+        result_cache_key_add_double(&key, dt);
+        result_cache_key_add_double(&key, I);
+        result_cache_key_add_int(&key, s.n_samples > 0 ? 0 : s.stride);
+        result_cache_key_add_int(&key, s.n_samples);
+        if (s.n_samples > 0) {
+            result_cache_key_add(&key, s.sample_times, s.n_samples * sizeof(double));
+        }
+        rows = malloc(sizeof(double) * 8 * (n_samples > 0 ? n_samples : 1));
+        if (rows != NULL && result_cache_get(cache, &key, rows, sizeof(double) * 8 * n_samples) == 0) {
+            for (int k = 0; k < n_samples; k++) {
+                output_spec_store(&s, out, k, rows + k * 8);
+            }
+            st.output_time = solver_stats_lap(&mark);
+            if (stats != NULL) {
+                *stats = st;
+            }
+            solver_stats_report("dichotomous_feedback_sundials", &st, NULL);
+            result_cache_key_free(&key);
+            free(rows);
+            return 0;
+        }
+    }
+
     realtype t0 = 0.0;
     realtype t;
     realtype T = dt * (n_steps - 1);
 
+    // Everything below is released at done, on success and on every error
+    int status = -1;
+    void *cvode_mem = NULL;
+    SUNMatrix A = NULL;
+    SUNLinearSolver LS = NULL;
+
     // Initial conditions
     N_Vector y = N_VNew_Serial(8);
+    if (y == NULL) {
+        fprintf(stderr, "Error in N_VNew_Serial\n");
+        goto done;
+    }
     NV_Ith_S(y, 0) = 0.0;  // HK
     NV_Ith_S(y, 1) = 0.0;  // HKp
     NV_Ith_S(y, 2) = 0.0;  // RR
@@ -82,70 +156,119 @@ void solve_dichotomous_feedback(double *results, int n_steps, double dt, double
     realtype params[1] = {I};
 
     // Create the CVODE memory block
-    void *cvode_mem = CVodeCreate(CV_ADAMS, CV_NEWTON);
+    cvode_mem = CVodeCreate(CV_ADAMS);
     if (cvode_mem == NULL) {
         fprintf(stderr, "Error in CVodeCreate\n");
-        return;
+        goto done;
     }
 
     // Initialize CVODE
     int flag = CVodeInit(cvode_mem, dichotomous_feedback, t0, y);
     if (flag != CV_SUCCESS) {
         fprintf(stderr, "Error in CVodeInit\n");
-        return;
+        goto done;
     }
 
     // Specify the relative and absolute tolerances
     flag = CVodeSStolerances(cvode_mem, 1e-4, 1e-8);
     if (flag != CV_SUCCESS) {
         fprintf(stderr, "Error in CVodeSStolerances\n");
-        return;
+        goto done;
     }
 
     // Create the dense SUNMatrix
-    SUNMatrix A = SUNDenseMatrix(8, 8);
+    A = SUNDenseMatrix(8, 8);
     if (A == NULL) {
         fprintf(stderr, "Error in SUNDenseMatrix\n");
-        return;
+        goto done;
     }
 
     // Create the dense SUNLinearSolver
-    SUNLinearSolver LS = SUNDenseLinearSolver(y, A);
+    LS = SUNLinSol_Dense(y, A);
     if (LS == NULL) {
         fprintf(stderr, "Error in SUNLinSol_Dense\n");
-        return;
+        goto done;
     }
 
     // Attach the linear solver to CVODE
-    flag = CVDlsSetLinearSolver(cvode_mem, LS, A);
+    flag = CVodeSetLinearSolver(cvode_mem, LS, A);
     if (flag != CV_SUCCESS) {
         fprintf(stderr, "Error in CVodeSetLinearSolver\n");
-        return;
+        goto done;
     }
 
     // Set the user data
     flag = CVodeSetUserData(cvode_mem, params);
     if (flag != CV_SUCCESS) {
         fprintf(stderr, "Error in CVodeSetUserData\n");
-        return;
+        goto done;
     }
 
-    // Time-stepping loop
+    st.setup_time = solver_stats_lap(&mark);
+
+    // Time-stepping loop: stop only where a sample is requested
     t = t0;
-    for (int i = 0; i < n_steps; i++) {
-        flag = CVode(cvode_mem, t + dt, y, &t, CV_NORMAL);
-        if (flag != CV_SUCCESS) {
-            fprintf(stderr, "Error in CVode\n");
-            return;
+    if (s.n_samples > 0) {
+        for (int k = 0; k < s.n_samples; k++) {
+            if (s.sample_times[k] > t) {
+                flag = CVode(cvode_mem, s.sample_times[k], y, &t, CV_NORMAL);
+                st.integrate_time += solver_stats_lap(&mark);
+                if (flag != CV_SUCCESS) {
+                    fprintf(stderr, "Error in CVode\n");
+                    goto done;
+                }
+            }
+            store_sample(&s, out, k, y, rows);
+            st.output_time += solver_stats_lap(&mark);
         }
-        for (int j = 0; j < 8; j++) {
-            results[i * 8 + j] = NV_Ith_S(y, j);
+    } else {
+        for (int i = 0; i < n_steps; i++) {
+            flag = CVode(cvode_mem, t + dt, y, &t, CV_NORMAL);
+            st.integrate_time += solver_stats_lap(&mark);
+            if (flag != CV_SUCCESS) {
+                fprintf(stderr, "Error in CVode\n");
+                goto done;
+            }
+            if (i % s.stride == 0) {
+                store_sample(&s, out, i / s.stride, y, rows);
+                st.output_time += solver_stats_lap(&mark);
+            }
         }
     }
 
+    solver_stats_collect_cvode(cvode_mem, &st);
+    if (stats != NULL) {
+        *stats = st;
+    }
+    solver_stats_report("dichotomous_feedback_sundials", &st, NULL);
+    if (cache != NULL && rows != NULL) {
+        result_cache_put(cache, &key, rows, sizeof(double) * 8 * n_samples);
+    }
+    status = 0;
+
+done:
     // Free
-    N_VDestroy(y);
+    if (cache != NULL) {
+        result_cache_key_free(&key);
+    }
+    free(rows);
+    if (y != NULL) {
+        N_VDestroy(y);
+    }
     CVodeFree(&cvode_mem);
     SUNLinSolFree(LS);
     SUNMatDestroy(A);
+
+    return status;
+}
+
+// Function to solve the ODE and write the samples selected by spec straight into out
+int solve_dichotomous_feedback_spec(void *out, const output_spec *spec, int n_steps, double dt, double I) {
+    return solve_dichotomous_feedback_stats(out, spec, n_steps, dt, I, NULL);
+}
+
+// Function to solve the ODE and store results in an array
+void solve_dichotomous_feedback(double *results, int n_steps, double dt, double I) {
+    output_spec spec = {0};  // every species at every step, float64, row-major
+    solve_dichotomous_feedback_spec(results, &spec, n_steps, dt, I);
 }
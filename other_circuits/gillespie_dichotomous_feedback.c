@@ -2,9 +2,19 @@
 #include <stdlib.h>
 #include <math.h>
 #include <time.h>
+#include "../common/output_spec.h"
+#include "../common/solver_stats.h"
+#include "../common/reaction_network.h"
+#include "../common/extrande.h"
 
 #define NUM_REACTIONS 8
 
+// Reaction names, in the order of compute_propensities (used in the statistics)
+static const char *const reaction_names[NUM_REACTIONS] = {
+    "HK_production", "HK_degradation", "HK_autophosphorylation", "HKp_to_RR",
+    "HKp_to_SR", "Output_production", "Output_degradation", "HKp_degradation"
+};
+
 // Parameters for the model
 #define BETA_HK 1.0
 #define BETA_RR 1.0
@@ -52,8 +62,8 @@ void compute_propensities(double *a, double *x, double I) {
     a[7] = DELTA * HKp; // Degradation of HKp
 }
 
-// Perform one step of the Gillespie algorithm
-void gillespie_step(double *x, double I, double *t) {
+// Perform one step of the Gillespie algorithm; returns the reaction that fired, -1 if none
+int gillespie_step(double *x, double I, double *t) {
     double a[NUM_REACTIONS];
     compute_propensities(a, x, I);
 
@@ -62,7 +72,7 @@ void gillespie_step(double *x, double I, double *t) {
         a0 += a[i];
     }
 
-    if (a0 == 0.0) return; // No more reactions
+    if (a0 == 0.0) return -1; // No more reactions
 
     // Determine the time until the next reaction
     double r1 = (double)rand() / RAND_MAX;
@@ -92,19 +102,139 @@ void gillespie_step(double *x, double I, double *t) {
         case 6: x[7] -= 1; break; // Degradation of Output
         case 7: x[1] -= 1; break; // Degradation of HKp
     }
+    return reaction;
 }
 
-// Function to solve the ODE using Gillespie algorithm and store results in an array
-void solve_dichotomous_feedback(double *results, int n_steps, double dt, double I) {
+// Function to run the Gillespie algorithm, write the samples selected by spec
+// straight into out and, when stats is not NULL, fill in the event counts and timings
+int solve_dichotomous_feedback_stats(void *out, const output_spec *spec, int n_steps, double dt, double I,
+                                     solver_stats *stats) {
+    double mark = solver_stats_clock();
+    solver_stats st = {0};
+    st.n_reactions = NUM_REACTIONS;
+
+    output_spec s;
+    if (output_spec_resolve(spec, 8, n_steps, &s) != 0) {
+        return -1;
+    }
+
     double t = 0.0;
     double x[8] = {0.0}; // Initial conditions: all concentrations start at 0
+    st.setup_time = solver_stats_lap(&mark);
 
-    for (int i = 0; i < n_steps; i++) {
-        while (t < i * dt) {
-            gillespie_step(x, I, &t);
+    int n_samples = s.n_samples > 0 ? s.n_samples : n_steps;
+    for (int i = 0; i < n_samples; i++) {
+        double t_sample = s.n_samples > 0 ? s.sample_times[i] : i * dt;
+        if (s.n_samples == 0 && i % s.stride != 0) {
+            continue;
         }
-        for (int j = 0; j < 8; j++) {
-            results[i * 8 + j] = x[j];
+        while (t < t_sample) {
+            int reaction = gillespie_step(x, I, &t);
+            if (reaction < 0) {
+                break; // No more reactions, the state stays as it is
+            }
+            st.reaction_events[reaction]++;
+        }
+        st.integrate_time += solver_stats_lap(&mark);
+        output_spec_store(&s, out, s.n_samples > 0 ? i : i / s.stride, x);
+        st.output_time += solver_stats_lap(&mark);
+    }
+
+    if (stats != NULL) {
+        *stats = st;
+    }
+    solver_stats_report("gillespie_dichotomous_feedback", &st, reaction_names);
+    return 0;
+}
+
+// Function to run the Gillespie algorithm and write the samples selected by spec straight into out
+int solve_dichotomous_feedback_spec(void *out, const output_spec *spec, int n_steps, double dt, double I) {
+    return solve_dichotomous_feedback_stats(out, spec, n_steps, dt, I, NULL);
+}
+
+// Function to solve the ODE using Gillespie algorithm and store results in an array
+void solve_dichotomous_feedback(double *results, int n_steps, double dt, double I) {
+    output_spec spec = {0};  // every species at every step, float64, row-major
+    solve_dichotomous_feedback_spec(results, &spec, n_steps, dt, I);
+}
+
+// Time-varying inputs: the same reactions as "dichotomous_feedback" in common/reaction_network.c,
+// simulated exactly with the thinning solver of common/extrande.c
+
+// Function to simulate one trajectory under the input schedule u with the given seed, write the
+// samples selected by spec straight into out and, when stats is not NULL, fill in the statistics
+int solve_dichotomous_feedback_input(void *out, const output_spec *spec, int n_steps, double dt,
+                                     const input_schedule *u, unsigned long seed, solver_stats *stats) {
+    const reaction_network *net = reaction_network_lookup("dichotomous_feedback");
+    extrande_options options = {0, seed};
+    extrande_solver *s = extrande_create(net, &options);
+    if (s == NULL) {
+        return -1;
+    }
+    int flag = extrande_run(s, NULL, u, NULL, 0, out, spec, n_steps, dt);
+    if (flag == 0) {
+        if (stats != NULL) {
+            *stats = *extrande_stats(s);
         }
+        solver_stats_report("gillespie_dichotomous_feedback_input", extrande_stats(s), net->reaction_names);
+    }
+    extrande_free(s);
+    return flag;
+}
+
+// Function to simulate n_runs trajectories under the input schedule u on threads threads
+// (<= 0: all CPUs); run k is written at out + k * run_stride elements (0: consecutive blocks)
+int solve_dichotomous_feedback_input_ensemble(void *out, const output_spec *spec, long run_stride, int n_runs,
+                                              int n_steps, double dt, const input_schedule *u,
+                                              unsigned long seed, int threads) {
+    const reaction_network *net = reaction_network_lookup("dichotomous_feedback");
+    extrande_options options = {0, seed};
+    solver_stats st;
+    int flag = extrande_ensemble(net, &options, NULL, u, NULL, out, spec, run_stride, n_runs, n_steps, dt,
+                                 threads, &st);
+    if (flag == 0) {
+        solver_stats_report("gillespie_dichotomous_feedback_input_ensemble", &st, net->reaction_names);
+    }
+    return flag;
+}
+
+// Function to simulate n_runs trajectories under a pulse train of the input: high for width
+// at the start of every period, low otherwise
+int solve_dichotomous_feedback_pulses(void *out, const output_spec *spec, long run_stride, int n_runs,
+                                      int n_steps, double dt, double low, double high, double period,
+                                      double width, unsigned long seed, int threads) {
+    if (!(period > 0) || !isfinite(period)) {
+        fprintf(stderr, "Error in solve_dichotomous_feedback_pulses: period must be positive\n");
+        return -1;
+    }
+    if (!(width >= 0 && width <= period)) {
+        fprintf(stderr, "Error in solve_dichotomous_feedback_pulses: width must be in [0, period]\n");
+        return -1;
+    }
+    input_schedule u = {0};
+    u.kind = INPUT_PULSE_TRAIN;
+    u.low = low;
+    u.high = high;
+    u.period = period;
+    u.width = width;
+    return solve_dichotomous_feedback_input_ensemble(out, spec, run_stride, n_runs, n_steps, dt, &u, seed,
+                                                     threads);
+}
+
+// Function to simulate n_runs trajectories with the input given at n_points increasing times,
+// held constant between them (linear == 0) or interpolated linearly
+int solve_dichotomous_feedback_piecewise(void *out, const output_spec *spec, long run_stride, int n_runs,
+                                         int n_steps, double dt, const double *times, const double *values,
+                                         int n_points, int linear, unsigned long seed, int threads) {
+    if (n_points < 1) {
+        fprintf(stderr, "Error in solve_dichotomous_feedback_piecewise: no input points\n");
+        return -1;
     }
+    input_schedule u = {0};
+    u.kind = linear ? INPUT_PIECEWISE_LINEAR : INPUT_PIECEWISE_CONSTANT;
+    u.n_points = n_points;
+    u.times = times;
+    u.values = values;
+    return solve_dichotomous_feedback_input_ensemble(out, spec, run_stride, n_runs, n_steps, dt, &u, seed,
+                                                     threads);
 }
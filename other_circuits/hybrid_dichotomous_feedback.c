@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../common/reaction_network.h"
+#include "../common/hybrid.h"
+
+// Hybrid SSA/ODE version of gillespie_dichotomous_feedback.c: the full
+// reaction list of the ODE model (network "dichotomous_feedback_full" in
+// common/reaction_network.c), with the abundant fast reactions integrated by
+// CVODE and the rest fired one event at a time. Same output layout as the
+// Gillespie library.
+
+#define INPUT_PARAM 14   // I in the parameter vector of the network
+#define DEFAULT_SEED 1
+
+// Function to simulate one trajectory with the given parameters (NULL: the defaults with
+// input I), partition threshold min_count (0 for the default) and seed, write the samples
+// selected by spec straight into out and, when stats is not NULL, fill in the statistics
+int solve_dichotomous_feedback_hybrid(void *out, const output_spec *spec, int n_steps, double dt, double I,
+                                      const double *params, double min_count, unsigned long seed,
+                                      solver_stats *stats) {
+    const reaction_network *net = reaction_network_lookup("dichotomous_feedback_full");
+    double p[16];
+    for (int k = 0; k < net->n_params; k++) {
+        p[k] = params != NULL ? params[k] : net->default_params[k];
+    }
+    if (params == NULL) {
+        p[INPUT_PARAM] = I;
+    }
+
+    hybrid_options options = {min_count, 0, 0, 0, seed};
+    hybrid_solver *s = hybrid_create(net, &options);
+    if (s == NULL) {
+        return -1;
+    }
+    int flag = hybrid_run(s, p, NULL, 0, out, spec, n_steps, dt);
+    if (flag == 0) {
+        if (stats != NULL) {
+            *stats = *hybrid_stats(s);
+        }
+        solver_stats_report("hybrid_dichotomous_feedback", hybrid_stats(s), net->reaction_names);
+    }
+    hybrid_free(s);
+    return flag;
+}
+
+// Function to simulate with the default parameters, write the samples selected by spec
+// straight into out and, when stats is not NULL, fill in the statistics
+int solve_dichotomous_feedback_stats(void *out, const output_spec *spec, int n_steps, double dt, double I,
+                                     solver_stats *stats) {
+    return solve_dichotomous_feedback_hybrid(out, spec, n_steps, dt, I, NULL, 0, DEFAULT_SEED, stats);
+}
+
+// Function to simulate with the default parameters and write the samples selected by spec straight into out
+int solve_dichotomous_feedback_spec(void *out, const output_spec *spec, int n_steps, double dt, double I) {
+    return solve_dichotomous_feedback_stats(out, spec, n_steps, dt, I, NULL);
+}
+
+// Function to run the hybrid simulation and store results in an array
+void solve_dichotomous_feedback(double *results, int n_steps, double dt, double I) {
+    output_spec spec = {0};  // every species at every step, float64, row-major
+    solve_dichotomous_feedback_spec(results, &spec, n_steps, dt, I);
+}
@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../common/reaction_network.h"
+#include "../common/cle.h"
+
+// Chemical Langevin version of gillespie_dichotomous_feedback.c: the same
+// reactions (common/reaction_network.c), the same entry points and the same
+// output layout, with an SDE step instead of one event at a time
+
+#define INPUT_PARAM 14   // I in the parameter vector of the network
+#define DEFAULT_SEED 1
+
+// Function to copy the default parameters with the input I
+static void set_params(const reaction_network *net, double *p, double I) {
+    for (int k = 0; k < net->n_params; k++) {
+        p[k] = net->default_params[k];
+    }
+    p[INPUT_PARAM] = I;
+}
+
+// Function to simulate one trajectory with the given method (CLE_EULER_MARUYAMA
+// or CLE_MILSTEIN), step h (0 for the default) and seed, write the samples
+// selected by spec straight into out and, when stats is not NULL, fill in the statistics
+int solve_dichotomous_feedback_cle(void *out, const output_spec *spec, int n_steps, double dt, double I,
+                                   int method, double h, unsigned long seed, solver_stats *stats) {
+    const reaction_network *net = reaction_network_lookup("dichotomous_feedback");
+    double p[16];
+    set_params(net, p, I);
+
+    cle_options options = {method, h, seed};
+    cle_solver *s = cle_solver_create(net, &options);
+    if (s == NULL) {
+        fprintf(stderr, "Error in cle_solver_create\n");
+        return -1;
+    }
+    int flag = cle_solver_run(s, p, NULL, 0, out, spec, n_steps, dt);
+    if (flag == 0) {
+        if (stats != NULL) {
+            *stats = *cle_solver_stats(s);
+        }
+        solver_stats_report("langevin_dichotomous_feedback", cle_solver_stats(s), NULL);
+    }
+    cle_solver_free(s);
+    return flag;
+}
+
+// Function to simulate n_runs independent trajectories on threads threads (<= 0: all CPUs);
+// run k is written at out + k * run_stride elements (0: consecutive [n_samples][n_species] blocks)
+int solve_dichotomous_feedback_ensemble(void *out, const output_spec *spec, long run_stride, int n_runs,
+                                        int n_steps, double dt, double I, int method, double h,
+                                        unsigned long seed, int threads) {
+    const reaction_network *net = reaction_network_lookup("dichotomous_feedback");
+    double p[16];
+    set_params(net, p, I);
+
+    cle_options options = {method, h, seed};
+    solver_stats st;
+    int flag = cle_ensemble(net, &options, p, NULL, out, spec, run_stride, n_runs, n_steps, dt, threads, &st);
+    if (flag == 0) {
+        solver_stats_report("langevin_dichotomous_feedback_ensemble", &st, NULL);
+    }
+    return flag;
+}
+
+// Function to simulate with Euler-Maruyama, write the samples selected by spec straight
+// into out and, when stats is not NULL, fill in the statistics
+int solve_dichotomous_feedback_stats(void *out, const output_spec *spec, int n_steps, double dt, double I,
+                                     solver_stats *stats) {
+    return solve_dichotomous_feedback_cle(out, spec, n_steps, dt, I, CLE_EULER_MARUYAMA, 0, DEFAULT_SEED, stats);
+}
+
+// Function to simulate with Euler-Maruyama and write the samples selected by spec straight into out
+int solve_dichotomous_feedback_spec(void *out, const output_spec *spec, int n_steps, double dt, double I) {
+    return solve_dichotomous_feedback_stats(out, spec, n_steps, dt, I, NULL);
+}
+
+// Function to solve the chemical Langevin equation and store results in an array
+void solve_dichotomous_feedback(double *results, int n_steps, double dt, double I) {
+    output_spec spec = {0};  // every species at every step, float64, row-major
+    solve_dichotomous_feedback_spec(results, &spec, n_steps, dt, I);
+}
@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "../common/reaction_network.h"
+#include "../common/moments.h"
+#include "../common/circuit_solver.h"
+
+// Mean, covariance and Fano factor of the Gillespie model from one ODE solve
+// of its moment equations (common/moments.c), in place of an SSA ensemble
+
+#define INPUT_PARAM 14   // I in the parameter vector of the network
+
+// Function to solve the moment equations (MOMENTS_LNA or MOMENTS_SECOND_ORDER) and store
+// mean[n_steps][8], cov[n_steps][8][8] and fano[n_steps][8]; cov and fano may be NULL
+int solve_dichotomous_feedback_moments(double *mean, double *cov, double *fano, int n_steps, double dt, double I,
+                                       int closure) {
+    const reaction_network *net = reaction_network_lookup("dichotomous_feedback");
+    int n = net->n_species;
+    moment_model mm;
+    if (moment_model_init(&mm, net, closure) != 0) {
+        return -1;
+    }
+
+    realtype p[MOMENTS_MAX_PARAMS];
+    for (int k = 0; k < net->n_params; k++) {
+        p[k] = net->default_params[k];
+    }
+    p[INPUT_PARAM] = I;
+    realtype *t_out = malloc(n_steps * sizeof(realtype));
+    realtype *y = malloc((size_t)n_steps * mm.n_states * sizeof(realtype));
+    circuit_solver_options options = {0};
+    circuit_solver *s = circuit_solver_create(&mm.model, &options);
+    int flag = -1;
+    if (t_out != NULL && y != NULL && s != NULL) {
+        for (int i = 0; i < n_steps; i++) {
+            t_out[i] = i * dt;
+        }
+        flag = circuit_solver_run(s, p, NULL, t_out, n_steps, y);
+        if (flag != 0) {
+            fprintf(stderr, "Error in circuit_solver_run\n");
+        }
+        solver_stats_report("moments_dichotomous_feedback", circuit_solver_stats(s), NULL);
+    }
+
+    if (flag == 0) {
+        for (int i = 0; i < n_steps; i++) {
+            const realtype *yi = y + (size_t)i * mm.n_states;
+            moment_model_unpack(&mm, yi, mean + (size_t)i * n, cov != NULL ? cov + (size_t)i * n * n : NULL);
+            for (int j = 0; fano != NULL && j < n; j++) {
+                double m = yi[j], var = yi[moment_model_cov_index(&mm, j, j)];
+                fano[(size_t)i * n + j] = m > 0 ? var / m : 0;
+            }
+        }
+    }
+    circuit_solver_free(s);
+    free(t_out);
+    free(y);
+    moment_model_free(&mm);
+    return flag;
+}
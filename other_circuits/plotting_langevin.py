@@ -0,0 +1,47 @@
+import ctypes
+import os
+import sys
+import numpy as np
+import matplotlib.pyplot as plt
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'common'))
+from output_spec import OutputSpec
+
+# Load the shared library
+lib = ctypes.CDLL('./langevin_dichotomous_feedback.so')
+
+# Define the function signature
+lib.solve_dichotomous_feedback_ensemble.argtypes = [ctypes.c_void_p, ctypes.POINTER(OutputSpec), ctypes.c_long, ctypes.c_int,
+                                                    ctypes.c_int, ctypes.c_double, ctypes.c_double, ctypes.c_int,
+                                                    ctypes.c_double, ctypes.c_ulong, ctypes.c_int]
+lib.solve_dichotomous_feedback_ensemble.restype = ctypes.c_int
+
+# Parameters
+n_runs = 1000
+n_steps = 500
+dt = 0.1
+I = 1.0
+MILSTEIN = 1
+results = np.zeros((n_runs, n_steps, 8), dtype=np.float64)
+
+# Call the C function: n_runs trajectories on all CPUs, step 0.01, seed 1; the default
+# spec stores every species at every step, so run k is results[k]
+lib.solve_dichotomous_feedback_ensemble(results.ctypes.data, ctypes.byref(OutputSpec()), 0, n_runs, n_steps, dt, I,
+                                        MILSTEIN, 0.01, 1, 0)
+
+# Plot the ensemble mean and one standard deviation
+t = np.linspace(0, dt * (n_steps - 1), n_steps)
+mean = results.mean(axis=0)
+std = results.std(axis=0)
+plt.figure(figsize=(12, 8))
+
+labels = ["HK", "HKp", "RR", "RRp", "SR", "SRp", "PH", "Output"]
+for i in range(8):
+    plt.plot(t, mean[:, i], label=labels[i])
+    plt.fill_between(t, mean[:, i] - std[:, i], mean[:, i] + std[:, i], alpha=0.2)
+
+plt.xlabel('Time')
+plt.ylabel('Copy number')
+plt.title('Chemical Langevin Equation, mean and standard deviation of %d runs' % n_runs)
+plt.legend()
+plt.show()
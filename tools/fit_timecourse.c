@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../common/circuits.h"
+#include "../common/fit.h"
+
+// Fit parameters of a registry circuit to time-course data (common/fit.c).
+// The CSV has a header "Time,<species>,..." as written by the drivers; every
+// column whose name is a species of the circuit is observed and the others
+// are ignored. The solve starts at t = 0 from the circuit's initial state.
+// Each NAME=lo:hi argument fits one parameter within [lo, hi], in log space;
+// the others keep their defaults. Prints every start and then the best fit.
+//
+// usage: fit_timecourse circuit data.csv NAME=lo:hi ... [starts=N] [threads=N]
+// e.g.   fit_timecourse transcription_translation
+//            1_introduction_biocircuits/transcription_translation_sundials.csv
+//            GAMMA_M=0.01:10 BETA_P=0.01:10   (on one line)
+
+#define MAX_LINE 4096
+#define MAX_COLUMNS 64
+
+// Function to read the observed columns of the CSV; returns the number of rows or -1
+static int read_csv(const char *path, const circuit_model *m, int *n_obs, int *obs_species,
+                    double **times, double **data) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        fprintf(stderr, "Error opening %s\n", path);
+        return -1;
+    }
+    char line[MAX_LINE];
+    int column_species[MAX_COLUMNS], n_columns = 0;
+    *n_obs = 0;
+    if (fgets(line, sizeof(line), f) != NULL) {
+        for (char *tok = strtok(line, ",\r\n"); tok != NULL && n_columns < MAX_COLUMNS; tok = strtok(NULL, ",\r\n")) {
+            int i = n_columns > 0 ? circuit_species_index(m, tok) : -1;
+            column_species[n_columns++] = i;
+            if (i >= 0) {
+                obs_species[(*n_obs)++] = i;
+            }
+        }
+    }
+    if (*n_obs == 0) {
+        fprintf(stderr, "Error: no column of %s is a species of %s\n", path, m->name);
+        fclose(f);
+        return -1;
+    }
+    int n_rows = 0, capacity = 0;
+    *times = NULL;
+    *data = NULL;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (n_rows == capacity) {
+            capacity = capacity > 0 ? 2 * capacity : 256;
+            *times = realloc(*times, sizeof(double) * capacity);
+            *data = realloc(*data, sizeof(double) * capacity * *n_obs);
+            if (*times == NULL || *data == NULL) {
+                fprintf(stderr, "Error: out of memory\n");
+                fclose(f);
+                return -1;
+            }
+        }
+        char *p = line;
+        int o = 0;
+        for (int c = 0; c < n_columns; c++) {
+            char *end;
+            double v = strtod(p, &end);
+            if (end == p) {
+                break;
+            }
+            if (c == 0) {
+                (*times)[n_rows] = v;
+            } else if (column_species[c] >= 0) {
+                (*data)[n_rows * *n_obs + o++] = v;
+            }
+            p = *end == ',' ? end + 1 : end;
+        }
+        if (o == *n_obs) {
+            n_rows++;
+        }
+    }
+    fclose(f);
+    return n_rows;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        fprintf(stderr, "usage: %s circuit data.csv NAME=lo:hi ... [starts=N] [threads=N]\n", argv[0]);
+        return 1;
+    }
+    const circuit_model *m = circuit_lookup(argv[1]);
+    if (m == NULL) {
+        fprintf(stderr, "Error: unknown circuit %s\n", argv[1]);
+        return 1;
+    }
+    fit_options options = {0};
+    options.log_scale = 1;
+    int fit_params[FIT_MAX_PARAMS], n_fit = 0;
+    double lower[FIT_MAX_PARAMS], upper[FIT_MAX_PARAMS];
+    for (int a = 3; a < argc; a++) {
+        if (strncmp(argv[a], "starts=", 7) == 0) {
+            options.n_starts = atoi(argv[a] + 7);
+            continue;
+        }
+        if (strncmp(argv[a], "threads=", 8) == 0) {
+            options.threads = atoi(argv[a] + 8);
+            continue;
+        }
+        char name[256];
+        double lo, hi;
+        if (sscanf(argv[a], "%255[^=]=%lf:%lf", name, &lo, &hi) != 3 || n_fit == FIT_MAX_PARAMS) {
+            fprintf(stderr, "Error: cannot parse %s\n", argv[a]);
+            return 1;
+        }
+        int j = circuit_param_index(m, name);
+        if (j < 0) {
+            fprintf(stderr, "Error: %s has no parameter %s\n", m->name, name);
+            return 1;
+        }
+        fit_params[n_fit] = j;
+        lower[n_fit] = lo;
+        upper[n_fit] = hi;
+        n_fit++;
+    }
+
+    int obs_species[MAX_COLUMNS], n_obs;
+    double *times, *data;
+    int n_times = read_csv(argv[2], m, &n_obs, obs_species, &times, &data);
+    if (n_times <= 0) {
+        return 1;
+    }
+
+    fit_problem problem = {m, NULL, NULL, n_fit, fit_params, lower, upper, n_obs, obs_species, NULL,
+                           0.0, n_times, times, data};
+    int n_starts = options.n_starts > 0 ? options.n_starts : 16;
+    fit_result *results = malloc(sizeof(fit_result) * n_starts);
+    int best = fit_run(&problem, &options, results, NULL);
+    if (best < 0) {
+        fprintf(stderr, "Error in fit_run\n");
+        return 1;
+    }
+
+    printf("Start,Status,Iterations,Cost");
+    for (int k = 0; k < n_fit; k++) {
+        printf(",%s", m->param_names[fit_params[k]]);
+    }
+    printf("\n");
+    for (int s = 0; s < n_starts; s++) {
+        printf("%d,%d,%d,%.6e", s, results[s].status, results[s].iterations, results[s].cost);
+        for (int k = 0; k < n_fit; k++) {
+            printf(",%.6g", results[s].params[k]);
+        }
+        printf("\n");
+    }
+    printf("# best start %d, cost %.6e:", best, results[best].cost);
+    for (int k = 0; k < n_fit; k++) {
+        printf(" %s=%.6g", m->param_names[fit_params[k]], results[best].params[k]);
+    }
+    printf("\n");
+    free(results);
+    free(times);
+    free(data);
+    return 0;
+}
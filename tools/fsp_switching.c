@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../common/reaction_network.h"
+#include "../common/fsp.h"
+
+// Stationary distribution, modes and switching rates of a small reaction
+// network from the finite state projection (common/fsp.c), without SSA
+// ensembles. The box is doubled until the stationary tail mass is below
+// TAIL_TOL. Output is CSV (Count, Probability) of the marginal of one species,
+// preceded by the modes and the mean first passage times between
+// neighbouring modes as '#' comment lines.
+//
+// usage: fsp_switching network [species] [NAME=value ...]
+// e.g.   fsp_switching positive_autoregulation 0 ALPHA=0.2
+
+#define TAIL_TOL 1e-10
+#define MODE_MIN_MASS 1e-3
+#define MAX_MODES 8
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s network [species] [NAME=value ...]\n", argv[0]);
+        return 1;
+    }
+    const reaction_network *net = reaction_network_lookup(argv[1]);
+    if (net == NULL) {
+        fprintf(stderr, "Error: unknown network %s\n", argv[1]);
+        return 1;
+    }
+    int species = 0, first_param = 2;
+    if (argc > 2 && strchr(argv[2], '=') == NULL) {
+        species = atoi(argv[2]);
+        first_param = 3;
+    }
+    if (species < 0 || species >= net->n_species) {
+        fprintf(stderr, "Error: species %d out of range\n", species);
+        return 1;
+    }
+
+    // Parameters: defaults, then NAME=value overrides
+    double params[64];
+    if (net->n_params > 64) {
+        fprintf(stderr, "Error: too many parameters\n");
+        return 1;
+    }
+    memcpy(params, net->default_params, net->n_params * sizeof(double));
+    for (int a = first_param; a < argc; a++) {
+        char *eq = strchr(argv[a], '=');
+        int k = -1;
+        for (int j = 0; eq != NULL && j < net->n_params; j++) {
+            if (strlen(net->param_names[j]) == (size_t)(eq - argv[a]) &&
+                strncmp(net->param_names[j], argv[a], eq - argv[a]) == 0) {
+                k = j;
+            }
+        }
+        if (k < 0) {
+            fprintf(stderr, "Error: unknown parameter %s\n", argv[a]);
+            return 1;
+        }
+        params[k] = atof(eq + 1);
+    }
+
+    // Grow the box until the stationary distribution fits
+    int size[FSP_MAX_SPECIES];
+    for (int i = 0; i < net->n_species; i++) {
+        size[i] = 32;
+    }
+    fsp_solver *s = NULL;
+    double *p = NULL;
+    for (;;) {
+        fsp_free(s);
+        free(p);
+        s = fsp_create(net, params, size, NULL);
+        p = s != NULL ? malloc(fsp_num_states(s) * sizeof(double)) : NULL;
+        if (p == NULL || fsp_stationary(s, NULL, p) != 0) {
+            fsp_free(s);
+            free(p);
+            return 1;
+        }
+        int grown = 0;
+        for (int i = 0; i < net->n_species; i++) {
+            double *marginal = malloc(size[i] * sizeof(double));
+            fsp_marginal(s, p, i, marginal);
+            double tail = 0;
+            for (int j = size[i] - size[i] / 8; j < size[i]; j++) {
+                tail += marginal[j];
+            }
+            free(marginal);
+            if (tail > TAIL_TOL) {
+                size[i] *= 2;
+                grown = 1;
+            }
+        }
+        if (!grown) {
+            break;
+        }
+    }
+
+    int n = fsp_size(s, species);
+    double *marginal = malloc(n * sizeof(double));
+    fsp_marginal(s, p, species, marginal);
+    int modes[MAX_MODES];
+    int n_modes = fsp_modes(marginal, n, MODE_MIN_MASS, modes, MAX_MODES);
+    n_modes = n_modes < MAX_MODES ? n_modes : MAX_MODES;
+
+    printf("# network %s, species %s, %ld states\n", net->name, net->species_names[species], fsp_num_states(s));
+    for (int m = 0; m < n_modes; m++) {
+        printf("# mode %d: %d\n", m, modes[m]);
+    }
+    // Passage between neighbouring modes, starting from the mode itself (other species at 0)
+    for (int m = 0; m + 1 < n_modes; m++) {
+        int from[FSP_MAX_SPECIES] = {0};
+        double up, down;
+        from[species] = modes[m];
+        int flag_up = fsp_mean_first_passage(s, from, species, modes[m + 1], 1, &up);
+        from[species] = modes[m + 1];
+        int flag_down = fsp_mean_first_passage(s, from, species, modes[m], -1, &down);
+        if (flag_up == 0) {
+            printf("# switching %d -> %d: mean first passage %.6g, rate %.6g\n", modes[m], modes[m + 1], up, 1 / up);
+        }
+        if (flag_down == 0) {
+            printf("# switching %d -> %d: mean first passage %.6g, rate %.6g\n", modes[m + 1], modes[m], down, 1 / down);
+        }
+    }
+    printf("Count,Probability\n");
+    for (int j = 0; j < n; j++) {
+        printf("%d,%.6e\n", j, marginal[j]);
+    }
+
+    free(marginal);
+    free(p);
+    fsp_free(s);
+    return 0;
+}
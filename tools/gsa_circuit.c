@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../common/circuits.h"
+#include "../common/circuit_solver.h"
+#include "../common/gsa.h"
+
+// Global sensitivity of scalar outputs of a registry circuit (common/gsa.c).
+// Each OUTPUT is final:SPECIES, peak:SPECIES or response:SPECIES (the time
+// to half way between the initial and final values) on a grid of N_TIMES
+// points over [0, t_end]. NAME=lo:hi arguments select the factors; without
+// any, every parameter except the input varies over [default / 2, 2 default].
+// Factors are sampled in log space. "sobol" prints first-order and total
+// indices from N base rows, "morris" the elementary effects of N
+// trajectories, both with bootstrap intervals, as CSV.
+//
+// usage: gsa_circuit sobol|morris circuit N OUTPUT... [NAME=lo:hi ...] [t_end=T] [threads=N] [seed=S]
+// e.g.   gsa_circuit sobol dichotomous_feedback 4096 final:Output peak:Output response:Output
+
+#define N_TIMES 201
+#define DEFAULT_T_END 100.0
+
+static const char *const kind_names[] = {"final", "peak", "response"};
+
+int main(int argc, char **argv) {
+    if (argc < 5 || (strcmp(argv[1], "sobol") != 0 && strcmp(argv[1], "morris") != 0)) {
+        fprintf(stderr, "usage: %s sobol|morris circuit N OUTPUT... [NAME=lo:hi ...] [t_end=T] [threads=N] [seed=S]\n",
+                argv[0]);
+        return 1;
+    }
+    int morris = strcmp(argv[1], "morris") == 0;
+    const circuit_model *m = circuit_lookup(argv[2]);
+    if (m == NULL) {
+        fprintf(stderr, "Error: unknown circuit %s\n", argv[2]);
+        return 1;
+    }
+    long n_rows = atol(argv[3]);
+    double t_end = DEFAULT_T_END;
+    gsa_options options = {0};
+    options.method = CIRCUIT_BDF;
+    gsa_output outputs[GSA_MAX_OUTPUTS];
+    int factors[GSA_MAX_FACTORS], n_outputs = 0, n_factors = 0;
+    double lower[GSA_MAX_FACTORS], upper[GSA_MAX_FACTORS];
+    for (int a = 4; a < argc; a++) {
+        char name[256];
+        double lo, hi;
+        const char *colon = strchr(argv[a], ':');
+        if (strncmp(argv[a], "t_end=", 6) == 0) {
+            t_end = atof(argv[a] + 6);
+        } else if (strncmp(argv[a], "threads=", 8) == 0) {
+            options.threads = atoi(argv[a] + 8);
+        } else if (strncmp(argv[a], "seed=", 5) == 0) {
+            options.seed = strtoull(argv[a] + 5, NULL, 10);
+        } else if (strchr(argv[a], '=') != NULL) {
+            int j = sscanf(argv[a], "%255[^=]=%lf:%lf", name, &lo, &hi) == 3 ? circuit_param_index(m, name) : -1;
+            if (j < 0 || n_factors == GSA_MAX_FACTORS) {
+                fprintf(stderr, "Error: cannot use factor %s\n", argv[a]);
+                return 1;
+            }
+            factors[n_factors] = j;
+            lower[n_factors] = lo;
+            upper[n_factors] = hi;
+            n_factors++;
+        } else if (colon != NULL && n_outputs < GSA_MAX_OUTPUTS) {
+            int kind = -1;
+            for (int k = 0; k < 3; k++) {
+                if (strncmp(argv[a], kind_names[k], colon - argv[a]) == 0 && strlen(kind_names[k]) == (size_t)(colon - argv[a])) {
+                    kind = k;
+                }
+            }
+            int species = circuit_species_index(m, colon + 1);
+            if (kind < 0 || species < 0) {
+                fprintf(stderr, "Error: cannot use output %s\n", argv[a]);
+                return 1;
+            }
+            outputs[n_outputs].kind = kind;
+            outputs[n_outputs].species = species;
+            n_outputs++;
+        } else {
+            fprintf(stderr, "Error: cannot parse %s\n", argv[a]);
+            return 1;
+        }
+    }
+    if (n_factors == 0) {
+        for (int j = 0; j < m->n_params && n_factors < GSA_MAX_FACTORS; j++) {
+            if (j != m->input_param && m->default_params[j] > 0) {
+                factors[n_factors] = j;
+                lower[n_factors] = m->default_params[j] / 2;
+                upper[n_factors] = m->default_params[j] * 2;
+                n_factors++;
+            }
+        }
+    }
+
+    double times[N_TIMES];
+    for (int k = 0; k < N_TIMES; k++) {
+        times[k] = t_end * k / (N_TIMES - 1);
+    }
+    gsa_problem problem = {m, NULL, NULL, n_factors, factors, lower, upper, 1, n_outputs, outputs, N_TIMES, times};
+
+    if (!morris) {
+        gsa_sobol_result results[GSA_MAX_OUTPUTS];
+        if (gsa_sobol(&problem, &options, n_rows, results) != 0) {
+            fprintf(stderr, "Error in gsa_sobol\n");
+            return 1;
+        }
+        printf("Output,Factor,First,FirstLow,FirstHigh,Total,TotalLow,TotalHigh\n");
+        for (int o = 0; o < n_outputs; o++) {
+            const gsa_sobol_result *r = &results[o];
+            const char *species = m->species_names[outputs[o].species], *kind = kind_names[outputs[o].kind];
+            printf("# %s:%s mean %.6g variance %.6g, %ld rows, %ld failed\n", kind, species, r->mean, r->variance,
+                   r->n_rows, r->n_failed);
+            for (int i = 0; i < n_factors; i++) {
+                printf("%s:%s,%s,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n", kind, species, m->param_names[factors[i]],
+                       r->first[i], r->first_lo[i], r->first_hi[i], r->total[i], r->total_lo[i], r->total_hi[i]);
+            }
+        }
+    } else {
+        gsa_morris_result results[GSA_MAX_OUTPUTS];
+        if (gsa_morris(&problem, &options, n_rows, results) != 0) {
+            fprintf(stderr, "Error in gsa_morris\n");
+            return 1;
+        }
+        printf("Output,Factor,Mu,MuStar,MuStarLow,MuStarHigh,Sigma,SigmaLow,SigmaHigh\n");
+        for (int o = 0; o < n_outputs; o++) {
+            const gsa_morris_result *r = &results[o];
+            const char *species = m->species_names[outputs[o].species], *kind = kind_names[outputs[o].kind];
+            printf("# %s:%s %ld trajectories, %ld failed\n", kind, species, r->n_rows, r->n_failed);
+            for (int i = 0; i < n_factors; i++) {
+                printf("%s:%s,%s,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g\n", kind, species, m->param_names[factors[i]],
+                       r->mu[i], r->mu_star[i], r->mu_star_lo[i], r->mu_star_hi[i], r->sigma[i], r->sigma_lo[i],
+                       r->sigma_hi[i]);
+            }
+        }
+    }
+    return 0;
+}
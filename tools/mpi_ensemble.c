@@ -0,0 +1,268 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mpi.h>
+#include "../common/circuits.h"
+#include "../common/circuit_solver.h"
+#include "../common/reaction_network.h"
+#include "../common/hybrid.h"
+#include "../common/cle.h"
+#include "../common/trajectory_io.h"
+#include "../common/mpi_runner.h"
+
+// Ensembles and sweeps over MPI ranks (common/mpi_runner.c).
+//
+//   ssa NETWORK N     N exact SSA runs of a reaction network (run k uses
+//                     random stream k of seed)
+//   hybrid NETWORK N  N hybrid SSA/ODE runs
+//   cle NETWORK N     N chemical Langevin runs (step h)
+//   ode CIRCUIT AXES  a grid sweep of a registry circuit over
+//                     NAME=lo:hi:n[:log] axes (all combinations, last fastest)
+//
+// NAME=value sets a parameter of every run. Rank 0 prints the mean and
+// standard deviation of every species at t_end and how many items each rank
+// took; out=FILE.bctr writes every trajectory.
+//
+// usage: mpirun -np R mpi_ensemble ssa|hybrid|cle NETWORK N [NAME=value ...] [out=FILE.bctr] [t_end=100] [n_times=101] [threads=N] [seed=S] [chunk=N] [h=0.01]
+//        mpirun -np R mpi_ensemble ode CIRCUIT NAME=lo:hi:n[:log] ... [out=FILE.bctr] [t_end=100] [n_times=101] [threads=N] [chunk=N]
+// e.g.   mpirun -np 4 mpi_ensemble ssa dichotomous_feedback 10000 out=df.bctr t_end=200 n_times=201
+
+#define MAX_AXES 8
+#define SSA 0
+#define HYBRID 1
+#define CLE 2
+#define ODE 3
+
+typedef struct {
+    int mode;
+    const reaction_network *network;
+    const circuit_model *model;
+    double *params;               // fixed parameters (network or circuit)
+    int n_params, n_species;
+    int n_times;
+    double dt;
+    realtype *t_out;
+    int n_axes;
+    int axes[MAX_AXES], counts[MAX_AXES], log_axis[MAX_AXES];
+    double lower[MAX_AXES], upper[MAX_AXES];
+    void **solvers;               // per thread
+    realtype *work;               // per thread: params and out (ode)
+} ensemble_ctx;
+
+static int simulate(long item, int thread, double *params, double *out, void *arg) {
+    ensemble_ctx *e = arg;
+    output_spec spec;
+    memset(&spec, 0, sizeof(spec));
+    memcpy(params, e->params, e->n_params * sizeof(double));
+    switch (e->mode) {
+    case SSA:
+    case HYBRID:
+        return hybrid_run(e->solvers[thread], params, NULL, item, out, &spec, e->n_times, e->dt) == 0 ? 0 : -1;
+    case CLE:
+        return cle_solver_run(e->solvers[thread], params, NULL, item, out, &spec, e->n_times, e->dt) == 0 ? 0 : -1;
+    default: {
+        realtype *p = e->work + (size_t)thread * (e->n_params + (size_t)e->n_times * e->n_species);
+        realtype *y = p + e->n_params;
+        for (long k = e->n_axes - 1, rest = item; k >= 0; rest /= e->counts[k], k--) {
+            double u = e->counts[k] > 1 ? (double)(rest % e->counts[k]) / (e->counts[k] - 1) : 0;
+            params[e->axes[k]] = e->log_axis[k] ? exp(log(e->lower[k]) + u * (log(e->upper[k]) - log(e->lower[k])))
+                                                : e->lower[k] + u * (e->upper[k] - e->lower[k]);
+        }
+        for (int j = 0; j < e->n_params; j++) {
+            p[j] = params[j];
+        }
+        if (circuit_solver_run(e->solvers[thread], p, NULL, e->t_out, e->n_times, y) != 0) {
+            return -1;
+        }
+        for (size_t v = 0; v < (size_t)e->n_times * e->n_species; v++) {
+            out[v] = y[v];
+        }
+        return 0;
+    }
+    }
+}
+
+// Function to print the usage on rank 0 and leave MPI
+static int usage(int rank, const char *program) {
+    if (rank == 0) {
+        fprintf(stderr, "usage: mpirun -np R %s ssa|hybrid|cle NETWORK N [NAME=value ...] [out=FILE.bctr] [t_end=100] [n_times=101] [threads=N] [seed=S] [chunk=N] [h=0.01]\n"
+                        "       mpirun -np R %s ode CIRCUIT NAME=lo:hi:n[:log] ... [out=FILE.bctr] [t_end=100] [n_times=101] [threads=N] [chunk=N]\n",
+                program, program);
+    }
+    MPI_Finalize();
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    int provided, rank, n_ranks;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &n_ranks);
+    if (argc < 4) {
+        return usage(rank, argv[0]);
+    }
+    ensemble_ctx e;
+    memset(&e, 0, sizeof(e));
+    e.mode = strcmp(argv[1], "ssa") == 0 ? SSA : strcmp(argv[1], "hybrid") == 0 ? HYBRID
+           : strcmp(argv[1], "cle") == 0 ? CLE : strcmp(argv[1], "ode") == 0 ? ODE : -1;
+    const char *const *species_names = NULL, *const *param_names = NULL;
+    if (e.mode == ODE) {
+        e.model = circuit_lookup(argv[2]);
+        if (e.model != NULL) {
+            e.n_params = e.model->n_params;
+            e.n_species = e.model->n_species;
+            species_names = e.model->species_names;
+            param_names = e.model->param_names;
+        }
+    } else if (e.mode >= 0) {
+        e.network = reaction_network_lookup(argv[2]);
+        if (e.network != NULL) {
+            e.n_params = e.network->n_params;
+            e.n_species = e.network->n_species;
+            species_names = e.network->species_names;
+            param_names = e.network->param_names;
+        }
+    }
+    if (e.model == NULL && e.network == NULL) {
+        if (rank == 0) {
+            fprintf(stderr, "Error: unknown model %s\n", argv[2]);
+        }
+        return usage(rank, argv[0]);
+    }
+    e.params = malloc(sizeof(double) * e.n_params);
+    for (int j = 0; j < e.n_params; j++) {
+        e.params[j] = e.model != NULL ? e.model->default_params[j] : e.network->default_params[j];
+    }
+
+    mpi_run_config config = {e.mode == ODE ? 1 : atol(argv[3]), e.n_species, species_names, e.n_params,
+                             param_names, 101, NULL, NULL, TRAJ_FLOAT64, 0, 0};
+    double t_end = 100, h = 0.01;
+    uint64_t seed = 0;
+    for (int a = e.mode == ODE ? 3 : 4; a < argc; a++) {
+        char name[256], scale[8] = "";
+        double lo, hi;
+        int count;
+        int j = -1;
+        if (strncmp(argv[a], "out=", 4) == 0) {
+            config.path = argv[a] + 4;
+        } else if (strncmp(argv[a], "t_end=", 6) == 0) {
+            t_end = atof(argv[a] + 6);
+        } else if (strncmp(argv[a], "n_times=", 8) == 0) {
+            config.n_times = atoi(argv[a] + 8);
+        } else if (strncmp(argv[a], "threads=", 8) == 0) {
+            config.threads = atoi(argv[a] + 8);
+        } else if (strncmp(argv[a], "chunk=", 6) == 0) {
+            config.chunk = atol(argv[a] + 6);
+        } else if (strncmp(argv[a], "seed=", 5) == 0) {
+            seed = strtoull(argv[a] + 5, NULL, 10);
+        } else if (strncmp(argv[a], "h=", 2) == 0) {
+            h = atof(argv[a] + 2);
+        } else if (e.mode == ODE && e.n_axes < MAX_AXES &&
+                   sscanf(argv[a], "%255[^=]=%lf:%lf:%d:%7s", name, &lo, &hi, &count, scale) >= 4 &&
+                   (j = circuit_param_index(e.model, name)) >= 0 && count >= 1) {
+            e.axes[e.n_axes] = j;
+            e.lower[e.n_axes] = lo;
+            e.upper[e.n_axes] = hi;
+            e.counts[e.n_axes] = count;
+            e.log_axis[e.n_axes] = strcmp(scale, "log") == 0 && lo > 0;
+            config.n_items *= count;
+            e.n_axes++;
+        } else {
+            const char *eq = strchr(argv[a], '=');
+            j = -1;
+            for (int k = 0; k < e.n_params && eq != NULL; k++) {
+                if (strlen(param_names[k]) == (size_t)(eq - argv[a]) && strncmp(param_names[k], argv[a], eq - argv[a]) == 0) {
+                    e.params[k] = atof(eq + 1);
+                    j = k;
+                }
+            }
+            if (j < 0) {
+                if (rank == 0) {
+                    fprintf(stderr, "Error: cannot use %s\n", argv[a]);
+                }
+                return usage(rank, argv[0]);
+            }
+        }
+    }
+    if (config.n_times < 2) {
+        config.n_times = 2;
+    }
+    e.n_times = config.n_times;
+    e.dt = t_end / (e.n_times - 1);
+    double *times = malloc(sizeof(double) * e.n_times);
+    e.t_out = malloc(sizeof(realtype) * e.n_times);
+    for (int k = 0; k < e.n_times; k++) {
+        times[k] = k * e.dt;
+        e.t_out[k] = times[k];
+    }
+    config.times = times;
+
+    // Per-thread solvers, sized before the run
+    int threads = mpi_run_threads(MPI_COMM_WORLD, config.threads);
+    config.threads = threads;
+    e.solvers = calloc(threads, sizeof(void *));
+    if (e.mode == ODE) {
+        e.work = malloc(sizeof(realtype) * threads * (e.n_params + (size_t)e.n_times * e.n_species));
+    }
+    int ok = e.solvers != NULL;
+    for (int t = 0; ok && t < threads; t++) {
+        if (e.mode == ODE) {
+            circuit_solver_options so = {0, 0, 0, CIRCUIT_BDF};
+            e.solvers[t] = circuit_solver_create(e.model, &so);
+        } else if (e.mode == CLE) {
+            cle_options co = {CLE_EULER_MARUYAMA, h, seed};
+            e.solvers[t] = cle_solver_create(e.network, &co);
+        } else {
+            hybrid_options ho = {e.mode == SSA ? INFINITY : 0, 0, 0, 0, seed};
+            e.solvers[t] = hybrid_create(e.network, &ho);
+        }
+        ok = e.solvers[t] != NULL;
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: cannot create the solvers on rank %d\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    size_t n_stats = (size_t)e.n_times * e.n_species;
+    mpi_run_result result;
+    memset(&result, 0, sizeof(result));
+    result.mean = rank == 0 ? malloc(sizeof(double) * n_stats) : NULL;
+    result.variance = rank == 0 ? malloc(sizeof(double) * n_stats) : NULL;
+    double start = MPI_Wtime();
+    int flag = mpi_run(MPI_COMM_WORLD, &config, simulate, &e, &result);
+    double seconds = MPI_Wtime() - start;
+    long *per_rank = rank == 0 ? malloc(sizeof(long) * n_ranks) : NULL;
+    MPI_Gather(&result.n_local, 1, MPI_LONG, per_rank, 1, MPI_LONG, 0, MPI_COMM_WORLD);
+    if (rank == 0 && flag == 0) {
+        printf("# %ld items on %d ranks x %d threads in %.3f s, %ld failed; items per rank:", config.n_items,
+               n_ranks, threads, seconds, result.n_failed);
+        for (int r = 0; r < n_ranks; r++) {
+            printf(" %ld", per_rank[r]);
+        }
+        printf("\nSpecies,Mean,SD\n");
+        for (int i = 0; i < e.n_species; i++) {
+            size_t k = (size_t)(e.n_times - 1) * e.n_species + i;
+            printf("%s,%.10g,%.10g\n", species_names[i], result.mean[k], sqrt(result.variance[k]));
+        }
+    }
+    for (int t = 0; t < threads; t++) {
+        if (e.mode == ODE) {
+            circuit_solver_free(e.solvers[t]);
+        } else if (e.mode == CLE) {
+            cle_solver_free(e.solvers[t]);
+        } else {
+            hybrid_free(e.solvers[t]);
+        }
+    }
+    free(per_rank);
+    free(result.mean);
+    free(result.variance);
+    free(e.solvers);
+    free(e.work);
+    free(e.params);
+    free(e.t_out);
+    free(times);
+    MPI_Finalize();
+    return flag != 0;
+}
@@ -0,0 +1,332 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../common/circuits.h"
+#include "../common/circuit_solver.h"
+#include "../common/periodic.h"
+#include "../common/output_pipeline.h"
+
+// Periodic steady state and Floquet multipliers of a periodically forced
+// registry circuit by shooting (common/periodic.c), for one forcing period
+// or a frequency-response sweep over many.
+//
+// The forcing is the circuit's own (repression_intervals, whose PERIOD
+// parameter follows period= and whose square wave switches at half period)
+// or forcing=sine|square on the input parameter (X of ffl, I of
+// dichotomous_feedback, or input=NAME): mean + amplitude sin(2 pi t / T), or
+// mean + amplitude in the first half period and mean - amplitude in the
+// second. mean defaults to the parameter's value and amplitude to mean.
+// breaks=f,... are extra jump times as fractions of the period.
+//
+// period=lo:hi:n[:log] sweeps n periods, each orbit starting Newton from the
+// previous one. One CSV row per period on stdout: Newton iterations, period
+// integrations, residual, largest multiplier modulus, stability, the min,
+// max and mean of each species over the orbit and the multipliers;
+// orbit=PATH writes the orbit of the last period (Time, species...).
+//
+// usage: periodic_orbit circuit [period=T|lo:hi:n[:log]] [forcing=sine|square] [input=NAME] [mean=M] [amplitude=A]
+//                       [breaks=f,...] [monodromy=variational|fd] [tol=1e-6] [max_iter=20] [warmup=1]
+//                       [points=201] [orbit=PATH] [NAME=value ...] [rtol=1e-8] [atol=1e-10] [method=bdf|adams|auto]
+// e.g.   periodic_orbit repression_intervals period=1:1000:31:log
+//        periodic_orbit ffl forcing=sine period=10:10000:13:log amplitude=0.5 orbit=ffl_orbit.csv
+
+#define NO_FORCING 0
+#define SINE 1
+#define SQUARE 2
+#define DEFAULT_POINTS 201
+#define MAX_STEPS 1000000    // one CVode call covers a whole piece of a period
+
+typedef struct {
+    int shape;
+    double mean, amplitude, period;
+} forcing;
+
+// Function to add the statistics of one orbit to the totals
+static void add_stats(solver_stats *total, const solver_stats *st) {
+    total->n_steps += st->n_steps;
+    total->n_rhs_evals += st->n_rhs_evals;
+    total->n_jac_evals += st->n_jac_evals;
+    total->n_lin_setups += st->n_lin_setups;
+    total->n_nonlin_iters += st->n_nonlin_iters;
+    total->n_nonlin_conv_fails += st->n_nonlin_conv_fails;
+    total->n_err_test_fails += st->n_err_test_fails;
+    total->n_method_switches += st->n_method_switches;
+    total->last_step = st->last_step;
+    total->setup_time += st->setup_time;
+    total->integrate_time += st->integrate_time;
+    total->output_time += st->output_time;
+}
+
+// Function to evaluate the forcing at time t
+static double forcing_value(double t, void *ctx) {
+    const forcing *f = ctx;
+    if (f->shape == SINE) {
+        return f->mean + f->amplitude * sin(2 * M_PI * t / f->period);
+    }
+    return f->mean + (fmod(t, f->period) < f->period / 2 ? f->amplitude : -f->amplitude);
+}
+
+// Function to parse lo:hi:n[:log] or a single value into the list of periods; returns their number
+static int parse_periods(const char *arg, double **periods) {
+    double lo, hi;
+    int n = 1;
+    char scale[8] = "";
+    int fields = sscanf(arg, "%lf:%lf:%d:%7s", &lo, &hi, &n, scale);
+    if (fields == 1) {
+        hi = lo;
+        n = 1;
+    } else if (fields < 3 || n < 1 || !(lo > 0) || !(hi > 0)) {
+        return -1;
+    }
+    *periods = malloc(sizeof(double) * n);
+    if (*periods == NULL) {
+        return -1;
+    }
+    int log_scale = strcmp(scale, "log") == 0;
+    for (int k = 0; k < n; k++) {
+        double w = n > 1 ? (double)k / (n - 1) : 0;
+        (*periods)[k] = log_scale ? lo * pow(hi / lo, w) : lo + (hi - lo) * w;
+    }
+    return n;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s circuit [period=T|lo:hi:n[:log]] [forcing=sine|square] [input=NAME] [mean=M] "
+                        "[amplitude=A] [breaks=f,...] [monodromy=variational|fd] [tol=1e-6] [max_iter=20] "
+                        "[warmup=1] [points=201] [orbit=PATH] [NAME=value ...] [rtol=1e-8] [atol=1e-10] "
+                        "[method=bdf|adams|auto]\n",
+                argv[0]);
+        return 1;
+    }
+    const circuit_model *m = circuit_lookup(argv[1]);
+    if (m == NULL) {
+        fprintf(stderr, "Error: unknown circuit %s\n", argv[1]);
+        return 1;
+    }
+    int n = m->n_species;
+    realtype *params = malloc(sizeof(realtype) * m->n_params);
+    realtype *y = malloc(sizeof(realtype) * n);
+    if (params == NULL || y == NULL) {
+        return 1;
+    }
+    memcpy(params, m->default_params, sizeof(realtype) * m->n_params);
+    memcpy(y, m->default_y0, sizeof(realtype) * n);
+    circuit_solver_options solver_options = {1e-8, 1e-10, MAX_STEPS, CIRCUIT_BDF};
+    periodic_options options = {0};
+    options.warmup = 1;
+    forcing f = {NO_FORCING, NAN, NAN, 0};
+    int param = m->input_param, points = DEFAULT_POINTS, n_fractions = 0;
+    double fractions[PERIODIC_MAX_BREAKS];
+    const char *period_arg = NULL, *orbit_path = NULL;
+    for (int a = 2; a < argc; a++) {
+        char name[256];
+        double value;
+        if (strncmp(argv[a], "period=", 7) == 0) {
+            period_arg = argv[a] + 7;
+        } else if (strncmp(argv[a], "forcing=", 8) == 0) {
+            f.shape = strcmp(argv[a] + 8, "square") == 0 ? SQUARE : SINE;
+        } else if (strncmp(argv[a], "input=", 6) == 0) {
+            param = circuit_param_index(m, argv[a] + 6);
+        } else if (strncmp(argv[a], "mean=", 5) == 0) {
+            f.mean = atof(argv[a] + 5);
+        } else if (strncmp(argv[a], "amplitude=", 10) == 0) {
+            f.amplitude = atof(argv[a] + 10);
+        } else if (strncmp(argv[a], "breaks=", 7) == 0) {
+            for (char *p = argv[a] + 7, *end; *p != '\0' && n_fractions < PERIODIC_MAX_BREAKS - 1; p = end + (*end == ',')) {
+                fractions[n_fractions++] = strtod(p, &end);
+                if (end == p) {
+                    fprintf(stderr, "Error: cannot use %s\n", argv[a]);
+                    return 1;
+                }
+            }
+        } else if (strncmp(argv[a], "monodromy=", 10) == 0) {
+            options.monodromy = strcmp(argv[a] + 10, "fd") == 0 ? PERIODIC_FINITE_DIFFERENCE : PERIODIC_VARIATIONAL;
+        } else if (strncmp(argv[a], "tol=", 4) == 0) {
+            options.tol = atof(argv[a] + 4);
+        } else if (strncmp(argv[a], "max_iter=", 9) == 0) {
+            options.max_iter = atoi(argv[a] + 9);
+        } else if (strncmp(argv[a], "warmup=", 7) == 0) {
+            options.warmup = atoi(argv[a] + 7);
+        } else if (strncmp(argv[a], "points=", 7) == 0) {
+            points = atoi(argv[a] + 7);
+        } else if (strncmp(argv[a], "orbit=", 6) == 0) {
+            orbit_path = argv[a] + 6;
+        } else if (strncmp(argv[a], "rtol=", 5) == 0) {
+            solver_options.rtol = atof(argv[a] + 5);
+        } else if (strncmp(argv[a], "atol=", 5) == 0) {
+            solver_options.atol = atof(argv[a] + 5);
+        } else if (strncmp(argv[a], "method=", 7) == 0) {
+            solver_options.method = strcmp(argv[a] + 7, "adams") == 0 ? CIRCUIT_ADAMS
+                                  : strcmp(argv[a] + 7, "auto") == 0  ? CIRCUIT_AUTO
+                                                                      : CIRCUIT_BDF;
+        } else if (sscanf(argv[a], "%255[^=]=%lf", name, &value) == 2 && circuit_param_index(m, name) >= 0) {
+            params[circuit_param_index(m, name)] = value;
+        } else if (sscanf(argv[a], "%255[^=]=%lf", name, &value) == 2 && circuit_species_index(m, name) >= 0) {
+            y[circuit_species_index(m, name)] = value;
+        } else {
+            fprintf(stderr, "Error: cannot use %s\n", argv[a]);
+            return 1;
+        }
+    }
+
+    // The forcing: the circuit's own PERIOD, or a wave on the input parameter
+    int period_param = circuit_param_index(m, "PERIOD");
+    if (f.shape == NO_FORCING && period_param < 0) {
+        fprintf(stderr, "Error: %s has no PERIOD parameter, force it with forcing=sine|square\n", m->name);
+        return 1;
+    }
+    if (f.shape != NO_FORCING && param < 0) {
+        fprintf(stderr, "Error: %s has no input parameter, name one with input=NAME\n", m->name);
+        return 1;
+    }
+    if (f.shape != NO_FORCING) {
+        f.mean = isnan(f.mean) ? params[param] : f.mean;
+        f.amplitude = isnan(f.amplitude) ? f.mean : f.amplitude;
+    }
+    if (f.shape == SQUARE || f.shape == NO_FORCING) {
+        fractions[n_fractions++] = 0.5;   // the square waves switch at half period, with any breaks= too
+    }
+    // Breaks in increasing order, once each
+    for (int b = 1; b < n_fractions; b++) {
+        double v = fractions[b];
+        int c = b - 1;
+        for (; c >= 0 && fractions[c] > v; c--) {
+            fractions[c + 1] = fractions[c];
+        }
+        fractions[c + 1] = v;
+    }
+    double *periods = NULL;
+    int n_periods = parse_periods(period_arg != NULL ? period_arg : "10", &periods);
+    if (period_arg == NULL && period_param >= 0) {
+        periods[0] = params[period_param];
+    }
+    if (n_periods < 1 || points < 2) {
+        fprintf(stderr, "Error: period must be T or lo:hi:n[:log] with positive ends, points at least 2\n");
+        return 1;
+    }
+
+    periodic_solver *ps = periodic_solver_create(m, &solver_options);
+    realtype *orbit = malloc(sizeof(realtype) * points * n);
+    if (ps == NULL || orbit == NULL) {
+        return 1;
+    }
+    if (f.shape != NO_FORCING) {
+        periodic_solver_set_input(ps, param, forcing_value, &f);
+    }
+
+    printf("period,iterations,period_integrations,residual,max_multiplier,stable");
+    for (int i = 0; i < n; i++) {
+        printf(",%s_min,%s_max,%s_mean", m->species_names[i], m->species_names[i], m->species_names[i]);
+    }
+    for (int i = 0; i < n; i++) {
+        printf(",multiplier%d_re,multiplier%d_im", i + 1, i + 1);
+    }
+    printf("\n");
+
+    periodic_result r;
+    solver_stats total = {0};
+    long n_integrations = 0;
+    double orbit_period = NAN;   // period of the orbit sampled last
+    int status = 0;
+    for (int k = 0; k < n_periods && status == 0; k++) {
+        double T = periods[k];
+        options.period = T;
+        options.n_breaks = 0;
+        for (int b = 0; b < n_fractions; b++) {
+            if (fractions[b] > 0 && fractions[b] < 1 && (b == 0 || fractions[b] > fractions[b - 1])) {
+                options.breaks[options.n_breaks++] = fractions[b] * T;
+            }
+        }
+        f.period = T;
+        if (period_param >= 0) {
+            params[period_param] = T;
+        }
+        int flag = periodic_solve(ps, params, y, &options, &r);
+        add_stats(&total, &r.stats);
+        n_integrations += r.n_periods;
+        if (flag < 0 || (flag == 0 && periodic_solver_sample(ps, params, r.y0, &options, points, orbit) != 0)) {
+            status = 1;
+            break;
+        }
+        if (flag == 1) {
+            fprintf(stderr, "Warning: no periodic orbit at period %g (residual %g after %d iterations)\n", T,
+                    r.residual, r.n_iter);
+            printf("%.10g,%d,%ld,%.3g,%.6g,nan", T, r.n_iter, r.n_periods, r.residual, r.max_multiplier);
+            for (int i = 0; i < 3 * n + 2 * n; i++) {
+                printf(",nan");
+            }
+            printf("\n");
+            continue;
+        }
+        // The next period starts Newton from this orbit
+        memcpy(y, r.y0, sizeof(realtype) * n);
+        orbit_period = T;
+
+        printf("%.10g,%d,%ld,%.3g,%.6g,%d", T, r.n_iter, r.n_periods, r.residual, r.max_multiplier,
+               r.max_multiplier < 1);
+        for (int i = 0; i < n; i++) {
+            double lo = INFINITY, hi = -INFINITY, sum = 0;
+            for (int p = 0; p < points; p++) {
+                double v = orbit[p * n + i];
+                lo = fmin(lo, v);
+                hi = fmax(hi, v);
+                // Trapezoidal mean over the period
+                sum += p == 0 || p == points - 1 ? v / 2 : v;
+            }
+            printf(",%.10g,%.10g,%.10g", lo, hi, sum / (points - 1));
+        }
+        for (int i = 0; i < n; i++) {
+            printf(",%.6g,%.6g", r.multiplier_re[i], r.multiplier_im[i]);
+        }
+        printf("\n");
+    }
+
+    if (status == 0 && orbit_path != NULL && !isnan(orbit_period)) {
+        const char **columns = malloc(sizeof(char *) * (n + 1));
+        columns[0] = "Time";
+        for (int i = 0; i < n; i++) {
+            columns[1 + i] = m->species_names[i];
+        }
+        output_config config = {.format = OUTPUT_AUTO, .n_columns = n + 1, .column_names = columns};
+        output_pipeline *out = output_pipeline_open(orbit_path, &config);
+        if (out == NULL) {
+            fprintf(stderr, "Error: cannot open %s\n", orbit_path);
+            status = 1;
+        } else {
+            output_stream *stream = output_stream_open(out, NULL);
+            double *row = malloc(sizeof(double) * (n + 1));
+            if (stream == NULL || row == NULL) {
+                fprintf(stderr, "Error: out of memory writing %s\n", orbit_path);
+                status = 1;
+            }
+            for (int p = 0; p < points && stream != NULL && row != NULL; p++) {
+                row[0] = orbit_period * p / (points - 1);
+                for (int i = 0; i < n; i++) {
+                    row[1 + i] = orbit[p * n + i];
+                }
+                output_stream_write(stream, row);
+            }
+            free(row);
+            if (stream != NULL) {
+                output_stream_close(stream);
+            }
+            if (output_pipeline_close(out) != 0) {
+                status = 1;
+            }
+        }
+        free(columns);
+    }
+
+    solver_stats_report("periodic_orbit", &total, NULL);
+    fprintf(stderr, "%d periods, %ld period integrations (%.1f per period), %ld steps\n", n_periods, n_integrations,
+            (double)n_integrations / n_periods, total.n_steps);
+
+    free(periods);
+    free(orbit);
+    periodic_solver_free(ps);
+    free(params);
+    free(y);
+    return status;
+}
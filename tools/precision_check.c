@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../common/circuits.h"
+#include "../common/circuit_solver.h"
+#include "../common/trajectory_io.h"
+
+// Accuracy of a single-precision build against the double one
+//
+// "write" solves every registry circuit with its defaults and the drivers'
+// tolerances (rtol 1e-4, atol 1e-8) and stores the trajectories as
+// DIR/<circuit>.bctr. Run it from a build against a double SUNDIALS and from
+// one against a single-precision SUNDIALS (realtype float), then "compare"
+// prints, per circuit, the largest difference relative to each species'
+// largest value in the reference, and the matching number of significant
+// digits.
+//
+// usage: precision_check write DIR
+//        precision_check compare REFERENCE_DIR DIR
+
+#define T_END 100.0
+#define N_TIMES 201
+
+// Function to solve every circuit and write DIR/<circuit>.bctr
+static int write_all(const char *dir) {
+    double times[N_TIMES];
+    realtype t_out[N_TIMES];
+    for (int k = 0; k < N_TIMES; k++) {
+        times[k] = T_END * k / (N_TIMES - 1);
+        t_out[k] = times[k];
+    }
+    printf("# realtype has %d bytes\n", (int)sizeof(realtype));
+    for (int c = 0; c < circuit_count(); c++) {
+        const circuit_model *m = circuit_at(c);
+        int n = m->n_species;
+        realtype *out = malloc(sizeof(realtype) * N_TIMES * n);
+        double *data = malloc(sizeof(double) * N_TIMES * n);
+        circuit_solver *s = circuit_solver_create(m, NULL);
+        if (out == NULL || data == NULL || s == NULL) {
+            fprintf(stderr, "Error in circuit_solver_create\n");
+            return 1;
+        }
+        int flag = circuit_solver_run(s, NULL, NULL, t_out, N_TIMES, out);
+        circuit_solver_free(s);
+        if (flag != 0) {
+            fprintf(stderr, "Error solving %s: flag %d\n", m->name, flag);
+            free(out);
+            free(data);
+            continue;
+        }
+        for (int k = 0; k < N_TIMES * n; k++) {
+            data[k] = out[k];
+        }
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%s.bctr", dir, m->name);
+        traj_writer *w = traj_writer_open(path, TRAJ_FLOAT64, n, m->species_names, 0, NULL, times, N_TIMES);
+        if (w == NULL || traj_writer_append(w, NULL, data, TRAJ_ROW_MAJOR) != 0 || traj_writer_close(w) != 0) {
+            fprintf(stderr, "Error writing %s\n", path);
+            return 1;
+        }
+        printf("%s\n", path);
+        free(out);
+        free(data);
+    }
+    return 0;
+}
+
+// Function to compare the files of every circuit found in both directories
+static int compare_all(const char *reference_dir, const char *dir) {
+    printf("Circuit,MaxAbsError,MaxRelError,Digits\n");
+    for (int c = 0; c < circuit_count(); c++) {
+        const circuit_model *m = circuit_at(c);
+        char path_a[4096], path_b[4096];
+        snprintf(path_a, sizeof(path_a), "%s/%s.bctr", reference_dir, m->name);
+        snprintf(path_b, sizeof(path_b), "%s/%s.bctr", dir, m->name);
+        traj_reader *a = traj_reader_open(path_a);
+        traj_reader *b = a != NULL ? traj_reader_open(path_b) : NULL;
+        if (b == NULL) {
+            traj_reader_close(a);
+            continue;
+        }
+        const struct traj_header *ha = traj_reader_header(a), *hb = traj_reader_header(b);
+        if (ha->n_species != hb->n_species || ha->n_times != hb->n_times) {
+            fprintf(stderr, "Error: %s and %s do not match\n", path_a, path_b);
+        } else {
+            double max_abs = 0, max_rel = 0;
+            for (uint32_t i = 0; i < ha->n_species; i++) {
+                double scale = 0, diff = 0;
+                for (uint64_t k = 0; k < ha->n_times; k++) {
+                    double va = traj_reader_value(a, 0, i, k), vb = traj_reader_value(b, 0, i, k);
+                    scale = fmax(scale, fabs(va));
+                    diff = fmax(diff, fabs(va - vb));
+                }
+                max_abs = fmax(max_abs, diff);
+                if (scale > 0) {
+                    max_rel = fmax(max_rel, diff / scale);
+                }
+            }
+            printf("%s,%.3e,%.3e,%.1f\n", m->name, max_abs, max_rel, max_rel > 0 ? -log10(max_rel) : INFINITY);
+        }
+        traj_reader_close(a);
+        traj_reader_close(b);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 3 && strcmp(argv[1], "write") == 0) {
+        return write_all(argv[2]);
+    }
+    if (argc == 4 && strcmp(argv[1], "compare") == 0) {
+        return compare_all(argv[2], argv[3]);
+    }
+    fprintf(stderr, "usage: %s write DIR\n       %s compare REFERENCE_DIR DIR\n", argv[0], argv[0]);
+    return 1;
+}
@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../common/circuits.h"
+#include "../common/circuit_solver.h"
+#include "../common/regime_map.h"
+
+// Boundary of a dynamical regime of a registry circuit over 1 to 6
+// parameters, by adaptive refinement (common/regime_map.c). Criteria:
+//
+//   bistable:SPECIES:HIGH  runs from SPECIES = 0 and SPECIES = HIGH (the rest
+//                          at the default y0) end apart: class 1, else 0
+//   pulse:SPECIES[:REL]    SPECIES peaks above (1 + REL) times its final
+//                          value (REL defaults to 0.1): class 1, else 0
+//
+// Each NAME=lo:hi argument is one axis, NAME=lo:hi:log a log-scaled one.
+// Prints the finest boundary cells (centre and half-widths) as CSV, or every
+// classified point with "points", and the number of runs against a uniform
+// grid of the same resolution.
+//
+// usage: regime_map circuit CRITERION NAME=lo:hi[:log] ... [coarse=8] [levels=5] [t_end=T] [threads=N] [points]
+// e.g.   regime_map positive_autoregulation bistable:Protein_concentration:100 BETA=1:20 K=1:10
+//        regime_map iffl pulse:Y_Concentration PRODUCTION_RATE_X=0.01:1:log HILL_COEFFICIENT=0.5:4
+
+#define BISTABLE 0
+#define PULSE 1
+#define N_TIMES 401
+#define DEFAULT_T_END 200.0
+#define SEPARATION_TOL 1e-2      // relative difference of the two final states that counts as bistable
+
+typedef struct {
+    const circuit_model *model;
+    int criterion;
+    int species;
+    double level;                // HIGH or REL
+    int n_axes;
+    int axes[REGIME_MAP_MAX_DIM];
+    realtype t_out[N_TIMES];
+    circuit_solver **solvers;    // one per thread
+    realtype *work;              // per thread: params, y0, out
+} classify_ctx;
+
+// Function to classify one parameter point
+static int classify(const double *x, int thread, void *arg) {
+    classify_ctx *ctx = arg;
+    const circuit_model *m = ctx->model;
+    int n = m->n_species;
+    realtype *params = ctx->work + (size_t)thread * (m->n_params + n + N_TIMES * (size_t)n);
+    realtype *y0 = params + m->n_params, *out = y0 + n;
+    for (int k = 0; k < ctx->n_axes; k++) {
+        params[ctx->axes[k]] = x[k];
+    }
+    circuit_solver *s = ctx->solvers[thread];
+    const realtype *last = out + (size_t)(N_TIMES - 1) * n;
+    if (ctx->criterion == PULSE) {
+        if (circuit_solver_run(s, params, NULL, ctx->t_out, N_TIMES, out) != 0) {
+            return -1;
+        }
+        double peak = 0;
+        for (int k = 0; k < N_TIMES; k++) {
+            peak = fmax(peak, out[(size_t)k * n + ctx->species]);
+        }
+        return peak > (1 + ctx->level) * last[ctx->species];
+    }
+    memcpy(y0, m->default_y0, n * sizeof(realtype));
+    y0[ctx->species] = 0;
+    if (circuit_solver_run(s, params, y0, ctx->t_out, N_TIMES, out) != 0) {
+        return -1;
+    }
+    double low = last[ctx->species];
+    memcpy(y0, m->default_y0, n * sizeof(realtype));
+    y0[ctx->species] = ctx->level;
+    if (circuit_solver_run(s, params, y0, ctx->t_out, N_TIMES, out) != 0) {
+        return -1;
+    }
+    double high = last[ctx->species];
+    return fabs(high - low) > SEPARATION_TOL * fmax(fabs(high), fabs(low)) + 1e-9;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        fprintf(stderr, "usage: %s circuit CRITERION NAME=lo:hi[:log] ... [coarse=8] [levels=5] [t_end=T] [threads=N] [points]\n",
+                argv[0]);
+        return 1;
+    }
+    classify_ctx ctx = {0};
+    const circuit_model *m = ctx.model = circuit_lookup(argv[1]);
+    if (m == NULL) {
+        fprintf(stderr, "Error: unknown circuit %s\n", argv[1]);
+        return 1;
+    }
+    char species[256];
+    ctx.level = 0.1;
+    if (sscanf(argv[2], "bistable:%255[^:]:%lf", species, &ctx.level) == 2) {
+        ctx.criterion = BISTABLE;
+    } else if (sscanf(argv[2], "pulse:%255[^:]:%lf", species, &ctx.level) >= 1) {
+        ctx.criterion = PULSE;
+    } else {
+        fprintf(stderr, "Error: cannot parse the criterion %s\n", argv[2]);
+        return 1;
+    }
+    ctx.species = circuit_species_index(m, species);
+    if (ctx.species < 0) {
+        fprintf(stderr, "Error: %s has no species %s\n", m->name, species);
+        return 1;
+    }
+
+    regime_map_options options = {0};
+    double lower[REGIME_MAP_MAX_DIM], upper[REGIME_MAP_MAX_DIM], t_end = DEFAULT_T_END;
+    int log_scale[REGIME_MAP_MAX_DIM], print_points = 0;
+    for (int a = 3; a < argc; a++) {
+        char name[256], scale[8] = "";
+        double lo, hi;
+        if (strncmp(argv[a], "coarse=", 7) == 0) {
+            options.coarse = atoi(argv[a] + 7);
+        } else if (strncmp(argv[a], "levels=", 7) == 0) {
+            options.max_level = atoi(argv[a] + 7);
+        } else if (strncmp(argv[a], "t_end=", 6) == 0) {
+            t_end = atof(argv[a] + 6);
+        } else if (strncmp(argv[a], "threads=", 8) == 0) {
+            options.threads = atoi(argv[a] + 8);
+        } else if (strcmp(argv[a], "points") == 0) {
+            print_points = 1;
+        } else if (sscanf(argv[a], "%255[^=]=%lf:%lf:%7s", name, &lo, &hi, scale) >= 3 &&
+                   ctx.n_axes < REGIME_MAP_MAX_DIM && circuit_param_index(m, name) >= 0) {
+            ctx.axes[ctx.n_axes] = circuit_param_index(m, name);
+            lower[ctx.n_axes] = lo;
+            upper[ctx.n_axes] = hi;
+            log_scale[ctx.n_axes] = strcmp(scale, "log") == 0;
+            ctx.n_axes++;
+        } else {
+            fprintf(stderr, "Error: cannot use %s\n", argv[a]);
+            return 1;
+        }
+    }
+    for (int k = 0; k < N_TIMES; k++) {
+        ctx.t_out[k] = t_end * k / (N_TIMES - 1);
+    }
+
+    // Per-thread solvers and buffers, parameters starting at the defaults
+    int threads = regime_map_threads(&options);
+    size_t per_thread = m->n_params + m->n_species + N_TIMES * (size_t)m->n_species;
+    ctx.solvers = calloc(threads, sizeof(circuit_solver *));
+    ctx.work = malloc(sizeof(realtype) * per_thread * threads);
+    circuit_solver_options so = {1e-6, 1e-10, 0, CIRCUIT_BDF};
+    for (int t = 0; ctx.solvers != NULL && ctx.work != NULL && t < threads; t++) {
+        ctx.solvers[t] = circuit_solver_create(m, &so);
+        if (ctx.solvers[t] == NULL) {
+            fprintf(stderr, "Error in circuit_solver_create\n");
+            return 1;
+        }
+        memcpy(ctx.work + t * per_thread, m->default_params, m->n_params * sizeof(realtype));
+    }
+
+    regime_map *map = regime_map_run(ctx.n_axes, lower, upper, log_scale, &options, classify, &ctx);
+    if (map == NULL) {
+        return 1;
+    }
+    printf("# %ld runs of the classifier, %.0f for a uniform grid of the same resolution (%.1fx fewer)\n",
+           regime_map_num_evaluations(map), regime_map_uniform_evaluations(map),
+           regime_map_uniform_evaluations(map) / regime_map_num_evaluations(map));
+    double lo[REGIME_MAP_MAX_DIM], hi[REGIME_MAP_MAX_DIM];
+    for (int k = 0; k < ctx.n_axes; k++) {
+        printf(k == 0 ? "%s" : ",%s", m->param_names[ctx.axes[k]]);
+    }
+    if (print_points) {
+        printf(",Class\n");
+        for (long p = 0; p < regime_map_num_evaluations(map); p++) {
+            int cls;
+            regime_map_point(map, p, lo, &cls);
+            for (int k = 0; k < ctx.n_axes; k++) {
+                printf(k == 0 ? "%.6g" : ",%.6g", lo[k]);
+            }
+            printf(",%d\n", cls);
+        }
+    } else {
+        for (int k = 0; k < ctx.n_axes; k++) {
+            printf(",%s_halfwidth", m->param_names[ctx.axes[k]]);
+        }
+        printf(",Classes\n");
+        for (long b = 0; b < regime_map_num_boundary(map); b++) {
+            unsigned classes;
+            regime_map_boundary_cell(map, b, lo, hi, &classes);
+            for (int k = 0; k < ctx.n_axes; k++) {
+                printf(k == 0 ? "%.6g" : ",%.6g", 0.5 * (lo[k] + hi[k]));
+            }
+            for (int k = 0; k < ctx.n_axes; k++) {
+                printf(",%.3g", 0.5 * (hi[k] - lo[k]));
+            }
+            printf(",0x%x\n", classes);
+        }
+    }
+    regime_map_free(map);
+    for (int t = 0; t < threads; t++) {
+        circuit_solver_free(ctx.solvers[t]);
+    }
+    free(ctx.solvers);
+    free(ctx.work);
+    return 0;
+}
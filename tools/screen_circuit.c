@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../common/circuits.h"
+#include "../common/circuit_solver.h"
+#include "../common/gsa.h"
+#include "../common/sobol.h"
+#include "../common/screen.h"
+
+// Two-stage screen of N candidates of a registry circuit (common/screen.c).
+// Candidates are Sobol points of the box given by NAME=lo:hi arguments,
+// sampled in log space; without any, every parameter except the input varies
+// over [default / 2, 2 default]. The CRITERION is KIND:SPECIES>=X or
+// KIND:SPECIES<=X with KIND final, peak, response (the time to half way
+// between the initial and final values) or pulse (peak over final, minus 1).
+// Prints the screen statistics and the hits as CSV.
+//
+// usage: screen_circuit circuit N CRITERION [NAME=lo:hi ...] [t_end=T] [margin=M] [audit=F] [threads=N] [seed=S]
+// e.g.   screen_circuit dichotomous_feedback 20000 'pulse:Output>=0.5' t_end=200
+
+#define DEFAULT_T_END 100.0
+#define MAX_FACTORS SOBOL_MAX_DIM
+
+static const char *const kind_names[] = {"final", "peak", "response", "pulse"};
+
+typedef struct {
+    gsa_output output;
+    int pulse;
+    double sign;                  // -1 for <= criteria, so a hit is always score >= threshold
+} criterion;
+
+// Function to score one trajectory
+static double score(const double *times, int n_times, const realtype *out, int n_species, void *ctx) {
+    const criterion *c = ctx;
+    if (c->pulse) {
+        gsa_output peak = {GSA_PEAK, c->output.species}, final = {GSA_FINAL, c->output.species};
+        double last = gsa_output_value(&final, times, n_times, out, n_species);
+        return gsa_output_value(&peak, times, n_times, out, n_species) / fmax(fabs(last), 1e-12) - 1;
+    }
+    return c->sign * gsa_output_value(&c->output, times, n_times, out, n_species);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        fprintf(stderr, "usage: %s circuit N CRITERION [NAME=lo:hi ...] [t_end=T] [margin=M] [audit=F] [threads=N] [seed=S]\n",
+                argv[0]);
+        return 1;
+    }
+    const circuit_model *m = circuit_lookup(argv[1]);
+    if (m == NULL) {
+        fprintf(stderr, "Error: unknown circuit %s\n", argv[1]);
+        return 1;
+    }
+    long n_candidates = atol(argv[2]);
+
+    criterion crit = {{0, 0}, 0, 1};
+    char kind[16], species[256], op[3];
+    double threshold;
+    int k_kind = -1;
+    if (sscanf(argv[3], "%15[^:]:%255[^<>=]%2[<>=]%lf", kind, species, op, &threshold) == 4) {
+        for (int k = 0; k < 4; k++) {
+            k_kind = strcmp(kind, kind_names[k]) == 0 ? k : k_kind;
+        }
+    }
+    crit.output.species = k_kind >= 0 ? circuit_species_index(m, species) : -1;
+    if (crit.output.species < 0 || (strcmp(op, ">=") != 0 && strcmp(op, "<=") != 0) ||
+        (k_kind == 3 && strcmp(op, ">=") != 0)) {
+        fprintf(stderr, "Error: cannot use the criterion %s\n", argv[3]);
+        return 1;
+    }
+    crit.output.kind = k_kind < 3 ? k_kind : GSA_PEAK;
+    crit.pulse = k_kind == 3;
+    if (strcmp(op, "<=") == 0) {
+        crit.sign = -1;
+        threshold = -threshold;
+    }
+
+    screen_options options = {0};
+    options.coarse.method = options.fine.method = CIRCUIT_BDF;
+    double t_end = DEFAULT_T_END;
+    int factors[MAX_FACTORS], n_factors = 0;
+    double lower[MAX_FACTORS], upper[MAX_FACTORS];
+    for (int a = 4; a < argc; a++) {
+        char name[256];
+        double lo, hi;
+        if (strncmp(argv[a], "t_end=", 6) == 0) {
+            t_end = atof(argv[a] + 6);
+        } else if (strncmp(argv[a], "margin=", 7) == 0) {
+            options.margin = atof(argv[a] + 7);
+        } else if (strncmp(argv[a], "audit=", 6) == 0) {
+            options.audit_fraction = atof(argv[a] + 6);
+        } else if (strncmp(argv[a], "threads=", 8) == 0) {
+            options.threads = atoi(argv[a] + 8);
+        } else if (strncmp(argv[a], "seed=", 5) == 0) {
+            options.seed = strtoull(argv[a] + 5, NULL, 10);
+        } else {
+            int j = sscanf(argv[a], "%255[^=]=%lf:%lf", name, &lo, &hi) == 3 ? circuit_param_index(m, name) : -1;
+            if (j < 0 || n_factors == MAX_FACTORS || lo <= 0 || hi < lo) {
+                fprintf(stderr, "Error: cannot use %s\n", argv[a]);
+                return 1;
+            }
+            factors[n_factors] = j;
+            lower[n_factors] = lo;
+            upper[n_factors] = hi;
+            n_factors++;
+        }
+    }
+    if (n_factors == 0) {
+        for (int j = 0; j < m->n_params && n_factors < MAX_FACTORS; j++) {
+            if (j != m->input_param && m->default_params[j] > 0) {
+                factors[n_factors] = j;
+                lower[n_factors] = m->default_params[j] / 2;
+                upper[n_factors] = m->default_params[j] * 2;
+                n_factors++;
+            }
+        }
+    }
+
+    // Candidates: the defaults with the factors at Sobol points of the box
+    realtype *params = malloc(sizeof(realtype) * m->n_params * (size_t)(n_candidates > 0 ? n_candidates : 1));
+    screen_candidate *candidates = malloc(sizeof(screen_candidate) * (size_t)(n_candidates > 0 ? n_candidates : 1));
+    if (n_candidates < 1 || params == NULL || candidates == NULL) {
+        fprintf(stderr, "Error: cannot allocate %ld candidates\n", n_candidates);
+        return 1;
+    }
+    sobol_state sobol;
+    sobol_init(&sobol, n_factors, options.seed);
+    double u[MAX_FACTORS];
+    for (long c = 0; c < n_candidates; c++) {
+        realtype *p = params + (size_t)c * m->n_params;
+        memcpy(p, m->default_params, m->n_params * sizeof(realtype));
+        sobol_next(&sobol, u);
+        for (int k = 0; k < n_factors; k++) {
+            p[factors[k]] = exp(log(lower[k]) + u[k] * (log(upper[k]) - log(lower[k])));
+        }
+    }
+
+    screen_problem problem = {m, NULL, n_candidates, params, 0, t_end, score, &crit, threshold};
+    screen_summary s;
+    if (screen_run(&problem, &options, candidates, &s) != 0) {
+        fprintf(stderr, "Error in screen_run\n");
+        return 1;
+    }
+    long rejected = s.n_candidates - s.n_refined;
+    printf("# %ld candidates: %ld passed the coarse pass, %ld hits, %ld false positives, %ld failed\n",
+           s.n_candidates, s.n_refined, s.n_hits, s.n_false_positives, s.n_failed);
+    printf("# audit: %ld of %ld rejected re-run, %ld false negatives (rate %.3g, 95%% upper %.3g, ~%.1f hits missed)\n",
+           s.n_audited, rejected, s.n_false_negatives, s.false_negative_rate, s.false_negative_upper,
+           s.expected_missed);
+    printf("# fine runs %.1f%% of candidates; rhs evaluations coarse %ld, fine %ld; %.3f s + %.3f s\n",
+           100.0 * (s.n_refined + s.n_audited) / s.n_candidates, s.coarse_rhs_evals, s.fine_rhs_evals,
+           s.coarse_seconds, s.fine_seconds);
+    printf("Candidate");
+    for (int k = 0; k < n_factors; k++) {
+        printf(",%s", m->param_names[factors[k]]);
+    }
+    printf(",CoarseScore,Score\n");
+    for (long c = 0; c < n_candidates; c++) {
+        if (candidates[c].refined && candidates[c].hit) {
+            printf("%ld", c);
+            for (int k = 0; k < n_factors; k++) {
+                printf(",%.6g", params[(size_t)c * m->n_params + factors[k]]);
+            }
+            printf(",%.6g,%.6g\n", crit.sign * candidates[c].coarse_score, crit.sign * candidates[c].fine_score);
+        }
+    }
+    free(params);
+    free(candidates);
+    return 0;
+}
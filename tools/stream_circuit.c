@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "../common/circuits.h"
+#include "../common/circuit_solver.h"
+#include "../common/input_stream.h"
+#include "../common/output_pipeline.h"
+
+// Drive a registry circuit with a long measured or generated input signal.
+// INPUT is a file or "-" for stdin with "time,value" lines (common/input_stream.h);
+// it is read in chunks and interpolated (hold, linear or spline), and the
+// circuit is integrated one smooth piece of the input at a time, restarting
+// CVODE at every discontinuity. Rows (Time, species..., the input) are
+// written every dt through the output pipeline to OUT ("-" for stdout, a
+// .bctr path for binary output), so memory stays bounded for any length.
+// The input drives the circuit's input parameter (X of ffl, I of
+// dichotomous_feedback) or the one named by input=NAME; other NAME=value
+// arguments set parameters or initial species values. Without t_end= the run
+// ends at the last input sample.
+//
+// usage: stream_circuit circuit INPUT OUT [interp=hold|linear|spline] [column=1] [input=NAME] [dt=1]
+//                       [t_start=T] [t_end=T] [chunk=65536] [rows=4096] [NAME=value ...] [rtol=] [atol=] [method=bdf|adams|auto]
+// e.g.   generate_trace | stream_circuit dichotomous_feedback - df_day.bctr interp=linear dt=60
+
+#define DEFAULT_ROWS 4096
+
+typedef struct {
+    const circuit_model *model;
+    circuit_solver *solver;
+    input_stream *input;
+    output_stream *stream;
+    const realtype *params;
+    realtype *t_out;
+    realtype *out;
+    double *row;
+    int rows;
+    long n_rows;
+    long n_pieces;
+    solver_stats total;
+} stream_job;
+
+// Function to evaluate the input for the solver
+static double input_value(double t, void *ctx) {
+    return input_stream_value(ctx, t);
+}
+
+// Function to add the statistics of one piece to the totals
+static void add_stats(solver_stats *total, const solver_stats *st) {
+    total->n_steps += st->n_steps;
+    total->n_rhs_evals += st->n_rhs_evals;
+    total->n_jac_evals += st->n_jac_evals;
+    total->n_lin_setups += st->n_lin_setups;
+    total->n_nonlin_iters += st->n_nonlin_iters;
+    total->n_nonlin_conv_fails += st->n_nonlin_conv_fails;
+    total->n_err_test_fails += st->n_err_test_fails;
+    total->n_method_switches += st->n_method_switches;
+    total->last_step = st->last_step;
+    total->setup_time += st->setup_time;
+    total->integrate_time += st->integrate_time;
+    total->output_time += st->output_time;
+}
+
+// Function to write the row of time t and state y
+static void write_row(stream_job *job, double t, const realtype *y) {
+    int n = job->model->n_species;
+    job->row[0] = t;
+    for (int i = 0; i < n; i++) {
+        job->row[1 + i] = y[i];
+    }
+    job->row[1 + n] = input_stream_value(job->input, t);
+    output_stream_write(job->stream, job->row);
+    job->n_rows++;
+}
+
+// Function to tell whether two times are the same up to a few ulps, so a
+// row time computed as t0 + k * dt is not taken for a separate output time
+// right next to a sample time (CVODE rejects a tout that close to its t0)
+static int same_time(double a, double b) {
+    return fabs(a - b) <= 4 * DBL_EPSILON * fmax(fabs(a), fabs(b));
+}
+
+// Function to integrate from t0 to t_end (INFINITY: to the end of the input) with rows every dt
+static int stream_run(stream_job *job, realtype *y, double t0, double t_end, double dt) {
+    int n = job->model->n_species;
+    double t = t0;
+    long k = 0;   // next row at t0 + k * dt
+    for (;;) {
+        double piece_end = input_stream_piece(job->input, t);
+        if (isnan(piece_end)) {
+            return -1;
+        }
+        if (same_time(t0 + k * dt, t)) {
+            write_row(job, t, y);
+            k++;
+        }
+        double target = isinf(t_end) && input_stream_eof(job->input) ? input_stream_last_time(job->input) : t_end;
+        if (t >= target) {
+            return 0;
+        }
+        double end = piece_end < target ? piece_end : target;
+
+        // The rows inside the piece, as many as fit; the next piece starts at the
+        // last one. A row on the piece end is written at the start of the next piece.
+        int m = 0;
+        job->t_out[m++] = t;
+        while (t0 + (k + m - 1) * dt < end && !same_time(t0 + (k + m - 1) * dt, end) && m < job->rows - 1) {
+            job->t_out[m] = t0 + (k + m - 1) * dt;
+            m++;
+        }
+        if (m == job->rows - 1 && t0 + (k + m - 1) * dt < end && !same_time(t0 + (k + m - 1) * dt, end)) {
+            end = t0 + (k + m - 1) * dt;
+        }
+        job->t_out[m++] = end;
+        int flag = circuit_solver_run(job->solver, job->params, y, job->t_out, m, job->out);
+        add_stats(&job->total, circuit_solver_stats(job->solver));
+        job->n_pieces++;
+        if (flag != 0) {
+            fprintf(stderr, "Error in CVode on [%g, %g]: %d\n", t, end, flag);
+            return -1;
+        }
+        for (int j = 1; j < m - 1; j++) {
+            write_row(job, job->t_out[j], job->out + (size_t)j * n);
+        }
+        k += m - 2;
+        memcpy(y, job->out + (size_t)(m - 1) * n, sizeof(realtype) * n);
+        t = end;
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        fprintf(stderr, "usage: %s circuit INPUT OUT [interp=hold|linear|spline] [column=1] [input=NAME] [dt=1] "
+                        "[t_start=T] [t_end=T] [chunk=65536] [rows=4096] [NAME=value ...] [rtol=] [atol=] [method=bdf|adams|auto]\n",
+                argv[0]);
+        return 1;
+    }
+    const circuit_model *m = circuit_lookup(argv[1]);
+    if (m == NULL) {
+        fprintf(stderr, "Error: unknown circuit %s\n", argv[1]);
+        return 1;
+    }
+    int n = m->n_species;
+    realtype *params = malloc(sizeof(realtype) * m->n_params);
+    realtype *y = malloc(sizeof(realtype) * n);
+    if (params == NULL || y == NULL) {
+        return 1;
+    }
+    memcpy(params, m->default_params, sizeof(realtype) * m->n_params);
+    memcpy(y, m->default_y0, sizeof(realtype) * n);
+    circuit_solver_options options = {0, 0, 0, CIRCUIT_BDF};
+    int interpolation = INPUT_LINEAR, column = 1, chunk = 0, rows = DEFAULT_ROWS, param = m->input_param;
+    double dt = 1.0, t_start = NAN, t_end = INFINITY;
+    for (int a = 4; a < argc; a++) {
+        char name[256];
+        double value;
+        if (strncmp(argv[a], "interp=", 7) == 0) {
+            interpolation = strcmp(argv[a] + 7, "hold") == 0     ? INPUT_HOLD
+                          : strcmp(argv[a] + 7, "spline") == 0 ? INPUT_SPLINE
+                                                               : INPUT_LINEAR;
+        } else if (strncmp(argv[a], "column=", 7) == 0) {
+            column = atoi(argv[a] + 7);
+        } else if (strncmp(argv[a], "input=", 6) == 0) {
+            param = circuit_param_index(m, argv[a] + 6);
+        } else if (strncmp(argv[a], "dt=", 3) == 0) {
+            dt = atof(argv[a] + 3);
+        } else if (strncmp(argv[a], "t_start=", 8) == 0) {
+            t_start = atof(argv[a] + 8);
+        } else if (strncmp(argv[a], "t_end=", 6) == 0) {
+            t_end = atof(argv[a] + 6);
+        } else if (strncmp(argv[a], "chunk=", 6) == 0) {
+            chunk = atoi(argv[a] + 6);
+        } else if (strncmp(argv[a], "rows=", 5) == 0) {
+            rows = atoi(argv[a] + 5);
+        } else if (strncmp(argv[a], "rtol=", 5) == 0) {
+            options.rtol = atof(argv[a] + 5);
+        } else if (strncmp(argv[a], "atol=", 5) == 0) {
+            options.atol = atof(argv[a] + 5);
+        } else if (strncmp(argv[a], "method=", 7) == 0) {
+            options.method = strcmp(argv[a] + 7, "adams") == 0 ? CIRCUIT_ADAMS
+                           : strcmp(argv[a] + 7, "auto") == 0  ? CIRCUIT_AUTO
+                                                               : CIRCUIT_BDF;
+        } else if (sscanf(argv[a], "%255[^=]=%lf", name, &value) == 2 && circuit_param_index(m, name) >= 0) {
+            params[circuit_param_index(m, name)] = value;
+        } else if (sscanf(argv[a], "%255[^=]=%lf", name, &value) == 2 && circuit_species_index(m, name) >= 0) {
+            y[circuit_species_index(m, name)] = value;
+        } else {
+            fprintf(stderr, "Error: cannot use %s\n", argv[a]);
+            return 1;
+        }
+    }
+    if (param < 0) {
+        fprintf(stderr, "Error: %s has no input parameter, name one with input=NAME\n", m->name);
+        return 1;
+    }
+    if (!(dt > 0) || rows < 3) {
+        fprintf(stderr, "Error: dt must be positive and rows at least 3\n");
+        return 1;
+    }
+
+    input_stream *input = input_stream_open(argv[2], column, interpolation, chunk);
+    circuit_solver *solver = circuit_solver_create(m, &options);
+    if (input == NULL || solver == NULL) {
+        return 1;
+    }
+    circuit_solver_set_input(solver, param, input_value, input);
+
+    // Rows: Time, the species and the input
+    const char **columns = malloc(sizeof(char *) * (n + 2));
+    columns[0] = "Time";
+    for (int i = 0; i < n; i++) {
+        columns[1 + i] = m->species_names[i];
+    }
+    columns[1 + n] = m->param_names[param];
+    output_config config = {.format = OUTPUT_AUTO, .n_columns = n + 2, .column_names = columns};
+    output_pipeline *out = output_pipeline_open(argv[3], &config);
+    if (out == NULL) {
+        fprintf(stderr, "Error: cannot open %s\n", argv[3]);
+        return 1;
+    }
+
+    stream_job job = {0};
+    job.model = m;
+    job.solver = solver;
+    job.input = input;
+    job.stream = output_stream_open(out, NULL);
+    job.params = params;
+    job.rows = rows;
+    job.t_out = malloc(sizeof(realtype) * rows);
+    job.out = malloc(sizeof(realtype) * rows * n);
+    job.row = malloc(sizeof(double) * (n + 2));
+    int flag = job.stream != NULL && job.t_out != NULL && job.out != NULL && job.row != NULL
+                   ? stream_run(&job, y, isnan(t_start) ? input_stream_first_time(input) : t_start, t_end, dt)
+                   : -1;
+    if (job.stream != NULL) {
+        output_stream_close(job.stream);
+    }
+    if (output_pipeline_close(out) != 0) {
+        flag = -1;
+    }
+    solver_stats_report("stream_circuit", &job.total, NULL);
+    fprintf(stderr, "%ld input samples (at most %ld held at once), %ld pieces, %ld rows, %ld steps\n",
+            input_stream_n_read(input), input_stream_peak_window(input), job.n_pieces, job.n_rows,
+            job.total.n_steps);
+
+    free(job.t_out);
+    free(job.out);
+    free(job.row);
+    free(columns);
+    circuit_solver_free(solver);
+    input_stream_close(input);
+    free(params);
+    free(y);
+    return flag != 0;
+}
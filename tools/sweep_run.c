@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <signal.h>
+#include "../common/circuits.h"
+#include "../common/circuit_solver.h"
+#include "../common/sweep.h"
+
+// Resumable, sharded sweeps of a registry circuit (common/sweep.c).
+//
+//   init DIR circuit DESIGN ...  create the sweep; DESIGN is a CSV file whose
+//                                header names parameters (one row per run, the
+//                                rest at the defaults) or NAME=lo:hi:n[:log]
+//                                grid axes (all combinations, last fastest)
+//   work DIR                     run shards until the sweep is complete; any
+//                                number of processes may work on one DIR, and
+//                                SIGTERM/SIGINT checkpoint and exit
+//   status DIR                   shards done, running and checkpointed
+//   merge DIR out.bctr           all rows, in design order, as one .bctr file
+//
+// usage: sweep_run init DIR circuit DESIGN... [shard=64] [t_end=100] [n_times=1001] [segment=0] [rtol=] [atol=] [method=bdf|adams|auto]
+//        sweep_run work DIR [threads=N] [checkpoint=SECONDS] [shards=N]
+//        sweep_run status DIR
+//        sweep_run merge DIR out.bctr
+// e.g.   sweep_run init df_sweep dichotomous_feedback I=0.1:10:50:log KDR=0.1:10:50:log t_end=500 n_times=5001 segment=500
+
+#define MAX_AXES 8
+
+static volatile sig_atomic_t stop_flag = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop_flag = 1;
+}
+
+// Function to read a design CSV (header of parameter names) into full parameter rows; returns the rows or NULL
+static realtype *read_design(const circuit_model *m, const char *path, long *n_rows) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Error: cannot open %s\n", path);
+        return NULL;
+    }
+    char line[8192];
+    int columns[256], n_columns = 0;
+    if (fgets(line, sizeof(line), fp) == NULL) {
+        fclose(fp);
+        return NULL;
+    }
+    for (char *name = strtok(line, ",\r\n"); name != NULL && n_columns < 256; name = strtok(NULL, ",\r\n")) {
+        columns[n_columns] = circuit_param_index(m, name);
+        if (columns[n_columns] < 0) {
+            fprintf(stderr, "Error: %s has no parameter %s\n", m->name, name);
+            fclose(fp);
+            return NULL;
+        }
+        n_columns++;
+    }
+    long capacity = 1024, n = 0;
+    realtype *design = malloc(sizeof(realtype) * m->n_params * capacity);
+    while (design != NULL && fgets(line, sizeof(line), fp) != NULL) {
+        if (line[0] == '\n' || line[0] == '\r' || line[0] == '\0') {
+            continue;
+        }
+        if (n == capacity) {
+            realtype *grown = realloc(design, sizeof(realtype) * m->n_params * (capacity *= 2));
+            if (grown == NULL) {
+                free(design);
+                design = NULL;
+                break;
+            }
+            design = grown;
+        }
+        realtype *row = design + (size_t)n * m->n_params;
+        memcpy(row, m->default_params, m->n_params * sizeof(realtype));
+        char *p = line;
+        for (int c = 0; c < n_columns; c++) {
+            char *end;
+            row[columns[c]] = strtod(p, &end);
+            if (end == p) {
+                fprintf(stderr, "Error: %s line %ld is incomplete\n", path, n + 2);
+                free(design);
+                fclose(fp);
+                return NULL;
+            }
+            p = end + (*end == ',');
+        }
+        n++;
+    }
+    fclose(fp);
+    *n_rows = n;
+    return design;
+}
+
+static int init(int argc, char **argv) {
+    const circuit_model *m = circuit_lookup(argv[3]);
+    if (m == NULL) {
+        fprintf(stderr, "Error: unknown circuit %s\n", argv[3]);
+        return 1;
+    }
+    sweep_config config = {m->name, 0, NULL, 0, 1001, 0.0, 100.0, 0, 0, CIRCUIT_BDF, 0};
+    const char *design_file = NULL;
+    int axes[MAX_AXES], counts[MAX_AXES], log_axis[MAX_AXES], n_axes = 0;
+    double lower[MAX_AXES], upper[MAX_AXES];
+    for (int a = 4; a < argc; a++) {
+        char name[256], scale[8] = "";
+        double lo, hi;
+        int count;
+        if (strncmp(argv[a], "shard=", 6) == 0) {
+            config.shard_rows = atol(argv[a] + 6);
+        } else if (strncmp(argv[a], "t_end=", 6) == 0) {
+            config.t_end = atof(argv[a] + 6);
+        } else if (strncmp(argv[a], "n_times=", 8) == 0) {
+            config.n_times = atoi(argv[a] + 8);
+        } else if (strncmp(argv[a], "segment=", 8) == 0) {
+            config.segment = atoi(argv[a] + 8);
+        } else if (strncmp(argv[a], "rtol=", 5) == 0) {
+            config.rtol = atof(argv[a] + 5);
+        } else if (strncmp(argv[a], "atol=", 5) == 0) {
+            config.atol = atof(argv[a] + 5);
+        } else if (strncmp(argv[a], "method=", 7) == 0) {
+            config.method = strcmp(argv[a] + 7, "adams") == 0 ? CIRCUIT_ADAMS
+                          : strcmp(argv[a] + 7, "auto") == 0  ? CIRCUIT_AUTO
+                                                              : CIRCUIT_BDF;
+        } else if (strchr(argv[a], '=') == NULL && design_file == NULL) {
+            design_file = argv[a];
+        } else if (sscanf(argv[a], "%255[^=]=%lf:%lf:%d:%7s", name, &lo, &hi, &count, scale) >= 4 &&
+                   n_axes < MAX_AXES && circuit_param_index(m, name) >= 0 && count >= 1 &&
+                   (strcmp(scale, "log") != 0 || lo > 0)) {
+            axes[n_axes] = circuit_param_index(m, name);
+            lower[n_axes] = lo;
+            upper[n_axes] = hi;
+            counts[n_axes] = count;
+            log_axis[n_axes] = strcmp(scale, "log") == 0;
+            n_axes++;
+        } else {
+            fprintf(stderr, "Error: cannot use %s\n", argv[a]);
+            return 1;
+        }
+    }
+
+    realtype *design;
+    if (design_file != NULL) {
+        design = read_design(m, design_file, &config.n_rows);
+    } else {
+        config.n_rows = 1;
+        for (int k = 0; k < n_axes; k++) {
+            config.n_rows *= counts[k];
+        }
+        design = malloc(sizeof(realtype) * m->n_params * config.n_rows);
+        for (long r = 0; design != NULL && r < config.n_rows; r++) {
+            realtype *row = design + (size_t)r * m->n_params;
+            memcpy(row, m->default_params, m->n_params * sizeof(realtype));
+            for (long k = n_axes - 1, rest = r; k >= 0; rest /= counts[k], k--) {
+                double u = counts[k] > 1 ? (double)(rest % counts[k]) / (counts[k] - 1) : 0;
+                row[axes[k]] = log_axis[k] ? exp(log(lower[k]) + u * (log(upper[k]) - log(lower[k])))
+                                           : lower[k] + u * (upper[k] - lower[k]);
+            }
+        }
+    }
+    if (design == NULL) {
+        return 1;
+    }
+    config.design = design;
+    int flag = sweep_create(argv[2], &config);
+    free(design);
+    if (flag != 0) {
+        return 1;
+    }
+    long shard_rows = config.shard_rows > 0 ? config.shard_rows : 64;
+    printf("%s: %ld rows of %s in %ld shards\n", argv[2], config.n_rows, m->name,
+           (config.n_rows + shard_rows - 1) / shard_rows);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3 || (strcmp(argv[1], "init") == 0 && argc < 4) || (strcmp(argv[1], "merge") == 0 && argc < 4)) {
+        fprintf(stderr, "usage: %s init DIR circuit DESIGN... [shard=64] [t_end=100] [n_times=1001] [segment=0] [rtol=] [atol=] [method=bdf|adams|auto]\n"
+                        "       %s work DIR [threads=N] [checkpoint=SECONDS] [shards=N]\n"
+                        "       %s status DIR\n"
+                        "       %s merge DIR out.bctr\n",
+                argv[0], argv[0], argv[0], argv[0]);
+        return 1;
+    }
+    if (strcmp(argv[1], "init") == 0) {
+        return init(argc, argv);
+    }
+    sweep *s = sweep_open(argv[2]);
+    if (s == NULL) {
+        return 1;
+    }
+    int flag = 0;
+    if (strcmp(argv[1], "work") == 0) {
+        sweep_work_options options = {0};
+        options.stop = &stop_flag;
+        for (int a = 3; a < argc; a++) {
+            if (strncmp(argv[a], "threads=", 8) == 0) {
+                options.threads = atoi(argv[a] + 8);
+            } else if (strncmp(argv[a], "checkpoint=", 11) == 0) {
+                options.checkpoint_seconds = atof(argv[a] + 11);
+            } else if (strncmp(argv[a], "shards=", 7) == 0) {
+                options.max_shards = atol(argv[a] + 7);
+            }
+        }
+        signal(SIGTERM, on_signal);
+        signal(SIGINT, on_signal);
+        long finished = sweep_work(s, &options);
+        flag = finished < 0;
+        printf("%ld shards finished%s\n", finished < 0 ? 0 : finished, stop_flag ? ", stopped at a checkpoint" : "");
+    } else if (strcmp(argv[1], "status") == 0) {
+        long n_shards, n_done, n_running, n_checkpointed;
+        sweep_status(s, &n_shards, &n_done, &n_running, &n_checkpointed);
+        printf("%s: %ld of %ld shards done, %ld running, %ld checkpointed\n", sweep_model(s)->name, n_done, n_shards,
+               n_running, n_checkpointed);
+    } else if (strcmp(argv[1], "merge") == 0) {
+        flag = sweep_merge(s, argv[3]) != 0;
+    } else {
+        fprintf(stderr, "Error: unknown command %s\n", argv[1]);
+        flag = 1;
+    }
+    sweep_close(s);
+    return flag;
+}
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../common/trajectory_io.h"
+
+// Convert a binary trajectory file (.bctr) back to the CSV layout of the
+// per-model drivers. Runs are written one after another; with more than one
+// run the first column is the run number and the parameters follow it.
+//
+// usage: traj2csv input.bctr [output.csv] [run]
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s input.bctr [output.csv] [run]\n", argv[0]);
+        return 1;
+    }
+
+    traj_reader *r = traj_reader_open(argv[1]);
+    if (r == NULL) {
+        return 1;
+    }
+    const struct traj_header *h = traj_reader_header(r);
+    uint64_t n_runs = traj_reader_num_runs(r);
+    uint64_t first = 0, last = n_runs;
+    if (argc > 3) {
+        first = strtoull(argv[3], NULL, 10);
+        if (first >= n_runs) {
+            fprintf(stderr, "Error: run %llu out of range (%llu runs)\n",
+                    (unsigned long long)first, (unsigned long long)n_runs);
+            traj_reader_close(r);
+            return 1;
+        }
+        last = first + 1;
+    }
+    int with_run_columns = last - first > 1;
+
+    FILE *fp = stdout;
+    if (argc > 2 && strcmp(argv[2], "-") != 0) {
+        fp = fopen(argv[2], "w");
+        if (fp == NULL) {
+            fprintf(stderr, "Error opening file!\n");
+            traj_reader_close(r);
+            return 1;
+        }
+    }
+
+    // Header line
+    if (with_run_columns) {
+        fprintf(fp, "Run,");
+        for (uint32_t k = 0; k < h->n_params; k++) {
+            fprintf(fp, "%s,", traj_reader_param_name(r, (int)k));
+        }
+    }
+    fprintf(fp, "Time");
+    for (uint32_t j = 0; j < h->n_species; j++) {
+        fprintf(fp, ",%s", traj_reader_species_name(r, (int)j));
+    }
+    fprintf(fp, "\n");
+
+    // Values, printed with enough digits to round-trip
+    const double *times = traj_reader_times(r);
+    for (uint64_t run = first; run < last; run++) {
+        const double *params = traj_reader_run_params(r, run);
+        for (uint64_t i = 0; i < h->n_times; i++) {
+            if (with_run_columns) {
+                fprintf(fp, "%llu,", (unsigned long long)run);
+                for (uint32_t k = 0; k < h->n_params; k++) {
+                    fprintf(fp, "%.17g,", params[k]);
+                }
+            }
+            fprintf(fp, "%.17g", times[i]);
+            for (uint32_t j = 0; j < h->n_species; j++) {
+                fprintf(fp, h->dtype == TRAJ_FLOAT64 ? ",%.17g" : ",%.9g", traj_reader_value(r, run, (int)j, i));
+            }
+            fprintf(fp, "\n");
+        }
+    }
+
+    if (fp != stdout) {
+        fclose(fp);
+    }
+    traj_reader_close(r);
+    return 0;
+}